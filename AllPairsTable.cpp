@@ -0,0 +1,292 @@
+#include "AllPairsTable.h"
+#include "Graph.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <queue>
+
+// Defined here as well, since std::min binds it by reference
+const int AllPairsTable::MAX_TRAVEL_TIME;
+
+AllPairsTable::AllPairsTable()
+    : numVertices(0), distanceData(nullptr), nextHopData(nullptr), fareData(nullptr),
+      travelTimeData(nullptr), lineChangeData(nullptr), repairedRows(0) {}
+
+void AllPairsTable::useOwnStorage() {
+    distanceData = distances.data();
+    nextHopData = nextHops.data();
+    fareData = fares.data();
+    travelTimeData = travelTimes.data();
+    lineChangeData = lineChanges.data();
+    owner.reset();
+}
+
+void AllPairsTable::computeRow(const Graph& graph, int dest) {
+    const int INF = std::numeric_limits<int>::max();
+    BasicQueryContext<BucketQueue>& context = BasicQueryContext<BucketQueue>::local();
+    graph.shortestPathTree(dest, context);
+    
+    // Stations on each route, found by memoised walks up the tree
+    thread_local std::vector<int> stations;
+    thread_local std::vector<int> pending;
+    stations.assign(numVertices, 0);
+    stations[dest] = 1;
+    
+    for (int src = 0; src < numVertices; src++) {
+        size_t i = index(src, dest);
+        int distance = context.getDistance(src);
+        if (distance == INF) {
+            distances[i] = INF;
+            nextHops[i] = 0;
+            fares[i] = 0;
+            travelTimes[i] = 0;
+            lineChanges[i] = 0;
+            continue;
+        }
+        for (int v = src; stations[v] == 0; v = context.getParent(v)) {
+            pending.push_back(v);
+        }
+        while (!pending.empty()) {
+            int v = pending.back();
+            pending.pop_back();
+            stations[v] = stations[context.getParent(v)] + 1;
+        }
+        
+        int changes = graph.estimateLineChanges(stations[src]);
+        distances[i] = distance;
+        nextHops[i] = static_cast<unsigned short>(src == dest ? dest : context.getParent(src));
+        fares[i] = static_cast<unsigned char>(graph.calculateFare(distance));
+        travelTimes[i] = static_cast<unsigned short>(
+            std::min(graph.estimateTravelTime(distance, changes), MAX_TRAVEL_TIME));
+        lineChanges[i] = static_cast<unsigned short>(changes);
+    }
+}
+
+void AllPairsTable::repairRow(const Graph& graph, int dest, int a, int b, int newDistance, bool used) {
+    const int INF = std::numeric_limits<int>::max();
+    typedef std::pair<int, int> Entry; // (distance, station)
+    int* rowDistances = &distances[index(0, dest)];
+    unsigned short* rowNextHops = &nextHops[index(0, dest)];
+    
+    thread_local std::vector<int> stations; // Stations on the route, 0 if not known yet
+    thread_local std::vector<int> known;    // Entries of stations to clear afterwards
+    thread_local std::vector<int> region;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    stations.resize(numVertices, 0);
+    
+    stations[dest] = 1;
+    known.push_back(dest);
+    
+    // Stations on the unchanged route from v, walking its next hops
+    auto countStations = [&](int v) {
+        int u = v;
+        int steps = 0;
+        while (stations[u] == 0) {
+            u = rowNextHops[u];
+            steps++;
+        }
+        int count = stations[u] + steps;
+        for (int w = v; w != u; w = rowNextHops[w]) {
+            stations[w] = count--;
+            known.push_back(w);
+        }
+        return stations[v];
+    };
+    
+    // Lower the distance of v through neighbour u
+    auto relax = [&](int v, int u, int distance) {
+        if (distance < rowDistances[v]) {
+            rowDistances[v] = distance;
+            rowNextHops[v] = static_cast<unsigned short>(u);
+            queue.push(Entry(distance, v));
+        }
+    };
+    
+    // The subtree below a connection the tree used loses its routes; it is
+    // found by following tree edges down from the end nearer the leaves
+    region.clear();
+    if (used) {
+        int child = a != dest && rowDistances[a] != INF && rowNextHops[a] == b ? a : b;
+        rowDistances[child] = INF;
+        region.push_back(child);
+        for (size_t i = 0; i < region.size(); i++) {
+            int u = region[i];
+            for (int e = graph.edgeBegin(u); e < graph.edgeEnd(u); e++) {
+                int v = graph.edgeTarget(e);
+                if (v != dest && rowDistances[v] != INF && rowNextHops[v] == u) {
+                    rowDistances[v] = INF;
+                    region.push_back(v);
+                }
+            }
+        }
+        
+        // Reattach it from the intact rest of the tree
+        for (int v : region) {
+            for (int e = graph.edgeBegin(v); e < graph.edgeEnd(v); e++) {
+                int u = graph.edgeTarget(e);
+                if (rowDistances[u] != INF) {
+                    relax(v, u, rowDistances[u] + graph.edgeDistance(e));
+                }
+            }
+        }
+    }
+    
+    // A shorter or reopened connection may shorten routes through either end
+    if (newDistance != INF) {
+        if (rowDistances[b] != INF) {
+            relax(a, b, rowDistances[b] + newDistance);
+        }
+        if (rowDistances[a] != INF) {
+            relax(b, a, rowDistances[a] + newDistance);
+        }
+    }
+    
+    // Dijkstra over the stations whose routes changed. Parents settle
+    // first, so each station's count builds on its parent's.
+    while (!queue.empty()) {
+        Entry current = queue.top();
+        queue.pop();
+        int u = current.second;
+        if (current.first > rowDistances[u]) {
+            continue;
+        }
+        
+        stations[u] = countStations(rowNextHops[u]) + 1;
+        known.push_back(u);
+        size_t i = index(u, dest);
+        int changes = graph.estimateLineChanges(stations[u]);
+        fares[i] = static_cast<unsigned char>(graph.calculateFare(current.first));
+        travelTimes[i] = static_cast<unsigned short>(
+            std::min(graph.estimateTravelTime(current.first, changes), MAX_TRAVEL_TIME));
+        lineChanges[i] = static_cast<unsigned short>(changes);
+        
+        for (int e = graph.edgeBegin(u); e < graph.edgeEnd(u); e++) {
+            relax(graph.edgeTarget(e), u, current.first + graph.edgeDistance(e));
+        }
+    }
+    
+    // Whatever the search did not reach is now cut off
+    for (int v : region) {
+        if (rowDistances[v] == INF) {
+            size_t i = index(v, dest);
+            nextHops[i] = 0;
+            fares[i] = 0;
+            travelTimes[i] = 0;
+            lineChanges[i] = 0;
+        }
+    }
+    
+    for (int v : known) {
+        stations[v] = 0;
+    }
+    known.clear();
+}
+
+void AllPairsTable::build(const Graph& graph, ThreadPool& pool) {
+    if (graph.getNumVertices() > std::numeric_limits<unsigned short>::max()) {
+        throw std::length_error("Network too large for an all-pairs table");
+    }
+    numVertices = graph.getNumVertices();
+    size_t cells = static_cast<size_t>(numVertices) * numVertices;
+    distances.assign(cells, std::numeric_limits<int>::max());
+    nextHops.assign(cells, 0);
+    fares.assign(cells, 0);
+    travelTimes.assign(cells, 0);
+    lineChanges.assign(cells, 0);
+    useOwnStorage();
+    repairedRows = 0;
+    
+    // The graph is undirected, so the tree rooted at dest gives every src
+    // its distance to dest, and src's parent in that tree is its next hop
+    pool.parallelFor(numVertices, [&](int dest) {
+        computeRow(graph, dest);
+    });
+}
+
+int AllPairsTable::repair(const Graph& graph, const AllPairsTable& previous, int a, int b,
+                          int oldDistance, int newDistance, ThreadPool* pool) {
+    const int INF = std::numeric_limits<int>::max();
+    if (graph.getNumVertices() != previous.numVertices) {
+        throw std::invalid_argument("All-pairs repair needs the same stations");
+    }
+    numVertices = previous.numVertices;
+    size_t cells = static_cast<size_t>(numVertices) * numVertices;
+    distances.assign(previous.distanceData, previous.distanceData + cells);
+    nextHops.assign(previous.nextHopData, previous.nextHopData + cells);
+    fares.assign(previous.fareData, previous.fareData + cells);
+    travelTimes.assign(previous.travelTimeData, previous.travelTimeData + cells);
+    lineChanges.assign(previous.lineChangeData, previous.lineChangeData + cells);
+    useOwnStorage();
+    
+    // A tree that did not use the connection stays shortest when it gets
+    // longer or closes; one that gains no strictly shorter route stays
+    // shortest when it gets shorter or reopens
+    std::vector<int> affected;
+    for (int dest = 0; dest < numVertices; dest++) {
+        int fromA = previous.getDistance(a, dest);
+        int fromB = previous.getDistance(b, dest);
+        bool used = oldDistance != INF &&
+                    ((a != dest && fromA != INF && previous.getNextHop(a, dest) == b) ||
+                     (b != dest && fromB != INF && previous.getNextHop(b, dest) == a));
+        bool improved = newDistance != INF &&
+                        ((fromB != INF && (fromA == INF || fromB + newDistance < fromA)) ||
+                         (fromA != INF && (fromB == INF || fromA + newDistance < fromB)));
+        if (used || improved) {
+            affected.push_back(dest);
+        }
+    }
+    
+    auto repairAffected = [&](int i) {
+        int dest = affected[i];
+        bool used = oldDistance != INF &&
+                    ((a != dest && previous.getDistance(a, dest) != INF && previous.getNextHop(a, dest) == b) ||
+                     (b != dest && previous.getDistance(b, dest) != INF && previous.getNextHop(b, dest) == a));
+        repairRow(graph, dest, a, b, newDistance, used);
+    };
+    if (pool) {
+        pool->parallelFor(static_cast<int>(affected.size()), repairAffected);
+    } else {
+        for (int i = 0; i < static_cast<int>(affected.size()); i++) {
+            repairAffected(i);
+        }
+    }
+    repairedRows = static_cast<int>(affected.size());
+    return repairedRows;
+}
+
+void AllPairsTable::attach(int numVertices, const int* distances, const unsigned short* nextHops,
+                           const unsigned char* fares, const unsigned short* travelTimes,
+                           const unsigned short* lineChanges, std::shared_ptr<const void> owner) {
+    this->numVertices = numVertices;
+    this->distances.clear();
+    this->nextHops.clear();
+    this->fares.clear();
+    this->travelTimes.clear();
+    this->lineChanges.clear();
+    distanceData = distances;
+    nextHopData = nextHops;
+    fareData = fares;
+    travelTimeData = travelTimes;
+    lineChangeData = lineChanges;
+    this->owner = owner;
+}
+
+void AllPairsTable::buildPath(int src, int dest, std::vector<int>& path) const {
+    path.clear();
+    if (getDistance(src, dest) == std::numeric_limits<int>::max()) {
+        return;
+    }
+    
+    const unsigned short* row = nextHopData + index(0, dest);
+    path.push_back(src);
+    for (int v = src; v != dest; v = row[v]) {
+        path.push_back(row[v]);
+    }
+}
+
+size_t AllPairsTable::memoryBytes() const {
+    return distances.size() * sizeof(int) + nextHops.size() * sizeof(unsigned short) +
+           fares.size() * sizeof(unsigned char) + travelTimes.size() * sizeof(unsigned short) +
+           lineChanges.size() * sizeof(unsigned short);
+}
@@ -0,0 +1,109 @@
+#ifndef ALL_PAIRS_TABLE_H
+#define ALL_PAIRS_TABLE_H
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+class Graph;
+class ThreadPool;
+
+// Dense precomputed answers for every station pair of a small network.
+// Entries are stored row-per-destination: entry (src, dest) lives at
+// dest * V + src, so walking a route's next hops reads one contiguous row.
+// A few hundred stations fit in L2 cache and every query is O(path length).
+class AllPairsTable {
+private:
+    int numVertices;
+    std::vector<int> distances;              // INT_MAX if unreachable
+    std::vector<unsigned short> nextHops;    // Next station from src towards dest
+    std::vector<unsigned char> fares;        // Graph::calculateFare of the distance
+    std::vector<unsigned short> travelTimes; // Graph::estimateTravelTime in minutes, clamped
+    std::vector<unsigned short> lineChanges; // Graph::estimateLineChanges of the route
+
+    // Where the getters read from: the vectors above after build(), or
+    // external storage (a mapped snapshot) kept alive by owner after attach()
+    const int* distanceData;
+    const unsigned short* nextHopData;
+    const unsigned char* fareData;
+    const unsigned short* travelTimeData;
+    const unsigned short* lineChangeData;
+    std::shared_ptr<const void> owner;
+
+    int repairedRows; // Destinations repaired by repair() (0 after build)
+
+    // In size_t: V * V overflows int long before the 65535-station limit
+    size_t index(int src, int dest) const {
+        return static_cast<size_t>(dest) * numVertices + src;
+    }
+    
+    // Point the getters at the owned vectors
+    void useOwnStorage();
+    
+    // Fill the row of dest from its shortest-path tree
+    void computeRow(const Graph& graph, int dest);
+    
+    // Update the row of dest in place after the connection between a and
+    // b changed to newDistance, re-searching only the stations whose route
+    // changes. used tells whether the row's old tree ran over the connection.
+    void repairRow(const Graph& graph, int dest, int a, int b, int newDistance, bool used);
+
+public:
+    // Networks above this size fall back to on-demand search
+    static const int DEFAULT_MAX_STATIONS = 1024;
+    
+    // Longest travel time stored; longer routes read as this value
+    static const int MAX_TRAVEL_TIME = 0xffff;
+    
+    // Smallest network whose repairs are worth starting threads for
+    static const int PARALLEL_REPAIR_MIN_STATIONS = 256;
+    
+    AllPairsTable();
+    
+    // Fill the tables with one shortest-path tree per station, run in
+    // parallel on the pool. The graph must be frozen.
+    void build(const Graph& graph, ThreadPool& pool);
+    
+    // Fill the table from previous, a table of the same network before the
+    // connection between a and b changed from oldDistance to newDistance
+    // (INT_MAX when closed), and the graph after the change (frozen).
+    // Only destinations whose shortest-path tree may differ are repaired:
+    // those whose tree used the connection, and those it now gives a
+    // strictly shorter route. Within such a row only the subtree that hung
+    // below the connection and the stations whose routes get shorter are
+    // searched again. Returns the number of rows repaired.
+    // Rows are repaired on pool, or on the calling thread if it is null.
+    int repair(const Graph& graph, const AllPairsTable& previous, int a, int b,
+               int oldDistance, int newDistance, ThreadPool* pool);
+    
+    // Serve the table from V*V arrays laid out as build() writes them,
+    // without copying. owner keeps the storage alive as long as the table.
+    void attach(int numVertices, const int* distances, const unsigned short* nextHops,
+                const unsigned char* fares, const unsigned short* travelTimes,
+                const unsigned short* lineChanges, std::shared_ptr<const void> owner);
+    
+    int getNumVertices() const { return numVertices; }
+    int getDistance(int src, int dest) const { return distanceData[index(src, dest)]; }
+    int getNextHop(int src, int dest) const { return nextHopData[index(src, dest)]; }
+    int getFare(int src, int dest) const { return fareData[index(src, dest)]; }
+    int getTravelTime(int src, int dest) const { return travelTimeData[index(src, dest)]; }
+    int getLineChanges(int src, int dest) const { return lineChangeData[index(src, dest)]; }
+    
+    // Raw arrays in dest * V + src order (for snapshots)
+    const int* getDistanceData() const { return distanceData; }
+    const unsigned short* getNextHopData() const { return nextHopData; }
+    const unsigned char* getFareData() const { return fareData; }
+    const unsigned short* getTravelTimeData() const { return travelTimeData; }
+    const unsigned short* getLineChangeData() const { return lineChangeData; }
+    
+    // Write the station sequence from src to dest into path (empty if unreachable)
+    void buildPath(int src, int dest, std::vector<int>& path) const;
+    
+    // Bytes held by the tables (zero when attached to external storage)
+    size_t memoryBytes() const;
+    
+    // Rows repaired by the repair() that produced this table
+    int getRepairedRows() const { return repairedRows; }
+};
+
+#endif // ALL_PAIRS_TABLE_H
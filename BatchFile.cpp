@@ -0,0 +1,198 @@
+#include "BatchFile.h"
+#include "CsvScanner.h"
+#include "NetworkSnapshot.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+// Query file bytes per block: large enough that a block outweighs the
+// cost of handing it to a worker
+static const size_t BLOCK_BYTES = 256u << 10;
+
+// Blocks in flight per worker; their output is held until written
+static const int BLOCKS_PER_WORKER = 4;
+
+// One block of the query file and what it produced
+struct BatchBlock {
+    const char* begin;
+    const char* end;
+    std::string output;
+    size_t queries;
+    size_t unreachable;
+    size_t rejected;
+    std::vector<LoadError> errors; // Line numbers within the block until merged
+};
+
+// BatchFileResult implementation
+BatchFileResult::BatchFileResult() : queries(0), unreachable(0), rejected(0), seconds(0.0) {}
+
+bool BatchFileResult::ok() const {
+    return errors.empty();
+}
+
+double BatchFileResult::queriesPerSecond() const {
+    return seconds > 0.0 ? queries / seconds : 0.0;
+}
+
+// Append a CSV field, quoting it if it contains a comma
+static void appendField(std::string& text, std::string_view field) {
+    if (field.find(',') != std::string_view::npos) {
+        text += '"';
+        text += field;
+        text += '"';
+    } else {
+        text += field;
+    }
+}
+
+static void appendNumber(std::string& text, int value) {
+    char digits[16];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+    text.append(digits, result.ptr - digits);
+}
+
+// Answer every query line of a block into its output
+static void runBlock(const Graph& graph, const std::string& path, BatchBlock& block) {
+    std::vector<std::string_view> fields;
+    const char* error;
+    thread_local Route route;
+    CsvScanner scanner(block.begin, block.end);
+
+    while (scanner.next(fields, error)) {
+        int src = -1;
+        int dest = -1;
+        std::string message;
+        if (error) {
+            message = error;
+        } else if (fields.size() < 2) {
+            message = "expected from,to";
+        } else if ((src = graph.getStationIndex(fields[0])) == -1) {
+            message = "unknown station '" + std::string(fields[0]) + "'";
+        } else if ((dest = graph.getStationIndex(fields[1])) == -1) {
+            message = "unknown station '" + std::string(fields[1]) + "'";
+        }
+        if (!message.empty()) {
+            block.rejected++;
+            if (block.errors.size() < BatchFileResult::MAX_REPORTED_ERRORS) {
+                block.errors.push_back({ path, scanner.getLine(), message });
+            }
+            continue;
+        }
+
+        std::string& out = block.output;
+        appendField(out, graph.getStationName(src));
+        out += ',';
+        appendField(out, graph.getStationName(dest));
+        block.queries++;
+        if (!graph.planRoute(src, dest, route) || route.path.empty()) {
+            block.unreachable++;
+            out += ",-1,0,0,0,\n";
+            continue;
+        }
+
+        out += ',';
+        appendNumber(out, route.distance);
+        out += ',';
+        appendNumber(out, route.fare);
+        out += ',';
+        appendNumber(out, route.travelTime);
+        out += ',';
+        appendNumber(out, route.lineChanges);
+        out += ',';
+
+        // Quote the whole path if any of its names needs it
+        size_t pathStart = out.size();
+        bool quote = false;
+        for (size_t i = 0; i < route.path.size(); i++) {
+            std::string_view name = graph.getStationName(route.path[i]);
+            quote = quote || name.find(',') != std::string_view::npos;
+            if (i > 0) {
+                out += ';';
+            }
+            out += name;
+        }
+        if (quote) {
+            out.insert(pathStart, 1, '"');
+            out += '"';
+        }
+        out += '\n';
+    }
+}
+
+BatchFileResult runBatchFile(const Graph& graph, const std::string& queriesPath, const std::string& outputPath,
+                             ThreadPool& pool) {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    BatchFileResult result;
+
+    MappedFile input;
+    std::string error;
+    if (!input.open(queriesPath, error)) {
+        result.errors.push_back({ queriesPath, 0, "cannot read file" });
+        return result;
+    }
+    FILE* output = std::fopen(outputPath.c_str(), "wb");
+    if (!output) {
+        result.errors.push_back({ outputPath, 0, "cannot write file" });
+        return result;
+    }
+    std::fputs("from,to,distance,fare,time,line_changes,path\n", output);
+
+    // Skip the header line
+    const char* data = input.getData();
+    const char* end = data + input.getSize();
+    const char* position = data;
+    if (position < end) {
+        const char* newline = static_cast<const char*>(std::memchr(position, '\n', end - position));
+        position = newline ? newline + 1 : end;
+    }
+    int linesBefore = 1;
+
+    std::vector<BatchBlock> blocks(pool.size() * BLOCKS_PER_WORKER);
+    bool written = true;
+    while (position < end) {
+        // Cut the next blocks at line ends
+        int numBlocks = 0;
+        while (numBlocks < static_cast<int>(blocks.size()) && position < end) {
+            BatchBlock& block = blocks[numBlocks++];
+            const char* blockEnd = end;
+            if (static_cast<size_t>(end - position) > BLOCK_BYTES) {
+                const char* newline = static_cast<const char*>(
+                    std::memchr(position + BLOCK_BYTES, '\n', end - position - BLOCK_BYTES));
+                blockEnd = newline ? newline + 1 : end;
+            }
+            block.begin = position;
+            block.end = blockEnd;
+            block.output.clear();
+            block.queries = block.unreachable = block.rejected = 0;
+            block.errors.clear();
+            position = blockEnd;
+        }
+
+        pool.parallelFor(numBlocks, [&](int b) { runBlock(graph, queriesPath, blocks[b]); });
+
+        for (int b = 0; b < numBlocks; b++) {
+            BatchBlock& block = blocks[b];
+            written = written && std::fwrite(block.output.data(), 1, block.output.size(), output) ==
+                                 block.output.size();
+            result.queries += block.queries;
+            result.unreachable += block.unreachable;
+            result.rejected += block.rejected;
+            for (LoadError& blockError : block.errors) {
+                if (result.errors.size() < BatchFileResult::MAX_REPORTED_ERRORS) {
+                    blockError.line += linesBefore;
+                    result.errors.push_back(blockError);
+                }
+            }
+            linesBefore += static_cast<int>(std::count(block.begin, block.end, '\n'));
+        }
+    }
+
+    if (std::fclose(output) != 0 || !written) {
+        result.errors.push_back({ outputPath, 0, "cannot write file" });
+    }
+    result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    return result;
+}
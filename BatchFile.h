@@ -0,0 +1,45 @@
+#ifndef BATCH_FILE_H
+#define BATCH_FILE_H
+
+#include <string>
+#include <vector>
+#include "Graph.h"
+#include "NetworkLoader.h"
+#include "ThreadPool.h"
+
+// Outcome of runBatchFile
+struct BatchFileResult {
+    size_t queries;              // Lines answered (including unreachable pairs)
+    size_t unreachable;
+    size_t rejected;             // Lines skipped as invalid
+    std::vector<LoadError> errors; // The first MAX_REPORTED_ERRORS problems, in file order
+    double seconds;
+
+    static const size_t MAX_REPORTED_ERRORS = 100;
+
+    BatchFileResult();
+
+    // Check if every line was answered and the output written
+    bool ok() const;
+
+    double queriesPerSecond() const;
+};
+
+// Plan a route for every origin-destination pair of a query file and write
+// one result line per pair:
+//   query file:   from,to                e.g.  Rajiv Chowk,Saket
+//   output file:  from,to,distance,fare,time,line_changes,path
+//                 e.g.  Rajiv Chowk,Saket,13,40,20,0,Rajiv Chowk;Central Secretariat;Saket
+// Both files start with a header line. Fields may be quoted as in network
+// files; output names containing commas are quoted. Unreachable pairs get
+// distance -1, zero fare, time and changes and an empty path. Lines with
+// unknown stations or missing fields are skipped and reported.
+//
+// Routes are those of Graph::planRoute. The query file is mapped and cut
+// into blocks at line boundaries; the pool's workers each format whole
+// blocks into their own buffers, which are written in file order, so the
+// output matches the input order and nothing is flushed per query.
+BatchFileResult runBatchFile(const Graph& graph, const std::string& queriesPath, const std::string& outputPath,
+                             ThreadPool& pool);
+
+#endif // BATCH_FILE_H
@@ -0,0 +1,114 @@
+#include "BatchQuery.h"
+#include <algorithm>
+#include <limits>
+
+void BatchResult::resize(size_t count) {
+    distances.resize(count);
+    fares.resize(count);
+    travelTimes.resize(count);
+}
+
+size_t BatchResult::size() const {
+    return distances.size();
+}
+
+// Fill entry i from a finished shortest-path tree rooted at the source
+static void recordFromTree(const Graph& graph, const SearchState& tree, int dest, size_t i,
+                           BatchResult& result) {
+    int distance = tree.getDistance(dest);
+    if (distance == std::numeric_limits<int>::max()) {
+        result.distances[i] = -1;
+        result.fares[i] = 0;
+        result.travelTimes[i] = 0;
+        return;
+    }
+    
+    int stations = 1;
+    for (int v = dest; tree.getParent(v) != -1; v = tree.getParent(v)) {
+        stations++;
+    }
+    result.distances[i] = distance;
+    result.fares[i] = static_cast<unsigned char>(graph.calculateFare(distance));
+    result.travelTimes[i] = static_cast<unsigned short>(std::min(
+        graph.estimateTravelTime(distance, graph.estimateLineChanges(stations)), AllPairsTable::MAX_TRAVEL_TIME));
+}
+
+// Fill entry i straight from the all-pairs table
+static void recordFromTable(const AllPairsTable& table, int src, int dest, size_t i, BatchResult& result) {
+    int distance = table.getDistance(src, dest);
+    bool reachable = distance != std::numeric_limits<int>::max();
+    result.distances[i] = reachable ? distance : -1;
+    result.fares[i] = static_cast<unsigned char>(reachable ? table.getFare(src, dest) : 0);
+    result.travelTimes[i] = static_cast<unsigned short>(reachable ? table.getTravelTime(src, dest) : 0);
+}
+
+void batchRoutes(const Graph& graph, const std::vector<std::pair<int, int>>& pairs,
+                 ThreadPool& pool, BatchResult& result) {
+    result.resize(pairs.size());
+    
+    // Query indices ordered by source; groupStarts marks where each source begins
+    std::vector<int> order(pairs.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = static_cast<int>(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return pairs[a].first < pairs[b].first;
+    });
+    std::vector<int> groupStarts;
+    for (size_t i = 0; i < order.size(); i++) {
+        if (i == 0 || pairs[order[i]].first != pairs[order[i - 1]].first) {
+            groupStarts.push_back(static_cast<int>(i));
+        }
+    }
+    groupStarts.push_back(static_cast<int>(order.size()));
+    
+    const AllPairsTable* table = graph.getAllPairsTable();
+    pool.parallelFor(static_cast<int>(groupStarts.size()) - 1, [&](int group) {
+        int begin = groupStarts[group];
+        int end = groupStarts[group + 1];
+        int src = pairs[order[begin]].first;
+        
+        if (table) {
+            for (int k = begin; k < end; k++) {
+                recordFromTable(*table, src, pairs[order[k]].second, order[k], result);
+            }
+            return;
+        }
+        
+        // A lone destination can stop early; otherwise grow the full tree once
+        BasicQueryContext<BucketQueue>& context = BasicQueryContext<BucketQueue>::local();
+        if (end - begin == 1) {
+            thread_local std::vector<int> path;
+            graph.dijkstra(src, pairs[order[begin]].second, context, path);
+        } else {
+            graph.shortestPathTree(src, context);
+        }
+        for (int k = begin; k < end; k++) {
+            recordFromTree(graph, context, pairs[order[k]].second, order[k], result);
+        }
+    });
+}
+
+void batchRoutes(const Graph& graph, const std::vector<int>& sources, const std::vector<int>& targets,
+                 ThreadPool& pool, BatchResult& result) {
+    result.resize(sources.size() * targets.size());
+    
+    const AllPairsTable* table = graph.getAllPairsTable();
+    pool.parallelFor(static_cast<int>(sources.size()), [&](int row) {
+        int src = sources[row];
+        size_t base = static_cast<size_t>(row) * targets.size();
+        
+        if (table) {
+            for (size_t j = 0; j < targets.size(); j++) {
+                recordFromTable(*table, src, targets[j], base + j, result);
+            }
+            return;
+        }
+        
+        BasicQueryContext<BucketQueue>& context = BasicQueryContext<BucketQueue>::local();
+        graph.shortestPathTree(src, context);
+        for (size_t j = 0; j < targets.size(); j++) {
+            recordFromTree(graph, context, targets[j], base + j, result);
+        }
+    });
+}
@@ -0,0 +1,34 @@
+#ifndef BATCH_QUERY_H
+#define BATCH_QUERY_H
+
+#include <vector>
+#include <utility>
+#include "Graph.h"
+#include "ThreadPool.h"
+
+// Columnar answers to a batch of route queries: entry i of every column
+// belongs to query i. Unreachable pairs have distance -1 and zero fare/time.
+struct BatchResult {
+    std::vector<int> distances;              // km
+    std::vector<unsigned char> fares;        // Rs, from Graph::calculateFare
+    std::vector<unsigned short> travelTimes; // Minutes, from Graph::estimateTravelTime (at most 65535)
+
+    // Make room for count queries
+    void resize(size_t count);
+    
+    // Number of queries answered
+    size_t size() const;
+};
+
+// Answer many origin-destination pairs at once. Pairs are grouped by
+// source so each shortest-path tree serves every destination of that
+// source, and the groups run on the pool's work-stealing workers.
+void batchRoutes(const Graph& graph, const std::vector<std::pair<int, int>>& pairs,
+                 ThreadPool& pool, BatchResult& result);
+
+// Answer every sources x targets combination. Entry (i, j) is at
+// i * targets.size() + j.
+void batchRoutes(const Graph& graph, const std::vector<int>& sources, const std::vector<int>& targets,
+                 ThreadPool& pool, BatchResult& result);
+
+#endif // BATCH_QUERY_H
@@ -0,0 +1,2363 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+#include <algorithm>
+#include <limits>
+#include <cstdio>
+#include <queue>
+#include <unordered_map>
+#include <set>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <new>
+#include <ostream>
+#include <sstream>
+#include "Graph.h"
+#include "DelhiNetwork.h"
+#include "SyntheticNetwork.h"
+#include "ContractionHierarchy.h"
+#include "LandmarkIndex.h"
+#include "AllPairsTable.h"
+#include "ThreadPool.h"
+#include "BatchQuery.h"
+#include "NetworkLoader.h"
+#include "NetworkSnapshot.h"
+#include "Timetable.h"
+#include "KShortestPaths.h"
+#include "RouteCache.h"
+#include "LiveNetwork.h"
+#include "RouteServer.h"
+#include "BatchFile.h"
+#include "Instrumentation.h"
+#include "StationIndex.h"
+#include "Isochrone.h"
+#include "ParetoRoutes.h"
+#include "DeltaStepping.h"
+#include "HubLabels.h"
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Benchmark driver for the route planner's shortest-path engines.
+// Build:  g++ -std=c++17 -O2 -pthread Benchmark.cpp Graph.cpp Heap.cpp QueryContext.cpp
+//             DelhiNetwork.cpp SyntheticNetwork.cpp ContractionHierarchy.cpp
+//             LandmarkIndex.cpp AllPairsTable.cpp ThreadPool.cpp BatchQuery.cpp
+//             NetworkLoader.cpp NetworkSnapshot.cpp Timetable.cpp KShortestPaths.cpp
+//             RouteCache.cpp LiveNetwork.cpp RouteServer.cpp BatchFile.cpp
+//             Instrumentation.cpp StationIndex.cpp StringArena.cpp Isochrone.cpp
+//             ParetoRoutes.cpp DeltaStepping.cpp HubLabels.cpp -o metro_bench
+// Usage:  metro_bench [--queries N] [--seed S] [--suite [--max-stations N] [--json FILE]]
+
+typedef std::chrono::steady_clock Clock;
+
+// Largest network the contraction hierarchy is built for
+const int CH_MAX_STATIONS = 20000;
+
+// Largest network hub labels are built for; labels grow with the network,
+// and expander-like synthetic networks need many hubs per station
+const int HUB_LABEL_MAX_STATIONS = 20000;
+
+// Stations apart whose connections are made zero-length to check CH
+const int ZERO_LENGTH_STRIDE = 10;
+
+// Landmarks per ALT index
+const int ALT_LANDMARKS = 8;
+
+// Largest network a full-day timetable is generated for
+const int TIMETABLE_MAX_STATIONS = 20000;
+
+// k-shortest-path answers compared with textbook Yen, and the largest
+// network the (slow) comparison runs on
+const int KSHORTEST_CHECKED_QUERIES = 200;
+const int KSHORTEST_CHECK_MAX_STATIONS = 20000;
+
+// Skewed route cache workload: distinct origin-destination pairs, queries
+// drawn from them, a cache size too small to hold them all, and the
+// largest network the (uncached) reference run is affordable on
+const int CACHE_DISTINCT_PAIRS = 2000;
+const int CACHE_QUERIES = 10000;
+const size_t CACHE_SMALL_BYTES = 256u << 10;
+const int CACHE_MAX_STATIONS = 20000;
+
+// Live updates: reader threads querying meanwhile, how often the repaired
+// all-pairs table is compared with a fresh build, and ALT queries checked
+// each time
+const int LIVE_READERS = 2;
+const int LIVE_CHECK_INTERVAL = 10;
+const int LIVE_ALT_CHECKS = 200;
+const int LIVE_UPDATES = 100;
+
+// Requests per query of the other benchmarks pipelined through the route
+// server or written to a batch file
+const int BULK_REQUESTS_PER_QUERY = 50;
+
+// Empty timed scopes run to measure the cost of recording one query
+const int TIMER_ROUNDS = 1000000;
+
+// Isochrone budgets (km, Rs, minutes) and the most origins searched
+const int ISOCHRONE_KM = 10;
+const int ISOCHRONE_FARE = 40;
+const int ISOCHRONE_MINUTES = 30;
+const int ISOCHRONE_MAX_ORIGINS = 4096;
+
+// Pareto fronts compared with the (slow) reference per network, and the
+// largest network the comparison runs on
+const int PARETO_CHECKED_QUERIES = 50;
+const int PARETO_CHECK_MAX_STATIONS = 20000;
+
+// Delta-stepping: thread counts timed, trees grown per run (scaled down
+// with network size to at least the minimum), and the regional-size
+// network grown on top of the usual ones (lines, stops per line)
+const int DELTA_THREADS[] = { 1, 2, 4, 8, 16, 32, 64 };
+const int DELTA_MIN_TREES = 3;
+const int DELTA_LARGE_NETWORK[2] = { 1000, 1500 };
+
+// Station name search: names returned per query and typos allowed
+const int NAME_SUGGESTIONS = 5;
+const int NAME_MAX_EDITS = 2;
+
+// Regression suite: queries per network (scaled down with size within
+// these bounds), the default limit on a generated network's stops (lines x
+// stops per line, an upper bound on its stations; the largest network has
+// about 1.1M stations), and the largest networks the contraction hierarchy
+// (geometric networks contract well) and hub labels are built for
+const int SUITE_MIN_QUERIES = 100;
+const int SUITE_MAX_QUERIES = 20000;
+const int SUITE_DEFAULT_MAX_STATIONS = 1500000;
+const int SUITE_CH_MAX_STATIONS = 200000;
+const int SUITE_HUB_LABEL_MAX_STATIONS = 50000;
+
+// Heap allocations made by the calling thread, counted by the global
+// operator new below so rendering can be checked to allocate nothing. Kept
+// out of line so GCC does not pair the inlined malloc and free with the
+// caller's new and delete and warn about a mismatch.
+thread_local uint64_t heapAllocations = 0;
+
+__attribute__((noinline)) void* operator new(std::size_t size) {
+    heapAllocations++;
+    void* memory = std::malloc(size == 0 ? 1 : size);
+    if (!memory) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+__attribute__((noinline)) void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+__attribute__((noinline)) void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+// Stream buffer that drops everything written to it
+class DiscardBuffer : public std::streambuf {
+protected:
+    int overflow(int ch) override {
+        return ch;
+    }
+    
+    std::streamsize xsputn(const char*, std::streamsize count) override {
+        return count;
+    }
+};
+
+// Random (source, destination) pairs, reproducible from the seed
+std::vector<std::pair<int, int>> makeQueries(int numVertices, int count, unsigned int seed) {
+    std::mt19937 rng(seed);
+    std::vector<std::pair<int, int>> queries;
+    queries.reserve(count);
+    for (int i = 0; i < count; i++) {
+        int src = static_cast<int>(rng() % numVertices);
+        int dest = static_cast<int>(rng() % numVertices);
+        queries.push_back(std::make_pair(src, dest));
+    }
+    return queries;
+}
+
+// Run every query with one priority queue policy. Distances are written to
+// results so policies can be checked against each other.
+template <typename Queue>
+double runQueries(const Graph& graph, const std::vector<std::pair<int, int>>& queries,
+                  std::vector<int>& results) {
+    BasicQueryContext<Queue> context;
+    std::vector<int> path;
+    results.resize(queries.size());
+    
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < queries.size(); i++) {
+        results[i] = graph.dijkstra(queries[i].first, queries[i].second, context, path);
+    }
+    Clock::time_point end = Clock::now();
+    
+    return std::chrono::duration<double, std::micro>(end - start).count() / queries.size();
+}
+
+// Print one result row and report any distance that disagrees with the reference
+void reportRow(const std::string& name, double microsPerQuery, double baseline,
+               const std::vector<int>& results, const std::vector<int>& reference) {
+    int mismatches = 0;
+    for (size_t i = 0; i < results.size(); i++) {
+        if (results[i] != reference[i]) {
+            mismatches++;
+        }
+    }
+    std::cout << "  " << std::left << std::setw(16) << name
+              << std::right << std::setw(12) << std::fixed << std::setprecision(3) << microsPerQuery
+              << std::setw(10) << std::setprecision(2) << baseline / microsPerQuery << "x"
+              << (mismatches == 0 ? "" : "  MISMATCHES: " + std::to_string(mismatches)) << "\n";
+}
+
+// Compare all priority queue policies on one network
+void benchmarkQueues(const std::string& title, const Graph& graph, int numQueries, unsigned int seed) {
+    std::vector<std::pair<int, int>> queries = makeQueries(graph.getNumVertices(), numQueries, seed);
+    std::vector<int> reference, results;
+    
+    std::cout << "\n" << title << " (" << graph.getNumVertices() << " stations, "
+              << numQueries << " queries)\n";
+    std::cout << "  " << std::left << std::setw(16) << "queue"
+              << std::right << std::setw(12) << "us/query" << std::setw(11) << "speedup" << "\n";
+    
+    double baseline = runQueries<MinHeap>(graph, queries, reference);
+    reportRow("binary heap", baseline, baseline, reference, reference);
+    
+    double time = runQueries<QuaternaryHeap>(graph, queries, results);
+    reportRow("4-ary heap", time, baseline, results, reference);
+    
+    time = runQueries<RadixHeap>(graph, queries, results);
+    reportRow("radix heap", time, baseline, results, reference);
+    
+    time = runQueries<BucketQueue>(graph, queries, results);
+    reportRow("bucket queue", time, baseline, results, reference);
+}
+
+// Sum of edge distances along a path, or -1 if two consecutive stations
+// are not directly connected
+int pathLength(const Graph& graph, const std::vector<int>& path) {
+    int length = 0;
+    for (size_t i = 1; i < path.size(); i++) {
+        int best = -1;
+        for (int e = graph.edgeBegin(path[i - 1]); e < graph.edgeEnd(path[i - 1]); e++) {
+            if (graph.edgeTarget(e) == path[i] && (best == -1 || graph.edgeDistance(e) < best)) {
+                best = graph.edgeDistance(e);
+            }
+        }
+        if (best == -1) {
+            return -1;
+        }
+        length += best;
+    }
+    return length;
+}
+
+// Time an exact point-to-point engine against plain dijkstra and check
+// that every distance matches and every path is identical or an equally
+// short valid route (only possible when the shortest path is not unique).
+// engine(src, dest, path) must return the distance like Graph::dijkstra.
+template <typename Engine>
+void benchmarkAgainstDijkstra(const std::string& title, const std::string& name, const Graph& graph,
+                              const std::vector<std::pair<int, int>>& queries, Engine engine) {
+    QueryContext context;
+    std::vector<std::vector<int>> referencePaths(queries.size());
+    std::vector<int> referenceDistances(queries.size());
+    std::vector<int> path;
+    
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < queries.size(); i++) {
+        referenceDistances[i] = graph.dijkstra(queries[i].first, queries[i].second, context, referencePaths[i]);
+    }
+    double baseline = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / queries.size();
+    
+    int identical = 0, ties = 0, errors = 0;
+    double total = 0;
+    for (size_t i = 0; i < queries.size(); i++) {
+        start = Clock::now();
+        int distance = engine(queries[i].first, queries[i].second, path);
+        total += std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+        
+        if (distance != referenceDistances[i]) {
+            errors++;
+        } else if (path == referencePaths[i]) {
+            identical++;
+        } else if (!path.empty() && path.front() == queries[i].first && path.back() == queries[i].second &&
+                   pathLength(graph, path) == distance) {
+            ties++;
+        } else {
+            errors++;
+        }
+    }
+    double time = total / queries.size();
+    
+    std::cout << "\n" << title << ": dijkstra vs " << name << " (" << queries.size() << " queries)\n";
+    std::cout << "  " << std::left << std::setw(16) << "dijkstra" << std::right << std::setw(12)
+              << std::fixed << std::setprecision(3) << baseline << " us/query\n";
+    std::cout << "  " << std::left << std::setw(16) << name << std::right << std::setw(12)
+              << time << " us/query" << std::setw(9) << std::setprecision(2) << baseline / time << "x\n";
+    std::cout << "  identical paths: " << identical << ", equal-length alternatives: " << ties
+              << ", errors: " << errors << "\n";
+}
+
+// Run the exact point-to-point engines against dijkstra on one network
+void benchmarkEngines(const std::string& title, const Graph& graph,
+                      const std::vector<std::pair<int, int>>& queries) {
+    BidirectionalContext bidirectionalContext;
+    benchmarkAgainstDijkstra(title, "bidirectional", graph, queries,
+        [&](int src, int dest, std::vector<int>& path) {
+            return graph.bidirectionalDijkstra(src, dest, bidirectionalContext, path);
+        });
+    
+    // All-pairs tables for networks small enough to hold them
+    if (graph.getNumVertices() <= AllPairsTable::DEFAULT_MAX_STATIONS) {
+        AllPairsTable table;
+        ThreadPool pool;
+        Clock::time_point start = Clock::now();
+        table.build(graph, pool);
+        double buildMillis = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        benchmarkAgainstDijkstra(title, "all-pairs", graph, queries,
+            [&](int src, int dest, std::vector<int>& path) {
+                table.buildPath(src, dest, path);
+                return table.getDistance(src, dest);
+            });
+        std::cout << "  tables built in " << std::setprecision(1) << buildMillis << " ms on "
+                  << pool.size() << " threads, " << table.memoryBytes() / 1024 << " KiB\n";
+    }
+    
+    // ALT with each landmark selection strategy
+    const LandmarkSelection selections[] = { LandmarkSelection::Random, LandmarkSelection::Farthest,
+                                             LandmarkSelection::Avoid };
+    const char* selectionNames[] = { "ALT random", "ALT farthest", "ALT avoid" };
+    QueryContext altContext;
+    for (int i = 0; i < 3; i++) {
+        LandmarkIndex landmarks;
+        Clock::time_point start = Clock::now();
+        landmarks.build(graph, ALT_LANDMARKS, selections[i]);
+        double buildMillis = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        benchmarkAgainstDijkstra(title, selectionNames[i], graph, queries,
+            [&](int src, int dest, std::vector<int>& path) {
+                return landmarks.query(src, dest, altContext, path);
+            });
+        std::cout << "  " << landmarks.getLandmarks().size() << " landmarks built in "
+                  << std::setprecision(1) << buildMillis << " ms\n";
+    }
+    
+    // The random interchanges of the synthetic generator make large networks
+    // expander-like, where contraction degenerates; keep preprocessing short
+    if (graph.getNumVertices() > CH_MAX_STATIONS) {
+        std::cout << "  (CH skipped above " << CH_MAX_STATIONS << " stations)\n";
+        return;
+    }
+    ContractionHierarchy hierarchy;
+    hierarchy.build(graph);
+    const ContractionStats& stats = hierarchy.getStats();
+    benchmarkAgainstDijkstra(title, "CH", graph, queries,
+        [&](int src, int dest, std::vector<int>& path) {
+            return hierarchy.query(src, dest, bidirectionalContext, path);
+        });
+    std::cout << "  CH preprocessing: " << std::setprecision(1) << stats.preprocessingMillis << " ms, "
+              << stats.shortcuts << " shortcuts for " << stats.originalEdges << " edges, "
+              << stats.upwardEdges << " upward edges\n";
+    
+    // Zero-length connections (accepted by the loader) must still get
+    // shortcuts: the same network with every connection of every tenth
+    // station set to 0 km
+    Graph zeroLength = graph.clone();
+    std::vector<int> neighbours;
+    for (int u = 0; u < zeroLength.getNumVertices(); u += ZERO_LENGTH_STRIDE) {
+        neighbours.clear();
+        for (int e = zeroLength.edgeBegin(u); e < zeroLength.edgeEnd(u); e++) {
+            neighbours.push_back(zeroLength.edgeTarget(e));
+        }
+        for (int v : neighbours) {
+            zeroLength.setConnectionDistance(u, v, 0);
+        }
+    }
+    ContractionHierarchy zeroHierarchy;
+    zeroHierarchy.build(zeroLength);
+    benchmarkAgainstDijkstra(title + " with 0 km links", "CH", zeroLength, queries,
+        [&](int src, int dest, std::vector<int>& path) {
+            return zeroHierarchy.query(src, dest, bidirectionalContext, path);
+        });
+}
+
+// Hub labels: label sizes and memory, routes unpacked from the labels
+// against dijkstra, distance-only queries (the merge alone) against
+// bidirectional dijkstra, and a save and load round trip that must give the
+// same distances and be refused for another network
+void benchmarkHubLabels(const std::string& title, const Graph& graph,
+                        const std::vector<std::pair<int, int>>& queries) {
+    if (graph.getNumVertices() > HUB_LABEL_MAX_STATIONS) {
+        std::cout << "\n" << title << ": hub labels skipped above " << HUB_LABEL_MAX_STATIONS << " stations\n";
+        return;
+    }
+    HubLabels labels;
+    labels.build(graph);
+    const HubLabelStats& stats = labels.getStats();
+    benchmarkAgainstDijkstra(title, "hub labels", graph, queries,
+        [&](int src, int dest, std::vector<int>& path) {
+            return labels.query(src, dest, path);
+        });
+    std::cout << "  labels built in " << std::setprecision(1) << stats.preprocessingMillis << " ms: "
+              << stats.averageLabelSize(graph.getNumVertices()) << " hubs per station on average, "
+              << stats.maxLabelSize << " at most, " << labels.memoryBytes() / 1024 << " KiB\n";
+    
+    // One untimed query first, so the context is allocated outside the timing
+    BidirectionalContext context;
+    std::vector<int> path;
+    std::vector<int> reference(queries.size());
+    if (!queries.empty()) {
+        graph.bidirectionalDijkstra(queries[0].first, queries[0].second, context, path);
+    }
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < queries.size(); i++) {
+        reference[i] = graph.bidirectionalDijkstra(queries[i].first, queries[i].second, context, path);
+    }
+    double baseline = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / queries.size();
+    
+    // Repeated so the clock is read rarely against the merge's cost
+    int errors = 0;
+    const int rounds = 10;
+    start = Clock::now();
+    for (int round = 0; round < rounds; round++) {
+        for (size_t i = 0; i < queries.size(); i++) {
+            errors += labels.distance(queries[i].first, queries[i].second) != reference[i] ? 1 : 0;
+        }
+    }
+    double time = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / (rounds * queries.size());
+    std::cout << "  distance only: bidirectional " << std::setprecision(0) << baseline << " ns, labels "
+              << time << " ns" << std::setw(9) << std::setprecision(1) << baseline / time << "x, errors: "
+              << errors / rounds << "\n";
+    
+    const std::string labelsPath = "metro_bench.hubs";
+    std::string error;
+    if (!labels.save(labelsPath, error)) {
+        std::cout << "  " << error << "\n";
+        return;
+    }
+    start = Clock::now();
+    HubLabels loaded;
+    bool ok = loaded.load(graph, labelsPath, error);
+    double loadMillis = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    if (!ok) {
+        std::cout << "  " << error << "\n";
+        std::remove(labelsPath.c_str());
+        return;
+    }
+    errors = 0;
+    for (size_t i = 0; i < queries.size(); i++) {
+        errors += loaded.distance(queries[i].first, queries[i].second) != reference[i] ? 1 : 0;
+    }
+    
+    // The same stations with one connection longer are another network
+    Graph changed = graph.clone();
+    int u = queries.empty() ? 0 : queries[0].first;
+    if (graph.edgeEnd(u) > graph.edgeBegin(u)) {
+        int e = graph.edgeBegin(u);
+        changed.setConnectionDistance(u, graph.edgeTarget(e), graph.edgeDistance(e) + 1);
+        errors += HubLabels().load(changed, labelsPath, error) ? 1 : 0;
+    }
+    std::remove(labelsPath.c_str());
+    std::cout << "  saved and loaded in " << std::setprecision(1) << loadMillis << " ms (built in "
+              << stats.preprocessingMillis << " ms), errors: " << errors << "\n";
+}
+
+// Batch API throughput against one dijkstra per pair. Queries come from
+// a limited set of origins, as in a fare audit.
+void benchmarkBatch(const std::string& title, const Graph& graph, int numQueries, unsigned int seed) {
+    std::mt19937 rng(seed);
+    int numOrigins = std::max(1, numQueries / 50);
+    std::vector<std::pair<int, int>> pairs;
+    for (int i = 0; i < numQueries; i++) {
+        int src = static_cast<int>(rng() % numOrigins) * (graph.getNumVertices() / numOrigins);
+        pairs.push_back(std::make_pair(src, static_cast<int>(rng() % graph.getNumVertices())));
+    }
+    
+    QueryContext context;
+    std::vector<int> path;
+    std::vector<int> reference(pairs.size());
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < pairs.size(); i++) {
+        reference[i] = graph.dijkstra(pairs[i].first, pairs[i].second, context, path);
+    }
+    double sequential = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    ThreadPool pool;
+    BatchResult result;
+    start = Clock::now();
+    batchRoutes(graph, pairs, pool, result);
+    double batch = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    int errors = 0;
+    for (size_t i = 0; i < pairs.size(); i++) {
+        int expected = reference[i] == std::numeric_limits<int>::max() ? -1 : reference[i];
+        if (result.distances[i] != expected) {
+            errors++;
+        }
+    }
+
+    // A trip longer than the 16-bit time columns saturates there, while
+    // planRoute still gives its exact time with or without the table
+    Graph distant;
+    distant.addStation("Near", "");
+    distant.addStation("Far", "");
+    distant.addEdge(0, 1, 50000);
+    distant.freeze();
+    int longTime = distant.estimateTravelTime(50000, 0);
+    for (int withTable = 0; withTable < 2; withTable++) {
+        if (withTable) {
+            distant.buildAllPairs(1);
+        }
+        Route route;
+        BatchResult saturated;
+        batchRoutes(distant, std::vector<std::pair<int, int>>{ { 0, 1 } }, pool, saturated);
+        if (!distant.planRoute(0, 1, route) || route.travelTime != longTime ||
+            saturated.travelTimes[0] != AllPairsTable::MAX_TRAVEL_TIME) {
+            errors++;
+        }
+    }
+
+    std::cout << "\n" << title << ": batch of " << pairs.size() << " pairs from " << numOrigins
+              << " origins on " << pool.size() << " threads\n";
+    std::cout << "  per-pair dijkstra " << std::setw(12) << std::setprecision(0) << pairs.size() / sequential
+              << " pairs/s\n";
+    std::cout << "  batchRoutes       " << std::setw(12) << pairs.size() / batch << " pairs/s"
+              << std::setw(9) << std::setprecision(2) << sequential / batch << "x, errors: " << errors << "\n";
+}
+
+// Route cache on a skewed workload: a few thousand origin-destination
+// pairs drawn with Zipf-distributed popularity, answered by planRoute
+// without a cache, with a large cache, with one too small for the working
+// set, and with the large cache shared by the worker threads. Cached
+// answers must equal uncached ones, and a changed network must not be
+// served stale routes.
+void benchmarkRouteCache(const std::string& title, Graph& graph, int numQueries, unsigned int seed) {
+    std::vector<std::pair<int, int>> pairs = makeQueries(graph.getNumVertices(), CACHE_DISTINCT_PAIRS, seed);
+    std::vector<double> weights;
+    for (int rank = 0; rank < CACHE_DISTINCT_PAIRS; rank++) {
+        weights.push_back(1.0 / (rank + 1));
+    }
+    std::mt19937 rng(seed);
+    std::discrete_distribution<int> popularity(weights.begin(), weights.end());
+    std::vector<std::pair<int, int>> queries;
+    for (int i = 0; i < numQueries; i++) {
+        queries.push_back(pairs[popularity(rng)]);
+    }
+    
+    // Uncached reference
+    std::vector<Route> reference(queries.size());
+    graph.setRouteCache(nullptr);
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < queries.size(); i++) {
+        graph.planRoute(queries[i].first, queries[i].second, reference[i]);
+    }
+    double uncachedSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    std::cout << "\n" << title << ": route cache, " << queries.size() << " Zipf queries over "
+              << CACHE_DISTINCT_PAIRS << " pairs\n";
+    std::cout << "  no cache          " << std::setw(10) << std::setprecision(1)
+              << uncachedSeconds * 1e6 / queries.size() << " us/query\n";
+    
+    // Sequential runs with a large and a small cache, then the large cache
+    // shared by a thread pool
+    const size_t sizes[] = { RouteCache::DEFAULT_MAX_BYTES, CACHE_SMALL_BYTES };
+    for (int run = 0; run < 3; run++) {
+        std::shared_ptr<RouteCache> cache = std::make_shared<RouteCache>(sizes[run == 1 ? 1 : 0]);
+        graph.setRouteCache(cache);
+        std::vector<Route> routes(queries.size());
+        ThreadPool pool;
+        start = Clock::now();
+        if (run < 2) {
+            for (size_t i = 0; i < queries.size(); i++) {
+                graph.planRoute(queries[i].first, queries[i].second, routes[i]);
+            }
+        } else {
+            pool.parallelFor(static_cast<int>(queries.size()), [&](int i) {
+                graph.planRoute(queries[i].first, queries[i].second, routes[i]);
+            });
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        
+        int errors = 0;
+        for (size_t i = 0; i < queries.size(); i++) {
+            if (routes[i].distance != reference[i].distance || routes[i].path != reference[i].path ||
+                routes[i].fare != reference[i].fare || routes[i].travelTime != reference[i].travelTime) {
+                errors++;
+            }
+        }
+        RouteCacheStats stats = cache->getStats();
+        std::string name = run == 0 ? "cache 64 MB" : run == 1 ? "cache 256 KB" : "cache, " +
+                           std::to_string(pool.size()) + " threads";
+        std::cout << "  " << std::left << std::setw(18) << name << std::right << std::setw(10)
+                  << std::setprecision(1) << seconds * 1e6 / queries.size() << " us/query"
+                  << std::setw(9) << std::setprecision(2) << uncachedSeconds / seconds << "x, hit rate "
+                  << std::setprecision(1) << stats.hitRate() * 100 << "%, " << stats.entries << " entries, "
+                  << stats.bytes / 1024 << " KB, " << stats.evictions << " evictions, errors: " << errors << "\n";
+    }
+    graph.setRouteCache(nullptr);
+    
+    // Adding a shortcut must be seen by the next query
+    Graph changing;
+    changing.addStation("A", "Test Line");
+    changing.addStation("B", "Test Line");
+    changing.addStation("C", "Test Line");
+    changing.addEdge("A", "B", 5);
+    changing.addEdge("B", "C", 5);
+    changing.freeze();
+    changing.setRouteCache(std::make_shared<RouteCache>());
+    Route before, after, again;
+    changing.planRoute(0, 2, before);
+    changing.addEdge("A", "C", 3);
+    changing.freeze();
+    changing.planRoute(0, 2, after);
+    changing.planRoute(0, 2, again);
+    bool stale = before.distance != 10 || after.distance != 3 || again.distance != 3 ||
+                 changing.getRouteCache()->getStats().hits != 1;
+    std::cout << "  invalidation on change " << (stale ? "FAILED" : "ok") << "\n";
+
+    // The all-pairs table does not answer line-aware routes, so with one
+    // built a repeated query must still come from the cache
+    changing.buildAllPairs(1);
+    changing.setRouteCache(std::make_shared<RouteCache>());
+    changing.planRoute(0, 2, before);
+    changing.planRoute(0, 2, again);
+    bool cached = changing.isLineAware() && changing.getAllPairsTable() &&
+                  changing.getRouteCache()->getStats().hits == 1 && again.distance == before.distance;
+    std::cout << "  line-aware with table  " << (cached ? "ok" : "FAILED") << "\n";
+}
+
+// Route server over a socket pair: a client thread pipelines every request
+// by station name and then closes its side, while the responses are read
+// back and compared with the lines planRoute answers produce when called
+// directly in one thread.
+void benchmarkServer(const std::string& title, const Graph& graph, int numRequests, unsigned int seed) {
+#ifndef _WIN32
+    std::vector<std::pair<int, int>> queries = makeQueries(graph.getNumVertices(), numRequests, seed);
+    std::string requests;
+    std::vector<std::string> expected(queries.size());
+    Route route;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < queries.size(); i++) {
+        std::string& line = expected[i];
+        if (!graph.planRoute(queries[i].first, queries[i].second, route) || route.path.empty()) {
+            line = "NONE";
+            continue;
+        }
+        line = "OK\t" + std::to_string(route.distance) + "\t" + std::to_string(route.fare) + "\t" +
+               std::to_string(route.travelTime) + "\t" + std::to_string(route.lineChanges);
+        for (int station : route.path) {
+            line += "\t" + std::string(graph.getStationName(station));
+        }
+    }
+    double directSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    for (const std::pair<int, int>& query : queries) {
+        requests += "ROUTE\t" + std::string(graph.getStationName(query.first)) + "\t" +
+                    std::string(graph.getStationName(query.second)) + "\n";
+    }
+    
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        std::cout << "\n" << title << ": route server skipped, no socket pair\n";
+        return;
+    }
+    RouteServer server(graph);
+    std::string error;
+    bool served = false;
+    start = Clock::now();
+    std::thread serverThread([&] {
+        served = server.serveStream(fds[0], fds[0], error);
+        shutdown(fds[0], SHUT_WR); // End of responses
+    });
+    std::thread client([&] {
+        size_t sent = 0;
+        while (sent < requests.size()) {
+            ssize_t written = write(fds[1], requests.data() + sent, requests.size() - sent);
+            if (written <= 0) {
+                break;
+            }
+            sent += written;
+        }
+        shutdown(fds[1], SHUT_WR);
+    });
+    
+    std::string responses;
+    char buffer[1 << 16];
+    ssize_t received;
+    while ((received = read(fds[1], buffer, sizeof(buffer))) > 0) {
+        responses.append(buffer, received);
+    }
+    client.join();
+    serverThread.join();
+    double serverSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    close(fds[0]);
+    close(fds[1]);
+    
+    int errors = served ? 0 : 1;
+    size_t position = 0;
+    for (size_t i = 0; i < expected.size(); i++) {
+        size_t end = responses.find('\n', position);
+        if (end == std::string::npos) {
+            errors += static_cast<int>(expected.size() - i);
+            break;
+        }
+        if (responses.compare(position, end - position, expected[i]) != 0) {
+            errors++;
+        }
+        position = end + 1;
+    }
+    
+    ServerStats stats = server.getStats();
+    std::cout << "\n" << title << ": route server, " << queries.size() << " pipelined requests\n";
+    std::cout << "  direct planRoute  " << std::setw(12) << std::setprecision(0)
+              << queries.size() / directSeconds << " queries/s, 1 thread\n";
+    std::cout << "  server            " << std::setw(12) << queries.size() / serverSeconds << " queries/s, "
+              << stats.batches << " batches of " << std::setprecision(1)
+              << static_cast<double>(stats.requests) / std::max<unsigned long long>(1, stats.batches)
+              << " on the pool, errors: " << errors << (served ? "" : " (" + error + ")") << "\n";
+#else
+    (void)graph;
+    (void)numRequests;
+    (void)seed;
+    std::cout << "\n" << title << ": route server not supported on Windows\n";
+#endif
+}
+
+// Batch mode on a generated query file: throughput of runBatchFile on the
+// pool, with every output line's distance and path checked against
+// planRoute
+void benchmarkBatchFile(const std::string& title, const Graph& graph, int numQueries, unsigned int seed) {
+    const std::string queriesPath = "metro_bench_queries.csv";
+    const std::string outputPath = "metro_bench_routes.csv";
+    std::vector<std::pair<int, int>> queries = makeQueries(graph.getNumVertices(), numQueries, seed);
+    FILE* file = std::fopen(queriesPath.c_str(), "wb");
+    if (!file) {
+        std::cout << "\n" << title << ": cannot write temporary query file\n";
+        return;
+    }
+    std::fputs("from,to\n", file);
+    for (const std::pair<int, int>& query : queries) {
+        std::string_view from = graph.getStationName(query.first);
+        std::string_view to = graph.getStationName(query.second);
+        std::fprintf(file, "%.*s,%.*s\n", static_cast<int>(from.size()), from.data(), static_cast<int>(to.size()),
+                     to.data());
+    }
+    std::fclose(file);
+    
+    ThreadPool pool;
+    BatchFileResult result = runBatchFile(graph, queriesPath, outputPath, pool);
+    
+    // Compare "distance,...,path" of each line with planRoute
+    int errors = static_cast<int>(result.errors.size());
+    std::vector<char> output;
+    file = std::fopen(outputPath.c_str(), "rb");
+    if (file) {
+        char buffer[1 << 16];
+        size_t read;
+        while ((read = std::fread(buffer, 1, sizeof(buffer), file)) > 0) {
+            output.insert(output.end(), buffer, buffer + read);
+        }
+        std::fclose(file);
+    }
+    std::string text(output.begin(), output.end());
+    size_t position = text.find('\n') + 1;
+    Route route;
+    for (size_t i = 0; i < queries.size(); i++) {
+        size_t end = text.find('\n', position);
+        if (position == 0 || end == std::string::npos) {
+            errors += static_cast<int>(queries.size() - i);
+            break;
+        }
+        std::string line = text.substr(position, end - position);
+        position = end + 1;
+        
+        std::string expected = "-1,0,0,0,";
+        if (graph.planRoute(queries[i].first, queries[i].second, route) && !route.path.empty()) {
+            expected = std::to_string(route.distance) + "," + std::to_string(route.fare) + "," +
+                       std::to_string(route.travelTime) + "," + std::to_string(route.lineChanges) + ",";
+            for (size_t j = 0; j < route.path.size(); j++) {
+                expected += j > 0 ? ";" : "";
+                expected += graph.getStationName(route.path[j]);
+            }
+        }
+        if (line.size() < expected.size() || line.compare(line.size() - expected.size(), expected.size(), expected) != 0) {
+            errors++;
+        }
+    }
+    std::remove(queriesPath.c_str());
+    std::remove(outputPath.c_str());
+    
+    std::cout << "\n" << title << ": batch file of " << queries.size() << " queries on " << pool.size()
+              << " threads\n";
+    std::cout << "  runBatchFile      " << std::setw(12) << std::setprecision(0) << result.queriesPerSecond()
+              << " queries/s, " << result.unreachable << " unreachable, errors: " << errors << "\n";
+}
+
+// Closures, reopenings and delays applied to a live network while reader
+// threads keep querying it. Each update's incremental repair is timed
+// against rebuilding the all-pairs table, repaired tables are compared
+// with fresh builds, landmark queries with dijkstra, and every reader
+// answer with dijkstra on the state the reader holds.
+void benchmarkLiveUpdates(const std::string& title, const Graph& graph, int numUpdates, unsigned int seed) {
+    const int INF = std::numeric_limits<int>::max();
+    Graph base = graph.clone();
+    base.buildAllPairs();
+    LiveNetwork live(std::move(base), ALT_LANDMARKS);
+    
+    // Readers check that each state they take answers consistently
+    std::atomic<bool> stop(false);
+    std::atomic<long long> reads(0);
+    std::atomic<int> readErrors(0);
+    std::vector<std::thread> readers;
+    for (int r = 0; r < LIVE_READERS; r++) {
+        readers.emplace_back([&, r]() {
+            std::mt19937 rng(seed + r);
+            QueryContext context;
+            std::vector<int> path;
+            while (!stop.load()) {
+                std::shared_ptr<const NetworkState> state = live.current();
+                int n = state->graph.getNumVertices();
+                int src = static_cast<int>(rng() % n);
+                int dest = static_cast<int>(rng() % n);
+                int expected = state->graph.dijkstra(src, dest, context, path);
+                if (state->graph.getAllPairsTable()->getDistance(src, dest) != expected) {
+                    readErrors++;
+                }
+                reads++;
+            }
+        });
+    }
+    
+    std::mt19937 rng(seed);
+    std::vector<std::pair<int, int>> closed;
+    QueryContext context;
+    std::vector<int> path;
+    double updateSeconds = 0;
+    double rebuildSeconds = 0;
+    int rebuilds = 0;
+    long long repairedRows = 0;
+    int errors = 0;
+    for (int u = 0; u < numUpdates; u++) {
+        std::shared_ptr<const NetworkState> state = live.current();
+        const Graph& current = state->graph;
+        
+        // Reopen a closed connection, or close or delay a random open one
+        int kind = static_cast<int>(rng() % 3);
+        Clock::time_point start = Clock::now();
+        if (kind == 0 && !closed.empty()) {
+            size_t pick = rng() % closed.size();
+            live.reopenConnection(closed[pick].first, closed[pick].second);
+            closed.erase(closed.begin() + pick);
+        } else {
+            int a = static_cast<int>(rng() % current.getNumVertices());
+            if (current.edgeBegin(a) == current.edgeEnd(a)) {
+                continue;
+            }
+            int b = current.edgeTarget(current.edgeBegin(a) +
+                                       static_cast<int>(rng() % (current.edgeEnd(a) - current.edgeBegin(a))));
+            if (kind == 1) {
+                live.closeConnection(a, b);
+                closed.push_back(std::make_pair(a, b));
+            } else {
+                int distance = current.getConnectionDistance(a, b);
+                live.setConnectionDistance(a, b, rng() % 2 ? distance + 1 + static_cast<int>(rng() % 5)
+                                                           : std::max(1, distance / 2));
+            }
+        }
+        updateSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+        
+        state = live.current();
+        repairedRows += state->graph.getAllPairsTable()->getRepairedRows();
+        
+        // Compare with a table built from scratch now and then, timing the
+        // rebuild under the same reader load
+        if (u % LIVE_CHECK_INTERVAL == 0 || u == numUpdates - 1) {
+            Graph fresh = state->graph.clone();
+            start = Clock::now();
+            fresh.buildAllPairs();
+            rebuildSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+            rebuilds++;
+            const AllPairsTable* expected = fresh.getAllPairsTable();
+            const AllPairsTable* repaired = state->graph.getAllPairsTable();
+            int n = state->graph.getNumVertices();
+            for (int src = 0; src < n; src++) {
+                for (int dest = 0; dest < n; dest++) {
+                    if (repaired->getDistance(src, dest) != expected->getDistance(src, dest) ||
+                        repaired->getFare(src, dest) != expected->getFare(src, dest)) {
+                        errors++;
+                    } else if (repaired->getDistance(src, dest) != INF) {
+                        repaired->buildPath(src, dest, path);
+                        if (pathLength(state->graph, path) != repaired->getDistance(src, dest)) {
+                            errors++;
+                        }
+                    }
+                }
+            }
+            for (const auto& query : makeQueries(n, LIVE_ALT_CHECKS, seed + u)) {
+                std::vector<int> altPath;
+                if (state->landmarks.query(query.first, query.second, context, altPath) !=
+                    state->graph.dijkstra(query.first, query.second, context, path)) {
+                    errors++;
+                }
+            }
+        }
+    }
+    stop = true;
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+
+    // Ids that name no station change nothing
+    int numVertices = graph.getNumVertices();
+    if (live.closeConnection(-1, 0) || live.reopenConnection(0, numVertices) ||
+        live.setConnectionDistance(numVertices, -1, 1)) {
+        errors++;
+    }
+    std::cout << "\n" << title << ": " << numUpdates << " live updates with " << LIVE_READERS
+              << " concurrent readers\n";
+    std::cout << "  full all-pairs rebuild " << std::setw(10) << std::setprecision(2)
+              << rebuildSeconds * 1e3 / rebuilds << " ms\n";
+    std::cout << "  incremental update     " << std::setw(10) << updateSeconds * 1e3 / numUpdates << " ms"
+              << std::setw(9) << std::setprecision(1)
+              << (rebuildSeconds / rebuilds) / (updateSeconds / numUpdates) << "x, "
+              << std::setprecision(1) << 100.0 * repairedRows / numUpdates / numVertices
+              << "% of rows touched, errors: " << errors << "\n";
+    std::cout << "  reader queries         " << std::setw(10) << reads.load() << ", errors: " << readErrors.load() << "\n";
+}
+
+// Sum of edge distances along a line-aware route, each hop on the line it
+// reports, or -1 if some hop is not an edge of its line
+int routeLength(const Graph& graph, const Route& route) {
+    int length = 0;
+    for (size_t h = 0; h + 1 < route.path.size(); h++) {
+        int hop = -1;
+        for (int e = graph.edgeBegin(route.path[h]); e < graph.edgeEnd(route.path[h]); e++) {
+            if (graph.edgeTarget(e) == route.path[h + 1] && graph.edgeLine(e) == route.lines[h] &&
+                (hop == -1 || graph.edgeDistance(e) < graph.edgeDistance(hop))) {
+                hop = e;
+            }
+        }
+        if (hop == -1) {
+            return -1;
+        }
+        length += graph.edgeDistance(hop);
+    }
+    return length;
+}
+
+// Travel time in half-minutes of the fastest route, by a plain Dijkstra
+// over (station, line) pairs kept in a hash map: a slow but independent
+// reference for Graph::fastestRoute. Returns -1 if dest is unreachable.
+int referenceFastestCost(const Graph& graph, int src, int dest) {
+    typedef std::pair<int, long long> Entry; // (cost, station * (lines + 1) + line + 1)
+    long long stride = graph.getNumLines() + 1;
+    std::unordered_map<long long, int> best;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    queue.push(Entry(0, src * stride)); // At the source, on no line yet
+    best[src * stride] = 0;
+    
+    while (!queue.empty()) {
+        Entry current = queue.top();
+        queue.pop();
+        int u = static_cast<int>(current.second / stride);
+        int line = static_cast<int>(current.second % stride) - 1;
+        if (current.first > best[current.second]) {
+            continue;
+        }
+        if (u == dest) {
+            return current.first;
+        }
+        for (int e = graph.edgeBegin(u); e < graph.edgeEnd(u); e++) {
+            int next = graph.edgeLine(e);
+            bool change = line != Graph::NO_LINE && next != Graph::NO_LINE && line != next;
+            // Leaving the source is boarding, never a change
+            change = change && current.second != src * stride;
+            int cost = current.first + Graph::HALF_MINUTES_PER_KM * graph.edgeDistance(e) +
+                       (change ? Graph::HALF_MINUTES_PER_CHANGE : 0);
+            long long key = graph.edgeTarget(e) * stride + next + 1;
+            auto it = best.find(key);
+            if (it == best.end() || cost < it->second) {
+                best[key] = cost;
+                queue.push(Entry(cost, key));
+            }
+        }
+    }
+    return -1;
+}
+
+// Compare line-aware fastest routes with plain shortest-distance search,
+// checking costs against the reference and that every reported hop exists
+void benchmarkLineAware(const std::string& title, const Graph& graph,
+                        const std::vector<std::pair<int, int>>& queries) {
+    QueryContext context;
+    std::vector<int> path;
+    Clock::time_point start = Clock::now();
+    for (const auto& query : queries) {
+        graph.dijkstra(query.first, query.second, context, path);
+    }
+    double shortestSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    std::vector<Route> routes(queries.size());
+    start = Clock::now();
+    for (size_t i = 0; i < queries.size(); i++) {
+        graph.fastestRoute(queries[i].first, queries[i].second, context, routes[i]);
+    }
+    double fastestSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    int errors = 0;
+    long long totalChanges = 0;
+    for (size_t i = 0; i < queries.size(); i++) {
+        const Route& route = routes[i];
+        int expected = referenceFastestCost(graph, queries[i].first, queries[i].second);
+        int cost = route.distance < 0 ? -1 : Graph::HALF_MINUTES_PER_KM * route.distance +
+                                              Graph::HALF_MINUTES_PER_CHANGE * route.lineChanges;
+        
+        // Each hop must be an edge of the reported line
+        if (cost != expected || (route.distance >= 0 && routeLength(graph, route) != route.distance)) {
+            errors++;
+        }
+        totalChanges += std::max(0, route.lineChanges);
+    }
+    
+    std::cout << "\n" << title << ": line-aware routing over " << graph.getNumStates() << " (station, line) states, "
+              << graph.getNumLines() << " lines\n";
+    std::cout << "  shortest distance " << std::setw(10) << std::setprecision(1)
+              << shortestSeconds * 1e6 / queries.size() << " us/query\n";
+    std::cout << "  fastest with lines" << std::setw(10) << fastestSeconds * 1e6 / queries.size() << " us/query"
+              << std::setw(9) << std::setprecision(2) << fastestSeconds / shortestSeconds << "x, "
+              << static_cast<double>(totalChanges) / queries.size() << " changes/route, errors: " << errors << "\n";
+}
+
+// Pareto front over (km, line changes) of the routes from src to dest with
+// at most maxChanges changes, shortest first, by a plain Dijkstra on km
+// over (station, line, changes) triples kept in a hash map: the shortest
+// route for each number of changes, kept if it is shorter than every route
+// with fewer. A slow but independent reference for paretoRoutes.
+std::vector<std::pair<int, int>> referenceParetoFront(const Graph& graph, int src, int dest, int maxChanges) {
+    typedef std::pair<int, long long> Entry; // (km, (station * (lines + 1) + line + 1) * (maxChanges + 1) + changes)
+    long long lineStride = graph.getNumLines() + 1;
+    long long changeStride = maxChanges + 1;
+    long long start = src * lineStride * changeStride; // At the source, on no line yet
+    std::unordered_map<long long, int> best;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    queue.push(Entry(0, start));
+    best[start] = 0;
+    
+    std::vector<int> shortest(maxChanges + 1, -1);
+    while (!queue.empty()) {
+        Entry current = queue.top();
+        queue.pop();
+        if (current.first > best[current.second]) {
+            continue;
+        }
+        int changes = static_cast<int>(current.second % changeStride);
+        int u = static_cast<int>(current.second / changeStride / lineStride);
+        int line = static_cast<int>(current.second / changeStride % lineStride) - 1;
+        if (u == dest) {
+            if (shortest[changes] == -1) {
+                shortest[changes] = current.first;
+            }
+            continue;
+        }
+        for (int e = graph.edgeBegin(u); e < graph.edgeEnd(u); e++) {
+            int next = graph.edgeLine(e);
+            bool change = current.second != start && line != Graph::NO_LINE && next != Graph::NO_LINE && line != next;
+            if (changes + (change ? 1 : 0) > maxChanges) {
+                continue;
+            }
+            long long key = (graph.edgeTarget(e) * lineStride + next + 1) * changeStride + changes + (change ? 1 : 0);
+            int km = current.first + graph.edgeDistance(e);
+            auto it = best.find(key);
+            if (it == best.end() || km < it->second) {
+                best[key] = km;
+                queue.push(Entry(km, key));
+            }
+        }
+    }
+    
+    std::vector<std::pair<int, int>> front;
+    for (int changes = 0; changes <= maxChanges; changes++) {
+        if (shortest[changes] != -1 && (front.empty() || shortest[changes] < front.back().first)) {
+            front.push_back(std::make_pair(shortest[changes], changes));
+        }
+    }
+    std::reverse(front.begin(), front.end());
+    return front;
+}
+
+// Pareto routes over distance and line changes against one shortest and
+// one fastest route per query. Every front must start with a shortest
+// route, go on to ever longer routes with ever fewer changes, hold a route
+// as fast as fastestRoute's and measure correctly hop by hop; the first
+// numChecked fronts are also compared with the reference.
+void benchmarkPareto(const std::string& title, const Graph& graph, const std::vector<std::pair<int, int>>& queries,
+                     int numChecked) {
+    const int INF = std::numeric_limits<int>::max();
+    QueryContext context;
+    std::vector<int> path;
+    std::vector<int> shortest(queries.size());
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < queries.size(); i++) {
+        shortest[i] = graph.dijkstra(queries[i].first, queries[i].second, context, path);
+    }
+    double shortestSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    std::vector<Route> fastest(queries.size());
+    start = Clock::now();
+    for (size_t i = 0; i < queries.size(); i++) {
+        graph.fastestRoute(queries[i].first, queries[i].second, context, fastest[i]);
+    }
+    double fastestSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    ParetoContext paretoContext;
+    std::vector<std::vector<Route>> fronts(queries.size());
+    start = Clock::now();
+    for (size_t i = 0; i < queries.size(); i++) {
+        paretoRoutes(graph, queries[i].first, queries[i].second, paretoContext, fronts[i]);
+    }
+    double paretoSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    int errors = 0;
+    long long totalRoutes = 0;
+    int withChoice = 0;
+    for (size_t i = 0; i < queries.size(); i++) {
+        const std::vector<Route>& front = fronts[i];
+        totalRoutes += front.size();
+        withChoice += front.size() > 1 ? 1 : 0;
+        bool valid = front.empty() == (shortest[i] == INF);
+        int fastestCost = INF;
+        for (size_t r = 0; r < front.size(); r++) {
+            const Route& route = front[r];
+            int length = route.lines.empty() ? pathLength(graph, route.path) : routeLength(graph, route);
+            valid = valid && length == route.distance && route.path.front() == queries[i].first &&
+                    route.path.back() == queries[i].second;
+            if (r > 0) {
+                valid = valid && route.distance > front[r - 1].distance &&
+                        route.lineChanges < front[r - 1].lineChanges;
+            }
+            fastestCost = std::min(fastestCost, Graph::HALF_MINUTES_PER_KM * route.distance +
+                                                Graph::HALF_MINUTES_PER_CHANGE * route.lineChanges);
+        }
+        if (!front.empty()) {
+            valid = valid && front[0].distance == shortest[i];
+            if (graph.isLineAware()) {
+                valid = valid && fastestCost == Graph::HALF_MINUTES_PER_KM * fastest[i].distance +
+                                                Graph::HALF_MINUTES_PER_CHANGE * fastest[i].lineChanges;
+            }
+        }
+        if (static_cast<int>(i) < numChecked && !front.empty() && graph.isLineAware()) {
+            std::vector<std::pair<int, int>> expected =
+                referenceParetoFront(graph, queries[i].first, queries[i].second, front[0].lineChanges);
+            valid = valid && expected.size() == front.size();
+            for (size_t r = 0; valid && r < front.size(); r++) {
+                valid = expected[r].first == front[r].distance && expected[r].second == front[r].lineChanges;
+            }
+        }
+        errors += valid ? 0 : 1;
+    }
+    
+    std::cout << "\n" << title << ": Pareto routes over distance and line changes\n";
+    std::cout << "  shortest distance " << std::setw(10) << std::setprecision(1) << std::fixed
+              << shortestSeconds * 1e6 / queries.size() << " us/query\n";
+    std::cout << "  fastest with lines" << std::setw(10) << fastestSeconds * 1e6 / queries.size() << " us/query\n";
+    std::cout << "  pareto front      " << std::setw(10) << paretoSeconds * 1e6 / queries.size() << " us/query"
+              << std::setw(9) << std::setprecision(2) << paretoSeconds / fastestSeconds << "x fastest, "
+              << static_cast<double>(totalRoutes) / queries.size() << " routes/query, " << std::setprecision(1)
+              << 100.0 * withChoice / queries.size() << "% with a choice, errors: " << errors << "\n";
+}
+
+// One-to-all trees by parallel delta-stepping against sequential
+// shortestPathTree with the binary heap and the bucket queue: a sweep of
+// deltas on one worker per hardware thread, then the suggested delta on 1
+// to 64 threads. Every tree must have dijkstra's distances, and each
+// parent must be a neighbour a shortest route arrives from. Speedups are
+// bounded by the hardware threads of the machine running the benchmark.
+void benchmarkDeltaStepping(const std::string& title, const Graph& graph, int numTrees, unsigned int seed) {
+    const int INF = std::numeric_limits<int>::max();
+    int numVertices = graph.getNumVertices();
+    std::mt19937 rng(seed);
+    std::vector<int> sources(numTrees);
+    for (int& source : sources) {
+        source = static_cast<int>(rng() % numVertices);
+    }
+    
+    std::vector<std::vector<int>> expected(numTrees, std::vector<int>(numVertices));
+    QueryContext heapContext;
+    Clock::time_point start = Clock::now();
+    for (int t = 0; t < numTrees; t++) {
+        graph.shortestPathTree(sources[t], heapContext);
+        for (int v = 0; v < numVertices; v++) {
+            expected[t][v] = heapContext.getDistance(v);
+        }
+    }
+    double heapSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    BasicQueryContext<BucketQueue> bucketContext;
+    start = Clock::now();
+    for (int t = 0; t < numTrees; t++) {
+        graph.shortestPathTree(sources[t], bucketContext);
+    }
+    double bucketSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    // Seconds per tree and trees with a wrong distance or parent, after
+    // one untimed tree that sizes the engine's arrays
+    auto run = [&](DeltaStepping& engine, int& errors) {
+        engine.shortestPathTree(sources[0]);
+        double seconds = 0;
+        errors = 0;
+        for (int t = 0; t < numTrees; t++) {
+            Clock::time_point begin = Clock::now();
+            engine.shortestPathTree(sources[t]);
+            seconds += std::chrono::duration<double>(Clock::now() - begin).count();
+            
+            bool valid = true;
+            for (int v = 0; valid && v < numVertices; v++) {
+                int distance = engine.getDistance(v);
+                int parent = engine.getParent(v);
+                valid = distance == expected[t][v];
+                if (v == sources[t] || distance == INF) {
+                    valid = valid && parent == -1;
+                    continue;
+                }
+                bool tight = false;
+                for (int e = graph.edgeBegin(v); valid && parent != -1 && e < graph.edgeEnd(v); e++) {
+                    tight = tight || (graph.edgeTarget(e) == parent &&
+                                      expected[t][parent] + graph.edgeDistance(e) == distance);
+                }
+                valid = valid && tight;
+            }
+            errors += valid ? 0 : 1;
+        }
+        return seconds / numTrees;
+    };
+    
+    std::cout << "\n" << title << ": one-to-all trees from " << numTrees << " sources, " << numVertices
+              << " stations, " << std::thread::hardware_concurrency() << " hardware threads\n";
+    std::cout << "  dijkstra, binary heap   " << std::setw(10) << std::fixed << std::setprecision(2)
+              << heapSeconds * 1e3 / numTrees << " ms/tree\n";
+    std::cout << "  dijkstra, bucket queue  " << std::setw(10) << bucketSeconds * 1e3 / numTrees << " ms/tree\n";
+    
+    int suggested = DeltaStepping::suggestDelta(graph);
+    std::vector<int> deltas = { 1, std::max(1, suggested / 4), std::max(1, suggested / 2), suggested,
+                                2 * suggested, 4 * suggested, 8 * suggested, graph.getMaxEdgeDistance() + 1 };
+    std::sort(deltas.begin(), deltas.end());
+    deltas.erase(std::unique(deltas.begin(), deltas.end()), deltas.end());
+    {
+        ThreadPool pool;
+        DeltaStepping engine(graph, pool);
+        for (int delta : deltas) {
+            engine.setDelta(delta);
+            int errors = 0;
+            double seconds = run(engine, errors);
+            std::cout << "  delta " << std::setw(4) << delta << ", " << std::setw(2) << pool.size() << " threads"
+                      << std::setw(10) << seconds * 1e3 << " ms/tree" << std::setw(9)
+                      << heapSeconds / numTrees / seconds << "x heap, errors: " << errors
+                      << (delta == suggested ? " (suggested)" : "") << "\n";
+        }
+    }
+    
+    double oneThread = 0;
+    for (int threads : DELTA_THREADS) {
+        ThreadPool pool(threads);
+        DeltaStepping engine(graph, pool);
+        int errors = 0;
+        double seconds = run(engine, errors);
+        if (threads == 1) {
+            oneThread = seconds;
+        }
+        std::cout << "  delta " << std::setw(4) << suggested << ", " << std::setw(2) << threads << " threads"
+                  << std::setw(10) << seconds * 1e3 << " ms/tree" << std::setw(9)
+                  << heapSeconds / numTrees / seconds << "x heap" << std::setw(8) << oneThread / seconds
+                  << "x 1 thread, errors: " << errors << "\n";
+    }
+}
+
+// One timetabled hop for the Connection Scan reference
+struct Connection {
+    int departure;
+    int arrival;
+    int from;
+    int to;
+    int trip;
+    
+    bool operator<(const Connection& other) const { return departure < other.departure; }
+};
+
+// Earliest arrival by Connection Scan over connections sorted by departure:
+// an independent check of the RAPTOR engine with unlimited transfers
+int connectionScan(const std::vector<Connection>& connections, int numStations, int numTrips,
+                   int transferSeconds, int src, int dest, int departureTime) {
+    const int INF = std::numeric_limits<int>::max();
+    std::vector<int> arrival(numStations, INF);
+    std::vector<char> onTrip(numStations == 0 ? 0 : numTrips, 0);
+    arrival[src] = departureTime;
+    
+    auto first = std::lower_bound(connections.begin(), connections.end(), Connection{ departureTime, 0, 0, 0, 0 });
+    for (auto c = first; c != connections.end() && c->departure < arrival[dest]; ++c) {
+        bool boardable = arrival[c->from] != INF &&
+                         arrival[c->from] + (c->from == src ? 0 : transferSeconds) <= c->departure;
+        if (onTrip[c->trip] || boardable) {
+            onTrip[c->trip] = 1;
+            arrival[c->to] = std::min(arrival[c->to], c->arrival);
+        }
+    }
+    return arrival[dest];
+}
+
+// Time RAPTOR on a generated full-day timetable and check its earliest
+// arrivals against Connection Scan
+void benchmarkTimetable(const std::string& title, const Graph& graph,
+                        const std::vector<std::pair<int, int>>& queries, unsigned int seed) {
+    TimetableOptions options;
+    Timetable timetable;
+    Clock::time_point start = Clock::now();
+    timetable.generate(graph, options);
+    double generateSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    std::vector<Connection> connections;
+    for (int route = 0; route < timetable.getNumRoutes(); route++) {
+        int numStops = timetable.routeStopEnd(route) - timetable.routeStopBegin(route);
+        for (int trip = timetable.routeTripBegin(route); trip < timetable.routeTripEnd(route); trip++) {
+            for (int i = 0; i + 1 < numStops; i++) {
+                connections.push_back({ timetable.getDeparture(trip, i), timetable.getArrival(trip, i + 1),
+                                        timetable.routeStop(timetable.routeStopBegin(route) + i),
+                                        timetable.routeStop(timetable.routeStopBegin(route) + i + 1), trip });
+            }
+        }
+    }
+    std::stable_sort(connections.begin(), connections.end());
+    
+    // Departures spread over the service day
+    std::mt19937 rng(seed);
+    std::vector<int> departures(queries.size());
+    for (int& time : departures) {
+        time = options.firstDeparture + static_cast<int>(rng() % (options.lastDeparture - options.firstDeparture));
+    }
+    
+    std::vector<Journey> journeys;
+    std::vector<int> arrivals(queries.size());
+    long long totalJourneys = 0;
+    start = Clock::now();
+    for (size_t i = 0; i < queries.size(); i++) {
+        bool found = timetable.earliestArrival(queries[i].first, queries[i].second, departures[i], journeys);
+        arrivals[i] = found ? journeys.back().arrivalTime : std::numeric_limits<int>::max();
+        totalJourneys += journeys.size();
+    }
+    double raptorSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    std::vector<int> reference(queries.size());
+    start = Clock::now();
+    for (size_t i = 0; i < queries.size(); i++) {
+        reference[i] = connectionScan(connections, graph.getNumVertices(), timetable.getNumTrips(),
+                                      timetable.getTransferSeconds(), queries[i].first, queries[i].second,
+                                      departures[i]);
+    }
+    double scanSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    // RAPTOR stops at DEFAULT_MAX_TRANSFERS; only a search with (practically)
+    // unlimited transfers must agree
+    const int UNLIMITED_TRANSFERS = 64;
+    int errors = 0, limited = 0;
+    for (size_t i = 0; i < queries.size(); i++) {
+        if (arrivals[i] != reference[i]) {
+            bool found = timetable.earliestArrival(queries[i].first, queries[i].second, departures[i], journeys,
+                                                   UNLIMITED_TRANSFERS);
+            int unlimited = found ? journeys.back().arrivalTime : std::numeric_limits<int>::max();
+            if (unlimited != reference[i]) {
+                errors++;
+            } else {
+                limited++;
+            }
+        }
+    }
+    
+    std::cout << "\n" << title << ": timetable of " << timetable.getNumRoutes() << " routes, "
+              << timetable.getNumTrips() << " trips, " << timetable.getNumStopTimes() << " stop times (generated in "
+              << std::setprecision(1) << generateSeconds * 1000 << " ms)\n";
+    std::cout << "  RAPTOR            " << std::setw(10) << std::setprecision(1)
+              << raptorSeconds * 1e6 / queries.size() << " us/query, "
+              << std::setprecision(2) << static_cast<double>(totalJourneys) / queries.size() << " Pareto journeys/query\n";
+    std::cout << "  connection scan   " << std::setw(10) << std::setprecision(1)
+              << scanSeconds * 1e6 / queries.size() << " us/query, over " << limited
+              << " transfer limit, errors: " << errors << "\n";
+}
+
+// Distances of the k shortest loopless paths by textbook Yen: a fresh,
+// complete Dijkstra for every spur and no pruning. A slow but independent
+// reference for KShortestPaths.
+std::vector<int> referenceKShortest(const Graph& graph, int src, int dest, int k) {
+    typedef std::pair<int, std::vector<int>> Candidate; // (distance, stations)
+    typedef std::pair<int, int> Entry;                  // (distance, station)
+    const int INF = std::numeric_limits<int>::max();
+    int numVertices = graph.getNumVertices();
+    std::vector<int> distance(numVertices), parent(numVertices);
+    std::vector<char> removed(numVertices);
+    
+    // Dijkstra from start over the stations not removed, without the hops
+    // from start to any of removedNext
+    auto search = [&](int start, const std::vector<int>& removedNext, std::vector<int>& path) {
+        std::fill(distance.begin(), distance.end(), INF);
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+        distance[start] = 0;
+        parent[start] = -1;
+        queue.push(Entry(0, start));
+        while (!queue.empty()) {
+            Entry current = queue.top();
+            queue.pop();
+            int u = current.second;
+            if (current.first > distance[u]) {
+                continue;
+            }
+            for (int e = graph.edgeBegin(u); e < graph.edgeEnd(u); e++) {
+                int v = graph.edgeTarget(e);
+                if (removed[v] || (u == start && std::count(removedNext.begin(), removedNext.end(), v))) {
+                    continue;
+                }
+                if (current.first + graph.edgeDistance(e) < distance[v]) {
+                    distance[v] = current.first + graph.edgeDistance(e);
+                    parent[v] = u;
+                    queue.push(Entry(distance[v], v));
+                }
+            }
+        }
+        path.clear();
+        if (distance[dest] != INF) {
+            for (int v = dest; v != -1; v = parent[v]) {
+                path.push_back(v);
+            }
+            std::reverse(path.begin(), path.end());
+        }
+        return distance[dest];
+    };
+    
+    std::vector<Candidate> accepted;
+    std::set<Candidate> candidates;
+    std::vector<int> path;
+    int first = search(src, std::vector<int>(), path);
+    if (first != INF) {
+        accepted.push_back(Candidate(first, path));
+    }
+    while (!accepted.empty() && static_cast<int>(accepted.size()) < k) {
+        const std::vector<int> last = accepted.back().second;
+        for (size_t i = 0; i + 1 < last.size(); i++) {
+            std::vector<int> root(last.begin(), last.begin() + i + 1);
+            std::fill(removed.begin(), removed.end(), 0);
+            for (size_t j = 0; j < i; j++) {
+                removed[last[j]] = 1;
+            }
+            std::vector<int> removedNext;
+            for (const Candidate& other : accepted) {
+                if (other.second.size() > i + 1 && std::equal(root.begin(), root.end(), other.second.begin())) {
+                    removedNext.push_back(other.second[i + 1]);
+                }
+            }
+            int spur = search(last[i], removedNext, path);
+            if (spur == INF) {
+                continue;
+            }
+            Candidate candidate(pathLength(graph, root) + spur, root);
+            candidate.second.insert(candidate.second.end(), path.begin() + 1, path.end());
+            candidates.insert(candidate);
+        }
+        if (candidates.empty()) {
+            break;
+        }
+        accepted.push_back(*candidates.begin());
+        candidates.erase(candidates.begin());
+    }
+    
+    std::vector<int> distances;
+    for (const Candidate& candidate : accepted) {
+        distances.push_back(candidate.first);
+    }
+    return distances;
+}
+
+// Time k shortest paths for k = 3 and k = 10 and check every answer: the
+// first route is a shortest path, routes are loopless, distinct, correctly
+// measured and in order. The first numChecked queries are also compared
+// with the textbook reference.
+void benchmarkKShortest(const std::string& title, const Graph& graph,
+                        const std::vector<std::pair<int, int>>& queries, int numChecked) {
+    KShortestPaths engine(graph);
+    KShortestContext context;
+    QueryContext dijkstraContext;
+    std::vector<int> path;
+    
+    std::cout << "\n" << title << ": k shortest paths, " << queries.size() << " queries\n";
+    const int ks[] = { 3, 10 };
+    for (int k : ks) {
+        std::vector<std::vector<Route>> results(queries.size());
+        Clock::time_point start = Clock::now();
+        for (size_t i = 0; i < queries.size(); i++) {
+            engine.query(queries[i].first, queries[i].second, k, context, results[i]);
+        }
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        
+        int errors = 0;
+        long long totalRoutes = 0;
+        for (size_t i = 0; i < queries.size(); i++) {
+            const std::vector<Route>& routes = results[i];
+            int shortest = graph.dijkstra(queries[i].first, queries[i].second, dijkstraContext, path);
+            totalRoutes += routes.size();
+            if (routes.empty() != (shortest == std::numeric_limits<int>::max()) ||
+                (!routes.empty() && routes[0].distance != shortest)) {
+                errors++;
+                continue;
+            }
+            std::set<std::vector<int>> distinct;
+            for (size_t r = 0; r < routes.size(); r++) {
+                const std::vector<int>& stations = routes[r].path;
+                std::vector<int> sorted(stations);
+                std::sort(sorted.begin(), sorted.end());
+                if (stations.front() != queries[i].first || stations.back() != queries[i].second ||
+                    std::adjacent_find(sorted.begin(), sorted.end()) != sorted.end() ||
+                    pathLength(graph, stations) != routes[r].distance ||
+                    (r > 0 && routes[r].distance < routes[r - 1].distance) ||
+                    !distinct.insert(stations).second) {
+                    errors++;
+                    break;
+                }
+            }
+        }
+        
+        // Independent check on a sample, timed for comparison
+        int checked = std::min(numChecked, static_cast<int>(queries.size()));
+        start = Clock::now();
+        for (int i = 0; i < checked; i++) {
+            std::vector<int> expected = referenceKShortest(graph, queries[i].first, queries[i].second, k);
+            bool same = expected.size() == results[i].size();
+            for (size_t r = 0; same && r < expected.size(); r++) {
+                same = expected[r] == results[i][r].distance;
+            }
+            if (!same) {
+                errors++;
+            }
+        }
+        double referenceSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+        
+        std::cout << "  k = " << std::left << std::setw(4) << k << std::right << std::setw(12)
+                  << std::setprecision(1) << seconds * 1e6 / queries.size() << " us/query, "
+                  << std::setprecision(2) << static_cast<double>(totalRoutes) / queries.size() << " routes/query";
+        if (checked > 0) {
+            std::cout << ", textbook Yen " << std::setprecision(1) << referenceSeconds * 1e6 / checked << " us/query";
+        }
+        std::cout << ", errors: " << errors << "\n";
+    }
+}
+
+// Time loadNetwork on a generated network written to temporary CSV files
+void benchmarkLoader(const Graph& graph, const std::string& title) {
+    const std::string stationsPath = "metro_bench_stations.csv";
+    const std::string linksPath = "metro_bench_links.csv";
+    if (!saveNetwork(graph, stationsPath, linksPath)) {
+        std::cout << "\n" << title << ": cannot write temporary network files\n";
+        return;
+    }
+    
+    Clock::time_point start = Clock::now();
+    Graph loaded;
+    LoadResult result = loadNetwork(loaded, stationsPath, linksPath);
+    double parseSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    loaded.freeze();
+    double totalSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    FILE* stationsFile = std::fopen(stationsPath.c_str(), "rb");
+    FILE* linksFile = std::fopen(linksPath.c_str(), "rb");
+    std::fseek(stationsFile, 0, SEEK_END);
+    std::fseek(linksFile, 0, SEEK_END);
+    double megabytes = (std::ftell(stationsFile) + std::ftell(linksFile)) / (1024.0 * 1024.0);
+    std::fclose(stationsFile);
+    std::fclose(linksFile);
+    std::remove(stationsPath.c_str());
+    std::remove(linksPath.c_str());
+    
+    std::cout << "\n" << title << ": load " << result.stations << " stations, " << result.links
+              << " links (" << std::setprecision(1) << megabytes << " MiB)"
+              << (result.ok() ? "" : ", ERRORS: " + std::to_string(result.errors.size())) << "\n";
+    std::cout << "  parse + build " << std::setw(10) << std::setprecision(1) << parseSeconds * 1000 << " ms"
+              << std::setw(10) << megabytes / parseSeconds << " MiB/s"
+              << std::setw(12) << std::setprecision(0) << (result.stations + result.links) / parseSeconds
+              << " lines/s\n";
+    std::cout << "  with freeze   " << std::setw(10) << std::setprecision(1) << totalSeconds * 1000 << " ms\n";
+}
+
+// Compare cold start from CSV (parse, freeze, all-pairs table when small
+// enough) with mapping a snapshot, and check the mapped graph answers the
+// same routes
+void benchmarkSnapshot(const Graph& graph, const std::string& title,
+                       const std::vector<std::pair<int, int>>& queries) {
+    const std::string stationsPath = "metro_bench_stations.csv";
+    const std::string linksPath = "metro_bench_links.csv";
+    const std::string snapshotPath = "metro_bench.snap";
+    std::string error;
+    if (!saveNetwork(graph, stationsPath, linksPath)) {
+        std::cout << "\n" << title << ": cannot write temporary network files\n";
+        return;
+    }
+    
+    Clock::time_point start = Clock::now();
+    Graph fromCsv;
+    loadNetwork(fromCsv, stationsPath, linksPath);
+    fromCsv.freeze();
+    fromCsv.buildAllPairs();
+    double csvSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::remove(stationsPath.c_str());
+    std::remove(linksPath.c_str());
+    
+    if (!saveSnapshot(fromCsv, snapshotPath, error)) {
+        std::cout << "\n" << title << ": " << error << "\n";
+        return;
+    }
+    
+    start = Clock::now();
+    Graph unverified;
+    bool ok = loadSnapshot(unverified, snapshotPath, error, false);
+    double mapSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    Route first;
+    if (ok && !queries.empty()) {
+        unverified.planRoute(queries[0].first, queries[0].second, first);
+    }
+    double firstQuerySeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    start = Clock::now();
+    Graph mapped;
+    ok = ok && loadSnapshot(mapped, snapshotPath, error);
+    double verifiedSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+    if (!ok) {
+        std::cout << "\n" << title << ": " << error << "\n";
+        std::remove(snapshotPath.c_str());
+        return;
+    }
+    
+    // Same file contents, so every route must match exactly
+    int errors = 0;
+    Route expected, actual;
+    for (const auto& query : queries) {
+        fromCsv.planRoute(query.first, query.second, expected);
+        mapped.planRoute(query.first, query.second, actual);
+        if (expected.distance != actual.distance || expected.fare != actual.fare ||
+            expected.travelTime != actual.travelTime || expected.path != actual.path) {
+            errors++;
+        }
+    }
+    for (int v = 0; v < graph.getNumVertices(); v++) {
+        std::string_view name = fromCsv.getStationName(v);
+        if (mapped.getStationIndex(name) != fromCsv.getStationIndex(name) ||
+            mapped.getStationLine(v) != fromCsv.getStationLine(v)) {
+            errors++;
+        }
+    }
+    
+    FILE* snapshotFile = std::fopen(snapshotPath.c_str(), "rb");
+    std::fseek(snapshotFile, 0, SEEK_END);
+    double megabytes = std::ftell(snapshotFile) / (1024.0 * 1024.0);
+    std::fclose(snapshotFile);
+    std::remove(snapshotPath.c_str());
+    
+    std::cout << "\n" << title << ": snapshot of " << std::setprecision(1) << megabytes << " MiB"
+              << (mapped.getAllPairsTable() ? " with" : " without") << " all-pairs table\n";
+    std::cout << "  CSV + prepare     " << std::setw(10) << std::setprecision(2) << csvSeconds * 1000 << " ms\n";
+    std::cout << "  map snapshot      " << std::setw(10) << mapSeconds * 1000 << " ms"
+              << std::setw(10) << std::setprecision(0) << csvSeconds / mapSeconds << "x\n";
+    std::cout << "  + first query     " << std::setw(10) << std::setprecision(2) << firstQuerySeconds * 1000 << " ms\n";
+    std::cout << "  map + checksum    " << std::setw(10) << verifiedSeconds * 1000 << " ms"
+              << ", errors: " << errors << "\n";
+}
+
+// Regression suite (--suite): one row per engine and network with
+// preprocessing time, memory, latency percentiles and throughput, on the
+// Delhi network and geometric networks up to the size limit. Results can
+// also be written as JSON (--json) to compare runs.
+
+// Figures of one engine on one network
+struct SuiteResult {
+    std::string engine;
+    double preprocessMillis;
+    long long memoryBytes;  // Resident memory added by preprocessing (approximate)
+    double p50Micros;
+    double p99Micros;
+    double p999Micros;
+    double meanMicros;
+    double queriesPerSecond;
+    int errors;             // Distances different from dijkstra
+};
+
+// One network of the suite and its results
+struct SuiteNetwork {
+    std::string name;
+    int stations;
+    int edges;
+    double buildMillis;     // Generation (or loading) plus freeze
+    long long memoryBytes;  // Resident memory added by building the graph (approximate)
+    int queries;
+    std::vector<SuiteResult> results;
+};
+
+// Resident set size of the process, or 0 where it cannot be read
+long long residentBytes() {
+#ifndef _WIN32
+    FILE* file = std::fopen("/proc/self/statm", "r");
+    if (!file) {
+        return 0;
+    }
+    long long pages = 0, resident = 0;
+    int fields = std::fscanf(file, "%lld %lld", &pages, &resident);
+    std::fclose(file);
+    return fields == 2 ? resident * sysconf(_SC_PAGESIZE) : 0;
+#else
+    return 0;
+#endif
+}
+
+// Value below which a fraction q of the sorted samples fall
+double percentile(const std::vector<double>& sorted, double q) {
+    size_t index = std::min(sorted.size() - 1, static_cast<size_t>(q * sorted.size()));
+    return sorted[index];
+}
+
+// Time every query of an engine individually. engine(src, dest, path)
+// returns the distance like Graph::dijkstra; reference is filled on the
+// first (reference) run and checked on the others.
+template <typename Engine>
+SuiteResult measureEngine(const std::string& name, const std::vector<std::pair<int, int>>& queries,
+                          std::vector<int>& reference, double preprocessMillis, long long memoryBytes,
+                          Engine engine) {
+    SuiteResult result;
+    result.engine = name;
+    result.preprocessMillis = preprocessMillis;
+    result.memoryBytes = memoryBytes;
+    result.errors = 0;
+    
+    bool isReference = reference.empty();
+    std::vector<double> micros(queries.size());
+    std::vector<int> path;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < queries.size(); i++) {
+        Clock::time_point queryStart = Clock::now();
+        int distance = engine(queries[i].first, queries[i].second, path);
+        micros[i] = std::chrono::duration<double, std::micro>(Clock::now() - queryStart).count();
+        if (isReference) {
+            reference.push_back(distance);
+        } else if (distance != reference[i]) {
+            result.errors++;
+        }
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    
+    std::sort(micros.begin(), micros.end());
+    result.p50Micros = percentile(micros, 0.5);
+    result.p99Micros = percentile(micros, 0.99);
+    result.p999Micros = percentile(micros, 0.999);
+    double total = 0;
+    for (double value : micros) {
+        total += value;
+    }
+    result.meanMicros = total / micros.size();
+    result.queriesPerSecond = queries.size() / seconds;
+    return result;
+}
+
+// Run every exact engine the network is small enough for
+void runSuiteEngines(const Graph& graph, SuiteNetwork& network, unsigned int seed) {
+    std::vector<std::pair<int, int>> queries = makeQueries(graph.getNumVertices(), network.queries, seed);
+    std::vector<int> reference;
+    
+    QueryContext context;
+    network.results.push_back(measureEngine("dijkstra", queries, reference, 0, 0,
+        [&](int src, int dest, std::vector<int>& path) { return graph.dijkstra(src, dest, context, path); }));
+    
+    BasicQueryContext<QuaternaryHeap> quaternaryContext;
+    network.results.push_back(measureEngine("dijkstra 4-ary", queries, reference, 0, 0,
+        [&](int src, int dest, std::vector<int>& path) {
+            return graph.dijkstra(src, dest, quaternaryContext, path);
+        }));
+    
+    BidirectionalContext bidirectionalContext;
+    network.results.push_back(measureEngine("bidirectional", queries, reference, 0, 0,
+        [&](int src, int dest, std::vector<int>& path) {
+            return graph.bidirectionalDijkstra(src, dest, bidirectionalContext, path);
+        }));
+    
+    {
+        long long memoryBefore = residentBytes();
+        Clock::time_point start = Clock::now();
+        LandmarkIndex landmarks;
+        landmarks.build(graph, ALT_LANDMARKS, LandmarkSelection::Avoid, seed);
+        double millis = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        network.results.push_back(measureEngine("ALT", queries, reference, millis, residentBytes() - memoryBefore,
+            [&](int src, int dest, std::vector<int>& path) { return landmarks.query(src, dest, context, path); }));
+    }
+    
+    if (graph.getNumVertices() <= SUITE_CH_MAX_STATIONS) {
+        long long memoryBefore = residentBytes();
+        ContractionHierarchy hierarchy;
+        hierarchy.build(graph);
+        network.results.push_back(measureEngine("CH", queries, reference, hierarchy.getStats().preprocessingMillis,
+                                                residentBytes() - memoryBefore,
+            [&](int src, int dest, std::vector<int>& path) {
+                return hierarchy.query(src, dest, bidirectionalContext, path);
+            }));
+    }
+    
+    // Distances only: the label merge is the query fare quotes run
+    if (graph.getNumVertices() <= SUITE_HUB_LABEL_MAX_STATIONS) {
+        HubLabels labels;
+        labels.build(graph);
+        network.results.push_back(measureEngine("hub labels", queries, reference,
+                                                labels.getStats().preprocessingMillis,
+                                                static_cast<long long>(labels.memoryBytes()),
+            [&](int src, int dest, std::vector<int>&) { return labels.distance(src, dest); }));
+    }
+    
+    if (graph.getNumVertices() <= AllPairsTable::DEFAULT_MAX_STATIONS) {
+        long long memoryBefore = residentBytes();
+        Clock::time_point start = Clock::now();
+        AllPairsTable table;
+        ThreadPool pool;
+        table.build(graph, pool);
+        double millis = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        network.results.push_back(measureEngine("all-pairs", queries, reference, millis,
+                                                std::max(residentBytes() - memoryBefore,
+                                                         static_cast<long long>(table.memoryBytes())),
+            [&](int src, int dest, std::vector<int>& path) {
+                table.buildPath(src, dest, path);
+                return table.getDistance(src, dest);
+            }));
+    }
+}
+
+// Print one network's rows
+void printSuiteNetwork(const SuiteNetwork& network) {
+    std::cout << "\n" << network.name << ": " << network.stations << " stations, " << network.edges
+              << " edges, built in " << std::fixed << std::setprecision(1) << network.buildMillis << " ms, "
+              << network.memoryBytes / (1024.0 * 1024.0) << " MiB, " << network.queries << " queries\n";
+    std::cout << "  " << std::left << std::setw(16) << "engine" << std::right << std::setw(11) << "prep ms"
+              << std::setw(10) << "MiB" << std::setw(11) << "p50 us" << std::setw(11) << "p99 us"
+              << std::setw(11) << "p99.9 us" << std::setw(12) << "queries/s" << std::setw(8) << "errors" << "\n";
+    for (const SuiteResult& result : network.results) {
+        std::cout << "  " << std::left << std::setw(16) << result.engine << std::right << std::setprecision(1)
+                  << std::setw(11) << result.preprocessMillis << std::setw(10)
+                  << result.memoryBytes / (1024.0 * 1024.0) << std::setprecision(2) << std::setw(11)
+                  << result.p50Micros << std::setw(11) << result.p99Micros << std::setw(11) << result.p999Micros
+                  << std::setprecision(0) << std::setw(12) << result.queriesPerSecond << std::setw(8)
+                  << result.errors << "\n";
+    }
+}
+
+// Write the suite's results as JSON. Returns false on I/O failure.
+bool writeSuiteJson(const std::string& path, unsigned int seed, const std::vector<SuiteNetwork>& networks) {
+    FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+    std::fprintf(file, "{\n  \"seed\": %u,\n  \"networks\": [", seed);
+    for (size_t n = 0; n < networks.size(); n++) {
+        const SuiteNetwork& network = networks[n];
+        std::fprintf(file, "%s\n    {\"name\": \"%s\", \"stations\": %d, \"edges\": %d, \"build_ms\": %.3f, "
+                     "\"memory_bytes\": %lld, \"queries\": %d, \"engines\": [",
+                     n > 0 ? "," : "", network.name.c_str(), network.stations, network.edges,
+                     network.buildMillis, network.memoryBytes, network.queries);
+        for (size_t r = 0; r < network.results.size(); r++) {
+            const SuiteResult& result = network.results[r];
+            std::fprintf(file, "%s\n      {\"engine\": \"%s\", \"preprocess_ms\": %.3f, \"memory_bytes\": %lld, "
+                         "\"p50_us\": %.3f, \"p99_us\": %.3f, \"p999_us\": %.3f, \"mean_us\": %.3f, "
+                         "\"queries_per_s\": %.1f, \"errors\": %d}",
+                         r > 0 ? "," : "", result.engine.c_str(), result.preprocessMillis, result.memoryBytes,
+                         result.p50Micros, result.p99Micros, result.p999Micros, result.meanMicros,
+                         result.queriesPerSecond, result.errors);
+        }
+        std::fprintf(file, "\n    ]}");
+    }
+    std::fprintf(file, "\n  ]\n}\n");
+    return std::fclose(file) == 0;
+}
+
+// Run the suite on the Delhi network and on geometric networks of up to
+// maxStations stops. Smaller networks get more queries, up to
+// SUITE_MAX_QUERIES, so each row takes a similar time; with fewer than 1000
+// queries p99.9 is simply the slowest query.
+int runSuite(int numQueries, unsigned int seed, int maxStations, const std::string& jsonPath) {
+    std::vector<SuiteNetwork> networks;
+    const int sizes[][2] = { { 0, 0 }, { 20, 50 }, { 50, 200 }, { 100, 1000 }, { 1000, 1500 } }; // (lines, stations per line)
+    for (const auto& size : sizes) {
+        if (size[0] * size[1] > maxStations) {
+            continue;
+        }
+        
+        SuiteNetwork network;
+        Graph graph;
+        long long memoryBefore = residentBytes();
+        Clock::time_point start = Clock::now();
+        if (size[0] == 0) {
+            network.name = "Delhi";
+            loadDelhiNetwork(graph);
+        } else {
+            SyntheticNetworkOptions options;
+            options.numLines = size[0];
+            options.stationsPerLine = size[1];
+            options.seed = seed;
+            options.layout = SyntheticLayout::Geometric;
+            options.spacing = StopSpacing::Suburban;
+            generateSyntheticNetwork(graph, options);
+            network.name = "Geometric " + std::to_string(size[0]) + "x" + std::to_string(size[1]);
+        }
+        graph.freeze();
+        network.buildMillis = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        network.memoryBytes = residentBytes() - memoryBefore;
+        network.stations = graph.getNumVertices();
+        network.edges = graph.edgeEnd(graph.getNumVertices() - 1);
+        network.queries = static_cast<int>(std::min<long long>(SUITE_MAX_QUERIES,
+            std::max<long long>(SUITE_MIN_QUERIES, numQueries * 1000LL / graph.getNumVertices())));
+        
+        runSuiteEngines(graph, network, seed);
+        printSuiteNetwork(network);
+        networks.push_back(network);
+    }
+    
+    if (!jsonPath.empty() && !writeSuiteJson(jsonPath, seed, networks)) {
+        std::cerr << "cannot write " << jsonPath << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+// Compare exact name lookup in the station index with the hash map it
+// replaced, and time completion and typo-tolerant search. A name with one
+// typo must still be found within one edit.
+void benchmarkStationIndex(const std::string& title, const Graph& graph, int numQueries, unsigned int seed) {
+    Graph copy = graph.clone();
+    Clock::time_point start = Clock::now();
+    copy.buildNameIndex();
+    double buildMillis = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    const StationIndex& index = *copy.getNameIndex();
+    
+    std::unordered_map<std::string, int> hashed;
+    for (int i = 0; i < graph.getNumVertices(); i++) {
+        hashed[std::string(graph.getStationName(i))] = i;
+    }
+    
+    // Every other lookup is of a name that does not exist
+    std::mt19937 rng(seed);
+    std::vector<std::string> names;
+    for (int q = 0; q < numQueries; q++) {
+        std::string name(graph.getStationName(static_cast<int>(rng() % graph.getNumVertices())));
+        if (q % 2 == 1) {
+            name[rng() % name.size()] = '#';
+        }
+        names.push_back(name);
+    }
+    
+    std::vector<int> reference(names.size());
+    start = Clock::now();
+    for (size_t q = 0; q < names.size(); q++) {
+        std::string_view name = names[q];
+        auto it = hashed.find(std::string(name));
+        reference[q] = it == hashed.end() ? -1 : it->second;
+    }
+    double hashMicros = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / names.size();
+    
+    int errors = 0;
+    start = Clock::now();
+    for (size_t q = 0; q < names.size(); q++) {
+        errors += index.find(names[q]) != reference[q] ? 1 : 0;
+    }
+    double findMicros = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / names.size();
+    
+    // Prefixes of lower-cased names, and names with one typo
+    std::vector<std::string> prefixes, typos;
+    std::vector<int> typoStations;
+    for (int q = 0; q < numQueries; q++) {
+        int station = static_cast<int>(rng() % graph.getNumVertices());
+        std::string name = StationIndex::fold(graph.getStationName(station));
+        prefixes.push_back(name.substr(0, 1 + rng() % name.size()));
+        if (name.size() < 7) {
+            continue;
+        }
+        size_t at = 1 + rng() % (name.size() - 2);
+        switch (rng() % 4) {
+        case 0: name[at] = name[at] == 'x' ? 'y' : 'x'; break;
+        case 1: name.erase(at, 1); break;
+        case 2: name.insert(at, 1, 'q'); break;
+        default: std::swap(name[at], name[at + 1]); break;
+        }
+        typos.push_back(name);
+        typoStations.push_back(station);
+    }
+    
+    std::vector<StationMatch> matches;
+    start = Clock::now();
+    for (const std::string& prefix : prefixes) {
+        index.complete(prefix, NAME_SUGGESTIONS, matches);
+        errors += matches.empty() ? 1 : 0;
+    }
+    double completeMicros = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / prefixes.size();
+    
+    start = Clock::now();
+    for (size_t q = 0; q < typos.size(); q++) {
+        index.search(typos[q], NAME_SUGGESTIONS, NAME_MAX_EDITS, matches);
+        errors += matches.empty() || matches[0].edits > 1 ? 1 : 0;
+    }
+    double searchMicros = typos.empty() ? 0.0 :
+        std::chrono::duration<double, std::micro>(Clock::now() - start).count() / typos.size();
+    
+    std::cout << "\n" << title << " station names (" << numQueries << " queries, index "
+              << std::fixed << std::setprecision(1) << buildMillis << " ms, "
+              << index.memoryBytes() / 1024 << " KiB)\n";
+    std::cout << "  exact, hash map     " << std::setw(10) << std::setprecision(3) << hashMicros << " us/query\n";
+    std::cout << "  exact, index        " << std::setw(10) << findMicros << " us/query  "
+              << std::setprecision(2) << hashMicros / findMicros << "x\n";
+    std::cout << "  prefix completion   " << std::setw(10) << std::setprecision(3) << completeMicros << " us/query\n";
+    std::cout << "  one-typo search     " << std::setw(10) << searchMicros << " us/query, errors: " << errors << "\n";
+}
+
+// Route rendering through by-value Station copies, as the planner used to
+void printPathByValue(std::ostream& out, const Graph& graph, const Route& route) {
+    const std::vector<int>& path = route.path;
+    if (route.lines.empty()) {
+        out << "Start at: " << graph.getStation(path[0]).getName()
+            << " (" << graph.getStation(path[0]).getLine() << ")\n";
+        for (size_t i = 1; i < path.size(); i++) {
+            Station currentStation = graph.getStation(path[i]);
+            out << "-> " << currentStation.getName() << " (" << currentStation.getLine() << ")\n";
+        }
+        return;
+    }
+    out << "Start at: " << graph.getStation(path[0]).getName()
+        << " (board " << std::string(graph.getLineName(route.lines[0])) << ")\n";
+    for (size_t i = 1; i < path.size(); i++) {
+        out << "-> " << graph.getStation(path[i]).getName()
+            << " (" << std::string(graph.getLineName(route.lines[i - 1])) << ")\n";
+        if (i < route.lines.size() && route.lines[i] != route.lines[i - 1]) {
+            out << "   Change to " << std::string(graph.getLineName(route.lines[i])) << "\n";
+        }
+    }
+}
+
+// Heap allocations and time of rendering routes and the map from the
+// interned names, against by-value copies. Output must match.
+void benchmarkRendering(const std::string& title, const Graph& graph,
+                        const std::vector<std::pair<int, int>>& queries) {
+    std::vector<Route> routes;
+    Route route;
+    for (const auto& query : queries) {
+        if (graph.planRoute(query.first, query.second, route) && !route.path.empty()) {
+            routes.push_back(route);
+        }
+    }
+    if (routes.empty()) {
+        return;
+    }
+    
+    int mismatches = 0;
+    for (size_t r = 0; r < routes.size(); r += 97) {
+        std::ostringstream expected, actual;
+        printPathByValue(expected, graph, routes[r]);
+        graph.printPath(actual, routes[r]);
+        mismatches += expected.str() != actual.str() ? 1 : 0;
+    }
+    
+    DiscardBuffer discard;
+    std::ostream out(&discard);
+    uint64_t before = heapAllocations;
+    Clock::time_point start = Clock::now();
+    for (const Route& next : routes) {
+        printPathByValue(out, graph, next);
+    }
+    double copyMicros = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / routes.size();
+    double copyAllocations = static_cast<double>(heapAllocations - before) / routes.size();
+    
+    before = heapAllocations;
+    start = Clock::now();
+    for (const Route& next : routes) {
+        graph.printPath(out, next);
+    }
+    double viewMicros = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / routes.size();
+    double viewAllocations = static_cast<double>(heapAllocations - before) / routes.size();
+    
+    std::streambuf* console = std::cout.rdbuf(&discard);
+    before = heapAllocations;
+    graph.displayMap();
+    uint64_t mapAllocations = heapAllocations - before;
+    std::cout.rdbuf(console);
+    
+    std::cout << "\n" << title << " route rendering (" << routes.size() << " routes)\n";
+    std::cout << "  " << std::left << std::setw(16) << "by-value copies" << std::right << std::fixed
+              << std::setprecision(3) << std::setw(10) << copyMicros << " us/route" << std::setprecision(1)
+              << std::setw(8) << copyAllocations << " allocations/route\n";
+    std::cout << "  " << std::left << std::setw(16) << "interned views" << std::right << std::setprecision(3)
+              << std::setw(10) << viewMicros << " us/route" << std::setprecision(1) << std::setw(8)
+              << viewAllocations << " allocations/route  " << std::setprecision(2) << copyMicros / viewMicros
+              << "x\n";
+    std::cout << "  map display: " << mapAllocations << " allocations"
+              << (mismatches == 0 ? "" : "  MISMATCHES: " + std::to_string(mismatches)) << "\n";
+}
+
+// Isochrones of many origins for each budget: one bounded search per
+// origin against a full shortest-path tree filtered afterwards, and the
+// bit-parallel multi-origin search against the bounded searches, all on
+// one thread. Every answer must hold the same stations at the same km.
+// The origins are a run of consecutive stations, as when a planner asks
+// for every station of an area (or of the whole network, repeatedly, on
+// small ones); scattered origins on a large network share no frontier and
+// gain nothing from being searched together.
+void benchmarkIsochrones(const std::string& title, const Graph& graph, int numOrigins, unsigned int seed) {
+    std::mt19937 rng(seed);
+    int first = static_cast<int>(rng() % graph.getNumVertices());
+    std::vector<int> origins(std::min(numOrigins, ISOCHRONE_MAX_ORIGINS));
+    for (size_t i = 0; i < origins.size(); i++) {
+        origins[i] = static_cast<int>((first + i) % graph.getNumVertices());
+    }
+    ThreadPool pool(1);
+    
+    std::cout << "\n" << title << " isochrones (" << origins.size() << " origins, us/origin)\n";
+    std::cout << "  " << std::left << std::setw(16) << "budget" << std::right << std::setw(10) << "stations"
+              << std::setw(12) << "full tree" << std::setw(12) << "bounded" << std::setw(14) << "bit-parallel"
+              << std::setw(10) << "speedup\n";
+    
+    const IsochroneBudget kinds[] = { IsochroneBudget::Distance, IsochroneBudget::Fare, IsochroneBudget::Time };
+    const int budgets[] = { ISOCHRONE_KM, ISOCHRONE_FARE, ISOCHRONE_MINUTES };
+    const char* names[] = { " km", " Rs", " minutes" };
+    for (int k = 0; k < 3; k++) {
+        IsochroneBudget kind = kinds[k];
+        int budget = budgets[k];
+        
+        // Reference: the whole tree, then keep what fits (shortest routes only)
+        bool fastest = kind == IsochroneBudget::Time && graph.isLineAware();
+        BasicQueryContext<BucketQueue> tree;
+        long long treeStations = 0;
+        Clock::time_point start = Clock::now();
+        for (int origin : origins) {
+            graph.shortestPathTree(origin, tree);
+            for (int v = 0; v < graph.getNumVertices(); v++) {
+                int distance = tree.getDistance(v);
+                if (distance != std::numeric_limits<int>::max() &&
+                    (kind == IsochroneBudget::Distance ? distance <= budget :
+                     kind == IsochroneBudget::Fare ? graph.calculateFare(distance) <= budget :
+                     graph.estimateTravelTime(distance, 0) <= budget)) {
+                    treeStations++;
+                }
+            }
+        }
+        double treeMicros = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / origins.size();
+        
+        // Warm both engines' per-thread scratch first
+        std::vector<std::vector<std::pair<int, int>>> bounded(origins.size());
+        Isochrone result;
+        MultiIsochrone multi;
+        isochrone(graph, origins[0], kind, budget, result);
+        multiIsochrone(graph, std::vector<int>(1, origins[0]), kind, budget, pool, multi);
+        long long stations = 0;
+        start = Clock::now();
+        for (size_t i = 0; i < origins.size(); i++) {
+            isochrone(graph, origins[i], kind, budget, result);
+            stations += result.size();
+            for (size_t s = 0; s < result.size(); s++) {
+                bounded[i].push_back(std::make_pair(result.stations[s], result.distances[s]));
+            }
+        }
+        double boundedMicros = std::chrono::duration<double, std::micro>(Clock::now() - start).count() /
+                               origins.size();
+        
+        start = Clock::now();
+        multiIsochrone(graph, origins, kind, budget, pool, multi);
+        double multiMicros = std::chrono::duration<double, std::micro>(Clock::now() - start).count() /
+                             origins.size();
+        
+        int mismatches = fastest || treeStations == stations ? 0 : 1;
+        std::vector<std::pair<int, int>> answer;
+        for (size_t i = 0; i < origins.size(); i++) {
+            answer.clear();
+            for (int s = multi.offsets[i]; s < multi.offsets[i + 1]; s++) {
+                answer.push_back(std::make_pair(multi.stations[s], multi.distances[s]));
+            }
+            std::sort(answer.begin(), answer.end());
+            std::sort(bounded[i].begin(), bounded[i].end());
+            mismatches += answer != bounded[i] ? 1 : 0;
+        }
+        
+        std::cout << "  " << std::left << std::setw(16) << std::to_string(budget) + names[k] << std::right
+                  << std::fixed << std::setprecision(1) << std::setw(10)
+                  << static_cast<double>(stations) / origins.size() << std::setprecision(2)
+                  << std::setw(12) << treeMicros << std::setw(12) << boundedMicros << std::setw(14) << multiMicros
+                  << std::setw(9) << boundedMicros / multiMicros << "x"
+                  << (fastest ? "  (fastest routes; tree is shortest)" : "")
+                  << (mismatches == 0 ? "" : "  MISMATCHES: " + std::to_string(mismatches)) << "\n";
+    }
+}
+
+// Work counted per dijkstra query, checked against the thread's totals,
+// and the cost of timing a query. Runs last on a network: the empty timed
+// scopes land in the dijkstra latency histogram.
+void benchmarkInstrumentation(const std::string& title, const Graph& graph, int numQueries, unsigned int seed) {
+    std::cout << "\n" << title << " instrumentation (" << numQueries << " queries)\n";
+    if (!instrumentation::report().enabled) {
+        std::cout << "  disabled at compile time\n";
+        return;
+    }
+    
+    std::vector<std::pair<int, int>> queries = makeQueries(graph.getNumVertices(), numQueries, seed);
+    QueryContext context;
+    std::vector<int> path;
+    ThreadStats& stats = instrumentation::local();
+    uint64_t before[NUM_COUNTERS];
+    uint64_t perQuery[NUM_COUNTERS] = {};
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        before[c] = stats.counters[c].load(std::memory_order_relaxed);
+    }
+    std::vector<double> micros;
+    micros.reserve(queries.size());
+    for (const auto& query : queries) {
+        graph.dijkstra(query.first, query.second, context, path);
+        const QueryStats& last = instrumentation::lastQuery();
+        micros.push_back(last.nanos / 1000.0);
+        for (int c = 0; c < NUM_COUNTERS; c++) {
+            perQuery[c] += last.counters[c];
+        }
+    }
+    int mismatches = 0;
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        if (stats.counters[c].load(std::memory_order_relaxed) - before[c] != perQuery[c]) {
+            mismatches++;
+        }
+    }
+    std::sort(micros.begin(), micros.end());
+    
+    std::cout << "  " << std::left << std::setw(16) << "per query" << std::right;
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        std::cout << "  " << counterName(static_cast<Counter>(c)) << " " << std::fixed << std::setprecision(1)
+                  << static_cast<double>(perQuery[c]) / queries.size();
+    }
+    std::cout << "\n  " << std::left << std::setw(16) << "latency (us)" << std::right << std::setprecision(2)
+              << "  p50 " << percentile(micros, 0.5) << "  p99 " << percentile(micros, 0.99)
+              << "  max " << micros.back() << "\n";
+    
+    Clock::time_point start = Clock::now();
+    for (int i = 0; i < TIMER_ROUNDS; i++) {
+        METRO_TIME_QUERY(Dijkstra);
+    }
+    double timerNanos = std::chrono::duration<double, std::nano>(Clock::now() - start).count() / TIMER_ROUNDS;
+    std::cout << "  " << std::left << std::setw(16) << "timing cost" << std::right << std::setprecision(1)
+              << "  " << timerNanos << " ns per query"
+              << (mismatches == 0 ? "" : "  COUNTER MISMATCHES: " + std::to_string(mismatches)) << "\n";
+}
+
+int main(int argc, char* argv[]) {
+    int numQueries = 2000;
+    unsigned int seed = 42;
+    bool suite = false;
+    int maxStations = SUITE_DEFAULT_MAX_STATIONS;
+    std::string jsonPath;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--queries" && i + 1 < argc) {
+            numQueries = std::atoi(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--suite") {
+            suite = true;
+        } else if (arg == "--max-stations" && i + 1 < argc) {
+            maxStations = std::atoi(argv[++i]);
+        } else if (arg == "--json" && i + 1 < argc) {
+            suite = true;
+            jsonPath = argv[++i];
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--queries N] [--seed S]"
+                      << " [--suite [--max-stations N] [--json FILE]]\n";
+            return 1;
+        }
+    }
+    if (suite) {
+        return runSuite(numQueries, seed, maxStations, jsonPath);
+    }
+    
+    Graph delhi;
+    loadDelhiNetwork(delhi);
+    delhi.freeze();
+    benchmarkQueues("Delhi network", delhi, numQueries * 10, seed);
+    
+    // Every ordered station pair of the Delhi network
+    std::vector<std::pair<int, int>> allPairs;
+    for (int src = 0; src < delhi.getNumVertices(); src++) {
+        for (int dest = 0; dest < delhi.getNumVertices(); dest++) {
+            allPairs.push_back(std::make_pair(src, dest));
+        }
+    }
+    benchmarkEngines("Delhi network", delhi, allPairs);
+    benchmarkHubLabels("Delhi network", delhi, allPairs);
+    benchmarkLineAware("Delhi network", delhi, allPairs);
+    benchmarkPareto("Delhi network", delhi, allPairs, static_cast<int>(allPairs.size()));
+    benchmarkTimetable("Delhi network", delhi, allPairs, seed);
+    benchmarkLiveUpdates("Delhi network", delhi, LIVE_UPDATES, seed);
+    benchmarkServer("Delhi network", delhi, numQueries * BULK_REQUESTS_PER_QUERY, seed);
+    benchmarkBatchFile("Delhi network", delhi, numQueries * BULK_REQUESTS_PER_QUERY, seed);
+    benchmarkKShortest("Delhi network", delhi, makeQueries(delhi.getNumVertices(), numQueries, seed),
+                       KSHORTEST_CHECKED_QUERIES);
+    benchmarkStationIndex("Delhi network", delhi, numQueries * 10, seed);
+    benchmarkRendering("Delhi network", delhi, allPairs);
+    benchmarkIsochrones("Delhi network", delhi, numQueries, seed);
+    benchmarkInstrumentation("Delhi network", delhi, numQueries, seed);
+    
+    const int sizes[][2] = { { 20, 50 }, { 100, 200 }, { 200, 1000 } }; // (lines, stations per line)
+    for (const auto& size : sizes) {
+        SyntheticNetworkOptions options;
+        options.numLines = size[0];
+        options.stationsPerLine = size[1];
+        options.seed = seed;
+        
+        Graph synthetic;
+        generateSyntheticNetwork(synthetic, options);
+        synthetic.freeze();
+        
+        // Scale the query count down with network size to bound run time
+        int scaledQueries = std::max(20, static_cast<int>(numQueries * 1000LL / synthetic.getNumVertices()));
+        std::string title = "Synthetic " + std::to_string(size[0]) + "x" + std::to_string(size[1]);
+        benchmarkQueues(title, synthetic, scaledQueries, seed);
+        benchmarkLoader(synthetic, title);
+        benchmarkSnapshot(synthetic, title, makeQueries(synthetic.getNumVertices(), scaledQueries, seed));
+        benchmarkBatch(title, synthetic, scaledQueries * 10, seed);
+        benchmarkServer(title, synthetic, scaledQueries * 10, seed);
+        benchmarkBatchFile(title, synthetic, scaledQueries * 10, seed);
+        if (synthetic.getNumVertices() <= AllPairsTable::DEFAULT_MAX_STATIONS) {
+            benchmarkLiveUpdates(title, synthetic, LIVE_UPDATES, seed);
+        }
+        if (synthetic.getNumVertices() <= CACHE_MAX_STATIONS) {
+            benchmarkRouteCache(title, synthetic, CACHE_QUERIES, seed);
+        }
+        benchmarkLineAware(title, synthetic, makeQueries(synthetic.getNumVertices(), scaledQueries, seed));
+        benchmarkPareto(title, synthetic, makeQueries(synthetic.getNumVertices(), scaledQueries, seed),
+                        synthetic.getNumVertices() <= PARETO_CHECK_MAX_STATIONS ? PARETO_CHECKED_QUERIES : 0);
+        if (synthetic.getNumVertices() <= TIMETABLE_MAX_STATIONS) {
+            benchmarkTimetable(title, synthetic, makeQueries(synthetic.getNumVertices(), scaledQueries, seed), seed);
+        }
+        benchmarkEngines(title, synthetic, makeQueries(synthetic.getNumVertices(), scaledQueries, seed));
+        benchmarkHubLabels(title, synthetic, makeQueries(synthetic.getNumVertices(), scaledQueries, seed));
+        benchmarkKShortest(title, synthetic, makeQueries(synthetic.getNumVertices(), scaledQueries, seed),
+                           synthetic.getNumVertices() <= KSHORTEST_CHECK_MAX_STATIONS ? KSHORTEST_CHECKED_QUERIES / 10 : 0);
+        benchmarkStationIndex(title, synthetic, numQueries * 10, seed);
+        benchmarkRendering(title, synthetic, makeQueries(synthetic.getNumVertices(), scaledQueries, seed));
+        benchmarkIsochrones(title, synthetic, scaledQueries * 10, seed);
+        benchmarkDeltaStepping(title, synthetic, std::max(DELTA_MIN_TREES, scaledQueries / 10), seed);
+        benchmarkInstrumentation(title, synthetic, scaledQueries, seed);
+    }
+    
+    // Regional scale: over a million stations, where one tree is worth
+    // spreading over cores
+    SyntheticNetworkOptions options;
+    options.numLines = DELTA_LARGE_NETWORK[0];
+    options.stationsPerLine = DELTA_LARGE_NETWORK[1];
+    options.seed = seed;
+    options.layout = SyntheticLayout::Geometric;
+    options.spacing = StopSpacing::Suburban;
+    Graph regional;
+    generateSyntheticNetwork(regional, options);
+    regional.freeze();
+    benchmarkDeltaStepping("Geometric " + std::to_string(DELTA_LARGE_NETWORK[0]) + "x" +
+                           std::to_string(DELTA_LARGE_NETWORK[1]), regional, DELTA_MIN_TREES, seed);
+    
+    return 0;
+}
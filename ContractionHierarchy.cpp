@@ -0,0 +1,320 @@
+#include "ContractionHierarchy.h"
+#include "Instrumentation.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+// Edge of the shrinking graph used while contracting
+struct ContractionEdge {
+    int target;
+    int distance;
+    int middle; // Bypassed vertex for shortcuts, -1 for real edges
+};
+
+// A shortcut found while contracting one vertex
+struct Shortcut {
+    int from;
+    int to;
+    int distance;
+};
+
+typedef std::vector<std::vector<ContractionEdge>> ContractionGraph;
+typedef BasicQueryContext<QuaternaryHeap> WitnessContext;
+
+// Settled-vertex budget of one witness search. A search that gives up
+// early only costs an unnecessary shortcut, never a wrong answer.
+static const int WITNESS_SETTLE_LIMIT = 500;
+
+// Keep a single edge per neighbour pair: the shortest one
+static void addOrImprove(std::vector<ContractionEdge>& edges, int target, int distance, int middle) {
+    for (ContractionEdge& edge : edges) {
+        if (edge.target == target) {
+            if (distance < edge.distance) {
+                edge.distance = distance;
+                edge.middle = middle;
+            }
+            return;
+        }
+    }
+    edges.push_back({ target, distance, middle });
+}
+
+// Bounded Dijkstra from source that never passes through skip. Afterwards
+// context.getDistance(w) is the length of some real path to w (or INT_MAX).
+static void witnessSearch(const ContractionGraph& graph, int source, int skip, int bound,
+                          WitnessContext& context) {
+    context.reset(static_cast<int>(graph.size()), 0);
+    QuaternaryHeap& queue = context.getQueue();
+    context.update(source, 0, -1);
+    queue.insert(source, 0);
+    
+    int settled = 0;
+    while (!queue.isEmpty() && settled < WITNESS_SETTLE_LIMIT) {
+        std::pair<int, int> current = queue.extractMin();
+        if (current.first > bound) {
+            break;
+        }
+        settled++;
+        
+        for (const ContractionEdge& edge : graph[current.second]) {
+            if (edge.target == skip) {
+                continue;
+            }
+            int candidate = current.first + edge.distance;
+            if (candidate < context.getDistance(edge.target)) {
+                context.update(edge.target, candidate, current.second);
+                queue.insert(edge.target, candidate);
+            }
+        }
+    }
+}
+
+// Find the shortcuts needed to remove v from the graph. Only pairs with
+// no witness path of equal or shorter length need one.
+static void findShortcuts(const ContractionGraph& graph, int v, WitnessContext& context,
+                          std::vector<Shortcut>& shortcuts) {
+    shortcuts.clear();
+    const std::vector<ContractionEdge>& neighbours = graph[v];
+    
+    // Every neighbour but the last has partners after it. The bound may be
+    // 0 (zero-length connections), which still needs a witness.
+    for (size_t i = 0; i + 1 < neighbours.size(); i++) {
+        int maxVia = 0;
+        for (size_t j = i + 1; j < neighbours.size(); j++) {
+            maxVia = std::max(maxVia, neighbours[i].distance + neighbours[j].distance);
+        }
+        
+        witnessSearch(graph, neighbours[i].target, v, maxVia, context);
+        for (size_t j = i + 1; j < neighbours.size(); j++) {
+            int via = neighbours[i].distance + neighbours[j].distance;
+            if (context.getDistance(neighbours[j].target) > via) {
+                shortcuts.push_back({ neighbours[i].target, neighbours[j].target, via });
+            }
+        }
+    }
+}
+
+// Contraction priority: edge difference plus contracted-neighbour count,
+// which spreads contraction evenly across the network
+static int contractionPriority(const ContractionGraph& graph, int v, const std::vector<int>& deleted,
+                               WitnessContext& context, std::vector<Shortcut>& shortcuts) {
+    findShortcuts(graph, v, context, shortcuts);
+    return static_cast<int>(shortcuts.size()) - static_cast<int>(graph[v].size()) + deleted[v];
+}
+
+ContractionHierarchy::ContractionHierarchy() : numVertices(0), stats() {}
+
+void ContractionHierarchy::build(const Graph& graph) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    
+    numVertices = graph.getNumVertices();
+    stats = ContractionStats();
+    
+    // Working copy of the graph with parallel edges and self loops removed
+    ContractionGraph working(numVertices);
+    for (int u = 0; u < numVertices; u++) {
+        for (int e = graph.edgeBegin(u); e < graph.edgeEnd(u); e++) {
+            if (graph.edgeTarget(e) != u) {
+                addOrImprove(working[u], graph.edgeTarget(e), graph.edgeDistance(e), -1);
+            }
+        }
+        stats.originalEdges += static_cast<int>(working[u].size());
+    }
+    stats.originalEdges /= 2;
+    
+    WitnessContext context;
+    std::vector<Shortcut> shortcuts;
+    std::vector<int> deleted(numVertices, 0);
+    std::vector<std::vector<ContractionEdge>> upward(numVertices);
+    
+    QuaternaryHeap order;
+    order.reset(numVertices);
+    for (int v = 0; v < numVertices; v++) {
+        order.insert(v, contractionPriority(working, v, deleted, context, shortcuts));
+    }
+    
+    rank.assign(numVertices, 0);
+    int nextRank = 0;
+    while (!order.isEmpty()) {
+        std::pair<int, int> current = order.extractMin();
+        int v = current.second;
+        
+        // Priorities are refreshed lazily: recompute on extraction and
+        // requeue if the vertex became less attractive meanwhile
+        int priority = contractionPriority(working, v, deleted, context, shortcuts);
+        if (priority > current.first) {
+            order.insert(v, priority);
+            continue;
+        }
+        
+        // Remaining neighbours all outrank v: they become its upward edges
+        rank[v] = nextRank++;
+        upward[v] = working[v];
+        for (const ContractionEdge& edge : working[v]) {
+            std::vector<ContractionEdge>& edges = working[edge.target];
+            for (size_t i = 0; i < edges.size(); i++) {
+                if (edges[i].target == v) {
+                    edges[i] = edges.back();
+                    edges.pop_back();
+                    break;
+                }
+            }
+            deleted[edge.target]++;
+        }
+        for (const Shortcut& shortcut : shortcuts) {
+            addOrImprove(working[shortcut.from], shortcut.to, shortcut.distance, v);
+            addOrImprove(working[shortcut.to], shortcut.from, shortcut.distance, v);
+        }
+        stats.shortcuts += static_cast<int>(shortcuts.size());
+        working[v].clear();
+    }
+    
+    // Pack the upward edges into CSR form
+    upOffsets.assign(numVertices + 1, 0);
+    for (int v = 0; v < numVertices; v++) {
+        upOffsets[v + 1] = upOffsets[v] + static_cast<int>(upward[v].size());
+    }
+    upTargets.resize(upOffsets[numVertices]);
+    upDistances.resize(upOffsets[numVertices]);
+    upMiddle.resize(upOffsets[numVertices]);
+    for (int v = 0; v < numVertices; v++) {
+        int e = upOffsets[v];
+        for (const ContractionEdge& edge : upward[v]) {
+            upTargets[e] = edge.target;
+            upDistances[e] = edge.distance;
+            upMiddle[e] = edge.middle;
+            e++;
+        }
+    }
+    stats.upwardEdges = upOffsets[numVertices];
+    
+    stats.preprocessingMillis = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+bool ContractionHierarchy::isBuilt() const {
+    return !upOffsets.empty();
+}
+
+int ContractionHierarchy::findEdge(int a, int b) const {
+    int lower = rank[a] < rank[b] ? a : b;
+    int higher = lower == a ? b : a;
+    for (int e = upOffsets[lower]; e < upOffsets[lower + 1]; e++) {
+        if (upTargets[e] == higher) {
+            return e;
+        }
+    }
+    return -1;
+}
+
+void ContractionHierarchy::unpackEdge(int from, int to, std::vector<int>& path) const {
+    int middle = upMiddle[findEdge(from, to)];
+    if (middle == -1) {
+        path.push_back(to);
+        return;
+    }
+    unpackEdge(from, middle, path);
+    unpackEdge(middle, to, path);
+}
+
+std::pair<int, std::vector<int>> ContractionHierarchy::query(int src, int dest) const {
+    std::vector<int> path;
+    int distance = query(src, dest, BidirectionalContext::local(), path);
+    return std::make_pair(distance, path);
+}
+
+int ContractionHierarchy::query(int src, int dest, BidirectionalContext& context, std::vector<int>& path) const {
+    METRO_TIME_QUERY(Hierarchy);
+    const int INF = std::numeric_limits<int>::max();
+    QueryContext* sides[2] = { &context.getForward(), &context.getBackward() };
+    sides[0]->reset(numVertices, 0);
+    sides[1]->reset(numVertices, 0);
+    sides[0]->update(src, 0, -1);
+    sides[0]->getQueue().insert(src, 0);
+    sides[1]->update(dest, 0, -1);
+    sides[1]->getQueue().insert(dest, 0);
+    
+    int best = INF;
+    int meeting = -1;
+    bool done[2] = { false, false };
+    int side = 0;
+    int settled = 0;
+    int relaxed = 0;
+    
+    while (!done[0] || !done[1]) {
+        if (done[side]) {
+            side = 1 - side;
+        }
+        QueryContext& self = *sides[side];
+        QueryContext& other = *sides[1 - side];
+        MinHeap& queue = self.getQueue();
+        
+        if (queue.isEmpty()) {
+            done[side] = true;
+            continue;
+        }
+        std::pair<int, int> current = queue.extractMin();
+        int u = current.second;
+        int distanceU = current.first;
+        
+        // Nothing further up this side can improve the best route
+        if (distanceU >= best) {
+            done[side] = true;
+            continue;
+        }
+        
+        // Both searches have reached u: a candidate route through it
+        int otherDistance = other.getDistance(u);
+        if (otherDistance != INF && distanceU + otherDistance < best) {
+            best = distanceU + otherDistance;
+            meeting = u;
+        }
+        
+        // Stall-on-demand: if a higher neighbour already offers a shorter
+        // way to u, u's label is not optimal and need not be expanded
+        bool stalled = false;
+        for (int e = upOffsets[u]; e < upOffsets[u + 1]; e++) {
+            int neighbourDistance = self.getDistance(upTargets[e]);
+            if (neighbourDistance != INF && neighbourDistance + upDistances[e] < distanceU) {
+                stalled = true;
+                break;
+            }
+        }
+        
+        settled++;
+        if (!stalled) {
+            relaxed += upOffsets[u + 1] - upOffsets[u];
+            for (int e = upOffsets[u]; e < upOffsets[u + 1]; e++) {
+                int v = upTargets[e];
+                int candidate = distanceU + upDistances[e];
+                if (candidate < self.getDistance(v)) {
+                    self.update(v, candidate, u);
+                    queue.insert(v, candidate);
+                }
+            }
+        }
+        side = 1 - side;
+    }
+    METRO_COUNT(SettledNodes, settled);
+    METRO_COUNT(RelaxedEdges, relaxed);
+    
+    path.clear();
+    if (best == INF) {
+        return INF;
+    }
+    
+    // Unpack meeting -> src (reversed into source-first order), then meeting -> dest
+    path.push_back(meeting);
+    for (int v = meeting, p = sides[0]->getParent(v); p != -1; v = p, p = sides[0]->getParent(v)) {
+        unpackEdge(v, p, path);
+    }
+    std::reverse(path.begin(), path.end());
+    for (int v = meeting, p = sides[1]->getParent(v); p != -1; v = p, p = sides[1]->getParent(v)) {
+        unpackEdge(v, p, path);
+    }
+    return best;
+}
+
+const ContractionStats& ContractionHierarchy::getStats() const {
+    return stats;
+}
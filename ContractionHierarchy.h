@@ -0,0 +1,63 @@
+#ifndef CONTRACTION_HIERARCHY_H
+#define CONTRACTION_HIERARCHY_H
+
+#include <vector>
+#include <utility>
+#include "Graph.h"
+#include "QueryContext.h"
+
+// Figures reported after building a contraction hierarchy
+struct ContractionStats {
+    double preprocessingMillis; // Wall time of build()
+    int originalEdges;          // Undirected edges in the input graph
+    int shortcuts;              // Shortcut edges added during contraction
+    int upwardEdges;            // Edges kept in the query graph
+};
+
+// Contraction hierarchy over a frozen Graph.
+// Vertices are contracted one by one in order of importance; whenever the
+// only shortest path between two neighbours runs through the contracted
+// vertex, a shortcut edge remembering that middle vertex is added. Queries
+// are a bidirectional Dijkstra that only climbs towards more important
+// vertices, so they settle a few dozen vertices even on large networks.
+// The hierarchy is a snapshot: rebuild it after the graph changes.
+class ContractionHierarchy {
+private:
+    int numVertices;
+    std::vector<int> rank; // Contraction order of each vertex
+    
+    // Upward CSR: edges from each vertex to its higher-ranked neighbours.
+    // upMiddle is the contracted vertex a shortcut bypasses (-1 for a real edge).
+    std::vector<int> upOffsets;
+    std::vector<int> upTargets;
+    std::vector<int> upDistances;
+    std::vector<int> upMiddle;
+    
+    ContractionStats stats;
+
+    // Index of the upward edge joining a and b (stored at the lower-ranked end)
+    int findEdge(int a, int b) const;
+    
+    // Append the real stations strictly after from, up to and including to
+    void unpackEdge(int from, int to, std::vector<int>& path) const;
+
+public:
+    ContractionHierarchy();
+    
+    // Contract every vertex of the graph (which must be frozen)
+    void build(const Graph& graph);
+    
+    // Check if build() has run
+    bool isBuilt() const;
+    
+    // Shortest distance and station sequence; same contract as Graph::dijkstra
+    std::pair<int, std::vector<int>> query(int src, int dest) const;
+    
+    // Allocation-free variant using the caller's reusable context
+    int query(int src, int dest, BidirectionalContext& context, std::vector<int>& path) const;
+    
+    // Preprocessing figures from the last build()
+    const ContractionStats& getStats() const;
+};
+
+#endif // CONTRACTION_HIERARCHY_H
@@ -0,0 +1,90 @@
+#ifndef CSV_SCANNER_H
+#define CSV_SCANNER_H
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+// Single-pass cursor over the CSV records of an in-memory file.
+// Fields are returned as views into the buffer. Blank lines are skipped
+// but counted, so getLine() is the record's line within the scanned range.
+class CsvScanner {
+private:
+    const char* pos;
+    const char* end;
+    int line; // Line number of the record last returned
+
+public:
+    CsvScanner(const std::vector<char>& buffer)
+        : pos(buffer.data()), end(buffer.data() + buffer.size()), line(0) {}
+    
+    // Scan [begin, end), which must start at the beginning of a line
+    CsvScanner(const char* begin, const char* end) : pos(begin), end(end), line(0) {}
+    
+    int getLine() const { return line; }
+    
+    // Split the next non-blank line into fields. Returns false at end of
+    // input; on a malformed line returns true with error set.
+    bool next(std::vector<std::string_view>& fields, const char*& error) {
+        fields.clear();
+        error = nullptr;
+        
+        while (pos < end) {
+            const char* newline = static_cast<const char*>(std::memchr(pos, '\n', end - pos));
+            const char* lineEnd = newline ? newline : end;
+            const char* cursor = pos;
+            pos = newline ? newline + 1 : end;
+            line++;
+            
+            // Ignore a trailing carriage return and blank lines
+            if (lineEnd > cursor && lineEnd[-1] == '\r') {
+                lineEnd--;
+            }
+            if (cursor == lineEnd) {
+                continue;
+            }
+            
+            while (true) {
+                while (cursor < lineEnd && (*cursor == ' ' || *cursor == '\t')) {
+                    cursor++;
+                }
+                
+                const char* fieldEnd;
+                if (cursor < lineEnd && *cursor == '"') {
+                    const char* start = cursor + 1;
+                    const char* close = std::find(start, lineEnd, '"');
+                    if (close == lineEnd) {
+                        error = "unterminated quoted field";
+                        return true;
+                    }
+                    fields.push_back(std::string_view(start, close - start));
+                    fieldEnd = close + 1;
+                    while (fieldEnd < lineEnd && (*fieldEnd == ' ' || *fieldEnd == '\t')) {
+                        fieldEnd++;
+                    }
+                    if (fieldEnd < lineEnd && *fieldEnd != ',') {
+                        error = *fieldEnd == '"' ? "escaped quotes are not supported"
+                                                 : "unexpected text after quoted field";
+                        return true;
+                    }
+                } else {
+                    fieldEnd = std::find(cursor, lineEnd, ',');
+                    const char* last = fieldEnd;
+                    while (last > cursor && (last[-1] == ' ' || last[-1] == '\t')) {
+                        last--;
+                    }
+                    fields.push_back(std::string_view(cursor, last - cursor));
+                }
+                
+                if (fieldEnd >= lineEnd) {
+                    return true;
+                }
+                cursor = fieldEnd + 1;
+            }
+        }
+        return false;
+    }
+};
+
+#endif // CSV_SCANNER_H
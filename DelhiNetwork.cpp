@@ -0,0 +1,70 @@
+#include "DelhiNetwork.h"
+
+void loadDelhiNetwork(Graph& graph) {
+    // Add stations with their lines
+    graph.addStation("Rajiv Chowk", "Blue & Yellow Line");
+    graph.addStation("Kashmere Gate", "Red & Yellow Line");
+    graph.addStation("Central Secretariat", "Yellow & Violet Line");
+    graph.addStation("Mandi House", "Blue & Violet Line");
+    graph.addStation("Yamuna Bank", "Blue Line");
+    graph.addStation("Inderlok", "Red & Green Line");
+    graph.addStation("Kirti Nagar", "Blue & Green Line");
+    graph.addStation("Welcome", "Red & Pink Line");
+    graph.addStation("Netaji Subhash Place", "Pink & Red Line");
+    graph.addStation("Azadpur", "Yellow & Pink Line");
+    graph.addStation("Dhaula Kuan", "Orange Line");
+    graph.addStation("New Delhi", "Yellow & Orange Line");
+    graph.addStation("Dwarka Sector 21", "Blue & Orange Line");
+    graph.addStation("Botanical Garden", "Blue & Magenta Line");
+    graph.addStation("Janakpuri West", "Blue & Magenta Line");
+    graph.addStation("Lajpat Nagar", "Violet & Pink Line");
+    graph.addStation("Mayur Vihar Phase-1", "Blue & Pink Line");
+    graph.addStation("Anand Vihar", "Blue & Pink Line");
+    graph.addStation("Saket", "Yellow Line");
+    graph.addStation("Chandni Chowk", "Yellow Line");
+    
+    // Add connections between stations (with distances in km and the line
+    // that runs them)
+    // Blue Line connections
+    graph.addEdge("Rajiv Chowk", "Mandi House", 2, "Blue Line");
+    graph.addEdge("Mandi House", "Yamuna Bank", 6, "Blue Line");
+    graph.addEdge("Rajiv Chowk", "Kirti Nagar", 7, "Blue Line");
+    graph.addEdge("Kirti Nagar", "Janakpuri West", 9, "Blue Line");
+    graph.addEdge("Yamuna Bank", "Anand Vihar", 8, "Blue Line");
+    graph.addEdge("Botanical Garden", "Janakpuri West", 38, "Magenta Line");
+    graph.addEdge("Yamuna Bank", "Mayur Vihar Phase-1", 3, "Blue Line");
+    
+    // Yellow Line connections
+    graph.addEdge("Rajiv Chowk", "Central Secretariat", 3, "Yellow Line");
+    graph.addEdge("Central Secretariat", "Saket", 10, "Yellow Line");
+    graph.addEdge("Rajiv Chowk", "New Delhi", 1, "Yellow Line");
+    graph.addEdge("New Delhi", "Chandni Chowk", 2, "Yellow Line");
+    graph.addEdge("Chandni Chowk", "Kashmere Gate", 2, "Yellow Line");
+    graph.addEdge("Kashmere Gate", "Azadpur", 8, "Yellow Line");
+    
+    // Red Line connections
+    graph.addEdge("Kashmere Gate", "Inderlok", 7, "Red Line");
+    graph.addEdge("Inderlok", "Netaji Subhash Place", 5, "Red Line");
+    graph.addEdge("Kashmere Gate", "Welcome", 5, "Red Line");
+    
+    // Green Line connections
+    graph.addEdge("Inderlok", "Kirti Nagar", 8, "Green Line");
+    
+    // Violet Line connections
+    graph.addEdge("Central Secretariat", "Mandi House", 2, "Violet Line");
+    graph.addEdge("Mandi House", "Lajpat Nagar", 6, "Violet Line");
+    
+    // Orange Line (Airport Express) connections
+    graph.addEdge("New Delhi", "Dhaula Kuan", 7, "Orange Line");
+    graph.addEdge("Dhaula Kuan", "Dwarka Sector 21", 15, "Orange Line");
+    
+    // Pink Line connections
+    graph.addEdge("Azadpur", "Netaji Subhash Place", 4, "Pink Line");
+    graph.addEdge("Netaji Subhash Place", "Welcome", 12, "Pink Line");
+    graph.addEdge("Welcome", "Anand Vihar", 10, "Pink Line");
+    graph.addEdge("Anand Vihar", "Mayur Vihar Phase-1", 6, "Pink Line");
+    graph.addEdge("Mayur Vihar Phase-1", "Lajpat Nagar", 10, "Pink Line");
+    
+    // Magenta Line connections - Fixed duplicate
+    // graph.addEdge("Botanical Garden", "Janakpuri West", 38); // Already added above
+}
@@ -0,0 +1,10 @@
+#ifndef DELHI_NETWORK_H
+#define DELHI_NETWORK_H
+
+#include "Graph.h"
+
+// Add the built-in Delhi Metro stations and connections to a graph.
+// The graph is left unfrozen so callers can extend it before freeze().
+void loadDelhiNetwork(Graph& graph);
+
+#endif // DELHI_NETWORK_H
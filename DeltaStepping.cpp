@@ -0,0 +1,214 @@
+#include "DeltaStepping.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+DeltaStepping::DeltaStepping(const Graph& graph, ThreadPool& pool, int delta)
+    : graph(&graph), pool(&pool), delta(1), numBuckets(0), capacity(0), source(-1) {
+    if (!graph.isFrozen()) {
+        throw std::logic_error("Graph must be frozen before querying");
+    }
+    setDelta(delta == 0 ? suggestDelta(graph) : delta);
+}
+
+void DeltaStepping::setDelta(int delta) {
+    if (delta <= 0) {
+        throw std::invalid_argument("Delta must be positive");
+    }
+    this->delta = delta;
+    numBuckets = graph->getMaxEdgeDistance() / delta + 2;
+}
+
+int DeltaStepping::getDelta() const {
+    return delta;
+}
+
+int DeltaStepping::suggestDelta(const Graph& graph) {
+    int numVertices = graph.getNumVertices();
+    int numEdges = numVertices == 0 ? 0 : graph.edgeEnd(numVertices - 1);
+    long long total = 0;
+    for (int e = 0; e < numEdges; e++) {
+        total += graph.edgeDistance(e);
+    }
+    // Four mean edge lengths per bucket (see the header)
+    return numEdges == 0 ? 1 : std::max(1, static_cast<int>(4 * total / numEdges));
+}
+
+template <typename Task>
+void DeltaStepping::forChunks(int count, Task task) {
+    int numChunks = (count + CHUNK_STATIONS - 1) / CHUNK_STATIONS;
+    if (static_cast<int>(chunks.size()) < numChunks) {
+        chunks.resize(numChunks);
+    }
+    auto run = [&task, count](int chunk) {
+        task(chunk, chunk * CHUNK_STATIONS, std::min(count, (chunk + 1) * CHUNK_STATIONS));
+    };
+    if (numChunks == 1) {
+        run(0);
+    } else if (numChunks > 1) {
+        pool->parallelFor(numChunks, run);
+    }
+}
+
+void DeltaStepping::runPhase(const std::vector<int>& stations, int bucket, bool heavy) {
+    int count = static_cast<int>(stations.size());
+    forChunks(count, [this, &stations, bucket, heavy](int c, int begin, int end) {
+        Chunk& chunk = chunks[c];
+        chunk.improved.clear();
+        chunk.taken.clear();
+        for (int i = begin; i < end; i++) {
+            int u = stations[i];
+            int distance = distances[u].load(std::memory_order_relaxed);
+            if (!heavy) {
+                // A station queued twice at one distance is relaxed once.
+                // Plain loads and stores suffice: two workers seeing the
+                // same station at once only repeat idempotent relaxations.
+                if (relaxedAt[u].load(std::memory_order_relaxed) == distance) {
+                    continue;
+                }
+                relaxedAt[u].store(distance, std::memory_order_relaxed);
+                if (takenIn[u].load(std::memory_order_relaxed) != bucket) {
+                    takenIn[u].store(bucket, std::memory_order_relaxed);
+                    chunk.taken.push_back(u);
+                }
+            }
+            for (int e = graph->edgeBegin(u); e < graph->edgeEnd(u); e++) {
+                int length = graph->edgeDistance(e);
+                if ((length > delta) == heavy && relax(graph->edgeTarget(e), distance + length)) {
+                    chunk.improved.push_back(graph->edgeTarget(e));
+                }
+            }
+        }
+    });
+
+    // Queue improved stations by their distance now; a station improved
+    // again after being queued is found twice and relaxed once
+    int numChunks = (count + CHUNK_STATIONS - 1) / CHUNK_STATIONS;
+    for (int c = 0; c < numChunks; c++) {
+        for (int v : chunks[c].improved) {
+            buckets[distances[v].load(std::memory_order_relaxed) / delta % numBuckets].push_back(v);
+        }
+        taken.insert(taken.end(), chunks[c].taken.begin(), chunks[c].taken.end());
+    }
+}
+
+void DeltaStepping::chooseParents() {
+    const int INF = std::numeric_limits<int>::max();
+    int numVertices = graph->getNumVertices();
+    forChunks(numVertices, [this, INF](int c, int begin, int end) {
+        Chunk& chunk = chunks[c];
+        chunk.orphans.clear();
+        for (int v = begin; v < end; v++) {
+            int distance = getDistance(v);
+            int parent = -1;
+            int parentDistance = INF;
+            if (v != source && distance != INF) {
+                for (int e = graph->edgeBegin(v); e < graph->edgeEnd(v); e++) {
+                    int u = graph->edgeTarget(e);
+                    int d = getDistance(u);
+                    if (d < distance && d + graph->edgeDistance(e) == distance &&
+                        (d < parentDistance || (d == parentDistance && u < parent))) {
+                        parent = u;
+                        parentDistance = d;
+                    }
+                }
+                if (parent == -1) {
+                    chunk.orphans.push_back(v); // Reached over zero-length connections only
+                }
+            }
+            parents[v] = parent;
+        }
+    });
+
+    // Stations reached only over zero-length connections hang off the
+    // lowest-numbered neighbour at the same distance that already has a
+    // parent, so the tree has no cycles
+    int numChunks = (numVertices + CHUNK_STATIONS - 1) / CHUNK_STATIONS;
+    frontier.clear();
+    for (int c = 0; c < numChunks; c++) {
+        frontier.insert(frontier.end(), chunks[c].orphans.begin(), chunks[c].orphans.end());
+    }
+    while (!frontier.empty()) {
+        size_t kept = 0;
+        for (int v : frontier) {
+            int parent = -1;
+            for (int e = graph->edgeBegin(v); e < graph->edgeEnd(v); e++) {
+                int u = graph->edgeTarget(e);
+                if (graph->edgeDistance(e) == 0 && getDistance(u) == getDistance(v) &&
+                    (u == source || parents[u] != -1) && (parent == -1 || u < parent)) {
+                    parent = u;
+                }
+            }
+            if (parent == -1) {
+                frontier[kept++] = v;
+            } else {
+                parents[v] = parent;
+            }
+        }
+        frontier.resize(kept);
+    }
+}
+
+void DeltaStepping::shortestPathTree(int src) {
+    METRO_TIME_QUERY(DeltaStepping);
+    const int INF = std::numeric_limits<int>::max();
+    int numVertices = graph->getNumVertices();
+    if (capacity < numVertices) {
+        capacity = numVertices;
+        distances.reset(new std::atomic<int>[capacity]);
+        relaxedAt.reset(new std::atomic<int>[capacity]);
+        takenIn.reset(new std::atomic<int>[capacity]);
+    }
+    parents.resize(numVertices);
+    forChunks(numVertices, [this, INF](int, int begin, int end) {
+        for (int v = begin; v < end; v++) {
+            distances[v].store(INF, std::memory_order_relaxed);
+            relaxedAt[v].store(-1, std::memory_order_relaxed);
+            takenIn[v].store(-1, std::memory_order_relaxed);
+        }
+    });
+
+    source = src;
+    buckets.resize(numBuckets);
+    for (std::vector<int>& bucket : buckets) {
+        bucket.clear();
+    }
+    distances[src].store(0, std::memory_order_relaxed);
+    buckets[0].push_back(src);
+
+    // Empty the buckets in order; after numBuckets empty ones in a row no
+    // station is queued anywhere
+    for (int bucket = 0, empty = 0; empty < numBuckets; bucket++) {
+        std::vector<int>& current = buckets[bucket % numBuckets];
+        if (current.empty()) {
+            empty++;
+            continue;
+        }
+        empty = 0;
+
+        // Light edges until the bucket stays empty, then heavy edges of
+        // every station taken from it
+        taken.clear();
+        while (!current.empty()) {
+            frontier.swap(current);
+            current.clear();
+            runPhase(frontier, bucket, false);
+        }
+        frontier.swap(taken);
+        taken.clear();
+        runPhase(frontier, bucket, true);
+    }
+
+    chooseParents();
+}
+
+void DeltaStepping::buildPath(int dest, std::vector<int>& path) const {
+    path.clear();
+    if (getDistance(dest) == std::numeric_limits<int>::max()) {
+        return;
+    }
+    for (int v = dest; v != -1; v = getParent(v)) {
+        path.push_back(v);
+    }
+    std::reverse(path.begin(), path.end());
+}
@@ -0,0 +1,124 @@
+#ifndef DELTA_STEPPING_H
+#define DELTA_STEPPING_H
+
+#include <vector>
+#include <atomic>
+#include <memory>
+#include "Graph.h"
+#include "ThreadPool.h"
+
+// One-to-all shortest-path trees by parallel delta-stepping (Meyer and
+// Sanders), for networks large enough that one tree is worth spreading
+// over cores.
+//
+// Stations wait in buckets of width delta by tentative distance. The
+// smallest non-empty bucket is emptied in phases: its stations, split into
+// chunks run on the pool, relax their light edges (at most delta long),
+// which may refill the same bucket; once it stays empty the stations taken
+// from it, whose distances are now final, relax their heavy edges in one
+// more phase. Distances are lowered with compare-and-swap, so stations can
+// be relaxed by any worker in any order; workers only wait for each other
+// at the end of a phase. A small delta does little wasted work but needs
+// many phases; a large one the reverse (delta = 1 is Dial's algorithm, and
+// a delta above every edge Bellman-Ford).
+//
+// Distances are the same as Graph::dijkstra's for any delta and number of
+// threads. Parents are chosen once the distances are known, the same way
+// each time: of the neighbours a shortest route can arrive from, the
+// nearest to the source, then the lowest-numbered. This is dijkstra's tree
+// wherever that nearest neighbour is unique.
+//
+// The object keeps references to the graph and the pool, which must
+// outlive it; the graph must stay frozen and unchanged. Trees are grown one
+// at a time.
+class DeltaStepping {
+private:
+    const Graph* graph;
+    ThreadPool* pool;
+    int delta;
+    int numBuckets; // Slots of the circular bucket array: one more than a distance can be ahead
+
+    // Per-station state of the current tree
+    int capacity;
+    std::unique_ptr<std::atomic<int>[]> distances;
+    std::unique_ptr<std::atomic<int>[]> relaxedAt; // Distance the light edges were last relaxed at
+    std::unique_ptr<std::atomic<int>[]> takenIn;   // Last bucket the station was taken from
+    std::vector<int> parents;
+    int source;
+
+    // Output of one chunk of a phase
+    struct Chunk {
+        std::vector<int> improved; // Stations whose distance it lowered
+        std::vector<int> taken;    // Stations it took from the bucket for the first time
+        std::vector<int> orphans;  // Stations it found no parent for (choosing parents)
+    };
+
+    std::vector<std::vector<int>> buckets; // Bucket b is slot b % numBuckets
+    std::vector<int> frontier;
+    std::vector<int> taken;                // Stations taken from the current bucket
+    std::vector<Chunk> chunks;
+
+    // Lower a station's distance if candidate is smaller
+    bool relax(int vertex, int candidate) {
+        std::atomic<int>& distance = distances[vertex];
+        int current = distance.load(std::memory_order_relaxed);
+        while (candidate < current) {
+            if (distance.compare_exchange_weak(current, candidate, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Run task(chunk, begin, end) over [0, count) in chunks, on the pool
+    // when there is more than one
+    template <typename Task>
+    void forChunks(int count, Task task);
+
+    // Relax the light (or heavy) edges of stations in bucket b, then queue
+    // every improved station in its bucket
+    void runPhase(const std::vector<int>& stations, int bucket, bool heavy);
+
+    // Choose every station's parent from the final distances
+    void chooseParents();
+
+public:
+    // Stations per chunk of work handed to a worker
+    static const int CHUNK_STATIONS = 1024;
+
+    // delta = 0 picks suggestDelta(graph)
+    DeltaStepping(const Graph& graph, ThreadPool& pool, int delta = 0);
+
+    // Bucket width: a positive number of km
+    void setDelta(int delta);
+    int getDelta() const;
+
+    // A delta that does well on metro-like networks: four times the mean
+    // edge length (at least 1). At the mean itself a bucket holds about one
+    // hop of the frontier, too little work per phase to share between
+    // workers; at four times it holds a few hops, nearly every edge is
+    // still light, and few stations are relaxed again. In the benchmark's
+    // one-thread sweep it is the fastest delta on the 1.1M-station network
+    // and within about a third of the fastest on the smaller ones.
+    static int suggestDelta(const Graph& graph);
+
+    // Grow the tree of every station reachable from src
+    void shortestPathTree(int src);
+
+    // Distance of a station in the last tree (INT_MAX if not reached)
+    int getDistance(int vertex) const {
+        return distances[vertex].load(std::memory_order_relaxed);
+    }
+
+    // Predecessor of a station in the last tree (-1 for the source and
+    // stations not reached)
+    int getParent(int vertex) const {
+        return parents[vertex];
+    }
+
+    // Write the route from the last tree's source to dest into path, source
+    // first (empty if dest was not reached)
+    void buildPath(int dest, std::vector<int>& path) const;
+};
+
+#endif // DELTA_STEPPING_H
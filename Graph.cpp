@@ -1,10 +1,15 @@
 #include "Graph.h"
-#include "Heap.h"
+#include "ThreadPool.h"
+#include "NetworkSnapshot.h"
+#include "RouteCache.h"
+#include "StationIndex.h"
 #include <iostream>
 #include <algorithm>
 #include <limits>
 #include <queue>
 #include <cmath>
+#include <stdexcept>
+#include <atomic>
 
 // Station class implementation
 Station::Station() : name(""), line("") {}
@@ -20,8 +25,16 @@ std::string Station::getLine() const {
     return line; 
 }
 
+std::string_view Station::getNameView() const {
+    return name;
+}
+
+std::string_view Station::getLineView() const {
+    return line;
+}
+
 // Edge class implementation
-Edge::Edge(int dest, int dist) : destination(dest), distance(dist) {}
+Edge::Edge(int dest, int dist, int line) : destination(dest), distance(dist), line(line) {}
 
 int Edge::getDestination() const { 
     return destination; 
@@ -31,118 +44,563 @@ int Edge::getDistance() const {
     return distance; 
 }
 
+int Edge::getLine() const {
+    return line;
+}
+
+// Route implementation
+Route::Route() : distance(-1), fare(0), travelTime(0), lineChanges(0) {}
+
+// Route cache option keys of the cached queries
+enum CachedQuery {
+    CACHED_PLANNED_ROUTE = 0,
+    CACHED_SHORTEST_PATH = 1 // Plus the SearchAlgorithm
+};
+
+// Next graph version. One counter serves every graph, so versions are
+// never reused even when a graph is replaced by another.
+static unsigned long long nextVersion() {
+    static std::atomic<unsigned long long> counter(0);
+    return ++counter;
+}
+
 // Graph class implementation
-Graph::Graph() : numVertices(0) {}
+Graph::Graph()
+    : numVertices(0), frozen(false), maxEdgeDistance(0), lineAware(false),
+      csrOffsets(nullptr), csrTargets(nullptr), csrDistances(nullptr), csrLines(nullptr),
+      csrStates(nullptr), csrStateOffsets(nullptr), csrStateLines(nullptr), csrStateStations(nullptr),
+      version(nextVersion()) {}
 
-void Graph::addStation(const std::string& name, const std::string& line) {
-    stations.push_back(Station(name, line));
-    stationIndices[name] = numVertices;
+// Split a station's line string into line names and pass each to emit:
+// "Blue & Yellow Line" -> "Blue Line", "Yellow Line". Names are views into
+// lines; only a name missing the shared suffix is copied, to append it.
+template <typename Emit>
+static void forEachLineName(std::string_view lines, Emit emit) {
+    const std::string_view separator = " & ";
+    const std::string_view suffix = " Line";
+    auto hasSuffix = [&suffix](std::string_view name) {
+        return name.size() >= suffix.size() && name.substr(name.size() - suffix.size()) == suffix;
+    };
+    
+    // The shared suffix is only written once, on the last name
+    size_t lastSeparator = lines.rfind(separator);
+    std::string_view last = lines.substr(lastSeparator == std::string_view::npos ? 0 : lastSeparator + separator.size());
+    bool shared = last.size() > suffix.size() && hasSuffix(last);
+    
+    std::string suffixed;
+    size_t start = 0;
+    while (true) {
+        size_t end = lines.find(separator, start);
+        std::string_view name = lines.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+        if (shared && !hasSuffix(name)) {
+            suffixed.assign(name.data(), name.size());
+            suffixed += suffix;
+            emit(std::string_view(suffixed));
+        } else {
+            emit(name);
+        }
+        if (end == std::string_view::npos) {
+            break;
+        }
+        start = end + separator.size();
+    }
+}
+
+void Graph::addStation(std::string_view name, std::string_view line) {
+    requireMutable();
+    int nameId = strings.intern(name);
+    stationNameIds.push_back(nameId);
+    stationLineTextIds.push_back(strings.intern(line));
+    stationIndices[nameId] = numVertices;
+    
+    std::vector<int> ids;
+    if (!line.empty()) {
+        forEachLineName(line, [this, &ids](std::string_view lineName) {
+            ids.push_back(addLine(lineName));
+        });
+    }
+    stationLineIds.push_back(ids);
     adjacencyList.push_back(std::list<Edge>());
     numVertices++;
+    frozen = false;
+    allPairs.reset();
+    version = nextVersion();
 }
 
-void Graph::addEdge(const std::string& src, const std::string& dest, int distance) {
+int Graph::addLine(std::string_view name) {
+    requireMutable();
+    int nameId = strings.intern(name);
+    auto it = lineIds.find(nameId);
+    if (it != lineIds.end()) {
+        return it->second;
+    }
+    lineNameIds.push_back(nameId);
+    lineIds[nameId] = static_cast<int>(lineNameIds.size()) - 1;
+    return static_cast<int>(lineNameIds.size()) - 1;
+}
+
+void Graph::addEdge(std::string_view src, std::string_view dest, int distance, std::string_view line) {
+    int srcIndex = getStationIndex(src);
+    int destIndex = getStationIndex(dest);
+    
     // Check if both stations exist
-    if (!hasStation(src) || !hasStation(dest)) {
+    if (srcIndex == -1 || destIndex == -1) {
         std::cerr << "Error: One or both stations do not exist: " << src << ", " << dest << std::endl;
         return;
     }
     
-    int srcIndex = stationIndices[src];
-    int destIndex = stationIndices[dest];
+    addEdge(srcIndex, destIndex, distance, line.empty() ? NO_LINE : addLine(line));
+}
+
+void Graph::addEdge(int srcIndex, int destIndex, int distance, int line) {
+    requireMutable();
+    
+    // Infer the line shared by both stations when it is unambiguous
+    if (line == NO_LINE) {
+        int shared = 0;
+        for (int candidate : stationLineIds[srcIndex]) {
+            const std::vector<int>& other = stationLineIds[destIndex];
+            if (std::find(other.begin(), other.end(), candidate) != other.end()) {
+                line = candidate;
+                shared++;
+            }
+        }
+        if (shared != 1) {
+            line = NO_LINE;
+        }
+    }
     
     // Add edge in both directions (undirected graph)
-    adjacencyList[srcIndex].push_back(Edge(destIndex, distance));
-    adjacencyList[destIndex].push_back(Edge(srcIndex, distance));
+    adjacencyList[srcIndex].push_back(Edge(destIndex, distance, line));
+    adjacencyList[destIndex].push_back(Edge(srcIndex, distance, line));
+    frozen = false;
+    allPairs.reset();
+    version = nextVersion();
 }
 
-bool Graph::hasStation(const std::string& name) const {
-    return stationIndices.find(name) != stationIndices.end();
+bool Graph::hasStations(int a, int b) const {
+    return a >= 0 && a < numVertices && b >= 0 && b < numVertices;
 }
 
-int Graph::getStationIndex(const std::string& name) const {
-    auto it = stationIndices.find(name);
-    if (it != stationIndices.end()) {
-        return it->second;
+bool Graph::closeConnection(int a, int b, ThreadPool* pool) {
+    requireMutable();
+    int oldDistance = getConnectionDistance(a, b);
+    if (oldDistance == std::numeric_limits<int>::max()) {
+        return false;
     }
-    return -1; // Station not found
+    
+    // Each undirected edge is recorded once, from a's list
+    for (auto it = adjacencyList[a].begin(); it != adjacencyList[a].end();) {
+        if (it->getDestination() == b) {
+            closedConnections.push_back({ a, b, it->getDistance(), it->getLine() });
+            it = adjacencyList[a].erase(it);
+        } else {
+            ++it;
+        }
+    }
+    adjacencyList[b].remove_if([a](const Edge& edge) { return edge.getDestination() == a; });
+    connectionChanged(a, b, oldDistance, pool);
+    return true;
 }
 
-Station Graph::getStation(int index) const {
-    if (index >= 0 && index < static_cast<int>(stations.size())) {
-        return stations[index];
+bool Graph::reopenConnection(int a, int b, ThreadPool* pool) {
+    requireMutable();
+    if (!hasStations(a, b)) {
+        return false;
     }
-    return Station(); // Return empty station if index is invalid
+    int oldDistance = getConnectionDistance(a, b);
+    bool reopened = false;
+    for (auto it = closedConnections.begin(); it != closedConnections.end();) {
+        if ((it->a == a && it->b == b) || (it->a == b && it->b == a)) {
+            adjacencyList[it->a].push_back(Edge(it->b, it->distance, it->line));
+            adjacencyList[it->b].push_back(Edge(it->a, it->distance, it->line));
+            it = closedConnections.erase(it);
+            reopened = true;
+        } else {
+            ++it;
+        }
+    }
+    if (reopened) {
+        connectionChanged(a, b, oldDistance, pool);
+    }
+    return reopened;
 }
 
-std::vector<std::string> Graph::getAllStations() const {
-    std::vector<std::string> stationNames;
-    for (const auto& station : stations) {
-        stationNames.push_back(station.getName());
+bool Graph::setConnectionDistance(int a, int b, int distance, ThreadPool* pool) {
+    requireMutable();
+    if (distance < 0) {
+        throw std::invalid_argument("Connection distance must not be negative");
     }
-    return stationNames;
+    int oldDistance = getConnectionDistance(a, b);
+    if (oldDistance == std::numeric_limits<int>::max()) {
+        return false;
+    }
+    
+    for (Edge& edge : adjacencyList[a]) {
+        if (edge.getDestination() == b) {
+            edge = Edge(b, distance, edge.getLine());
+        }
+    }
+    for (Edge& edge : adjacencyList[b]) {
+        if (edge.getDestination() == a) {
+            edge = Edge(a, distance, edge.getLine());
+        }
+    }
+    connectionChanged(a, b, oldDistance, pool);
+    return true;
+}
+
+int Graph::getConnectionDistance(int a, int b) const {
+    int distance = std::numeric_limits<int>::max();
+    if (!hasStations(a, b)) {
+        return distance;
+    }
+    if (frozen) {
+        for (int e = csrOffsets[a]; e < csrOffsets[a + 1]; e++) {
+            if (csrTargets[e] == b) {
+                distance = std::min(distance, csrDistances[e]);
+            }
+        }
+        return distance;
+    }
+    for (const Edge& edge : adjacencyList[a]) {
+        if (edge.getDestination() == b) {
+            distance = std::min(distance, edge.getDistance());
+        }
+    }
+    return distance;
 }
 
-void Graph::printPath(const std::vector<int>& parent, int dest, std::vector<int>& path) {
-    if (parent[dest] == -1) {
-        path.push_back(dest);
+void Graph::connectionChanged(int a, int b, int oldDistance, ThreadPool* pool) {
+    version = nextVersion();
+    if (!frozen) {
+        allPairs.reset();
         return;
     }
-    printPath(parent, parent[dest], path);
-    path.push_back(dest);
+    
+    freeze();
+    if (allPairs) {
+        std::shared_ptr<AllPairsTable> table = std::make_shared<AllPairsTable>();
+        table->repair(*this, *allPairs, a, b, oldDistance, getConnectionDistance(a, b), pool);
+        allPairs = table;
+    }
 }
 
-std::pair<int, std::vector<int>> Graph::dijkstra(int src, int dest) {
-    std::vector<int> distance(numVertices, std::numeric_limits<int>::max());
-    std::vector<int> parent(numVertices, -1);
-    MinHeap minHeap(numVertices);
+Graph Graph::clone() const {
+    Graph copy;
+    if (snapshot) {
+        // Rebuild the mutable form from the mapped arrays. Lines are added
+        // first so they keep their ids, and CSR order is kept so the copy
+        // freezes to identical arrays.
+        for (int line = 0; line < snapshot->getNumLines(); line++) {
+            copy.addLine(snapshot->getLineName(line));
+        }
+        for (int i = 0; i < numVertices; i++) {
+            copy.addStation(stationName(i), stationLine(i));
+        }
+        for (int u = 0; u < numVertices; u++) {
+            for (int e = csrOffsets[u]; e < csrOffsets[u + 1]; e++) {
+                copy.adjacencyList[u].push_back(Edge(csrTargets[e], csrDistances[e], csrLines[e]));
+            }
+        }
+    } else {
+        copy.numVertices = numVertices;
+        copy.adjacencyList = adjacencyList;
+        copy.strings = strings;
+        copy.stationNameIds = stationNameIds;
+        copy.stationLineTextIds = stationLineTextIds;
+        copy.stationIndices = stationIndices;
+        copy.lineNameIds = lineNameIds;
+        copy.lineIds = lineIds;
+        copy.stationLineIds = stationLineIds;
+        copy.closedConnections = closedConnections;
+        copy.nameIndex = nameIndex;
+    }
     
-    // Distance of source vertex from itself is 0
-    distance[src] = 0;
-    minHeap.insert(src, 0);
+    if (frozen) {
+        copy.freeze();
+    }
+    copy.allPairs = allPairs;
+    copy.routeCache = routeCache;
+    copy.version = version;
+    return copy;
+}
+
+void Graph::freeze() {
+    if (snapshot) {
+        return; // Already in its query layout
+    }
     
-    // Process vertices
-    while (!minHeap.isEmpty()) {
-        // Extract the vertex with minimum distance
-        std::pair<int, int> current = minHeap.extractMin();
-        int u = current.second;
-        
-        // If we reached the destination, we can stop
-        if (u == dest) {
-            break;
+    edgeOffsets.assign(numVertices + 1, 0);
+    for (int i = 0; i < numVertices; i++) {
+        edgeOffsets[i + 1] = edgeOffsets[i] + static_cast<int>(adjacencyList[i].size());
+    }
+    
+    // Pack edges in insertion order so neighbour iteration order is unchanged
+    edgeTargets.resize(edgeOffsets[numVertices]);
+    edgeDistances.resize(edgeOffsets[numVertices]);
+    edgeLines.resize(edgeOffsets[numVertices]);
+    maxEdgeDistance = 0;
+    lineAware = false;
+    for (int i = 0; i < numVertices; i++) {
+        int e = edgeOffsets[i];
+        for (const Edge& edge : adjacencyList[i]) {
+            edgeTargets[e] = edge.getDestination();
+            edgeDistances[e] = edge.getDistance();
+            edgeLines[e] = edge.getLine();
+            maxEdgeDistance = std::max(maxEdgeDistance, edgeDistances[e]);
+            lineAware = lineAware || edgeLines[e] != NO_LINE;
+            e++;
         }
-        
-        // Update distance value of adjacent vertices
-        for (const Edge& edge : adjacencyList[u]) {
-            int v = edge.getDestination();
-            int weight = edge.getDistance();
-            
-            // If there is a shorter path to v through u
-            if (distance[u] != std::numeric_limits<int>::max() && 
-                distance[u] + weight < distance[v]) {
-                distance[v] = distance[u] + weight;
-                parent[v] = u;
-                
-                // Update distance in min heap
-                if (minHeap.contains(v)) {
-                    minHeap.decreaseKey(v, distance[v]);
-                } else {
-                    minHeap.insert(v, distance[v]);
-                }
+    }
+    
+    // One state per distinct line at each station. The graph is undirected,
+    // so the lines arriving at a station are the lines of its own edges.
+    stateOffsets.assign(numVertices + 1, 0);
+    stateLines.clear();
+    stateStations.clear();
+    for (int v = 0; v < numVertices; v++) {
+        stateOffsets[v] = static_cast<int>(stateLines.size());
+        for (int e = edgeOffsets[v]; e < edgeOffsets[v + 1]; e++) {
+            if (std::find(stateLines.begin() + stateOffsets[v], stateLines.end(), edgeLines[e]) == stateLines.end()) {
+                stateLines.push_back(edgeLines[e]);
+                stateStations.push_back(v);
             }
         }
     }
+    stateOffsets[numVertices] = static_cast<int>(stateLines.size());
     
-    // Reconstruct path
-    std::vector<int> path;
-    if (distance[dest] != std::numeric_limits<int>::max()) {
-        printPath(parent, dest, path);
+    edgeStates.resize(edgeOffsets[numVertices]);
+    for (int e = 0; e < edgeOffsets[numVertices]; e++) {
+        int v = edgeTargets[e];
+        int state = stateOffsets[v];
+        while (stateLines[state] != edgeLines[e]) {
+            state++;
+        }
+        edgeStates[e] = state;
     }
     
-    return std::make_pair(distance[dest], path);
+    csrOffsets = edgeOffsets.data();
+    csrTargets = edgeTargets.data();
+    csrDistances = edgeDistances.data();
+    csrLines = edgeLines.data();
+    csrStates = edgeStates.data();
+    csrStateOffsets = stateOffsets.data();
+    csrStateLines = stateLines.data();
+    csrStateStations = stateStations.data();
+    frozen = true;
+    
+    // Stations are only ever added, so an index of as many is current
+    if (!nameIndex || nameIndex->size() != numVertices) {
+        buildNameIndex();
+    }
+}
+
+bool Graph::isFrozen() const {
+    return frozen;
+}
+
+void Graph::attachSnapshot(std::shared_ptr<const NetworkSnapshot> snapshot) {
+    std::shared_ptr<RouteCache> cache = routeCache;
+    *this = Graph();
+    routeCache = cache;
+    this->snapshot = snapshot;
+    numVertices = snapshot->getNumVertices();
+    csrOffsets = snapshot->getEdgeOffsets();
+    csrTargets = snapshot->getEdgeTargets();
+    csrDistances = snapshot->getEdgeDistances();
+    csrLines = snapshot->getEdgeLines();
+    csrStates = snapshot->getEdgeStates();
+    csrStateOffsets = snapshot->getStateOffsets();
+    csrStateLines = snapshot->getStateLines();
+    csrStateStations = snapshot->getStateStations();
+    maxEdgeDistance = snapshot->getMaxEdgeDistance();
+    lineAware = snapshot->isLineAware();
+    frozen = true;
+    
+    if (snapshot->hasAllPairs()) {
+        std::shared_ptr<AllPairsTable> table = std::make_shared<AllPairsTable>();
+        table->attach(numVertices, snapshot->getPairDistances(), snapshot->getPairNextHops(),
+                      snapshot->getPairFares(), snapshot->getPairTravelTimes(),
+                      snapshot->getPairLineChanges(), snapshot);
+        allPairs = table;
+    }
+}
+
+bool Graph::isSnapshot() const {
+    return snapshot != nullptr;
+}
+
+unsigned long long Graph::getVersion() const {
+    return version;
+}
+
+void Graph::setRouteCache(std::shared_ptr<RouteCache> cache) {
+    routeCache = cache;
+}
+
+RouteCache* Graph::getRouteCache() const {
+    return routeCache.get();
+}
+
+int Graph::getNumVertices() const {
+    return numVertices;
+}
+
+int Graph::getMaxEdgeDistance() const {
+    return maxEdgeDistance;
+}
+
+int Graph::getNumLines() const {
+    if (snapshot) {
+        return snapshot->getNumLines();
+    }
+    return static_cast<int>(lineNameIds.size());
 }
 
-int Graph::calculateFare(int distance) {
+std::string_view Graph::getLineName(int line) const {
+    if (line < 0 || line >= getNumLines()) {
+        return std::string_view();
+    }
+    if (snapshot) {
+        return snapshot->getLineName(line);
+    }
+    return strings.get(lineNameIds[line]);
+}
+
+int Graph::getLineId(std::string_view name) const {
+    if (snapshot) {
+        // Networks have a handful of lines; a scan beats building a map
+        for (int line = 0; line < snapshot->getNumLines(); line++) {
+            if (snapshot->getLineName(line) == name) {
+                return line;
+            }
+        }
+        return NO_LINE;
+    }
+    auto it = lineIds.find(strings.find(name));
+    return it != lineIds.end() ? it->second : NO_LINE;
+}
+
+bool Graph::isLineAware() const {
+    return lineAware;
+}
+
+void Graph::requireFrozen() const {
+    if (!frozen) {
+        throw std::logic_error("Graph must be frozen before querying");
+    }
+}
+
+void Graph::requireMutable() const {
+    if (snapshot) {
+        throw std::logic_error("Graph loaded from a snapshot is read-only");
+    }
+}
+
+std::string_view Graph::stationName(int index) const {
+    if (snapshot) {
+        return snapshot->getStationName(index);
+    }
+    return strings.get(stationNameIds[index]);
+}
+
+std::string_view Graph::stationLine(int index) const {
+    if (snapshot) {
+        return snapshot->getStationLine(index);
+    }
+    return strings.get(stationLineTextIds[index]);
+}
+
+bool Graph::buildAllPairs(int numThreads, int maxStations) {
+    requireFrozen();
+    
+    allPairs.reset();
+    if (numVertices > maxStations) {
+        return false;
+    }
+    
+    std::shared_ptr<AllPairsTable> table = std::make_shared<AllPairsTable>();
+    ThreadPool pool(numThreads);
+    table->build(*this, pool);
+    allPairs = table;
+    return true;
+}
+
+const AllPairsTable* Graph::getAllPairsTable() const {
+    return allPairs.get();
+}
+
+bool Graph::hasStation(std::string_view name) const {
+    return getStationIndex(name) != -1;
+}
+
+int Graph::getStationIndex(std::string_view name) const {
+    if (snapshot) {
+        return snapshot->findStation(name);
+    }
+    if (frozen && nameIndex) {
+        return nameIndex->find(name);
+    }
+    auto it = stationIndices.find(strings.find(name));
+    if (it != stationIndices.end()) {
+        return it->second;
+    }
+    return -1; // Station not found
+}
+
+Station Graph::getStation(int index) const {
+    if (index >= 0 && index < numVertices) {
+        return Station(std::string(stationName(index)), std::string(stationLine(index)));
+    }
+    return Station(); // Return empty station if index is invalid
+}
+
+void Graph::buildNameIndex() {
+    std::vector<std::string_view> names;
+    names.reserve(numVertices);
+    for (int i = 0; i < numVertices; i++) {
+        names.push_back(stationName(i));
+    }
+    std::shared_ptr<StationIndex> index = std::make_shared<StationIndex>();
+    index->build(names);
+    nameIndex = index;
+}
+
+const StationIndex* Graph::getNameIndex() const {
+    return nameIndex.get();
+}
+
+std::string_view Graph::getStationName(int index) const {
+    return stationName(index);
+}
+
+std::string_view Graph::getStationLine(int index) const {
+    return stationLine(index);
+}
+
+std::vector<std::string> Graph::getAllStations() const {
+    std::vector<std::string> stationNames;
+    stationNames.reserve(numVertices);
+    for (int i = 0; i < numVertices; i++) {
+        stationNames.push_back(std::string(stationName(i)));
+    }
+    return stationNames;
+}
+
+std::pair<int, std::vector<int>> Graph::dijkstra(int src, int dest) const {
+    std::vector<int> path;
+    int distance = dijkstra(src, dest, QueryContext::local(), path);
+    return std::make_pair(distance, path);
+}
+
+std::pair<int, std::vector<int>> Graph::bidirectionalDijkstra(int src, int dest) const {
+    std::vector<int> path;
+    int distance = bidirectionalDijkstra(src, dest, BidirectionalContext::local(), path);
+    return std::make_pair(distance, path);
+}
+
+int Graph::calculateFare(int distance) const {
     if (distance <= 0) return 0;
     if (distance <= 2) return 10;
     if (distance <= 5) return 20;
@@ -152,12 +610,81 @@ int Graph::calculateFare(int distance) {
     return 60; // for distances > 32 km
 }
 
-int Graph::estimateTravelTime(int distance, int changes) {
+int Graph::estimateTravelTime(int distance, int changes) const {
     // 1 km = 1.5 mins, each interchange adds 2 mins
     return static_cast<int>(std::round(distance * 1.5 + changes * 2));
 }
 
-std::pair<int, std::vector<int>> Graph::shortestPath(const std::string& srcName, const std::string& destName) {
+int Graph::estimateLineChanges(int numStations) const {
+    // Rough heuristic: assume a change every four stations on longer trips
+    if (numStations <= 2) {
+        return 0;
+    }
+    return numStations / 4;
+}
+
+bool Graph::planRoute(int src, int dest, Route& route) const {
+    METRO_TIME_QUERY(PlanRoute);
+    
+    // The all-pairs table answers queries directly, but only without line
+    // data: line-aware routes are searched every time and worth caching
+    if (!routeCache || (allPairs && !lineAware)) {
+        return computeRoute(src, dest, route);
+    }
+    if (routeCache->lookup(src, dest, CACHED_PLANNED_ROUTE, version, route)) {
+        return route.distance >= 0;
+    }
+    
+    // Unreachable pairs are cached too, as a route with distance -1
+    bool found = computeRoute(src, dest, route);
+    routeCache->insert(src, dest, CACHED_PLANNED_ROUTE, version, route);
+    return found;
+}
+
+bool Graph::computeRoute(int src, int dest, Route& route) const {
+    if (lineAware) {
+        if (!fastestRoute(src, dest, QueryContext::local(), route)) {
+            route = Route();
+            return false;
+        }
+        return true;
+    }
+    
+    // Without line data no hop has a known line and changes are estimated
+    route.lines.clear();
+    route.interchanges.clear();
+    if (allPairs) {
+        if (allPairs->getDistance(src, dest) == std::numeric_limits<int>::max()) {
+            route = Route();
+            return false;
+        }
+        route.distance = allPairs->getDistance(src, dest);
+        route.fare = allPairs->getFare(src, dest);
+        route.lineChanges = allPairs->getLineChanges(src, dest);
+        route.travelTime = allPairs->getTravelTime(src, dest);
+        if (route.travelTime == AllPairsTable::MAX_TRAVEL_TIME) {
+            // Clamped in the table; the rare longer trip is worked out again
+            route.travelTime = estimateTravelTime(route.distance, route.lineChanges);
+        }
+        allPairs->buildPath(src, dest, route.path);
+        return true;
+    }
+    
+    int distance = dijkstra(src, dest, QueryContext::local(), route.path);
+    if (distance == std::numeric_limits<int>::max()) {
+        route.distance = -1;
+        route.path.clear();
+        return false;
+    }
+    route.distance = distance;
+    route.fare = calculateFare(distance);
+    route.lineChanges = estimateLineChanges(static_cast<int>(route.path.size()));
+    route.travelTime = estimateTravelTime(distance, route.lineChanges);
+    return true;
+}
+
+std::pair<int, std::vector<int>> Graph::shortestPath(const std::string& srcName, const std::string& destName,
+                                                     SearchAlgorithm algorithm) const {
     int src = getStationIndex(srcName);
     int dest = getStationIndex(destName);
     
@@ -165,21 +692,75 @@ std::pair<int, std::vector<int>> Graph::shortestPath(const std::string& srcName,
         return std::make_pair(-1, std::vector<int>()); // Invalid stations
     }
     
-    return dijkstra(src, dest);
+    if (allPairs) {
+        std::vector<int> path;
+        allPairs->buildPath(src, dest, path);
+        return std::make_pair(allPairs->getDistance(src, dest), path);
+    }
+    
+    const int INF = std::numeric_limits<int>::max();
+    int options = CACHED_SHORTEST_PATH + static_cast<int>(algorithm);
+    Route route;
+    if (routeCache && routeCache->lookup(src, dest, options, version, route)) {
+        return std::make_pair(route.distance < 0 ? INF : route.distance, route.path);
+    }
+    
+    std::pair<int, std::vector<int>> result = algorithm == SearchAlgorithm::Bidirectional
+                                              ? bidirectionalDijkstra(src, dest) : dijkstra(src, dest);
+    if (routeCache) {
+        // Stored with fare and time so the entry is a complete answer
+        if (result.first != INF) {
+            route.distance = result.first;
+            route.fare = calculateFare(result.first);
+            route.lineChanges = estimateLineChanges(static_cast<int>(result.second.size()));
+            route.travelTime = estimateTravelTime(result.first, route.lineChanges);
+            route.path = result.second;
+        }
+        routeCache->insert(src, dest, options, version, route);
+    }
+    return result;
 }
 
 void Graph::displayMap() const {
+    requireFrozen();
+    
     std::cout << "\n===== Delhi Metro Map =====\n";
     for (int i = 0; i < numVertices; i++) {
-        const Station& station = stations[i];
-        std::cout << "Station: " << station.getName() << " (Line: " << station.getLine() << ")\n";
+        std::cout << "Station: " << stationName(i) << " (Line: " << stationLine(i) << ")\n";
         std::cout << "  Connected to: ";
         
-        for (const Edge& edge : adjacencyList[i]) {
-            std::cout << stations[edge.getDestination()].getName() 
-                      << " (" << edge.getDistance() << " km) ";
+        for (int e = csrOffsets[i]; e < csrOffsets[i + 1]; e++) {
+            std::cout << stationName(csrTargets[e]) 
+                      << " (" << csrDistances[e] << " km) ";
         }
         std::cout << "\n";
     }
     std::cout << "==========================\n";
+}
+
+void Graph::printPath(std::ostream& out, const Route& route) const {
+    const std::vector<int>& path = route.path;
+    if (path.empty()) {
+        return;
+    }
+    if (route.lines.empty()) {
+        for (size_t i = 0; i < path.size(); i++) {
+            out << (i == 0 ? "Start at: " : "-> ") << stationName(path[i]) << " (" << stationLine(path[i]) << ")\n";
+        }
+        return;
+    }
+    
+    // Each hop is shown with the line it is travelled on; a connection
+    // without one (the links file's line column is optional) shows the
+    // station's line string instead and never counts as a change
+    out << "Start at: " << stationName(path[0]) << " (board "
+        << (route.lines[0] == NO_LINE ? stationLine(path[0]) : getLineName(route.lines[0])) << ")\n";
+    for (size_t i = 1; i < path.size(); i++) {
+        int line = route.lines[i - 1];
+        out << "-> " << stationName(path[i]) << " ("
+            << (line == NO_LINE ? stationLine(path[i]) : getLineName(line)) << ")\n";
+        if (i < route.lines.size() && Graph::isLineChange(route.lines[i - 1], route.lines[i])) {
+            out << "   Change to " << getLineName(route.lines[i]) << "\n";
+        }
+    }
 }
\ No newline at end of file
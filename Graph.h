@@ -3,11 +3,23 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <list>
+#include <limits>
+#include <memory>
+#include <algorithm>
+#include <iosfwd>
+#include "QueryContext.h"
+#include "AllPairsTable.h"
+#include "Instrumentation.h"
+#include "StringArena.h"
 
-// Forward declaration of MinHeap class
-class MinHeap;
+class NetworkSnapshot;
+class RouteCache;
+class StationIndex;
+class StationNameList;
+class ThreadPool;
 
 // Represents a metro station
 class Station {
@@ -21,6 +33,10 @@ public:
     
     std::string getName() const;
     std::string getLine() const;
+    
+    // Non-copying accessors, valid while the station lives
+    std::string_view getNameView() const;
+    std::string_view getLineView() const;
 };
 
 // Edge represents connection between two stations
@@ -28,60 +44,641 @@ class Edge {
 private:
     int destination;
     int distance;
+    int line; // Line id, or Graph::NO_LINE if unknown
 
 public:
-    Edge(int dest, int dist);
+    Edge(int dest, int dist, int line);
     
     int getDestination() const;
     int getDistance() const;
+    int getLine() const;
+};
+
+// Everything reported to a rider about one route
+struct Route {
+    int distance;        // Total distance in km, or -1 if there is no route
+    int fare;            // Rs, from Graph::calculateFare
+    int travelTime;      // Minutes, from Graph::estimateTravelTime
+    int lineChanges;     // Exact on line-aware networks, else Graph::estimateLineChanges
+    std::vector<int> path; // Station indices, source first
+    std::vector<int> lines; // Line id of each hop (path.size() - 1 entries; empty if lines are unknown)
+    std::vector<int> interchanges; // Stations where the rider changes line, in order
+
+    Route();
+};
+
+// Algorithms available behind Graph::shortestPath
+enum class SearchAlgorithm {
+    Dijkstra,      // One search from the source, stopping at the destination
+    Bidirectional  // Searches from both ends that meet in the middle
 };
 
 // Graph representing the metro network
 class Graph {
 private:
     int numVertices;
-    std::vector<Station> stations;
-    std::vector<std::list<Edge>> adjacencyList;
-    std::unordered_map<std::string, int> stationIndices; // Maps station names to indices
+    std::vector<std::list<Edge>> adjacencyList; // Mutable build-phase adjacency
+    
+    // Station names, station line strings and line names, each stored once
+    // in one buffer. Stations and lines refer to them by arena id.
+    StringArena strings;
+    std::vector<int> stationNameIds;
+    std::vector<int> stationLineTextIds;
+    std::unordered_map<int, int> stationIndices; // Name id -> station (the last added with it)
+
+    // Frozen compressed sparse row (CSR) adjacency used by all queries.
+    // The edges of vertex u are [edgeOffsets[u], edgeOffsets[u + 1]) in the
+    // packed edgeTargets/edgeDistances arrays.
+    bool frozen;
+    std::vector<int> edgeOffsets;
+    std::vector<int> edgeTargets;
+    std::vector<int> edgeDistances;
+    int maxEdgeDistance;
+
+    // Metro lines by compact id. Each station's line string may name several
+    // lines ("Blue & Yellow Line"); their ids are kept for inferring the
+    // line of edges added without one.
+    std::vector<int> lineNameIds;
+    std::unordered_map<int, int> lineIds; // Name id -> line id
+    std::vector<std::vector<int>> stationLineIds; // Build phase only
+
+    // Line-expanded state space for line-aware search, built by freeze().
+    // A state is a (station, line) pair the rider can be in; the states of
+    // station v are [stateOffsets[v], stateOffsets[v + 1]). edgeStates maps
+    // each CSR edge to the state of arriving over it.
+    std::vector<int> edgeLines;     // Line id of each CSR edge
+    std::vector<int> edgeStates;
+    std::vector<int> stateOffsets;
+    std::vector<int> stateLines;
+    std::vector<int> stateStations;
+    bool lineAware;                 // Some edge has a known line
+
+    // Where queries read the CSR arrays from: the vectors above, or the
+    // mapped snapshot the graph was loaded from
+    const int* csrOffsets;
+    const int* csrTargets;
+    const int* csrDistances;
+    const int* csrLines;
+    const int* csrStates;
+    const int* csrStateOffsets;
+    const int* csrStateLines;
+    const int* csrStateStations;
+
+    // Backing file of a snapshot-loaded graph (null otherwise). Station
+    // names, lines and name lookups are then served from the mapping.
+    std::shared_ptr<const NetworkSnapshot> snapshot;
 
-    // Helper function for Dijkstra's algorithm
-    void printPath(const std::vector<int>& parent, int dest, std::vector<int>& path);
+    // Precomputed answers for small networks (null when not built)
+    std::shared_ptr<const AllPairsTable> allPairs;
+    
+    // Sorted name index for lookups while frozen and for station search
+    // (null until built; shared by clones, as names never change)
+    std::shared_ptr<const StationIndex> nameIndex;
+    
+    // Changes with every modification of the network (see getVersion)
+    unsigned long long version;
+    
+    // Connections taken out by closeConnection, kept for reopenConnection
+    struct ClosedConnection {
+        int a;
+        int b;
+        int distance;
+        int line;
+    };
+    std::vector<ClosedConnection> closedConnections;
+    
+    // Answers of planRoute and shortestPath kept for repeat queries (null
+    // when disabled). Not consulted while the all-pairs table is built.
+    std::shared_ptr<RouteCache> routeCache;
+
+    // Throw if a query is attempted before freeze()
+    void requireFrozen() const;
+    
+    // Throw if the graph is backed by a read-only snapshot
+    void requireMutable() const;
+    
+    // Name and line of a valid station index, wherever they are stored
+    std::string_view stationName(int index) const;
+    std::string_view stationLine(int index) const;
+    
+    // planRoute without the route cache
+    bool computeRoute(int src, int dest, Route& route) const;
+    
+    // Check if both ids name stations
+    bool hasStations(int a, int b) const;
+    
+    // Bring queries up to date after the connection between a and b,
+    // previously oldDistance long, changed: re-freeze a frozen graph and
+    // repair its all-pairs table (on pool, if not null) rather than
+    // dropping it
+    void connectionChanged(int a, int b, int oldDistance, ThreadPool* pool);
+    
+    // Dijkstra from src into context, stopping once dest is settled
+    // (dest == -1 settles every reachable station)
+    template <typename Queue>
+    void search(int src, int dest, BasicQueryContext<Queue>& context) const;
 
 public:
+    // Line id of edges whose line is unknown
+    static const int NO_LINE = -1;
+    
+    // Line-aware travel time model in half-minutes, so it stays integral:
+    // 1.5 minutes per km and 2 minutes per change of line
+    static const int HALF_MINUTES_PER_KM = 3;
+    static const int HALF_MINUTES_PER_CHANGE = 4;
+    
+    // Whether moving from one line to another is a change (unknown lines never are)
+    static bool isLineChange(int from, int to) {
+        return from != to && from != NO_LINE && to != NO_LINE;
+    }
+    
     Graph();
     
+    // The CSR pointers refer to this object's own vectors, so graphs move
+    // but do not copy implicitly (see clone)
+    Graph(const Graph&) = delete;
+    Graph& operator=(const Graph&) = delete;
+    Graph(Graph&&) = default;
+    Graph& operator=(Graph&&) = default;
+    
     // Add a new station to the graph
-    void addStation(const std::string& name, const std::string& line);
+    void addStation(std::string_view name, std::string_view line);
+    
+    // Register a metro line and return its id (the existing id if known)
+    int addLine(std::string_view name);
+    
+    // Add an edge (connection) between two stations, on the named line.
+    // With no line it is inferred from the stations' line strings.
+    void addEdge(std::string_view src, std::string_view dest, int distance, std::string_view line = "");
+    
+    // Add an edge between two stations by index (both must be valid). With
+    // NO_LINE the line is inferred: the one line both stations share, if any.
+    void addEdge(int srcIndex, int destIndex, int distance, int line = NO_LINE);
+    
+    // Runtime changes to the connection between two adjacent stations
+    // (every edge joining them). On a frozen graph the change is visible to
+    // the next query: the CSR is rebuilt and the all-pairs table repaired
+    // for the affected destinations only. The graph must not be queried by
+    // other threads meanwhile; LiveNetwork applies changes to a copy.
+    // Table rows are repaired on pool, or on the calling thread if it is
+    // null. Station ids out of range change nothing and return false.
+    
+    // Take the connection out of service. Returns false if none is open.
+    bool closeConnection(int a, int b, ThreadPool* pool = nullptr);
+    
+    // Restore a closed connection with its distance and line. Returns false
+    // if none is closed.
+    bool reopenConnection(int a, int b, ThreadPool* pool = nullptr);
+    
+    // Change the distance of the open connection (delays are expressed as
+    // extra distance). Returns false if none is open; throws
+    // std::invalid_argument for a negative distance.
+    bool setConnectionDistance(int a, int b, int distance, ThreadPool* pool = nullptr);
+    
+    // Shortest open connection between two stations, or INT_MAX if none
+    // (or either id is out of range)
+    int getConnectionDistance(int a, int b) const;
+    
+    // Independent copy, frozen if this graph is. A snapshot-backed graph is
+    // copied into ordinary mutable storage. The all-pairs table (never
+    // modified in place) and the route cache (keyed by version) are shared.
+    Graph clone() const;
+    
+    // Pack the build-phase adjacency into the CSR arrays used by queries.
+    // Adding stations or edges afterwards thaws the graph until the next freeze.
+    void freeze();
+    
+    // Check if the graph has been frozen since the last modification
+    bool isFrozen() const;
+    
+    // Replace the graph with a frozen, read-only view of a validated
+    // snapshot (see loadSnapshot in NetworkSnapshot.h). Queries run on the
+    // mapped arrays in place; adding stations or edges throws.
+    void attachSnapshot(std::shared_ptr<const NetworkSnapshot> snapshot);
+    
+    // Check if the graph is served from a snapshot
+    bool isSnapshot() const;
+    
+    // Version of the network: unique among all graphs and states of a graph
+    // in this process, and increased by every station or edge added, so
+    // results computed on one version are valid exactly while it lasts
+    unsigned long long getVersion() const;
+    
+    // Serve planRoute and shortestPath through a route cache, which may be
+    // shared with other graphs (null disables caching). The cache is kept
+    // across attachSnapshot; entries from earlier versions are ignored.
+    void setRouteCache(std::shared_ptr<RouteCache> cache);
+    
+    // The route cache, or null if caching is disabled
+    RouteCache* getRouteCache() const;
+    
+    // Number of stations in the graph
+    int getNumVertices() const;
+    
+    // CSR accessors (valid only while frozen)
+    int edgeBegin(int vertex) const { return csrOffsets[vertex]; }
+    int edgeEnd(int vertex) const { return csrOffsets[vertex + 1]; }
+    int edgeTarget(int edge) const { return csrTargets[edge]; }
+    int edgeDistance(int edge) const { return csrDistances[edge]; }
+    int edgeLine(int edge) const { return csrLines[edge]; }
+    
+    // Number of metro lines
+    int getNumLines() const;
+    
+    // Name of a line id ("" for NO_LINE), valid until the graph changes
+    std::string_view getLineName(int line) const;
+    
+    // Id of a line by name, or NO_LINE
+    int getLineId(std::string_view name) const;
     
-    // Add an edge (connection) between two stations
-    void addEdge(const std::string& src, const std::string& dest, int distance);
+    // Check if any edge has a known line, so routes can count real changes
+    bool isLineAware() const;
+    
+    // Line-expanded state space (valid only while frozen)
+    int getNumStates() const { return csrStateOffsets[numVertices]; }
+    int stateBegin(int vertex) const { return csrStateOffsets[vertex]; }
+    int stateEnd(int vertex) const { return csrStateOffsets[vertex + 1]; }
+    int stateLine(int state) const { return csrStateLines[state]; }
+    int stateStation(int state) const { return csrStateStations[state]; }
+    int edgeState(int edge) const { return csrStates[edge]; }
+    
+    // Largest edge distance in the frozen graph (sizes bucket queues)
+    int getMaxEdgeDistance() const;
+    
+    // Precompute every route into an AllPairsTable, one shortest-path tree
+    // per station spread over numThreads threads (0 = all cores). Networks
+    // larger than maxStations are left to on-demand search. Returns whether
+    // the table was built; it is dropped again when the graph changes.
+    bool buildAllPairs(int numThreads = 0, int maxStations = AllPairsTable::DEFAULT_MAX_STATIONS);
+    
+    // The all-pairs table, or null if queries are answered by search
+    const AllPairsTable* getAllPairsTable() const;
     
     // Check if a station exists in the graph
-    bool hasStation(const std::string& name) const;
+    bool hasStation(std::string_view name) const;
+    
+    // Get the index of a station by name (exact and case-sensitive), or -1
+    int getStationIndex(std::string_view name) const;
+    
+    // Index station names for lookup and for searching partial, mixed-case
+    // or misspelled names. freeze() does this whenever stations were added;
+    // snapshot-backed graphs look names up in the snapshot and build the
+    // index only when asked, to keep loading fast.
+    void buildNameIndex();
     
-    // Get the index of a station by name
-    int getStationIndex(const std::string& name) const;
+    // The station name index, or null if not built
+    const StationIndex* getNameIndex() const;
     
-    // Get the station object by index
+    // Copy of a station's name and line string (an empty Station if the
+    // index is invalid). Prefer the views below, which copy nothing.
     Station getStation(int index) const;
     
-    // Get all stations
+    // Name and line string of a valid station index without copying them,
+    // valid until the graph changes
+    std::string_view getStationName(int index) const;
+    std::string_view getStationLine(int index) const;
+    
+    // Every station name in index order, as a range of views
+    StationNameList getStationNames() const;
+    
+    // Copies of all station names (see getStationNames)
     std::vector<std::string> getAllStations() const;
     
     // Find shortest path using Dijkstra's algorithm
-    std::pair<int, std::vector<int>> dijkstra(int src, int dest);
+    std::pair<int, std::vector<int>> dijkstra(int src, int dest) const;
+    
+    // Allocation-free variant: runs in the caller's reusable context and
+    // writes the route into path. Returns INT_MAX if dest is unreachable.
+    // The context's Queue type selects the priority queue (see Heap.h).
+    template <typename Queue>
+    int dijkstra(int src, int dest, BasicQueryContext<Queue>& context, std::vector<int>& path) const;
+    
+    // Settle every station reachable from src. Afterwards the context holds
+    // the complete shortest-path tree (distances and parents).
+    template <typename Queue>
+    void shortestPathTree(int src, BasicQueryContext<Queue>& context) const;
+    
+    // Find shortest path with two frontiers, one from each end. Relies on the
+    // graph being undirected, which addEdge guarantees.
+    std::pair<int, std::vector<int>> bidirectionalDijkstra(int src, int dest) const;
+    
+    // Allocation-free variant of bidirectionalDijkstra
+    template <typename Queue>
+    int bidirectionalDijkstra(int src, int dest, BasicBidirectionalContext<Queue>& context,
+                              std::vector<int>& path) const;
     
     // Calculate fare based on distance
-    int calculateFare(int distance);
+    int calculateFare(int distance) const;
     
     // Estimate travel time based on distance and line changes
-    int estimateTravelTime(int distance, int changes);
+    int estimateTravelTime(int distance, int changes) const;
     
-    // Find shortest path between two stations by name
-    std::pair<int, std::vector<int>> shortestPath(const std::string& srcName, const std::string& destName);
+    // Estimate line changes on a route visiting numStations stations
+    // (used when the network has no line data)
+    int estimateLineChanges(int numStations) const;
+    
+    // Fastest route by travel time including interchange penalties, found
+    // by Dijkstra over (station, line) states. Fills every Route field with
+    // exact values. Returns false if dest is unreachable.
+    template <typename Queue>
+    bool fastestRoute(int src, int dest, BasicQueryContext<Queue>& context, Route& route) const;
+    
+    // Route with fare, travel time and line changes. On line-aware networks
+    // this is the fastest route; otherwise the shortest one, served from the
+    // all-pairs table when built. Routes the table does not answer come from
+    // the route cache when enabled. Returns false if there is no route.
+    bool planRoute(int src, int dest, Route& route) const;
+    
+    // Find shortest path between two stations by name.
+    // Served from the all-pairs table when built, else from the route cache
+    // when enabled.
+    std::pair<int, std::vector<int>> shortestPath(const std::string& srcName, const std::string& destName,
+                                                  SearchAlgorithm algorithm = SearchAlgorithm::Dijkstra) const;
     
     // Print the metro map
     void displayMap() const;
+    
+    // Print a route's stations one per line, each with the line it is
+    // reached on (or the station's line string on networks without line
+    // data), without allocating
+    void printPath(std::ostream& out, const Route& route) const;
+};
+
+// Read-only range over every station name of a graph, in index order,
+// yielding string_views (a copy-free stand-in for a span of names). Valid
+// until the graph changes.
+class StationNameList {
+private:
+    const Graph* graph;
+
+public:
+    class Iterator {
+    private:
+        const Graph* graph;
+        int index;
+        
+    public:
+        Iterator(const Graph* graph, int index) : graph(graph), index(index) {}
+        
+        std::string_view operator*() const { return graph->getStationName(index); }
+        Iterator& operator++() { index++; return *this; }
+        bool operator==(const Iterator& other) const { return index == other.index; }
+        bool operator!=(const Iterator& other) const { return index != other.index; }
+    };
+    
+    explicit StationNameList(const Graph& graph) : graph(&graph) {}
+    
+    Iterator begin() const { return Iterator(graph, 0); }
+    Iterator end() const { return Iterator(graph, graph->getNumVertices()); }
+    int size() const { return graph->getNumVertices(); }
+    std::string_view operator[](int index) const { return graph->getStationName(index); }
 };
 
+inline StationNameList Graph::getStationNames() const {
+    return StationNameList(*this);
+}
+
+template <typename Queue>
+void Graph::search(int src, int dest, BasicQueryContext<Queue>& context) const {
+    requireFrozen();
+    
+    context.reset(numVertices, maxEdgeDistance);
+    Queue& queue = context.getQueue();
+    
+    // Distance of source vertex from itself is 0
+    context.update(src, 0, -1);
+    queue.insert(src, 0);
+    
+    // Work done, counted locally and recorded once at the end
+    int settled = 0;
+    int relaxed = 0;
+    
+    // Process vertices
+    while (!queue.isEmpty()) {
+        // Extract the vertex with minimum distance
+        std::pair<int, int> current = queue.extractMin();
+        int u = current.second;
+        int distanceU = current.first;
+        
+        // Skip entries superseded by a later decrease (lazy queues only)
+        if (distanceU > context.getDistance(u)) {
+            continue;
+        }
+        settled++;
+        
+        // If we reached the destination, we can stop
+        if (u == dest) {
+            break;
+        }
+        
+        // Update distance value of adjacent vertices
+        relaxed += csrOffsets[u + 1] - csrOffsets[u];
+        for (int e = csrOffsets[u]; e < csrOffsets[u + 1]; e++) {
+            int v = csrTargets[e];
+            int candidate = distanceU + csrDistances[e];
+            
+            // If there is a shorter path to v through u
+            if (candidate < context.getDistance(v)) {
+                context.update(v, candidate, u);
+                queue.insert(v, candidate);
+            }
+        }
+    }
+    METRO_COUNT(SettledNodes, settled);
+    METRO_COUNT(RelaxedEdges, relaxed);
+}
+
+template <typename Queue>
+int Graph::dijkstra(int src, int dest, BasicQueryContext<Queue>& context, std::vector<int>& path) const {
+    METRO_TIME_QUERY(Dijkstra);
+    search(src, dest, context);
+    
+    // Reconstruct path
+    context.buildPath(dest, path);
+    return context.getDistance(dest);
+}
+
+template <typename Queue>
+void Graph::shortestPathTree(int src, BasicQueryContext<Queue>& context) const {
+    METRO_TIME_QUERY(ShortestPathTree);
+    search(src, -1, context);
+}
+
+template <typename Queue>
+int Graph::bidirectionalDijkstra(int src, int dest, BasicBidirectionalContext<Queue>& context,
+                                 std::vector<int>& path) const {
+    METRO_TIME_QUERY(Bidirectional);
+    requireFrozen();
+    
+    const int INF = std::numeric_limits<int>::max();
+    BasicQueryContext<Queue>& forward = context.getForward();
+    BasicQueryContext<Queue>& backward = context.getBackward();
+    forward.reset(numVertices, maxEdgeDistance);
+    backward.reset(numVertices, maxEdgeDistance);
+    
+    forward.update(src, 0, -1);
+    forward.getQueue().insert(src, 0);
+    backward.update(dest, 0, -1);
+    backward.getQueue().insert(dest, 0);
+    
+    // Best src -> dest distance seen so far and the vertex where it meets
+    int best = src == dest ? 0 : INF;
+    int meeting = src == dest ? src : -1;
+    
+    // Keys of the last vertex settled in each direction. Once their sum
+    // reaches best, no undiscovered path can be shorter.
+    int radius[2] = { 0, 0 };
+    BasicQueryContext<Queue>* sides[2] = { &forward, &backward };
+    int side = 0;
+    int settled = 0;
+    int relaxed = 0;
+    
+    while (!forward.getQueue().isEmpty() && !backward.getQueue().isEmpty()) {
+        if (best != INF && radius[0] + radius[1] >= best) {
+            break;
+        }
+        
+        BasicQueryContext<Queue>& self = *sides[side];
+        BasicQueryContext<Queue>& other = *sides[1 - side];
+        std::pair<int, int> current = self.getQueue().extractMin();
+        int u = current.second;
+        int distanceU = current.first;
+        
+        // Skip entries superseded by a later decrease (lazy queues only)
+        if (distanceU <= self.getDistance(u)) {
+            radius[side] = distanceU;
+            settled++;
+            relaxed += csrOffsets[u + 1] - csrOffsets[u];
+            
+            for (int e = csrOffsets[u]; e < csrOffsets[u + 1]; e++) {
+                int v = csrTargets[e];
+                int candidate = distanceU + csrDistances[e];
+                
+                if (candidate < self.getDistance(v)) {
+                    self.update(v, candidate, u);
+                    self.getQueue().insert(v, candidate);
+                    
+                    // v is labelled from both ends: a complete route
+                    int otherDistance = other.getDistance(v);
+                    if (otherDistance != INF && candidate + otherDistance < best) {
+                        best = candidate + otherDistance;
+                        meeting = v;
+                    }
+                }
+            }
+        }
+        
+        // Alternate directions so both frontiers grow at the same pace
+        side = 1 - side;
+    }
+    METRO_COUNT(SettledNodes, settled);
+    METRO_COUNT(RelaxedEdges, relaxed);
+    
+    // Reconstruct path: src -> meeting from the forward tree, then
+    // meeting -> dest by following backward parents
+    path.clear();
+    if (best == INF) {
+        return INF;
+    }
+    forward.buildPath(meeting, path);
+    for (int v = backward.getParent(meeting); v != -1; v = backward.getParent(v)) {
+        path.push_back(v);
+    }
+    return best;
+}
+
+template <typename Queue>
+bool Graph::fastestRoute(int src, int dest, BasicQueryContext<Queue>& context, Route& route) const {
+    METRO_TIME_QUERY(FastestRoute);
+    requireFrozen();
+    
+    route.path.clear();
+    route.lines.clear();
+    route.interchanges.clear();
+    if (src == dest) {
+        route.distance = 0;
+        route.fare = calculateFare(0);
+        route.travelTime = 0;
+        route.lineChanges = 0;
+        route.path.push_back(src);
+        return true;
+    }
+    
+    context.reset(getNumStates(), HALF_MINUTES_PER_KM * maxEdgeDistance + HALF_MINUTES_PER_CHANGE);
+    Queue& queue = context.getQueue();
+    
+    // Boarding at the source is free on every line: seed each first hop
+    for (int e = csrOffsets[src]; e < csrOffsets[src + 1]; e++) {
+        int state = csrStates[e];
+        int cost = HALF_MINUTES_PER_KM * csrDistances[e];
+        if (cost < context.getDistance(state)) {
+            context.update(state, cost, -1);
+            queue.insert(state, cost);
+        }
+    }
+    
+    int reached = -1;
+    int settled = 0;
+    int relaxed = 0;
+    while (!queue.isEmpty()) {
+        std::pair<int, int> current = queue.extractMin();
+        int state = current.second;
+        int cost = current.first;
+        
+        // Skip entries superseded by a later decrease (lazy queues only)
+        if (cost > context.getDistance(state)) {
+            continue;
+        }
+        
+        settled++;
+        int u = csrStateStations[state];
+        if (u == dest) {
+            reached = state;
+            break;
+        }
+        
+        int line = csrStateLines[state];
+        relaxed += csrOffsets[u + 1] - csrOffsets[u];
+        for (int e = csrOffsets[u]; e < csrOffsets[u + 1]; e++) {
+            int candidate = cost + HALF_MINUTES_PER_KM * csrDistances[e] +
+                            (isLineChange(line, csrLines[e]) ? HALF_MINUTES_PER_CHANGE : 0);
+            int next = csrStates[e];
+            if (candidate < context.getDistance(next)) {
+                context.update(next, candidate, state);
+                queue.insert(next, candidate);
+            }
+        }
+    }
+    
+    METRO_COUNT(SettledNodes, settled);
+    METRO_COUNT(RelaxedEdges, relaxed);
+    
+    if (reached == -1) {
+        route.distance = -1;
+        return false;
+    }
+    
+    // Walk the state chain back to the source; it is reversed below
+    int cost = context.getDistance(reached);
+    for (int state = reached; state != -1; state = context.getParent(state)) {
+        route.path.push_back(csrStateStations[state]);
+        route.lines.push_back(csrStateLines[state]);
+    }
+    route.path.push_back(src);
+    std::reverse(route.path.begin(), route.path.end());
+    std::reverse(route.lines.begin(), route.lines.end());
+    
+    // The station after hop i - 1 is where the rider changes before hop i
+    for (size_t i = 1; i < route.lines.size(); i++) {
+        if (isLineChange(route.lines[i - 1], route.lines[i])) {
+            route.interchanges.push_back(route.path[i]);
+        }
+    }
+    route.lineChanges = static_cast<int>(route.interchanges.size());
+    route.distance = (cost - HALF_MINUTES_PER_CHANGE * route.lineChanges) / HALF_MINUTES_PER_KM;
+    route.fare = calculateFare(route.distance);
+    route.travelTime = estimateTravelTime(route.distance, route.lineChanges);
+    return true;
+}
+
 #endif // GRAPH_H
\ No newline at end of file
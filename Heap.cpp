@@ -1,4 +1,5 @@
 #include "Heap.h"
+#include "Instrumentation.h"
 #include <algorithm>
 
 // Constructor
@@ -6,6 +7,21 @@ MinHeap::MinHeap(int maxSize) : size(0) {
     positions.resize(maxSize, -1);
 }
 
+// Empty the heap, keeping its storage for reuse
+void MinHeap::reset(int maxSize, int maxEdgeWeight) {
+    (void)maxEdgeWeight;
+
+    for (int i = 0; i < size; i++) {
+        positions[heap[i].second] = -1;
+    }
+    heap.clear();
+    size = 0;
+    
+    if (static_cast<int>(positions.size()) < maxSize) {
+        positions.resize(maxSize, -1);
+    }
+}
+
 // Helper functions
 int MinHeap::parent(int i) { 
     return (i - 1) / 2; 
@@ -66,6 +82,7 @@ void MinHeap::heapify(int i) {
 void MinHeap::insert(int vertex, int distance) {
     if (contains(vertex)) {
         // Update key value of existing vertex
+        METRO_COUNT(HeapDecreases, 1);
         int i = positions[vertex];
         heap[i].first = distance;
         
@@ -83,6 +100,7 @@ void MinHeap::insert(int vertex, int distance) {
         }
     } else {
         // Insert new vertex
+        METRO_COUNT(HeapInserts, 1);
         heap.push_back(std::make_pair(distance, vertex));
         positions[vertex] = size;
         size++;
@@ -110,6 +128,7 @@ std::pair<int, int> MinHeap::extractMin() {
     }
     
     // Store the root (minimum) element
+    METRO_COUNT(HeapExtracts, 1);
     std::pair<int, int> root = heap[0];
     
     // Replace root with last element and remove last element
@@ -140,6 +159,7 @@ void MinHeap::decreaseKey(int vertex, int newDistance) {
         throw std::runtime_error("New distance is greater than current distance");
     }
     
+    METRO_COUNT(HeapDecreases, 1);
     heap[i].first = newDistance;
     
     // Fix the min heap property if needed
@@ -154,4 +174,124 @@ void MinHeap::decreaseKey(int vertex, int newDistance) {
         // Move up to parent
         i = parent(i);
     }
-}
\ No newline at end of file
+}
+
+// RadixHeap implementation
+RadixHeap::RadixHeap() : last(0), size(0) {}
+
+int RadixHeap::bucketFor(int distance) const {
+    unsigned int diff = static_cast<unsigned int>(distance) ^ static_cast<unsigned int>(last);
+    if (diff == 0) {
+        return 0;
+    }
+#if defined(__GNUC__)
+    return 32 - __builtin_clz(diff);
+#else
+    int bucket = 0;
+    while (diff != 0) {
+        diff >>= 1;
+        bucket++;
+    }
+    return bucket;
+#endif
+}
+
+void RadixHeap::reset(int maxSize, int maxEdgeWeight) {
+    (void)maxSize;
+    (void)maxEdgeWeight;
+    for (int i = 0; i < NUM_BUCKETS; i++) {
+        buckets[i].clear();
+    }
+    last = 0;
+    size = 0;
+}
+
+bool RadixHeap::isEmpty() const {
+    return size == 0;
+}
+
+void RadixHeap::insert(int vertex, int distance) {
+    if (distance < last) {
+        throw std::runtime_error("Radix heap key is below the last extracted key");
+    }
+    METRO_COUNT(HeapInserts, 1);
+    buckets[bucketFor(distance)].push_back(std::make_pair(distance, vertex));
+    size++;
+}
+
+std::pair<int, int> RadixHeap::extractMin() {
+    if (isEmpty()) {
+        throw std::runtime_error("Heap is empty");
+    }
+    
+    // Refill bucket 0 from the first non-empty bucket; all of its entries
+    // share a prefix with the new minimum and land in strictly lower buckets
+    if (buckets[0].empty()) {
+        int i = 1;
+        while (buckets[i].empty()) {
+            i++;
+        }
+        int newLast = buckets[i][0].first;
+        for (const auto& entry : buckets[i]) {
+            newLast = std::min(newLast, entry.first);
+        }
+        last = newLast;
+        for (const auto& entry : buckets[i]) {
+            buckets[bucketFor(entry.first)].push_back(entry);
+        }
+        buckets[i].clear();
+    }
+    
+    METRO_COUNT(HeapExtracts, 1);
+    std::pair<int, int> result = buckets[0].back();
+    buckets[0].pop_back();
+    size--;
+    return result;
+}
+
+// BucketQueue implementation
+BucketQueue::BucketQueue() : numBuckets(0), current(0), size(0) {}
+
+void BucketQueue::reset(int maxSize, int maxEdgeWeight) {
+    (void)maxSize;
+    if (size > 0) {
+        for (auto& bucket : buckets) {
+            bucket.clear();
+        }
+    }
+    numBuckets = std::max(maxEdgeWeight, 0) + 1;
+    if (static_cast<int>(buckets.size()) < numBuckets) {
+        buckets.resize(numBuckets);
+    }
+    current = 0;
+    size = 0;
+}
+
+bool BucketQueue::isEmpty() const {
+    return size == 0;
+}
+
+void BucketQueue::insert(int vertex, int distance) {
+    if (distance < current || distance - current >= numBuckets) {
+        throw std::runtime_error("Bucket queue key outside the current window");
+    }
+    METRO_COUNT(HeapInserts, 1);
+    buckets[distance % numBuckets].push_back(std::make_pair(distance, vertex));
+    size++;
+}
+
+std::pair<int, int> BucketQueue::extractMin() {
+    if (isEmpty()) {
+        throw std::runtime_error("Heap is empty");
+    }
+    
+    while (buckets[current % numBuckets].empty()) {
+        current++;
+    }
+    METRO_COUNT(HeapExtracts, 1);
+    std::vector<std::pair<int, int>>& bucket = buckets[current % numBuckets];
+    std::pair<int, int> result = bucket.back();
+    bucket.pop_back();
+    size--;
+    return result;
+}
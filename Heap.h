@@ -5,6 +5,16 @@
 #include <utility>
 #include <limits>
 #include <stdexcept>
+#include "Instrumentation.h"
+
+// Priority queue policies for Graph::dijkstra. Every policy provides:
+//   void reset(int maxSize, int maxEdgeWeight)  - empty the queue for a new query
+//   bool isEmpty() const
+//   void insert(int vertex, int distance)       - insert, or lower a queued key
+//   std::pair<int, int> extractMin()            - (distance, vertex)
+// Policies without decrease-key (RadixHeap, BucketQueue) keep superseded
+// entries and may return them later with a stale, larger distance; the
+// search skips such entries.
 
 // MinHeap class for Dijkstra's algorithm to find shortest path
 // Each element is a pair of (distance, vertex_id)
@@ -23,7 +33,12 @@ private:
     void heapify(int i);
 
 public:
-    MinHeap(int maxSize);
+    MinHeap(int maxSize = 0);
+    
+    // Empty the heap and make room for vertices [0, maxSize).
+    // Only entries still in the heap are touched, so this is cheap after a
+    // query that stopped early.
+    void reset(int maxSize, int maxEdgeWeight = 0);
     
     bool isEmpty() const;
     
@@ -43,4 +58,157 @@ public:
     void decreaseKey(int vertex, int newDistance);
 };
 
+// Indexed d-ary min-heap with iterative sifting.
+// A wider fan-out gives a shallower tree and fewer cache misses per
+// decrease-key than the binary MinHeap, at the cost of more comparisons
+// per extraction.
+template <int D>
+class DAryHeap {
+private:
+    std::vector<std::pair<int, int>> heap; // (distance, vertex_id)
+    std::vector<int> positions; // To track position of vertex in heap
+
+    // Move the element at i up until its parent is not larger
+    void siftUp(int i) {
+        std::pair<int, int> item = heap[i];
+        while (i > 0) {
+            int p = (i - 1) / D;
+            if (heap[p].first <= item.first) {
+                break;
+            }
+            heap[i] = heap[p];
+            positions[heap[i].second] = i;
+            i = p;
+        }
+        heap[i] = item;
+        positions[item.second] = i;
+    }
+
+    // Move the element at i down until no child is smaller
+    void siftDown(int i) {
+        int size = static_cast<int>(heap.size());
+        std::pair<int, int> item = heap[i];
+        while (true) {
+            int first = D * i + 1;
+            if (first >= size) {
+                break;
+            }
+            int last = first + D < size ? first + D : size;
+            int smallest = first;
+            for (int c = first + 1; c < last; c++) {
+                if (heap[c].first < heap[smallest].first) {
+                    smallest = c;
+                }
+            }
+            if (heap[smallest].first >= item.first) {
+                break;
+            }
+            heap[i] = heap[smallest];
+            positions[heap[i].second] = i;
+            i = smallest;
+        }
+        heap[i] = item;
+        positions[item.second] = i;
+    }
+
+public:
+    DAryHeap() {}
+
+    void reset(int maxSize, int maxEdgeWeight = 0) {
+        (void)maxEdgeWeight;
+        for (const auto& entry : heap) {
+            positions[entry.second] = -1;
+        }
+        heap.clear();
+        if (static_cast<int>(positions.size()) < maxSize) {
+            positions.resize(maxSize, -1);
+        }
+    }
+
+    bool isEmpty() const {
+        return heap.empty();
+    }
+
+    bool contains(int vertex) const {
+        return vertex >= 0 && vertex < static_cast<int>(positions.size()) && positions[vertex] != -1;
+    }
+
+    void insert(int vertex, int distance) {
+        if (contains(vertex)) {
+            int i = positions[vertex];
+            if (distance < heap[i].first) {
+                METRO_COUNT(HeapDecreases, 1);
+                heap[i].first = distance;
+                siftUp(i);
+            }
+            return;
+        }
+        METRO_COUNT(HeapInserts, 1);
+        heap.push_back(std::make_pair(distance, vertex));
+        siftUp(static_cast<int>(heap.size()) - 1);
+    }
+
+    std::pair<int, int> extractMin() {
+        if (heap.empty()) {
+            throw std::runtime_error("Heap is empty");
+        }
+        METRO_COUNT(HeapExtracts, 1);
+        std::pair<int, int> root = heap[0];
+        positions[root.second] = -1;
+        std::pair<int, int> last = heap.back();
+        heap.pop_back();
+        if (!heap.empty()) {
+            heap[0] = last;
+            siftDown(0);
+        }
+        return root;
+    }
+};
+
+typedef DAryHeap<4> QuaternaryHeap;
+
+// Monotone radix heap for non-negative integer keys.
+// Keys are bucketed by the highest bit in which they differ from the last
+// extracted minimum, so each entry moves between buckets at most 32 times.
+// Valid only when every inserted key is >= the last extracted key, which
+// holds for Dijkstra with non-negative weights.
+class RadixHeap {
+private:
+    static const int NUM_BUCKETS = 33;
+    std::vector<std::pair<int, int>> buckets[NUM_BUCKETS]; // (distance, vertex_id)
+    int last; // Last extracted key
+    int size;
+
+    // Bucket for a key relative to the last extracted key
+    int bucketFor(int distance) const;
+
+public:
+    RadixHeap();
+
+    void reset(int maxSize, int maxEdgeWeight = 0);
+    bool isEmpty() const;
+    void insert(int vertex, int distance);
+    std::pair<int, int> extractMin();
+};
+
+// Dial's bucket queue: a circular array of maxEdgeWeight + 1 buckets.
+// Every queued key lies within maxEdgeWeight of the current minimum, so a
+// key maps to a unique bucket and extraction scans forward at most C slots.
+// Best for small integer weights such as kilometre distances.
+class BucketQueue {
+private:
+    std::vector<std::vector<std::pair<int, int>>> buckets; // (distance, vertex_id)
+    int numBuckets;
+    int current; // Smallest key that can still be queued
+    int size;
+
+public:
+    BucketQueue();
+
+    void reset(int maxSize, int maxEdgeWeight = 0);
+    bool isEmpty() const;
+    void insert(int vertex, int distance);
+    std::pair<int, int> extractMin();
+};
+
 #endif // HEAP_H
\ No newline at end of file
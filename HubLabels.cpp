@@ -0,0 +1,439 @@
+#include "HubLabels.h"
+#include "NetworkSnapshot.h"
+#include "QueryContext.h"
+#include "Instrumentation.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static const char HUB_LABEL_MAGIC[8] = { 'M', 'E', 'T', 'R', 'O', 'H', 'U', 'B' };
+static const uint32_t HUB_LABEL_BYTE_ORDER = 0x01020304;
+
+// Shortest-path trees sampled to rank the stations. More samples give
+// smaller labels; beyond a few hundred the gain no longer pays for the trees.
+static const int ORDER_SAMPLES = 256;
+
+struct HubLabelHeader {
+    char magic[8];            // "METROHUB"
+    uint32_t formatVersion;   // HUB_LABEL_FORMAT_VERSION of the writer
+    uint32_t headerSize;      // sizeof(HubLabelHeader) of the writer
+    uint32_t byteOrder;       // 0x01020304 as written by the writer
+    uint32_t numVertices;
+    uint64_t numEntries;
+    uint64_t networkChecksum; // networkFingerprint of the indexed graph
+    uint64_t fileSize;
+    uint64_t checksum;        // snapshotChecksum of everything after the header
+};
+
+// Checksum of the station count and every connection, which a snapshot
+// keeps in the same order as the graph it was written from
+static uint64_t networkFingerprint(const Graph& graph) {
+    int numVertices = graph.getNumVertices();
+    std::vector<int> words(1, numVertices);
+    for (int u = 0; u < numVertices; u++) {
+        words.push_back(graph.edgeEnd(u) - graph.edgeBegin(u));
+        for (int e = graph.edgeBegin(u); e < graph.edgeEnd(u); e++) {
+            words.push_back(graph.edgeTarget(e));
+            words.push_back(graph.edgeDistance(e));
+        }
+    }
+    words.resize((words.size() + 1) / 2 * 2, 0);
+    return snapshotChecksum(reinterpret_cast<const char*>(words.data()), words.size() * sizeof(int));
+}
+
+// Stations by importance: the number of stations below each in a sample of
+// shortest-path trees (how many shortest routes it lies on), then degree,
+// then index
+static void rankStations(const Graph& graph, std::vector<int>& order) {
+    int numVertices = graph.getNumVertices();
+    std::vector<long long> score(numVertices, 0);
+    std::vector<int> settled, below(numVertices);
+    BasicQueryContext<BucketQueue> context;
+    int samples = std::min(ORDER_SAMPLES, numVertices);
+    for (int i = 0; i < samples; i++) {
+        int root = static_cast<int>(static_cast<long long>(i) * numVertices / samples);
+        graph.shortestPathTree(root, context);
+
+        // Children before parents: farthest first
+        settled.clear();
+        for (int v = 0; v < numVertices; v++) {
+            if (context.getDistance(v) != std::numeric_limits<int>::max()) {
+                settled.push_back(v);
+                below[v] = 1;
+            }
+        }
+        std::sort(settled.begin(), settled.end(), [&context](int a, int b) {
+            return context.getDistance(a) > context.getDistance(b);
+        });
+        for (int v : settled) {
+            score[v] += below[v];
+            if (context.getParent(v) != -1) {
+                below[context.getParent(v)] += below[v];
+            }
+        }
+    }
+
+    order.resize(numVertices);
+    for (int v = 0; v < numVertices; v++) {
+        order[v] = v;
+    }
+    std::sort(order.begin(), order.end(), [&score, &graph](int a, int b) {
+        if (score[a] != score[b]) {
+            return score[a] > score[b];
+        }
+        int degreeA = graph.edgeEnd(a) - graph.edgeBegin(a);
+        int degreeB = graph.edgeEnd(b) - graph.edgeBegin(b);
+        return degreeA != degreeB ? degreeA > degreeB : a < b;
+    });
+}
+
+// Smallest distA[i] + distB[j] over the hubs two sorted labels share
+// (INT_MAX if none). Blocks of four hubs from each label are compared all
+// against all, rotating one block three times; the block with the smaller
+// last hub is then done, as every hub it could still match lies behind.
+static int mergeLabels(const int* hubsA, const int* distA, int sizeA,
+                       const int* hubsB, const int* distB, int sizeB) {
+    const int INF = std::numeric_limits<int>::max();
+    int best = INF;
+    int i = 0, j = 0;
+#if defined(__SSE2__)
+    const __m128i none = _mm_set1_epi32(INF);
+    __m128i bestBlock = none;
+    while (i + 4 <= sizeA && j + 4 <= sizeB) {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hubsA + i));
+        __m128i da = _mm_loadu_si128(reinterpret_cast<const __m128i*>(distA + i));
+        __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hubsB + j));
+        __m128i db = _mm_loadu_si128(reinterpret_cast<const __m128i*>(distB + j));
+        for (int rotation = 0; rotation < 4; rotation++) {
+            __m128i match = _mm_cmpeq_epi32(a, b);
+            __m128i sum = _mm_or_si128(_mm_and_si128(match, _mm_add_epi32(da, db)), _mm_andnot_si128(match, none));
+            __m128i smaller = _mm_cmplt_epi32(sum, bestBlock);
+            bestBlock = _mm_or_si128(_mm_and_si128(smaller, sum), _mm_andnot_si128(smaller, bestBlock));
+            b = _mm_shuffle_epi32(b, _MM_SHUFFLE(0, 3, 2, 1));
+            db = _mm_shuffle_epi32(db, _MM_SHUFFLE(0, 3, 2, 1));
+        }
+        int lastA = hubsA[i + 3];
+        int lastB = hubsB[j + 3];
+        i += lastA <= lastB ? 4 : 0;
+        j += lastB <= lastA ? 4 : 0;
+    }
+    int lanes[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), bestBlock);
+    best = std::min(std::min(lanes[0], lanes[1]), std::min(lanes[2], lanes[3]));
+#endif
+
+    // What is left of either label, one hub at a time
+    while (i < sizeA && j < sizeB) {
+        if (hubsA[i] < hubsB[j]) {
+            i++;
+        } else if (hubsA[i] > hubsB[j]) {
+            j++;
+        } else {
+            best = std::min(best, distA[i++] + distB[j++]);
+        }
+    }
+    return best;
+}
+
+// HubLabelStats implementation
+double HubLabelStats::averageLabelSize(int numVertices) const {
+    return numVertices == 0 ? 0 : static_cast<double>(entries) / numVertices;
+}
+
+// HubLabels implementation
+HubLabels::HubLabels() : numVertices(0), networkChecksum(0), stats() {}
+
+void HubLabels::build(const Graph& graph) {
+    if (!graph.isFrozen()) {
+        throw std::logic_error("Graph must be frozen before querying");
+    }
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const int INF = std::numeric_limits<int>::max();
+
+    numVertices = graph.getNumVertices();
+    rankStations(graph, order);
+
+    // Labels grow one hub at a time, in rank order, so each stays sorted
+    struct Entry {
+        int hub;
+        int distance;
+        int parent;
+    };
+    std::vector<std::vector<Entry>> labels(numVertices);
+    std::vector<int> hubDistances(numVertices, INF); // The current hub's label, by hub rank
+    BasicQueryContext<BucketQueue> context;
+    for (int rank = 0; rank < numVertices; rank++) {
+        int hub = order[rank];
+        for (const Entry& entry : labels[hub]) {
+            hubDistances[entry.hub] = entry.distance;
+        }
+
+        // Dijkstra from the hub, pruned at stations whose distance the
+        // labels of more important hubs already cover
+        context.reset(numVertices, graph.getMaxEdgeDistance());
+        BucketQueue& queue = context.getQueue();
+        context.update(hub, 0, -1);
+        queue.insert(hub, 0);
+        while (!queue.isEmpty()) {
+            std::pair<int, int> current = queue.extractMin();
+            int distance = current.first;
+            int u = current.second;
+            if (distance > context.getDistance(u)) {
+                continue;
+            }
+            bool covered = false;
+            for (const Entry& entry : labels[u]) {
+                if (hubDistances[entry.hub] != INF && hubDistances[entry.hub] + entry.distance <= distance) {
+                    covered = true;
+                    break;
+                }
+            }
+            if (covered) {
+                continue;
+            }
+            labels[u].push_back(Entry{ rank, distance, context.getParent(u) });
+
+            for (int e = graph.edgeBegin(u); e < graph.edgeEnd(u); e++) {
+                int v = graph.edgeTarget(e);
+                int candidate = distance + graph.edgeDistance(e);
+                if (candidate < context.getDistance(v)) {
+                    context.update(v, candidate, u);
+                    queue.insert(v, candidate);
+                }
+            }
+        }
+
+        for (const Entry& entry : labels[hub]) {
+            hubDistances[entry.hub] = INF;
+        }
+    }
+
+    // Pack the labels into CSR form
+    stats = HubLabelStats();
+    labelOffsets.assign(numVertices + 1, 0);
+    for (int v = 0; v < numVertices; v++) {
+        int size = static_cast<int>(labels[v].size());
+        labelOffsets[v + 1] = labelOffsets[v] + size;
+        stats.maxLabelSize = std::max(stats.maxLabelSize, size);
+    }
+    stats.entries = labelOffsets[numVertices];
+    labelHubs.resize(stats.entries);
+    labelDistances.resize(stats.entries);
+    labelParents.resize(stats.entries);
+    for (int v = 0; v < numVertices; v++) {
+        int i = labelOffsets[v];
+        for (const Entry& entry : labels[v]) {
+            labelHubs[i] = entry.hub;
+            labelDistances[i] = entry.distance;
+            labelParents[i] = entry.parent;
+            i++;
+        }
+        std::vector<Entry>().swap(labels[v]);
+    }
+    networkChecksum = networkFingerprint(graph);
+
+    stats.preprocessingMillis = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+bool HubLabels::isBuilt() const {
+    return !labelOffsets.empty();
+}
+
+int HubLabels::distance(int src, int dest) const {
+    int a = labelOffsets[src];
+    int b = labelOffsets[dest];
+    return mergeLabels(labelHubs.data() + a, labelDistances.data() + a, labelOffsets[src + 1] - a,
+                       labelHubs.data() + b, labelDistances.data() + b, labelOffsets[dest + 1] - b);
+}
+
+int HubLabels::findEntry(int v, int rank) const {
+    const int* begin = labelHubs.data() + labelOffsets[v];
+    const int* end = labelHubs.data() + labelOffsets[v + 1];
+    return static_cast<int>(std::lower_bound(begin, end, rank) - labelHubs.data());
+}
+
+void HubLabels::walkToHub(int v, int rank, std::vector<int>& path) const {
+    for (; v != -1; v = labelParents[findEntry(v, rank)]) {
+        path.push_back(v);
+    }
+}
+
+std::pair<int, std::vector<int>> HubLabels::query(int src, int dest) const {
+    std::vector<int> path;
+    int distance = query(src, dest, path);
+    return std::make_pair(distance, path);
+}
+
+int HubLabels::query(int src, int dest, std::vector<int>& path) const {
+    METRO_TIME_QUERY(HubLabels);
+    const int INF = std::numeric_limits<int>::max();
+    path.clear();
+    if (src == dest) {
+        path.push_back(src);
+        return 0;
+    }
+
+    // The meeting hub is needed too, so merge one entry at a time
+    int best = INF;
+    int meeting = -1;
+    int i = labelOffsets[src], j = labelOffsets[dest];
+    while (i < labelOffsets[src + 1] && j < labelOffsets[dest + 1]) {
+        if (labelHubs[i] < labelHubs[j]) {
+            i++;
+        } else if (labelHubs[i] > labelHubs[j]) {
+            j++;
+        } else {
+            if (labelDistances[i] + labelDistances[j] < best) {
+                best = labelDistances[i] + labelDistances[j];
+                meeting = labelHubs[i];
+            }
+            i++;
+            j++;
+        }
+    }
+    if (meeting == -1) {
+        return INF;
+    }
+
+    // Up from src to the hub, then down to dest
+    walkToHub(src, meeting, path);
+    size_t middle = path.size();
+    walkToHub(dest, meeting, path);
+    std::reverse(path.begin() + middle, path.end());
+    path.erase(path.begin() + middle); // The hub, reached from both ends
+    return best;
+}
+
+size_t HubLabels::memoryBytes() const {
+    return (order.capacity() + labelOffsets.capacity() + labelHubs.capacity() + labelDistances.capacity() +
+            labelParents.capacity()) * sizeof(int);
+}
+
+const HubLabelStats& HubLabels::getStats() const {
+    return stats;
+}
+
+// Append an int array as one 8-byte aligned section
+static void appendSection(std::vector<char>& buffer, const std::vector<int>& values) {
+    const char* bytes = reinterpret_cast<const char*>(values.data());
+    buffer.insert(buffer.end(), bytes, bytes + values.size() * sizeof(int));
+    buffer.resize((buffer.size() + 7) / 8 * 8, 0);
+}
+
+// Copy count ints of the section at offset into values, and return the
+// offset of the next section
+static size_t readSection(const char* data, size_t offset, size_t count, std::vector<int>& values) {
+    values.resize(count);
+    if (count > 0) {
+        std::memcpy(values.data(), data + offset, count * sizeof(int));
+    }
+    return offset + (count * sizeof(int) + 7) / 8 * 8;
+}
+
+bool HubLabels::save(const std::string& path, std::string& error) const {
+    if (!isBuilt()) {
+        error = "hub labels must be built before saving";
+        return false;
+    }
+
+    std::vector<char> buffer(sizeof(HubLabelHeader), 0);
+    appendSection(buffer, order);
+    appendSection(buffer, labelOffsets);
+    appendSection(buffer, labelHubs);
+    appendSection(buffer, labelDistances);
+    appendSection(buffer, labelParents);
+
+    HubLabelHeader& header = *reinterpret_cast<HubLabelHeader*>(buffer.data());
+    std::memcpy(header.magic, HUB_LABEL_MAGIC, sizeof(HUB_LABEL_MAGIC));
+    header.formatVersion = HUB_LABEL_FORMAT_VERSION;
+    header.headerSize = sizeof(HubLabelHeader);
+    header.byteOrder = HUB_LABEL_BYTE_ORDER;
+    header.numVertices = static_cast<uint32_t>(numVertices);
+    header.numEntries = labelHubs.size();
+    header.networkChecksum = networkChecksum;
+    header.fileSize = buffer.size();
+    header.checksum = snapshotChecksum(buffer.data() + sizeof(HubLabelHeader), buffer.size() - sizeof(HubLabelHeader));
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        error = "cannot create " + path;
+        return false;
+    }
+    size_t written = std::fwrite(buffer.data(), 1, buffer.size(), file);
+    if (std::fclose(file) != 0 || written != buffer.size()) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+bool HubLabels::load(const Graph& graph, const std::string& path, std::string& error) {
+    MappedFile file;
+    if (!file.open(path, error)) {
+        return false;
+    }
+
+    const char* data = file.getData();
+    size_t size = file.getSize();
+    if (size < sizeof(HubLabelHeader)) {
+        error = path + ": not a hub label file (too short)";
+        return false;
+    }
+    const HubLabelHeader* header = reinterpret_cast<const HubLabelHeader*>(data);
+    if (std::memcmp(header->magic, HUB_LABEL_MAGIC, sizeof(HUB_LABEL_MAGIC)) != 0) {
+        error = path + ": not a hub label file";
+        return false;
+    }
+    if (header->formatVersion != HUB_LABEL_FORMAT_VERSION || header->headerSize != sizeof(HubLabelHeader) ||
+        header->byteOrder != HUB_LABEL_BYTE_ORDER) {
+        error = path + ": hub label format " + std::to_string(header->formatVersion) +
+                " is not supported (expected " + std::to_string(HUB_LABEL_FORMAT_VERSION) + ")";
+        return false;
+    }
+    size_t vertices = header->numVertices;
+    size_t entries = header->numEntries;
+    size_t expected = sizeof(HubLabelHeader) + (vertices * sizeof(int) + 7) / 8 * 8 +
+                      ((vertices + 1) * sizeof(int) + 7) / 8 * 8 + 3 * ((entries * sizeof(int) + 7) / 8 * 8);
+    if (header->fileSize != size || size != expected) {
+        error = path + ": hub label file is truncated";
+        return false;
+    }
+    if (snapshotChecksum(data + sizeof(HubLabelHeader), size - sizeof(HubLabelHeader)) != header->checksum) {
+        error = path + ": hub label checksum mismatch";
+        return false;
+    }
+    if (vertices != static_cast<size_t>(graph.getNumVertices()) ||
+        header->networkChecksum != networkFingerprint(graph)) {
+        error = path + ": hub labels were built for a different network";
+        return false;
+    }
+
+    HubLabels loaded;
+    size_t offset = sizeof(HubLabelHeader);
+    offset = readSection(data, offset, vertices, loaded.order);
+    offset = readSection(data, offset, vertices + 1, loaded.labelOffsets);
+    offset = readSection(data, offset, entries, loaded.labelHubs);
+    offset = readSection(data, offset, entries, loaded.labelDistances);
+    readSection(data, offset, entries, loaded.labelParents);
+    loaded.numVertices = static_cast<int>(vertices);
+    loaded.networkChecksum = header->networkChecksum;
+    loaded.stats.entries = static_cast<long long>(entries);
+    for (size_t v = 0; v < vertices; v++) {
+        loaded.stats.maxLabelSize = std::max(loaded.stats.maxLabelSize,
+                                             loaded.labelOffsets[v + 1] - loaded.labelOffsets[v]);
+    }
+    *this = std::move(loaded);
+    return true;
+}
+
+std::string hubLabelsPath(const std::string& snapshotPath) {
+    return snapshotPath + ".hubs";
+}
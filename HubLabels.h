@@ -0,0 +1,114 @@
+#ifndef HUB_LABELS_H
+#define HUB_LABELS_H
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include "Graph.h"
+
+// Bumped whenever the layout or the meaning of the label file changes
+const uint32_t HUB_LABEL_FORMAT_VERSION = 1;
+
+// Figures reported after building or loading hub labels
+struct HubLabelStats {
+    double preprocessingMillis; // Wall time of build() (0 after load())
+    long long entries;          // (hub, distance) pairs over every label
+    int maxLabelSize;
+
+    // Mean entries per station
+    double averageLabelSize(int numVertices) const;
+};
+
+// Hub labels (2-hop labels) over a frozen Graph, for distance-only queries
+// such as fare quotes that must not run a search at all.
+//
+// Every station v gets a label: a list of hubs h with the distance d(v, h),
+// chosen so that any two stations share a hub on some shortest route
+// between them. A query merges the two labels, which are sorted by hub,
+// and takes the smallest d(s, h) + d(h, t): a few dozen comparisons and no
+// per-query state, so the index can be read from any number of threads.
+//
+// The labels are built by pruned landmark labeling (Akiba, Iwata and
+// Yoshida): stations are taken in order of importance, and a Dijkstra
+// search from each adds it as a hub to the labels of the stations it
+// reaches, but stops wherever the labels built so far already give a
+// distance no longer than the search's. Important stations are those on
+// many shortest routes, estimated from a sample of shortest-path trees.
+//
+// Each entry also keeps the neighbour one hop nearer its hub, so a route
+// can be unpacked by walking both labels to the meeting hub.
+//
+// Labels are saved to a file of their own, next to the network snapshot,
+// and the file remembers a checksum of the network's connections so it is
+// only loaded for the network it was built for. Layout (native byte order,
+// every section 8-byte aligned):
+//
+//   header        magic "METROHUB", format version, sizes, checksums
+//   order         int32[V], the station of each hub rank
+//   offsets       int32[V + 1], the entries of station v are [offsets[v], offsets[v + 1])
+//   hubs          int32[N], hub ranks, ascending within each label
+//   distances     int32[N]
+//   parents       int32[N], neighbour one hop nearer the hub (-1 at the hub)
+//
+// The labels are a snapshot: rebuild them after the graph changes.
+class HubLabels {
+private:
+    int numVertices;
+    std::vector<int> order; // Station of each hub rank, most important first
+
+    // Label CSR, structure of arrays so queries stream hubs and distances
+    std::vector<int> labelOffsets;
+    std::vector<int> labelHubs;
+    std::vector<int> labelDistances;
+    std::vector<int> labelParents;
+
+    uint64_t networkChecksum; // Fingerprint of the indexed connections
+    HubLabelStats stats;
+
+    // Index of hub rank in v's label (which must contain it)
+    int findEntry(int v, int rank) const;
+
+    // Append the stations from v to the hub of rank, v first
+    void walkToHub(int v, int rank, std::vector<int>& path) const;
+
+public:
+    HubLabels();
+
+    // Label every station of the graph (which must be frozen)
+    void build(const Graph& graph);
+
+    // Check if build() or load() has run
+    bool isBuilt() const;
+
+    // Shortest distance between two stations (INT_MAX if unreachable).
+    // Not timed: reading the clock would cost more than the query.
+    int distance(int src, int dest) const;
+
+    // Shortest distance and station sequence; same contract as Graph::dijkstra
+    std::pair<int, std::vector<int>> query(int src, int dest) const;
+
+    // Variant writing the route into the caller's path
+    int query(int src, int dest, std::vector<int>& path) const;
+
+    // Bytes held by the labels and the order
+    size_t memoryBytes() const;
+
+    // Figures from the last build() or load()
+    const HubLabelStats& getStats() const;
+
+    // Write the labels to path. Returns false and sets error on I/O failure.
+    bool save(const std::string& path, std::string& error) const;
+
+    // Replace the labels with those saved at path for graph (which must be
+    // frozen). Returns false and sets error (leaving the labels untouched)
+    // if the file is missing, corrupt, from an incompatible version or
+    // built for a different network.
+    bool load(const Graph& graph, const std::string& path, std::string& error);
+};
+
+// Where the labels of a network snapshot are kept: next to it
+std::string hubLabelsPath(const std::string& snapshotPath);
+
+#endif // HUB_LABELS_H
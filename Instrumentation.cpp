@@ -0,0 +1,231 @@
+#include "Instrumentation.h"
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+
+// Every ThreadStats ever registered. Entries are never removed, so the
+// figures of finished threads stay in the totals.
+static std::mutex registryMutex;
+static std::vector<std::unique_ptr<ThreadStats>>& registry() {
+    static std::vector<std::unique_ptr<ThreadStats>> threads;
+    return threads;
+}
+
+const char* counterName(Counter counter) {
+    static const char* const names[NUM_COUNTERS] = { "settled_nodes", "relaxed_edges", "heap_inserts",
+                                                     "heap_decreases", "heap_extracts" };
+    return names[static_cast<int>(counter)];
+}
+
+const char* queryKindName(QueryKind kind) {
+    static const char* const names[NUM_QUERY_KINDS] = { "dijkstra", "shortest_path_tree", "bidirectional",
+                                                        "fastest_route", "plan_route", "landmark",
+                                                        "hierarchy", "isochrone", "pareto",
+                                                        "delta_stepping", "hub_labels" };
+    return names[static_cast<int>(kind)];
+}
+
+// LatencyHistogram implementation
+LatencyHistogram::LatencyHistogram() {
+    for (std::atomic<uint64_t>& count : counts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+void LatencyHistogram::addTo(std::vector<uint64_t>& totals) const {
+    for (int b = 0; b < NUM_BUCKETS; b++) {
+        totals[b] += counts[b].load(std::memory_order_relaxed);
+    }
+}
+
+uint64_t LatencyHistogram::bucketStart(int bucket) {
+    if (bucket < 64) {
+        return static_cast<uint64_t>(bucket);
+    }
+    int magnitude = (bucket - 64) / 32 + 6;
+    uint64_t sub = static_cast<uint64_t>((bucket - 64) % 32);
+    return (32 + sub) << (magnitude - SUB_BUCKET_BITS);
+}
+
+// ThreadStats implementation
+ThreadStats::ThreadStats() {
+    for (std::atomic<uint64_t>& counter : counters) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+}
+
+QueryStats::QueryStats() : kind(QueryKind::Dijkstra), nanos(0), counters() {}
+
+LatencySummary::LatencySummary()
+    : queries(0), meanMicros(0), p50Micros(0), p90Micros(0), p99Micros(0), p999Micros(0), maxMicros(0) {}
+
+InstrumentationReport::InstrumentationReport() : enabled(false), threads(0), counters() {}
+
+#ifndef METRO_NO_INSTRUMENTATION
+// Summarise merged bucket counts. A percentile is reported as the middle
+// of the bucket it falls in.
+static LatencySummary summarise(const std::vector<uint64_t>& buckets) {
+    LatencySummary summary;
+    double total = 0;
+    int last = -1;
+    for (int b = 0; b < LatencyHistogram::NUM_BUCKETS; b++) {
+        if (buckets[b] == 0) {
+            continue;
+        }
+        summary.queries += buckets[b];
+        uint64_t end = b + 1 < LatencyHistogram::NUM_BUCKETS ? LatencyHistogram::bucketStart(b + 1)
+                                                             : LatencyHistogram::bucketStart(b) * 2;
+        total += buckets[b] * (LatencyHistogram::bucketStart(b) + end) / 2.0;
+        last = b;
+    }
+    if (summary.queries == 0) {
+        return summary;
+    }
+    summary.meanMicros = total / summary.queries / 1000.0;
+    summary.maxMicros = (last + 1 < LatencyHistogram::NUM_BUCKETS ? LatencyHistogram::bucketStart(last + 1)
+                                                                   : LatencyHistogram::bucketStart(last) * 2) / 1000.0;
+
+    const double quantiles[] = { 0.5, 0.9, 0.99, 0.999 };
+    double* results[] = { &summary.p50Micros, &summary.p90Micros, &summary.p99Micros, &summary.p999Micros };
+    for (int q = 0; q < 4; q++) {
+        uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(quantiles[q] * summary.queries + 0.5));
+        uint64_t seen = 0;
+        for (int b = 0; b < LatencyHistogram::NUM_BUCKETS; b++) {
+            seen += buckets[b];
+            if (seen >= rank) {
+                uint64_t start = LatencyHistogram::bucketStart(b);
+                uint64_t end = b + 1 < LatencyHistogram::NUM_BUCKETS ? LatencyHistogram::bucketStart(b + 1)
+                                                                     : start * 2;
+                *results[q] = (start + end) / 2.0 / 1000.0;
+                break;
+            }
+        }
+    }
+    return summary;
+}
+#endif
+
+std::string InstrumentationReport::formatText() const {
+    if (!enabled) {
+        return "Instrumentation disabled at compile time\n";
+    }
+    std::string text;
+    char line[256];
+    std::snprintf(line, sizeof(line), "Query instrumentation (%d threads)\n", threads);
+    text += line;
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        std::snprintf(line, sizeof(line), "  %-16s %16llu\n", counterName(static_cast<Counter>(c)),
+                      static_cast<unsigned long long>(counters[c]));
+        text += line;
+    }
+    std::snprintf(line, sizeof(line), "  %-20s %10s %10s %10s %10s %10s %10s %10s\n", "query (us)", "count",
+                  "mean", "p50", "p90", "p99", "p99.9", "max");
+    text += line;
+    for (int k = 0; k < NUM_QUERY_KINDS; k++) {
+        const LatencySummary& summary = latency[k];
+        if (summary.queries == 0) {
+            continue;
+        }
+        std::snprintf(line, sizeof(line), "  %-20s %10llu %10.2f %10.2f %10.2f %10.2f %10.2f %10.2f\n",
+                      queryKindName(static_cast<QueryKind>(k)), static_cast<unsigned long long>(summary.queries),
+                      summary.meanMicros, summary.p50Micros, summary.p90Micros, summary.p99Micros,
+                      summary.p999Micros, summary.maxMicros);
+        text += line;
+    }
+    return text;
+}
+
+std::string InstrumentationReport::formatJson() const {
+    std::string json;
+    char field[256];
+    std::snprintf(field, sizeof(field), "{\"enabled\": %s, \"threads\": %d, \"counters\": {",
+                  enabled ? "true" : "false", threads);
+    json += field;
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        std::snprintf(field, sizeof(field), "%s\"%s\": %llu", c > 0 ? ", " : "",
+                      counterName(static_cast<Counter>(c)), static_cast<unsigned long long>(counters[c]));
+        json += field;
+    }
+    json += "}, \"queries\": {";
+    bool first = true;
+    for (int k = 0; k < NUM_QUERY_KINDS; k++) {
+        const LatencySummary& summary = latency[k];
+        if (summary.queries == 0) {
+            continue;
+        }
+        std::snprintf(field, sizeof(field),
+                      "%s\"%s\": {\"count\": %llu, \"mean_us\": %.3f, \"p50_us\": %.3f, \"p90_us\": %.3f, "
+                      "\"p99_us\": %.3f, \"p999_us\": %.3f, \"max_us\": %.3f}",
+                      first ? "" : ", ", queryKindName(static_cast<QueryKind>(k)),
+                      static_cast<unsigned long long>(summary.queries), summary.meanMicros, summary.p50Micros,
+                      summary.p90Micros, summary.p99Micros, summary.p999Micros, summary.maxMicros);
+        json += field;
+        first = false;
+    }
+    json += "}}";
+    return json;
+}
+
+namespace instrumentation {
+
+ThreadStats& registerThread() {
+    std::unique_ptr<ThreadStats> stats(new ThreadStats());
+    current = stats.get();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registry().push_back(std::move(stats));
+    return *current;
+}
+
+QueryStats& lastQuery() {
+    thread_local QueryStats last;
+    return last;
+}
+
+InstrumentationReport report() {
+    InstrumentationReport result;
+#ifndef METRO_NO_INSTRUMENTATION
+    result.enabled = true;
+    std::vector<std::vector<uint64_t>> buckets(NUM_QUERY_KINDS,
+                                               std::vector<uint64_t>(LatencyHistogram::NUM_BUCKETS, 0));
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        result.threads = static_cast<int>(registry().size());
+        for (const std::unique_ptr<ThreadStats>& stats : registry()) {
+            for (int c = 0; c < NUM_COUNTERS; c++) {
+                result.counters[c] += stats->counters[c].load(std::memory_order_relaxed);
+            }
+            for (int k = 0; k < NUM_QUERY_KINDS; k++) {
+                stats->latency[k].addTo(buckets[k]);
+            }
+        }
+    }
+    for (int k = 0; k < NUM_QUERY_KINDS; k++) {
+        result.latency[k] = summarise(buckets[k]);
+    }
+#endif
+    return result;
+}
+
+}
+
+// QueryTimer implementation
+QueryTimer::QueryTimer(QueryKind kind) : kind(kind), stats(&instrumentation::local()) {
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        countersAtStart[c] = stats->counters[c].load(std::memory_order_relaxed);
+    }
+    start = std::chrono::steady_clock::now();
+}
+
+QueryTimer::~QueryTimer() {
+    uint64_t nanos = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+    stats->latency[static_cast<int>(kind)].record(nanos);
+
+    QueryStats& last = instrumentation::lastQuery();
+    last.kind = kind;
+    last.nanos = nanos;
+    for (int c = 0; c < NUM_COUNTERS; c++) {
+        last.counters[c] = stats->counters[c].load(std::memory_order_relaxed) - countersAtStart[c];
+    }
+}
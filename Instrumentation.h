@@ -0,0 +1,194 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Query instrumentation: work counters and latency histograms for the
+// route engines, cheap enough to leave on in production.
+//
+// Every thread writes to its own ThreadStats, registered on first use and
+// kept for the life of the process, so recording never takes a lock or
+// contends with another thread: a count is a plain load and store of a
+// relaxed atomic that only its thread writes. A report sums every
+// thread's figures while they keep recording.
+//
+// Building with -DMETRO_NO_INSTRUMENTATION removes it all: the METRO_*
+// macros expand to nothing and reports come back empty.
+
+// What the engines count
+enum class Counter {
+    SettledNodes,  // Vertices (or line states) taken from the queue and expanded
+    RelaxedEdges,  // Edges scanned from settled vertices
+    HeapInserts,
+    HeapDecreases, // Insert of a queued vertex with a smaller key, or decreaseKey
+    HeapExtracts,
+    COUNT
+};
+
+// Query entry points that are timed
+enum class QueryKind {
+    Dijkstra,         // Graph::dijkstra
+    ShortestPathTree, // Graph::shortestPathTree
+    Bidirectional,    // Graph::bidirectionalDijkstra
+    FastestRoute,     // Graph::fastestRoute
+    PlanRoute,        // Graph::planRoute, including cache and table lookups
+    Landmark,         // LandmarkIndex::query
+    Hierarchy,        // ContractionHierarchy::query
+    Isochrone,        // isochrone (one origin)
+    Pareto,           // paretoRoutes
+    DeltaStepping,    // DeltaStepping::shortestPathTree
+    HubLabels,        // HubLabels::query (routes; distances are not timed)
+    COUNT
+};
+
+const int NUM_COUNTERS = static_cast<int>(Counter::COUNT);
+const int NUM_QUERY_KINDS = static_cast<int>(QueryKind::COUNT);
+
+// Names used in reports
+const char* counterName(Counter counter);
+const char* queryKindName(QueryKind kind);
+
+// Log-linear histogram of nanosecond latencies in the style of
+// HdrHistogram: values below 64 are exact, and every power of two above is
+// split into 32 buckets, so a recorded value is off by at most about 3%.
+// Written by one thread, readable from any.
+class LatencyHistogram {
+public:
+    static const int SUB_BUCKET_BITS = 5;
+    static const int NUM_BUCKETS = 64 + (64 - 6) * 32;
+
+    LatencyHistogram();
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    // Count one value (owning thread only)
+    void record(uint64_t nanos) {
+        std::atomic<uint64_t>& bucket = counts[bucketOf(nanos)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    // Add the bucket counts to totals (NUM_BUCKETS entries)
+    void addTo(std::vector<uint64_t>& totals) const;
+
+    static int bucketOf(uint64_t value) {
+        if (value < 64) {
+            return static_cast<int>(value);
+        }
+        int magnitude = 63 - __builtin_clzll(value);
+        int sub = static_cast<int>(value >> (magnitude - SUB_BUCKET_BITS)) & 31;
+        return 64 + (magnitude - 6) * 32 + sub;
+    }
+
+    // Smallest value counted in a bucket
+    static uint64_t bucketStart(int bucket);
+
+private:
+    std::atomic<uint64_t> counts[NUM_BUCKETS];
+};
+
+// One thread's figures
+struct alignas(64) ThreadStats {
+    std::atomic<uint64_t> counters[NUM_COUNTERS];
+    LatencyHistogram latency[NUM_QUERY_KINDS];
+
+    ThreadStats();
+
+    void add(Counter counter, uint64_t amount) {
+        std::atomic<uint64_t>& total = counters[static_cast<int>(counter)];
+        total.store(total.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+};
+
+// Figures of the calling thread's last finished query of any timed kind
+struct QueryStats {
+    QueryKind kind;
+    uint64_t nanos;
+    uint64_t counters[NUM_COUNTERS];
+
+    QueryStats();
+};
+
+// Latency summary of one query kind over all threads
+struct LatencySummary {
+    uint64_t queries;
+    double meanMicros;
+    double p50Micros;
+    double p90Micros;
+    double p99Micros;
+    double p999Micros;
+    double maxMicros; // Upper end of the slowest bucket
+
+    LatencySummary();
+};
+
+// Totals over every thread at one moment
+struct InstrumentationReport {
+    bool enabled;   // False when built with METRO_NO_INSTRUMENTATION
+    int threads;    // Threads that have recorded anything
+    uint64_t counters[NUM_COUNTERS];
+    LatencySummary latency[NUM_QUERY_KINDS];
+
+    InstrumentationReport();
+
+    // Human-readable table
+    std::string formatText() const;
+
+    // One line of JSON
+    std::string formatJson() const;
+};
+
+namespace instrumentation {
+
+// The calling thread's stats once registered. Defined here so the hot
+// path reads it directly rather than through a TLS wrapper call.
+inline thread_local ThreadStats* current = nullptr;
+
+// Register a ThreadStats for the calling thread
+ThreadStats& registerThread();
+
+// The calling thread's stats, registered on first use
+inline ThreadStats& local() {
+    ThreadStats* stats = current;
+    return stats ? *stats : registerThread();
+}
+
+// The calling thread's last finished query
+QueryStats& lastQuery();
+
+// Sum every thread's figures
+InstrumentationReport report();
+
+}
+
+// Times one query of a kind from construction to destruction into the
+// thread's histogram, and leaves its counters in lastQuery(). Nested
+// timers (planRoute around fastestRoute) each record their own kind.
+class QueryTimer {
+private:
+    QueryKind kind;
+    ThreadStats* stats;
+    std::chrono::steady_clock::time_point start;
+    uint64_t countersAtStart[NUM_COUNTERS];
+
+public:
+    explicit QueryTimer(QueryKind kind);
+    ~QueryTimer();
+
+    QueryTimer(const QueryTimer&) = delete;
+    QueryTimer& operator=(const QueryTimer&) = delete;
+};
+
+#ifndef METRO_NO_INSTRUMENTATION
+#define METRO_COUNT(counter, amount) instrumentation::local().add(Counter::counter, amount)
+#define METRO_TIME_QUERY(kind) QueryTimer metroQueryTimer(QueryKind::kind)
+#else
+#define METRO_COUNT(counter, amount) ((void)(amount))
+#define METRO_TIME_QUERY(kind) ((void)0)
+#endif
+
+#endif // INSTRUMENTATION_H
@@ -0,0 +1,487 @@
+#include "Isochrone.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+// km limit standing for "no limit": a budget larger than any route
+static const int UNBOUNDED_KM = std::numeric_limits<int>::max() / 2;
+
+// Distances searched for the largest km within a fare or time budget
+static const int KM_SEARCH_LIMIT = 1 << 24;
+
+// Count stations per fare among fares[begin, end)
+static void countFareBands(const std::vector<unsigned char>& fares, int begin, int end,
+                           std::vector<std::pair<int, int>>& bands) {
+    int counts[256] = {};
+    for (int i = begin; i < end; i++) {
+        counts[fares[i]]++;
+    }
+    bands.clear();
+    for (int fare = 0; fare < 256; fare++) {
+        if (counts[fare] > 0) {
+            bands.push_back(std::make_pair(fare, counts[fare]));
+        }
+    }
+}
+
+// Isochrone implementation
+void Isochrone::clear() {
+    stations.clear();
+    distances.clear();
+    travelTimes.clear();
+    fares.clear();
+}
+
+size_t Isochrone::size() const {
+    return stations.size();
+}
+
+void Isochrone::fareBands(std::vector<std::pair<int, int>>& bands) const {
+    countFareBands(fares, 0, static_cast<int>(fares.size()), bands);
+}
+
+// MultiIsochrone implementation
+int MultiIsochrone::numOrigins() const {
+    return offsets.empty() ? 0 : static_cast<int>(offsets.size()) - 1;
+}
+
+int MultiIsochrone::count(int origin) const {
+    return offsets[origin + 1] - offsets[origin];
+}
+
+void MultiIsochrone::fareBands(int origin, std::vector<std::pair<int, int>>& bands) const {
+    countFareBands(fares, offsets[origin], offsets[origin + 1], bands);
+}
+
+// IsochroneContext implementation
+IsochroneContext::IsochroneContext() : generation(0) {}
+
+IsochroneContext& IsochroneContext::local() {
+    thread_local IsochroneContext context;
+    return context;
+}
+
+// Largest km whose cost is within budget (cost never decreases with km),
+// -1 if even 0 km is over it
+template <typename Cost>
+static int largestWithin(Cost cost, int budget) {
+    if (cost(0) > budget) {
+        return -1;
+    }
+    if (cost(KM_SEARCH_LIMIT) <= budget) {
+        return UNBOUNDED_KM;
+    }
+    int low = 0;                // Within budget
+    int high = KM_SEARCH_LIMIT; // Over it
+    while (high - low > 1) {
+        int middle = low + (high - low) / 2;
+        (cost(middle) <= budget ? low : high) = middle;
+    }
+    return low;
+}
+
+// Longest route in km a budget allows, for every budget measured on the
+// shortest route
+static int distanceLimit(const Graph& graph, IsochroneBudget kind, int budget) {
+    switch (kind) {
+    case IsochroneBudget::Distance:
+        return budget;
+    case IsochroneBudget::Fare:
+        return largestWithin([&graph](int km) { return graph.calculateFare(km); }, budget);
+    default:
+        return largestWithin([&graph](int km) { return graph.estimateTravelTime(km, 0); }, budget);
+    }
+}
+
+// Whether a budget is measured on the fastest route over (station, line)
+// states rather than on the shortest route
+static bool usesLineStates(const Graph& graph, IsochroneBudget kind) {
+    return kind == IsochroneBudget::Time && graph.isLineAware();
+}
+
+// Append one station to a result
+static void appendStation(const Graph& graph, int station, int distance, int travelTime, Isochrone& result) {
+    result.stations.push_back(station);
+    result.distances.push_back(distance);
+    result.travelTimes.push_back(static_cast<unsigned short>(std::min(travelTime, 0xffff)));
+    result.fares.push_back(static_cast<unsigned char>(graph.calculateFare(distance)));
+}
+
+// Dijkstra from src over stations, settling no station beyond maxKm
+static void shortestWithin(const Graph& graph, int src, int maxKm, BasicQueryContext<BucketQueue>& context,
+                           Isochrone& result) {
+    context.reset(graph.getNumVertices(), graph.getMaxEdgeDistance());
+    BucketQueue& queue = context.getQueue();
+    context.update(src, 0, -1);
+    queue.insert(src, 0);
+
+    int settled = 0;
+    int relaxed = 0;
+    while (!queue.isEmpty()) {
+        std::pair<int, int> current = queue.extractMin();
+        int u = current.second;
+        int distanceU = current.first;
+
+        // Skip entries superseded by a later decrease
+        if (distanceU > context.getDistance(u)) {
+            continue;
+        }
+        settled++;
+        appendStation(graph, u, distanceU, graph.estimateTravelTime(distanceU, 0), result);
+
+        relaxed += graph.edgeEnd(u) - graph.edgeBegin(u);
+        for (int e = graph.edgeBegin(u); e < graph.edgeEnd(u); e++) {
+            int v = graph.edgeTarget(e);
+            int candidate = distanceU + graph.edgeDistance(e);
+            if (candidate <= maxKm && candidate < context.getDistance(v)) {
+                context.update(v, candidate, u);
+                queue.insert(v, candidate);
+            }
+        }
+    }
+    METRO_COUNT(SettledNodes, settled);
+    METRO_COUNT(RelaxedEdges, relaxed);
+}
+
+// Dijkstra from src over (station, line) states in half-minutes, as
+// Graph::fastestRoute, listing each station when its first state settles
+static void fastestWithin(const Graph& graph, int src, int budget, BasicQueryContext<BucketQueue>& search,
+                          std::vector<int>& changes, std::vector<unsigned int>& emitted, unsigned int generation,
+                          Isochrone& result) {
+    // round(cost / 2) minutes is within budget exactly when cost <= 2 * budget
+    int bound = budget > std::numeric_limits<int>::max() / 4 ? std::numeric_limits<int>::max() / 2 : 2 * budget;
+
+    search.reset(graph.getNumStates(),
+                 Graph::HALF_MINUTES_PER_KM * graph.getMaxEdgeDistance() + Graph::HALF_MINUTES_PER_CHANGE);
+    BucketQueue& queue = search.getQueue();
+    emitted[src] = generation;
+    appendStation(graph, src, 0, 0, result);
+
+    // Boarding at the origin is free on every line: seed each first hop
+    for (int e = graph.edgeBegin(src); e < graph.edgeEnd(src); e++) {
+        int state = graph.edgeState(e);
+        int cost = Graph::HALF_MINUTES_PER_KM * graph.edgeDistance(e);
+        if (cost <= bound && cost < search.getDistance(state)) {
+            search.update(state, cost, -1);
+            changes[state] = 0;
+            queue.insert(state, cost);
+        }
+    }
+
+    int settled = 0;
+    int relaxed = 0;
+    while (!queue.isEmpty()) {
+        std::pair<int, int> current = queue.extractMin();
+        int state = current.second;
+        int cost = current.first;
+        if (cost > search.getDistance(state)) {
+            continue;
+        }
+        settled++;
+
+        int u = graph.stateStation(state);
+        if (emitted[u] != generation) {
+            emitted[u] = generation;
+            int distance = (cost - Graph::HALF_MINUTES_PER_CHANGE * changes[state]) / Graph::HALF_MINUTES_PER_KM;
+            appendStation(graph, u, distance, graph.estimateTravelTime(distance, changes[state]), result);
+        }
+
+        int line = graph.stateLine(state);
+        relaxed += graph.edgeEnd(u) - graph.edgeBegin(u);
+        for (int e = graph.edgeBegin(u); e < graph.edgeEnd(u); e++) {
+            bool change = Graph::isLineChange(line, graph.edgeLine(e));
+            int candidate = cost + Graph::HALF_MINUTES_PER_KM * graph.edgeDistance(e) +
+                            (change ? Graph::HALF_MINUTES_PER_CHANGE : 0);
+            int next = graph.edgeState(e);
+            if (candidate <= bound && candidate < search.getDistance(next)) {
+                search.update(next, candidate, state);
+                changes[next] = changes[state] + (change ? 1 : 0);
+                queue.insert(next, candidate);
+            }
+        }
+    }
+    METRO_COUNT(SettledNodes, settled);
+    METRO_COUNT(RelaxedEdges, relaxed);
+}
+
+void isochrone(const Graph& graph, int src, IsochroneBudget kind, int budget, IsochroneContext& context,
+               Isochrone& result) {
+    METRO_TIME_QUERY(Isochrone);
+    if (!graph.isFrozen()) {
+        throw std::logic_error("Graph must be frozen before querying");
+    }
+    result.clear();
+    if (budget < 0) {
+        return;
+    }
+
+    if (usesLineStates(graph, kind)) {
+        if (context.emitted.size() < static_cast<size_t>(graph.getNumVertices())) {
+            context.emitted.assign(graph.getNumVertices(), 0);
+            context.generation = 0;
+        }
+        if (context.changes.size() < static_cast<size_t>(graph.getNumStates())) {
+            context.changes.resize(graph.getNumStates());
+        }
+        if (++context.generation == 0) {
+            std::fill(context.emitted.begin(), context.emitted.end(), 0);
+            context.generation = 1;
+        }
+        fastestWithin(graph, src, budget, context.search, context.changes, context.emitted, context.generation,
+                      result);
+        return;
+    }
+
+    int maxKm = distanceLimit(graph, kind, budget);
+    if (maxKm >= 0) {
+        shortestWithin(graph, src, maxKm, context.search, result);
+    }
+}
+
+void isochrone(const Graph& graph, int src, IsochroneBudget kind, int budget, Isochrone& result) {
+    isochrone(graph, src, kind, budget, IsochroneContext::local(), result);
+}
+
+// Stations newly reached by some origins of a group at one distance
+struct LaneEntry {
+    int station;
+    uint64_t lanes; // One bit per origin of the group
+};
+
+// A station reached by one origin of a group
+struct LaneHit {
+    int lane;
+    int station;
+    int distance;
+};
+
+// Stations reached by each origin of a group, origin by origin. Times and
+// fares are only kept when they do not follow from the km alone.
+struct LaneOutput {
+    std::vector<int> counts;
+    std::vector<int> stations;
+    std::vector<int> distances;
+    std::vector<unsigned short> travelTimes;
+    std::vector<unsigned char> fares;
+};
+
+// Scratch of one group search, reused by a worker thread. Only stations
+// in touched are dirty, and they are cleaned after every search.
+struct LaneSearch {
+    std::vector<uint64_t> reached;               // Origins that reached each station
+    std::vector<int> pendingLevel;               // Distance of a station's latest entry
+    std::vector<int> pendingIndex;               // Position of that entry in its bucket
+    std::vector<int> touched;
+    std::vector<std::vector<LaneEntry>> buckets; // Entries by distance, modulo the bucket count
+    std::vector<LaneHit> hits;
+    std::vector<int> starts;                     // Next output position of each origin
+};
+
+// Isochrones of up to MULTI_ISOCHRONE_LANES origins at once: Dial's
+// algorithm where an entry carries the set of origins reaching a station
+// at a distance, and only origins that had not reached the target yet are
+// passed along an edge. Every origin sees exactly the distances its own
+// search would, since each (origin, station) pair is first reached at its
+// shortest distance.
+static void searchLanes(const Graph& graph, const int* origins, int numOrigins, int maxKm, LaneOutput& output) {
+    thread_local LaneSearch threadScratch;
+    LaneSearch& scratch = threadScratch;
+    int numVertices = graph.getNumVertices();
+    int numBuckets = graph.getMaxEdgeDistance() + 1;
+    if (scratch.reached.size() != static_cast<size_t>(numVertices)) {
+        scratch.reached.assign(numVertices, 0);
+        scratch.pendingLevel.assign(numVertices, -1);
+        scratch.pendingIndex.resize(numVertices);
+    }
+    scratch.buckets.resize(numBuckets);
+    scratch.hits.clear();
+
+    // Queue origins onto one station and distance, merging with the
+    // station's entry for that distance when it is still to come
+    long long pending = 0;
+    auto push = [&scratch, &pending, numBuckets](int station, int level, int current, uint64_t lanes) {
+        std::vector<LaneEntry>& bucket = scratch.buckets[level % numBuckets];
+        if (level > current && scratch.pendingLevel[station] == level) {
+            bucket[scratch.pendingIndex[station]].lanes |= lanes;
+            return;
+        }
+        scratch.pendingLevel[station] = level;
+        scratch.pendingIndex[station] = static_cast<int>(bucket.size());
+        bucket.push_back(LaneEntry{ station, lanes });
+        pending++;
+    };
+    for (int lane = 0; lane < numOrigins; lane++) {
+        push(origins[lane], 0, -1, 1ull << lane);
+    }
+
+    int settled = 0;
+    int relaxed = 0;
+    for (int level = 0; pending > 0 && level <= maxKm; level++) {
+        std::vector<LaneEntry>& bucket = scratch.buckets[level % numBuckets];
+
+        // Zero-length edges append to the bucket being scanned
+        for (size_t i = 0; i < bucket.size(); i++) {
+            int u = bucket[i].station;
+            uint64_t fresh = bucket[i].lanes & ~scratch.reached[u];
+            if (fresh == 0) {
+                continue;
+            }
+            if (scratch.reached[u] == 0) {
+                scratch.touched.push_back(u);
+            }
+            scratch.reached[u] |= fresh;
+            settled++;
+            for (uint64_t bits = fresh; bits != 0; bits &= bits - 1) {
+                scratch.hits.push_back(LaneHit{ __builtin_ctzll(bits), u, level });
+            }
+
+            relaxed += graph.edgeEnd(u) - graph.edgeBegin(u);
+            for (int e = graph.edgeBegin(u); e < graph.edgeEnd(u); e++) {
+                int next = level + graph.edgeDistance(e);
+                if (next > maxKm) {
+                    continue;
+                }
+                int v = graph.edgeTarget(e);
+                uint64_t lanes = fresh & ~scratch.reached[v];
+                if (lanes != 0) {
+                    push(v, next, level, lanes);
+                }
+            }
+        }
+        pending -= static_cast<long long>(bucket.size());
+        bucket.clear();
+    }
+    METRO_COUNT(SettledNodes, settled);
+    METRO_COUNT(RelaxedEdges, relaxed);
+
+    // Every station pushed was reached, so cleaning the touched ones
+    // leaves the scratch ready for the next group
+    for (int station : scratch.touched) {
+        scratch.reached[station] = 0;
+        scratch.pendingLevel[station] = -1;
+    }
+    scratch.touched.clear();
+
+    // Group the hits by origin, keeping each origin's in distance order
+    output.counts.assign(numOrigins, 0);
+    for (const LaneHit& hit : scratch.hits) {
+        output.counts[hit.lane]++;
+    }
+    scratch.starts.resize(numOrigins);
+    int start = 0;
+    for (int lane = 0; lane < numOrigins; lane++) {
+        scratch.starts[lane] = start;
+        start += output.counts[lane];
+    }
+    output.stations.resize(scratch.hits.size());
+    output.distances.resize(scratch.hits.size());
+    for (const LaneHit& hit : scratch.hits) {
+        int position = scratch.starts[hit.lane]++;
+        output.stations[position] = hit.station;
+        output.distances[position] = hit.distance;
+    }
+}
+
+// One isochrone() per origin of a group, for budgets the lanes cannot carry
+static void searchEach(const Graph& graph, const int* origins, int numOrigins, IsochroneBudget kind, int budget,
+                       LaneOutput& output) {
+    thread_local Isochrone result;
+    output.counts.assign(numOrigins, 0);
+    output.stations.clear();
+    output.distances.clear();
+    output.travelTimes.clear();
+    output.fares.clear();
+    for (int lane = 0; lane < numOrigins; lane++) {
+        isochrone(graph, origins[lane], kind, budget, result);
+        output.counts[lane] = static_cast<int>(result.size());
+        output.stations.insert(output.stations.end(), result.stations.begin(), result.stations.end());
+        output.distances.insert(output.distances.end(), result.distances.begin(), result.distances.end());
+        output.travelTimes.insert(output.travelTimes.end(), result.travelTimes.begin(), result.travelTimes.end());
+        output.fares.insert(output.fares.end(), result.fares.begin(), result.fares.end());
+    }
+}
+
+void multiIsochrone(const Graph& graph, const std::vector<int>& sources, IsochroneBudget kind, int budget,
+                    ThreadPool& pool, MultiIsochrone& result) {
+    if (!graph.isFrozen()) {
+        throw std::logic_error("Graph must be frozen before querying");
+    }
+    int numSources = static_cast<int>(sources.size());
+
+    // Stations are numbered along their lines, so origins taken in station
+    // order share a group with their neighbours and their searches overlap
+    std::vector<int> order(numSources);
+    for (int i = 0; i < numSources; i++) {
+        order[i] = i;
+    }
+    std::stable_sort(order.begin(), order.end(), [&sources](int a, int b) { return sources[a] < sources[b]; });
+    std::vector<int> sorted(numSources);
+    for (int i = 0; i < numSources; i++) {
+        sorted[i] = sources[order[i]];
+    }
+
+    // A negative budget, or a fare or time below that of 0 km, reaches nothing
+    bool lanes = !usesLineStates(graph, kind);
+    int maxKm = lanes && budget >= 0 ? distanceLimit(graph, kind, budget) : budget;
+    int numGroups = maxKm < 0 ? 0 : (numSources + MULTI_ISOCHRONE_LANES - 1) / MULTI_ISOCHRONE_LANES;
+    std::vector<LaneOutput> groups(numGroups);
+    pool.parallelFor(numGroups, [&](int group) {
+        int first = group * MULTI_ISOCHRONE_LANES;
+        int count = std::min(MULTI_ISOCHRONE_LANES, numSources - first);
+        if (lanes) {
+            searchLanes(graph, sorted.data() + first, count, maxKm, groups[group]);
+        } else {
+            searchEach(graph, sorted.data() + first, count, kind, budget, groups[group]);
+        }
+    });
+
+    // Lay the groups' answers out in the caller's origin order
+    result.offsets.assign(numSources + 1, 0);
+    std::vector<int> groupStarts(numSources);
+    for (int group = 0; group < numGroups; group++) {
+        int start = 0;
+        for (size_t lane = 0; lane < groups[group].counts.size(); lane++) {
+            int i = order[group * MULTI_ISOCHRONE_LANES + lane];
+            groupStarts[i] = start;
+            result.offsets[i + 1] = groups[group].counts[lane];
+            start += groups[group].counts[lane];
+        }
+    }
+    for (int i = 0; i < numSources; i++) {
+        result.offsets[i + 1] += result.offsets[i];
+    }
+    size_t total = result.offsets[numSources];
+    result.stations.resize(total);
+    result.distances.resize(total);
+    result.travelTimes.resize(total);
+    result.fares.resize(total);
+
+    // Otherwise time and fare depend on the km alone: work them out once per km
+    int longest = 0;
+    for (const LaneOutput& group : groups) {
+        for (int distance : group.distances) {
+            longest = std::max(longest, distance);
+        }
+    }
+    std::vector<unsigned short> travelTimes(lanes ? longest + 1 : 0);
+    std::vector<unsigned char> fares(lanes ? longest + 1 : 0);
+    for (size_t distance = 0; distance < travelTimes.size(); distance++) {
+        int km = static_cast<int>(distance);
+        travelTimes[distance] = static_cast<unsigned short>(std::min(graph.estimateTravelTime(km, 0), 0xffff));
+        fares[distance] = static_cast<unsigned char>(graph.calculateFare(km));
+    }
+
+    for (int p = 0; p < numSources && numGroups > 0; p++) {
+        int i = order[p];
+        const LaneOutput& group = groups[p / MULTI_ISOCHRONE_LANES];
+        int from = groupStarts[i];
+        int to = result.offsets[i];
+        for (int k = 0; k < result.offsets[i + 1] - result.offsets[i]; k++) {
+            int distance = group.distances[from + k];
+            result.stations[to + k] = group.stations[from + k];
+            result.distances[to + k] = distance;
+            result.travelTimes[to + k] = lanes ? travelTimes[distance] : group.travelTimes[from + k];
+            result.fares[to + k] = lanes ? fares[distance] : group.fares[from + k];
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef ISOCHRONE_H
+#define ISOCHRONE_H
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "Graph.h"
+#include "QueryContext.h"
+#include "ThreadPool.h"
+
+// What an isochrone's budget limits
+enum class IsochroneBudget {
+    Distance, // km along the shortest route
+    Fare,     // Rs, the fare of the shortest route (Graph::calculateFare)
+    Time      // Minutes along the fastest route, interchanges included, on
+              // line-aware networks; 1.5 minutes per km on others
+};
+
+// Stations reachable from one origin within a budget, nearest first (by
+// the budget's measure), the origin itself included. Entry i of every
+// column belongs to stations[i].
+struct Isochrone {
+    std::vector<int> stations;
+    std::vector<int> distances;              // km of the route found (of equally fast routes, any one)
+    std::vector<unsigned short> travelTimes; // Minutes: exact for a Time budget on line-aware
+                                             // networks, otherwise without interchanges
+    std::vector<unsigned char> fares;        // Rs, from the distance
+
+    // Drop every station
+    void clear();
+
+    // Number of stations reached
+    size_t size() const;
+
+    // Stations per fare as (Rs, stations), cheapest first
+    void fareBands(std::vector<std::pair<int, int>>& bands) const;
+};
+
+// Isochrones of many origins in one set of columns: origin i's stations
+// are [offsets[i], offsets[i + 1]), nearest first.
+struct MultiIsochrone {
+    std::vector<int> offsets;
+    std::vector<int> stations;
+    std::vector<int> distances;
+    std::vector<unsigned short> travelTimes;
+    std::vector<unsigned char> fares;
+
+    // Number of origins
+    int numOrigins() const;
+
+    // Stations reached from origin i
+    int count(int origin) const;
+
+    // Stations per fare from origin i as (Rs, stations), cheapest first
+    void fareBands(int origin, std::vector<std::pair<int, int>>& bands) const;
+};
+
+// Reusable scratch state of isochrone queries. A context must not be
+// shared between threads; use local() for a per-thread instance.
+class IsochroneContext {
+private:
+    friend void isochrone(const Graph&, int, IsochroneBudget, int, IsochroneContext&, Isochrone&);
+
+    BasicQueryContext<BucketQueue> search;
+    std::vector<int> changes;             // Line changes to each state (Time budget)
+    std::vector<unsigned int> emitted;    // Stations already listed, by generation
+    unsigned int generation;
+
+public:
+    IsochroneContext();
+
+    // Context owned by the calling thread
+    static IsochroneContext& local();
+};
+
+// Every station reachable from src within budget (inclusive), found by
+// Dijkstra that stops at the budget instead of at a destination. A
+// negative budget reaches nothing. The graph must be frozen.
+void isochrone(const Graph& graph, int src, IsochroneBudget kind, int budget, IsochroneContext& context,
+               Isochrone& result);
+
+// isochrone() in the calling thread's context
+void isochrone(const Graph& graph, int src, IsochroneBudget kind, int budget, Isochrone& result);
+
+// Isochrones of many origins at once, each the same set with the same
+// distances as isochrone() gives it. Origins are taken in station order
+// and searched together in groups of MULTI_ISOCHRONE_LANES, one bit of a
+// machine word per origin: a bucket queue over distances carries, for
+// each station, the mask of origins newly reaching it, so one scan of a
+// station's edges serves every origin of the group. This pays off when
+// the origins are near each other (every station of an area); scattered
+// origins cost about what separate searches do. Groups run on the pool. A
+// Time budget on line-aware networks, whose interchange penalties make km
+// unrecoverable per bit, runs one search per origin on the pool instead.
+void multiIsochrone(const Graph& graph, const std::vector<int>& sources, IsochroneBudget kind, int budget,
+                    ThreadPool& pool, MultiIsochrone& result);
+
+// Origins searched together by multiIsochrone (the bits of a word)
+const int MULTI_ISOCHRONE_LANES = 64;
+
+#endif // ISOCHRONE_H
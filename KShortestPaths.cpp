@@ -0,0 +1,264 @@
+#include "KShortestPaths.h"
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <set>
+
+// A loopless src -> dest path found by the search
+struct KShortestPaths::Path {
+    int distance;
+    std::vector<int> stations;
+    int deviation; // Position of the spur station where it leaves the path it was derived from
+
+    // Shortest first; equally short paths in station order so results are reproducible
+    bool operator<(const Path& other) const {
+        if (distance != other.distance) {
+            return distance < other.distance;
+        }
+        return stations < other.stations;
+    }
+};
+
+// Length of the shortest edge joining two adjacent stations
+static int hopDistance(const Graph& graph, int from, int to) {
+    int distance = std::numeric_limits<int>::max();
+    for (int e = graph.edgeBegin(from); e < graph.edgeEnd(from); e++) {
+        if (graph.edgeTarget(e) == to) {
+            distance = std::min(distance, graph.edgeDistance(e));
+        }
+    }
+    return distance;
+}
+
+// KShortestContext implementation
+KShortestContext::KShortestContext() : generation(0) {}
+
+void KShortestContext::resetBlocked(int numVertices) {
+    if (static_cast<int>(blocked.size()) < numVertices) {
+        blocked.resize(numVertices, 0);
+    }
+
+    // Same generation scheme as SearchState: clear only on wrap-around
+    generation++;
+    if (generation == 0) {
+        std::fill(blocked.begin(), blocked.end(), 0);
+        generation = 1;
+    }
+}
+
+KShortestContext& KShortestContext::local() {
+    thread_local KShortestContext context;
+    return context;
+}
+
+// KShortestPaths implementation
+KShortestPaths::KShortestPaths(const Graph& graph) : graph(&graph) {}
+
+int KShortestPaths::spurPath(int spur, int dest, int limit, KShortestContext& context,
+                             std::vector<int>& path) const {
+    const int INF = std::numeric_limits<int>::max();
+    const QueryContext& tree = context.tree;
+    const std::vector<int>& blockedNext = context.blockedNext;
+    path.clear();
+
+    // The tree path from the spur is shortest on the full network, so it is
+    // the answer whenever none of its stations or its first hop is removed
+    int first = tree.getParent(spur);
+    bool treePathFree = std::find(blockedNext.begin(), blockedNext.end(), first) == blockedNext.end();
+    for (int v = first; treePathFree && v != -1; v = tree.getParent(v)) {
+        treePathFree = !context.isBlocked(v);
+    }
+    if (treePathFree) {
+        for (int v = spur; v != -1; v = tree.getParent(v)) {
+            path.push_back(v);
+        }
+        return tree.getDistance(spur);
+    }
+
+    // Otherwise A* with the tree distances as potentials. Removing stations
+    // and edges only lengthens paths, so they stay consistent lower bounds.
+    QueryContext& search = context.spur;
+    search.reset(graph->getNumVertices(), 0);
+    MinHeap& queue = search.getQueue();
+    search.update(spur, 0, -1);
+    queue.insert(spur, tree.getDistance(spur));
+
+    bool reached = false;
+    while (!queue.isEmpty()) {
+        std::pair<int, int> current = queue.extractMin();
+
+        // Every remaining path is at least as long as the limit
+        if (current.first >= limit) {
+            break;
+        }
+
+        int u = current.second;
+        if (u == dest) {
+            reached = true;
+            break;
+        }
+
+        int distanceU = search.getDistance(u);
+        for (int e = graph->edgeBegin(u); e < graph->edgeEnd(u); e++) {
+            int v = graph->edgeTarget(e);
+            if (context.isBlocked(v) || tree.getDistance(v) == INF) {
+                continue;
+            }
+            if (u == spur && std::find(blockedNext.begin(), blockedNext.end(), v) != blockedNext.end()) {
+                continue;
+            }
+
+            int candidate = distanceU + graph->edgeDistance(e);
+            if (candidate < search.getDistance(v)) {
+                search.update(v, candidate, u);
+                queue.insert(v, candidate + tree.getDistance(v));
+            }
+        }
+    }
+
+    if (!reached) {
+        return INF;
+    }
+    search.buildPath(dest, path);
+    return search.getDistance(dest);
+}
+
+void KShortestPaths::fillRoute(const std::vector<int>& stations, int distance, Route& route) const {
+    route.distance = distance;
+    route.fare = graph->calculateFare(distance);
+    route.path = stations;
+    route.lines.clear();
+    route.interchanges.clear();
+
+    if (!graph->isLineAware()) {
+        route.lineChanges = graph->estimateLineChanges(static_cast<int>(stations.size()));
+        route.travelTime = graph->estimateTravelTime(distance, route.lineChanges);
+        return;
+    }
+
+    // Ride each hop on its shortest edge, staying on the current line when
+    // an equally short edge of that line exists
+    for (size_t i = 0; i + 1 < stations.size(); i++) {
+        int previous = i > 0 ? route.lines[i - 1] : Graph::NO_LINE;
+        int line = Graph::NO_LINE;
+        int best = std::numeric_limits<int>::max();
+        for (int e = graph->edgeBegin(stations[i]); e < graph->edgeEnd(stations[i]); e++) {
+            if (graph->edgeTarget(e) != stations[i + 1]) {
+                continue;
+            }
+            int hop = graph->edgeDistance(e);
+            if (hop < best || (hop == best && graph->edgeLine(e) == previous)) {
+                best = hop;
+                line = graph->edgeLine(e);
+            }
+        }
+        route.lines.push_back(line);
+        if (i > 0 && Graph::isLineChange(previous, line)) {
+            route.interchanges.push_back(stations[i]);
+        }
+    }
+    route.lineChanges = static_cast<int>(route.interchanges.size());
+    route.travelTime = graph->estimateTravelTime(distance, route.lineChanges);
+}
+
+std::vector<Route> KShortestPaths::query(int src, int dest, int k) const {
+    std::vector<Route> routes;
+    query(src, dest, k, KShortestContext::local(), routes);
+    return routes;
+}
+
+int KShortestPaths::query(int src, int dest, int k, KShortestContext& context, std::vector<Route>& routes) const {
+    const int INF = std::numeric_limits<int>::max();
+    routes.clear();
+    if (k <= 0) {
+        return 0;
+    }
+
+    // One tree towards dest serves every spur search of the query
+    const QueryContext& tree = context.tree;
+    graph->shortestPathTree(dest, context.tree);
+    if (tree.getDistance(src) == INF) {
+        return 0;
+    }
+
+    // The first route is the tree path from src
+    std::vector<Path> accepted(1);
+    accepted[0].distance = tree.getDistance(src);
+    accepted[0].deviation = 0;
+    for (int v = src; v != -1; v = tree.getParent(v)) {
+        accepted[0].stations.push_back(v);
+    }
+
+    // Best candidates not accepted yet, at most as many as are still needed
+    std::set<Path> candidates;
+    std::vector<char> sharesRoot;
+    std::vector<int> spurStations;
+
+    while (static_cast<int>(accepted.size()) < k) {
+        const Path& last = accepted.back();
+        int needed = k - static_cast<int>(accepted.size());
+        context.resetBlocked(graph->getNumVertices());
+        sharesRoot.assign(accepted.size(), 1);
+
+        // Spur from each station of the last path, with the stations before
+        // it blocked. Positions before its deviation were already spurred
+        // with the same root when its parent path was processed.
+        int rootDistance = 0;
+        for (int i = 0; i + 1 < static_cast<int>(last.stations.size()); i++) {
+            int spur = last.stations[i];
+
+            // Accepted paths that start with the same stations [0, i]
+            for (size_t p = 0; p < accepted.size(); p++) {
+                const std::vector<int>& stations = accepted[p].stations;
+                sharesRoot[p] = sharesRoot[p] && static_cast<int>(stations.size()) > i + 1 && stations[i] == spur;
+            }
+
+            if (i >= last.deviation) {
+                // Their next hops are already taken
+                context.blockedNext.clear();
+                for (size_t p = 0; p < accepted.size(); p++) {
+                    if (sharesRoot[p]) {
+                        context.blockedNext.push_back(accepted[p].stations[i + 1]);
+                    }
+                }
+
+                // With enough candidates, only a strictly shorter route matters
+                int limit = INF;
+                if (static_cast<int>(candidates.size()) >= needed) {
+                    limit = std::prev(candidates.end())->distance - rootDistance;
+                }
+
+                int spurDistance = INF;
+                if (tree.getDistance(spur) < limit) {
+                    spurDistance = spurPath(spur, dest, limit, context, spurStations);
+                }
+                if (spurDistance != INF) {
+                    Path candidate;
+                    candidate.distance = rootDistance + spurDistance;
+                    candidate.deviation = i;
+                    candidate.stations.assign(last.stations.begin(), last.stations.begin() + i);
+                    candidate.stations.insert(candidate.stations.end(), spurStations.begin(), spurStations.end());
+                    candidates.insert(std::move(candidate));
+                    if (static_cast<int>(candidates.size()) > needed) {
+                        candidates.erase(std::prev(candidates.end()));
+                    }
+                }
+            }
+
+            rootDistance += hopDistance(*graph, spur, last.stations[i + 1]);
+            context.block(spur);
+        }
+
+        if (candidates.empty()) {
+            break;
+        }
+        accepted.push_back(*candidates.begin());
+        candidates.erase(candidates.begin());
+    }
+
+    routes.resize(accepted.size());
+    for (size_t i = 0; i < accepted.size(); i++) {
+        fillRoute(accepted[i].stations, accepted[i].distance, routes[i]);
+    }
+    return static_cast<int>(routes.size());
+}
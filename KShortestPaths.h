@@ -0,0 +1,78 @@
+#ifndef K_SHORTEST_PATHS_H
+#define K_SHORTEST_PATHS_H
+
+#include <vector>
+#include "Graph.h"
+#include "QueryContext.h"
+
+class KShortestContext;
+
+// Alternative routes: the k shortest loopless paths between two stations,
+// by Yen's algorithm. Each accepted path is re-searched from every station
+// on it (the spur) with the stations before the spur and the next hops of
+// the accepted paths sharing that prefix removed.
+//
+// One shortest-path tree grown from the destination is shared by all spur
+// searches of a query. Its distances are exact on the full network and
+// never overestimate on the reduced one, so each spur search is an A*
+// search that heads straight for the destination; when the tree's own path
+// from the spur avoids every removed station and hop it is the answer and
+// no search runs at all. Spurs are only taken from where a path leaves its
+// parent (Lawler's refinement), and a spur whose lower bound cannot beat
+// the candidates already kept is skipped.
+//
+// The object keeps a reference to the graph, which must outlive it and stay
+// frozen and unchanged.
+class KShortestPaths {
+private:
+    const Graph* graph;
+
+    struct Path;
+
+    // Shortest spur -> dest path avoiding the blocked stations and first
+    // hops, shorter than limit. Writes it into path (spur first) and returns
+    // its distance, or INT_MAX if there is none.
+    int spurPath(int spur, int dest, int limit, KShortestContext& context, std::vector<int>& path) const;
+
+    // Fill a route's distance, fare, time and lines from its stations
+    void fillRoute(const std::vector<int>& stations, int distance, Route& route) const;
+
+public:
+    explicit KShortestPaths(const Graph& graph);
+
+    // Up to k loopless routes from src to dest, shortest first, each with
+    // fare, travel time and line changes. Fewer are returned if the network
+    // has fewer distinct routes; none if dest is unreachable.
+    std::vector<Route> query(int src, int dest, int k) const;
+
+    // Allocation-light variant in the caller's reusable context. Returns the
+    // number of routes written into routes.
+    int query(int src, int dest, int k, KShortestContext& context, std::vector<Route>& routes) const;
+};
+
+// Reusable scratch state of a k-shortest-paths query. A context must not be
+// shared between threads; use local() for a per-thread instance.
+class KShortestContext {
+private:
+    friend class KShortestPaths;
+
+    QueryContext tree;                  // Shortest-path tree towards the destination
+    QueryContext spur;                  // Spur searches
+    std::vector<unsigned int> blocked;  // Stations removed while spurring one path
+    unsigned int generation;
+    std::vector<int> blockedNext;       // Next hops removed at the current spur
+
+    // Unblock every station of a network with numVertices stations
+    void resetBlocked(int numVertices);
+
+    void block(int vertex) { blocked[vertex] = generation; }
+    bool isBlocked(int vertex) const { return blocked[vertex] == generation; }
+
+public:
+    KShortestContext();
+
+    // Context owned by the calling thread
+    static KShortestContext& local();
+};
+
+#endif // K_SHORTEST_PATHS_H
@@ -0,0 +1,249 @@
+#include "LandmarkIndex.h"
+#include "Instrumentation.h"
+#include <algorithm>
+#include <limits>
+#include <random>
+#include <cstdlib>
+
+LandmarkIndex::LandmarkIndex() : graph(nullptr), numLandmarks(0) {}
+
+void LandmarkIndex::computeDistances(int i, QueryContext& context) {
+    int numVertices = graph->getNumVertices();
+    graph->shortestPathTree(landmarks[i], context);
+    for (int v = 0; v < numVertices; v++) {
+        distances[static_cast<size_t>(v) * numLandmarks + i] = context.getDistance(v);
+    }
+}
+
+int LandmarkIndex::selectAvoid(int root, QueryContext& context) const {
+    const int INF = std::numeric_limits<int>::max();
+    int numVertices = graph->getNumVertices();
+    graph->shortestPathTree(root, context);
+    
+    // Tree vertices ordered by decreasing distance, so children come first
+    std::vector<int> order;
+    for (int v = 0; v < numVertices; v++) {
+        if (context.getDistance(v) != INF) {
+            order.push_back(v);
+        }
+    }
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return context.getDistance(a) > context.getDistance(b);
+    });
+    
+    // weight(v) = how much the current landmarks underestimate d(root, v).
+    // size(v) sums the weights of v's subtree, or is zero if the subtree
+    // already contains a landmark.
+    std::vector<long long> size(numVertices, 0);
+    std::vector<char> hasLandmark(numVertices, 0);
+    for (int landmark : landmarks) {
+        hasLandmark[landmark] = 1;
+    }
+    for (int v : order) {
+        size[v] += context.getDistance(v) - lowerBound(root, v);
+        int parent = context.getParent(v);
+        if (parent != -1) {
+            hasLandmark[parent] |= hasLandmark[v];
+            size[parent] += size[v];
+        }
+    }
+    
+    // Children lists of the tree
+    std::vector<int> childOffsets(numVertices + 1, 0);
+    for (int v : order) {
+        if (context.getParent(v) != -1) {
+            childOffsets[context.getParent(v) + 1]++;
+        }
+    }
+    for (int v = 0; v < numVertices; v++) {
+        childOffsets[v + 1] += childOffsets[v];
+    }
+    std::vector<int> children(childOffsets[numVertices]);
+    std::vector<int> fill(childOffsets.begin(), childOffsets.end() - 1);
+    for (int v : order) {
+        if (context.getParent(v) != -1) {
+            children[fill[context.getParent(v)]++] = v;
+        }
+    }
+    
+    // Descend from the root along the heaviest landmark-free subtree
+    int current = root;
+    while (true) {
+        int next = -1;
+        for (int c = childOffsets[current]; c < childOffsets[current + 1]; c++) {
+            int child = children[c];
+            if (!hasLandmark[child] && (next == -1 || size[child] > size[next])) {
+                next = child;
+            }
+        }
+        if (next == -1) {
+            return current;
+        }
+        current = next;
+    }
+}
+
+void LandmarkIndex::build(const Graph& graph, int count, LandmarkSelection selection, unsigned int seed) {
+    const int INF = std::numeric_limits<int>::max();
+    this->graph = &graph;
+    int numVertices = graph.getNumVertices();
+    numLandmarks = std::max(0, std::min(count, numVertices));
+    landmarks.clear();
+    distances.assign(static_cast<size_t>(numVertices) * numLandmarks, INF);
+    
+    QueryContext context;
+    std::mt19937 rng(seed);
+    
+    for (int i = 0; i < numLandmarks; i++) {
+        int landmark = -1;
+        
+        if (selection == LandmarkSelection::Random || (i == 0 && selection == LandmarkSelection::Avoid)) {
+            do {
+                landmark = static_cast<int>(rng() % numVertices);
+            } while (std::find(landmarks.begin(), landmarks.end(), landmark) != landmarks.end());
+            
+            // Start avoid from the periphery rather than a random station
+            if (selection == LandmarkSelection::Avoid) {
+                graph.shortestPathTree(landmark, context);
+                for (int v = 0; v < numVertices; v++) {
+                    if (context.getDistance(v) != INF && context.getDistance(v) > context.getDistance(landmark)) {
+                        landmark = v;
+                    }
+                }
+            }
+        } else if (selection == LandmarkSelection::Farthest) {
+            // Maximise the distance to the nearest chosen landmark; the first
+            // one is the station farthest from a random start
+            if (i == 0) {
+                graph.shortestPathTree(static_cast<int>(rng() % numVertices), context);
+            }
+            int bestDistance = -1;
+            for (int v = 0; v < numVertices; v++) {
+                int nearest = INF;
+                if (i == 0) {
+                    nearest = context.getDistance(v);
+                } else {
+                    for (int j = 0; j < i; j++) {
+                        nearest = std::min(nearest, distances[static_cast<size_t>(v) * numLandmarks + j]);
+                    }
+                }
+                if (nearest != INF && nearest > bestDistance) {
+                    bestDistance = nearest;
+                    landmark = v;
+                }
+            }
+        } else {
+            landmark = selectAvoid(static_cast<int>(rng() % numVertices), context);
+        }
+        
+        // Every station already chosen (tiny or fragmented network)
+        if (landmark == -1 || std::find(landmarks.begin(), landmarks.end(), landmark) != landmarks.end()) {
+            break;
+        }
+        landmarks.push_back(landmark);
+        computeDistances(i, context);
+    }
+    
+    // Drop the unused table columns if fewer landmarks were found
+    if (static_cast<int>(landmarks.size()) < numLandmarks) {
+        int found = static_cast<int>(landmarks.size());
+        std::vector<int> packed(static_cast<size_t>(numVertices) * found);
+        for (int v = 0; v < numVertices; v++) {
+            for (int i = 0; i < found; i++) {
+                packed[static_cast<size_t>(v) * found + i] = distances[static_cast<size_t>(v) * numLandmarks + i];
+            }
+        }
+        distances.swap(packed);
+        numLandmarks = found;
+    }
+}
+
+bool LandmarkIndex::isBuilt() const {
+    return graph != nullptr;
+}
+
+int LandmarkIndex::update(const Graph& graph, int a, int b) {
+    const int INF = std::numeric_limits<int>::max();
+    this->graph = &graph;
+    int distance = graph.getConnectionDistance(a, b);
+    if (distance == INF) {
+        return 0;
+    }
+    
+    // Bounds stay consistent as long as no edge is shorter than the
+    // difference of its ends' stored distances
+    int recomputed = 0;
+    QueryContext& context = QueryContext::local();
+    for (int i = 0; i < numLandmarks; i++) {
+        int fromA = distances[static_cast<size_t>(a) * numLandmarks + i];
+        int fromB = distances[static_cast<size_t>(b) * numLandmarks + i];
+        bool improved = (fromB != INF && (fromA == INF || fromB + distance < fromA)) ||
+                        (fromA != INF && (fromB == INF || fromA + distance < fromB));
+        if (improved) {
+            computeDistances(i, context);
+            recomputed++;
+        }
+    }
+    return recomputed;
+}
+
+int LandmarkIndex::lowerBound(int from, int to) const {
+    const int INF = std::numeric_limits<int>::max();
+    const int* fromRow = &distances[static_cast<size_t>(from) * numLandmarks];
+    const int* toRow = &distances[static_cast<size_t>(to) * numLandmarks];
+    
+    int bound = 0;
+    for (int i = 0; i < numLandmarks; i++) {
+        // A landmark that cannot reach both stations says nothing
+        if (fromRow[i] != INF && toRow[i] != INF) {
+            bound = std::max(bound, std::abs(toRow[i] - fromRow[i]));
+        }
+    }
+    return bound;
+}
+
+std::pair<int, std::vector<int>> LandmarkIndex::query(int src, int dest) const {
+    std::vector<int> path;
+    int distance = query(src, dest, QueryContext::local(), path);
+    return std::make_pair(distance, path);
+}
+
+int LandmarkIndex::query(int src, int dest, QueryContext& context, std::vector<int>& path) const {
+    // A* with potential lowerBound(v, dest). The bound is consistent, so
+    // every station is settled at most once, just as in plain Dijkstra.
+    METRO_TIME_QUERY(Landmark);
+    context.reset(graph->getNumVertices(), 0);
+    MinHeap& queue = context.getQueue();
+    context.update(src, 0, -1);
+    queue.insert(src, lowerBound(src, dest));
+    
+    int settled = 0;
+    int relaxed = 0;
+    while (!queue.isEmpty()) {
+        int u = queue.extractMin().second;
+        settled++;
+        if (u == dest) {
+            break;
+        }
+        
+        int distanceU = context.getDistance(u);
+        relaxed += graph->edgeEnd(u) - graph->edgeBegin(u);
+        for (int e = graph->edgeBegin(u); e < graph->edgeEnd(u); e++) {
+            int v = graph->edgeTarget(e);
+            int candidate = distanceU + graph->edgeDistance(e);
+            if (candidate < context.getDistance(v)) {
+                context.update(v, candidate, u);
+                queue.insert(v, candidate + lowerBound(v, dest));
+            }
+        }
+    }
+    METRO_COUNT(SettledNodes, settled);
+    METRO_COUNT(RelaxedEdges, relaxed);
+    
+    context.buildPath(dest, path);
+    return context.getDistance(dest);
+}
+
+const std::vector<int>& LandmarkIndex::getLandmarks() const {
+    return landmarks;
+}
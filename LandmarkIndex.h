@@ -0,0 +1,74 @@
+#ifndef LANDMARK_INDEX_H
+#define LANDMARK_INDEX_H
+
+#include <vector>
+#include <utility>
+#include "Graph.h"
+#include "QueryContext.h"
+
+// How landmarks are chosen when building a LandmarkIndex
+enum class LandmarkSelection {
+    Random,   // Uniformly random stations
+    Farthest, // Each new landmark is the station farthest from those chosen
+    Avoid     // Goldberg-Harrelson "avoid": favour regions the current
+              // landmarks bound poorly
+};
+
+// ALT (A*, landmarks, triangle inequality) goal-directed search.
+// For every landmark L the index stores d(L, v) for all stations. Because
+// the network is undirected, |d(L, t) - d(L, v)| is a lower bound on
+// d(v, t), and the largest bound over all landmarks steers an A* search
+// towards the destination while keeping it exact. No coordinates are
+// needed, only the integer edge distances.
+// The index is built on demand by whoever wants ALT queries (LiveNetwork
+// and the benchmark); the console app does not build one, since its routes
+// come from the all-pairs table or the line-aware search.
+// The index keeps a reference to the graph, which must outlive it and stay
+// frozen and unchanged; rebuild the index after the graph changes.
+class LandmarkIndex {
+private:
+    const Graph* graph;
+    int numLandmarks;
+    std::vector<int> landmarks;
+    
+    // Vertex-major distance table: distances[v * numLandmarks + i] = d(landmarks[i], v)
+    std::vector<int> distances;
+    
+    // Fill the table column of landmark i
+    void computeDistances(int i, QueryContext& context);
+    
+    // Pick the next landmark with the avoid heuristic
+    int selectAvoid(int root, QueryContext& context) const;
+
+public:
+    LandmarkIndex();
+    
+    // Choose count landmarks and compute their distance tables.
+    // seed makes Random selection and the starting station reproducible.
+    void build(const Graph& graph, int count, LandmarkSelection selection, unsigned int seed = 42);
+    
+    // Check if build() has run
+    bool isBuilt() const;
+    
+    // Move the index to graph, a copy of the indexed network whose
+    // connection between a and b has since changed (see
+    // Graph::setConnectionDistance). A longer or closed connection leaves
+    // the stored distances valid, if looser, bounds. A shorter or reopened
+    // one makes the landmarks it brings closer to a or b recompute their
+    // distances. Returns the number of landmarks recomputed.
+    int update(const Graph& graph, int a, int b);
+    
+    // Lower bound on the distance between two stations
+    int lowerBound(int from, int to) const;
+    
+    // Shortest distance and station sequence; same contract as Graph::dijkstra
+    std::pair<int, std::vector<int>> query(int src, int dest) const;
+    
+    // Allocation-free variant using the caller's reusable context
+    int query(int src, int dest, QueryContext& context, std::vector<int>& path) const;
+    
+    // Chosen landmark stations
+    const std::vector<int>& getLandmarks() const;
+};
+
+#endif // LANDMARK_INDEX_H
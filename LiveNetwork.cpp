@@ -0,0 +1,60 @@
+#include "LiveNetwork.h"
+#include <atomic>
+#include <stdexcept>
+
+LiveNetwork::LiveNetwork(Graph graph, int numLandmarks) {
+    if (!graph.isFrozen()) {
+        throw std::logic_error("Graph must be frozen before going live");
+    }
+    std::shared_ptr<NetworkState> initial = std::make_shared<NetworkState>();
+    initial->graph = std::move(graph);
+    if (numLandmarks > 0) {
+        initial->landmarks.build(initial->graph, numLandmarks, LandmarkSelection::Avoid);
+    }
+    state = initial;
+}
+
+std::shared_ptr<const NetworkState> LiveNetwork::current() const {
+    return std::atomic_load(&state);
+}
+
+template <typename Change>
+bool LiveNetwork::update(int a, int b, Change change) {
+    std::lock_guard<std::mutex> lock(updateMutex);
+    std::shared_ptr<const NetworkState> previous = current();
+
+    // The copy is private to this writer until it is published
+    std::shared_ptr<NetworkState> next = std::make_shared<NetworkState>();
+    next->graph = previous->graph.clone();
+    
+    // Repairs touch a small region of each row; threads only pay off on
+    // larger tables
+    if (!repairPool && next->graph.getAllPairsTable() &&
+        next->graph.getNumVertices() >= AllPairsTable::PARALLEL_REPAIR_MIN_STATIONS) {
+        repairPool.reset(new ThreadPool());
+    }
+    if (!change(next->graph, repairPool.get())) {
+        return false;
+    }
+    if (previous->landmarks.isBuilt()) {
+        next->landmarks = previous->landmarks;
+        next->landmarks.update(next->graph, a, b);
+    }
+
+    std::atomic_store(&state, std::shared_ptr<const NetworkState>(next));
+    return true;
+}
+
+bool LiveNetwork::closeConnection(int a, int b) {
+    return update(a, b, [&](Graph& graph, ThreadPool* pool) { return graph.closeConnection(a, b, pool); });
+}
+
+bool LiveNetwork::reopenConnection(int a, int b) {
+    return update(a, b, [&](Graph& graph, ThreadPool* pool) { return graph.reopenConnection(a, b, pool); });
+}
+
+bool LiveNetwork::setConnectionDistance(int a, int b, int distance) {
+    return update(a, b, [&](Graph& graph, ThreadPool* pool) {
+        return graph.setConnectionDistance(a, b, distance, pool);
+    });
+}
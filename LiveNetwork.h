@@ -0,0 +1,61 @@
+#ifndef LIVE_NETWORK_H
+#define LIVE_NETWORK_H
+
+#include <memory>
+#include <mutex>
+#include "Graph.h"
+#include "LandmarkIndex.h"
+#include "ThreadPool.h"
+
+// One immutable state of a live network: the graph and the indexes built
+// on it, always consistent with each other
+struct NetworkState {
+    Graph graph;
+    LandmarkIndex landmarks; // Built only if the live network was given landmarks
+};
+
+// A network that changes while it is being queried, for closures and
+// delays during the day.
+//
+// Readers call current() and query the state they get without any lock;
+// it stays valid and unchanged for as long as they hold it, even while
+// changes are applied. Writers are serialised: each change copies the
+// current state, applies itself to the copy, repairs the precomputed
+// structures incrementally (all-pairs rows and landmark distances affected
+// by the change; the route cache is keyed by graph version) and publishes
+// the new state atomically. A contraction hierarchy cannot be repaired this
+// way and must be rebuilt on a state that needs one.
+class LiveNetwork {
+private:
+    std::shared_ptr<const NetworkState> state; // Accessed with std::atomic_load/store
+    std::mutex updateMutex;
+    
+    // Repairs all-pairs rows of large tables; started by the first update
+    // that needs it and kept for the next ones
+    std::unique_ptr<ThreadPool> repairPool;
+
+    // Apply change (given the graph and the repair pool, and returning
+    // whether it did anything) to a copy of the state and publish it
+    template <typename Change>
+    bool update(int a, int b, Change change);
+
+public:
+    // Take over a frozen graph. With numLandmarks > 0 an ALT index is built
+    // and kept up to date as well.
+    explicit LiveNetwork(Graph graph, int numLandmarks = 0);
+
+    LiveNetwork(const LiveNetwork&) = delete;
+    LiveNetwork& operator=(const LiveNetwork&) = delete;
+
+    // The latest published state
+    std::shared_ptr<const NetworkState> current() const;
+
+    // Graph::closeConnection, reopenConnection and setConnectionDistance on
+    // a new state. Return false, publishing nothing, if there was nothing
+    // to change.
+    bool closeConnection(int a, int b);
+    bool reopenConnection(int a, int b);
+    bool setConnectionDistance(int a, int b, int distance);
+};
+
+#endif // LIVE_NETWORK_H
@@ -2,9 +2,29 @@
 #include <string>
 #include <vector>
 #include <iomanip>
+#include <fstream>
 #include <cstdlib>
 #include <limits>
+#include <memory>
 #include "Graph.h"
+#include "DelhiNetwork.h"
+#include "NetworkLoader.h"
+#include "NetworkSnapshot.h"
+#include "Timetable.h"
+#include "KShortestPaths.h"
+#include "RouteCache.h"
+#include "RouteServer.h"
+#include "BatchFile.h"
+#include "Instrumentation.h"
+#include "StationIndex.h"
+#include "Isochrone.h"
+#include "ParetoRoutes.h"
+#include "HubLabels.h"
+
+#ifndef _WIN32
+#include <csignal>
+#include <unistd.h>
+#endif
 
 // Helper function to clear the screen (cross-platform)
 void clearScreen() {
@@ -21,7 +41,11 @@ void displayMenu() {
     std::cout << "1. List All Stations\n";
     std::cout << "2. Show Metro Map\n";
     std::cout << "3. Get Shortest Route & Fare\n";
-    std::cout << "4. Exit\n";
+    std::cout << "4. Plan Trip by Departure Time\n";
+    std::cout << "5. Find Alternative Routes\n";
+    std::cout << "6. Stations Within Reach\n";
+    std::cout << "7. Compare Route Options\n";
+    std::cout << "8. Exit\n";
     std::cout << "====================================\n";
     std::cout << "Enter your choice: ";
 }
@@ -47,93 +71,176 @@ std::string getStringInput(const std::string& prompt) {
     return value;
 }
 
+#ifndef _WIN32
+// Server stopped by SIGINT/SIGTERM; RouteServer::stop is async-signal-safe
+RouteServer* runningServer = nullptr;
+
+void stopServer(int) {
+    if (runningServer) {
+        runningServer->stop();
+    }
+}
+#endif
+
+// Routes listed by "Find Alternative Routes"
+const int ALTERNATIVE_ROUTES = 3;
+
+// Names suggested for a station that is not found, and the typos allowed
+const int STATION_SUGGESTIONS = 3;
+const int SUGGESTION_MAX_EDITS = 2;
+
 // Main application class
 class DelhiMetroApp {
 private:
     Graph metroGraph;
+    Timetable timetable; // Regular service generated from the network's lines
+    HubLabels hubLabels; // Fare quotes of the server, when saved with the snapshot
 
     // Initialize the metro graph with stations and connections
     void initializeMetroNetwork() {
-        // Add stations with their lines
-        metroGraph.addStation("Rajiv Chowk", "Blue & Yellow Line");
-        metroGraph.addStation("Kashmere Gate", "Red & Yellow Line");
-        metroGraph.addStation("Central Secretariat", "Yellow & Violet Line");
-        metroGraph.addStation("Mandi House", "Blue & Violet Line");
-        metroGraph.addStation("Yamuna Bank", "Blue Line");
-        metroGraph.addStation("Inderlok", "Red & Green Line");
-        metroGraph.addStation("Kirti Nagar", "Blue & Green Line");
-        metroGraph.addStation("Welcome", "Red & Pink Line");
-        metroGraph.addStation("Netaji Subhash Place", "Pink & Red Line");
-        metroGraph.addStation("Azadpur", "Yellow & Pink Line");
-        metroGraph.addStation("Dhaula Kuan", "Orange Line");
-        metroGraph.addStation("New Delhi", "Yellow & Orange Line");
-        metroGraph.addStation("Dwarka Sector 21", "Blue & Orange Line");
-        metroGraph.addStation("Botanical Garden", "Blue & Magenta Line");
-        metroGraph.addStation("Janakpuri West", "Blue & Magenta Line");
-        metroGraph.addStation("Lajpat Nagar", "Violet & Pink Line");
-        metroGraph.addStation("Mayur Vihar Phase-1", "Blue & Pink Line");
-        metroGraph.addStation("Anand Vihar", "Blue & Pink Line");
-        metroGraph.addStation("Saket", "Yellow Line");
-        metroGraph.addStation("Chandni Chowk", "Yellow Line");
-        
-        // Add connections between stations (with distances in km)
-        // Blue Line connections
-        metroGraph.addEdge("Rajiv Chowk", "Mandi House", 2);
-        metroGraph.addEdge("Mandi House", "Yamuna Bank", 6);
-        metroGraph.addEdge("Rajiv Chowk", "Kirti Nagar", 7);
-        metroGraph.addEdge("Kirti Nagar", "Janakpuri West", 9);
-        metroGraph.addEdge("Yamuna Bank", "Anand Vihar", 8);
-        metroGraph.addEdge("Botanical Garden", "Janakpuri West", 38);
-        metroGraph.addEdge("Yamuna Bank", "Mayur Vihar Phase-1", 3);
-        
-        // Yellow Line connections
-        metroGraph.addEdge("Rajiv Chowk", "Central Secretariat", 3);
-        metroGraph.addEdge("Central Secretariat", "Saket", 10);
-        metroGraph.addEdge("Rajiv Chowk", "New Delhi", 1);
-        metroGraph.addEdge("New Delhi", "Chandni Chowk", 2);
-        metroGraph.addEdge("Chandni Chowk", "Kashmere Gate", 2);
-        metroGraph.addEdge("Kashmere Gate", "Azadpur", 8);
-        
-        // Red Line connections
-        metroGraph.addEdge("Kashmere Gate", "Inderlok", 7);
-        metroGraph.addEdge("Inderlok", "Netaji Subhash Place", 5);
-        metroGraph.addEdge("Kashmere Gate", "Welcome", 5);
-        
-        // Green Line connections
-        metroGraph.addEdge("Inderlok", "Kirti Nagar", 8);
-        
-        // Violet Line connections
-        metroGraph.addEdge("Central Secretariat", "Mandi House", 2);
-        metroGraph.addEdge("Mandi House", "Lajpat Nagar", 6);
-        
-        // Orange Line (Airport Express) connections
-        metroGraph.addEdge("New Delhi", "Dhaula Kuan", 7);
-        metroGraph.addEdge("Dhaula Kuan", "Dwarka Sector 21", 15);
-        
-        // Pink Line connections
-        metroGraph.addEdge("Azadpur", "Netaji Subhash Place", 4);
-        metroGraph.addEdge("Netaji Subhash Place", "Welcome", 12);
-        metroGraph.addEdge("Welcome", "Anand Vihar", 10);
-        metroGraph.addEdge("Anand Vihar", "Mayur Vihar Phase-1", 6);
-        metroGraph.addEdge("Mayur Vihar Phase-1", "Lajpat Nagar", 10);
-        
-        // Magenta Line connections - Fixed duplicate
-        // metroGraph.addEdge("Botanical Garden", "Janakpuri West", 38); // Already added above
+        loadDelhiNetwork(metroGraph);
+    }
+
+    // Pack the network into its read-only query layout
+    void prepareQueries() {
+        metroGraph.freeze();
+        
+        // Small networks answer distance lookups from precomputed tables;
+        // routes searched per query (line-aware or larger networks) are
+        // kept in a cache
+        metroGraph.buildAllPairs();
+        metroGraph.setRouteCache(std::make_shared<RouteCache>());
+        prepareTimetable();
+    }
+
+    // Generate the timetable for departure-time queries
+    void prepareTimetable() {
+        timetable.generate(metroGraph, TimetableOptions());
     }
 
 public:
     DelhiMetroApp() {
         // Initialize the metro network with stations and connections
         initializeMetroNetwork();
+        prepareQueries();
+    }
+
+    // Replace the built-in network with one loaded from CSV files.
+    // Reports every rejected line and returns false if there were any.
+    bool loadNetworkFiles(const std::string& stationsPath, const std::string& linksPath) {
+        metroGraph = Graph();
+        hubLabels = HubLabels();
+        LoadResult result = loadNetwork(metroGraph, stationsPath, linksPath);
+        for (const LoadError& error : result.errors) {
+            std::cerr << error.file << ":" << error.line << ": " << error.message << "\n";
+        }
+        if (!result.ok()) {
+            return false;
+        }
+        prepareQueries();
+        return true;
+    }
+
+    // Replace the network with a prebuilt binary snapshot, used in place
+    bool loadSnapshotFile(const std::string& path) {
+        std::string error;
+        if (!loadSnapshot(metroGraph, path, error)) {
+            std::cerr << error << "\n";
+            return false;
+        }
+        metroGraph.buildNameIndex();
+        prepareTimetable();
+        
+        // Labels saved next to the snapshot; without them fare quotes search
+        hubLabels = HubLabels();
+        std::string labelsPath = hubLabelsPath(path);
+        if (std::ifstream(labelsPath).good() && !hubLabels.load(metroGraph, labelsPath, error)) {
+            std::cerr << error << " (fare quotes will search instead)\n";
+        }
+        return true;
+    }
+
+    // Write the prepared network as a snapshot for fast startup, with the
+    // hub labels of its fare quotes next to it
+    bool saveSnapshotFile(const std::string& path) {
+        std::string error;
+        if (!saveSnapshot(metroGraph, path, error)) {
+            std::cerr << error << "\n";
+            return false;
+        }
+        if (!hubLabels.isBuilt()) {
+            hubLabels.build(metroGraph);
+        }
+        if (!hubLabels.save(hubLabelsPath(path), error)) {
+            std::cerr << error << "\n";
+            return false;
+        }
+        return true;
+    }
+
+    // Answer route queries from other programs instead of running the menu:
+    // over the Unix domain socket at socketPath, or over stdin/stdout when
+    // it is empty. Runs until the input ends or the process is interrupted.
+    bool serve(const std::string& socketPath, int numThreads) {
+#ifndef _WIN32
+        // A client that goes away is an error on its own connection, not a
+        // reason to terminate
+        std::signal(SIGPIPE, SIG_IGN);
+        RouteServer server(metroGraph, numThreads);
+        server.setHubLabels(hubLabels.isBuilt() ? &hubLabels : nullptr);
+        runningServer = &server;
+        std::signal(SIGINT, stopServer);
+        std::signal(SIGTERM, stopServer);
+        std::string error;
+        bool ok = socketPath.empty() ? server.serveStream(STDIN_FILENO, STDOUT_FILENO, error)
+                                     : server.serveSocket(socketPath, error);
+        std::signal(SIGINT, SIG_DFL);
+        std::signal(SIGTERM, SIG_DFL);
+        runningServer = nullptr;
+        if (!ok) {
+            std::cerr << error << "\n";
+        }
+        
+        ServerStats stats = server.getStats();
+        std::cerr << "Served " << stats.requests << " requests in " << stats.batches << " batches over "
+                  << stats.connections << " connection(s), " << std::fixed << std::setprecision(0)
+                  << stats.requestsPerSecond() << " requests/s\n";
+        return ok;
+#else
+        (void)socketPath;
+        (void)numThreads;
+        std::cerr << "Server mode is not supported on Windows\n";
+        return false;
+#endif
+    }
+
+    // Plan a route for every line of a query file into an output file
+    // instead of running the menu, on numThreads workers (0 = all cores).
+    // Reports rejected lines and the overall throughput on stderr.
+    bool runBatch(const std::string& queriesPath, const std::string& outputPath, int numThreads) {
+        ThreadPool pool(numThreads);
+        BatchFileResult result = runBatchFile(metroGraph, queriesPath, outputPath, pool);
+        for (const LoadError& error : result.errors) {
+            std::cerr << error.file << ":" << error.line << ": " << error.message << "\n";
+        }
+        if (result.rejected > result.errors.size()) {
+            std::cerr << "... " << result.rejected << " lines rejected in total\n";
+        }
+        
+        std::cerr << "Answered " << result.queries << " queries (" << result.unreachable << " unreachable, "
+                  << result.rejected << " rejected) in " << std::fixed << std::setprecision(2)
+                  << result.seconds << " s on " << pool.size() << " threads: " << std::setprecision(0)
+                  << result.queriesPerSecond() << " queries/s\n";
+        return result.ok();
     }
 
     // Display all stations in the network
     void displayAllStations() {
-        std::vector<std::string> stations = metroGraph.getAllStations();
+        StationNameList stations = metroGraph.getStationNames();
         
         clearScreen();
         std::cout << "\n========== ALL METRO STATIONS ==========\n";
-        for (size_t i = 0; i < stations.size(); i++) {
+        for (int i = 0; i < stations.size(); i++) {
             std::cout << i + 1 << ". " << stations[i] << "\n";
         }
         std::cout << "======================================\n";
@@ -151,51 +258,72 @@ public:
         std::cin.get();
     }
 
+    // Ask for a station and return its index. A name that differs from a
+    // station's only in case, spacing or punctuation is accepted (name is
+    // set to the real one); otherwise the closest names are suggested and
+    // -1 returned. role names the station in messages.
+    int readStation(const std::string& prompt, const std::string& role, std::string& name) {
+        name = getStringInput(prompt);
+        int station = metroGraph.getStationIndex(name);
+        const StationIndex* index = metroGraph.getNameIndex();
+        if (station == -1 && index) {
+            station = index->findFolded(name);
+            if (station != -1) {
+                name = std::string(metroGraph.getStationName(station));
+            }
+        }
+        if (station != -1) {
+            return station;
+        }
+        
+        std::cout << role << " station not found!\n";
+        std::vector<StationMatch> matches;
+        if (index) {
+            index->search(name, STATION_SUGGESTIONS, SUGGESTION_MAX_EDITS, matches);
+        }
+        for (size_t i = 0; i < matches.size(); i++) {
+            std::cout << (i == 0 ? "Did you mean: " : ", ") << metroGraph.getStationName(matches[i].station);
+        }
+        if (!matches.empty()) {
+            std::cout << "?\n";
+        }
+        std::cout << "\nPress Enter to continue...";
+        std::cin.get();
+        return -1;
+    }
+
     // Get the shortest route and fare between two stations
     void getRouteAndFare() {
         clearScreen();
         std::cout << "\n========== GET ROUTE & FARE ==========\n";
         
         // Get source station
-        std::string sourceStation = getStringInput("Enter source station: ");
-        if (!metroGraph.hasStation(sourceStation)) {
-            std::cout << "Source station not found!\n";
-            std::cout << "\nPress Enter to continue...";
-            std::cin.get();
+        std::string sourceStation;
+        int source = readStation("Enter source station: ", "Source", sourceStation);
+        if (source == -1) {
             return;
         }
         
         // Get destination station
-        std::string destStation = getStringInput("Enter destination station: ");
-        if (!metroGraph.hasStation(destStation)) {
-            std::cout << "Destination station not found!\n";
-            std::cout << "\nPress Enter to continue...";
-            std::cin.get();
+        std::string destStation;
+        int destination = readStation("Enter destination station: ", "Destination", destStation);
+        if (destination == -1) {
             return;
         }
         
-        // Find shortest path
-        auto result = metroGraph.shortestPath(sourceStation, destStation);
-        int totalDistance = result.first;
-        std::vector<int> path = result.second;
+        // Find shortest path with fare, time and line changes
+        Route route;
+        bool found = metroGraph.planRoute(source, destination, route);
+        int totalDistance = route.distance;
+        const std::vector<int>& path = route.path;
         
         // Display results
-        if (totalDistance == -1 || path.empty()) {
+        if (!found || path.empty()) {
             std::cout << "No path found between " << sourceStation << " and " << destStation << "\n";
         } else {
-            int fare = metroGraph.calculateFare(totalDistance);
-            
-            // Simplified line change counting (basic heuristic)
-            int lineChanges = 0;
-            if (path.size() > 2) {
-                // For simplicity, estimate line changes based on path length
-                // This is a rough approximation since complex line change detection
-                // would require more sophisticated logic
-                lineChanges = static_cast<int>(path.size() / 4); // Rough estimate
-            }
-            
-            // Estimate travel time
-            int travelTime = metroGraph.estimateTravelTime(totalDistance, lineChanges);
+            int fare = route.fare;
+            int lineChanges = route.lineChanges;
+            int travelTime = route.travelTime;
             
             std::cout << "\n========== ROUTE DETAILS ==========\n";
             std::cout << "Source: " << sourceStation << "\n";
@@ -203,18 +331,19 @@ public:
             std::cout << "Total Distance: " << totalDistance << " km\n";
             std::cout << "Total Fare: Rs " << fare << "\n";
             std::cout << "Estimated Travel Time: " << travelTime << " minutes\n";
-            std::cout << "Estimated Line Changes: " << lineChanges << "\n";
             
-            std::cout << "\n========== SHORTEST PATH ==========\n";
-            std::cout << "Start at: " << metroGraph.getStation(path[0]).getName() 
-                      << " (" << metroGraph.getStation(path[0]).getLine() << ")\n";
-            
-            for (size_t i = 1; i < path.size(); i++) {
-                Station currentStation = metroGraph.getStation(path[i]);
-                
-                std::cout << "-> " << currentStation.getName() 
-                          << " (" << currentStation.getLine() << ")\n";
+            // Line-aware networks report the exact changes; otherwise they are estimated
+            if (route.lines.empty()) {
+                std::cout << "Estimated Line Changes: " << lineChanges << "\n";
+            } else {
+                std::cout << "Line Changes: " << lineChanges << "\n";
+                for (int station : route.interchanges) {
+                    std::cout << "  Interchange at " << metroGraph.getStationName(station) << "\n";
+                }
             }
+            
+            std::cout << "\n========== SHORTEST PATH ==========\n";
+            metroGraph.printPath(std::cout, route);
             std::cout << "====================================\n";
         }
         
@@ -222,6 +351,191 @@ public:
         std::cin.get();
     }
 
+    // Earliest arrival for a departure time, with fewer-change alternatives
+    void planTrip() {
+        clearScreen();
+        std::cout << "\n========== PLAN TRIP ==========\n";
+        
+        std::string sourceStation;
+        int source = readStation("Enter source station: ", "Source", sourceStation);
+        if (source == -1) {
+            return;
+        }
+        
+        std::string destStation;
+        int destination = readStation("Enter destination station: ", "Destination", destStation);
+        if (destination == -1) {
+            return;
+        }
+        
+        int departure = parseClockTime(getStringInput("Enter departure time (HH:MM): "));
+        if (departure < 0) {
+            std::cout << "Invalid time!\n";
+            std::cout << "\nPress Enter to continue...";
+            std::cin.get();
+            return;
+        }
+        
+        std::vector<Journey> journeys;
+        if (!timetable.earliestArrival(source, destination, departure, journeys)) {
+            std::cout << "No service from " << sourceStation << " to " << destStation
+                      << " after " << formatClockTime(departure) << "\n";
+        } else {
+            // Earliest arrival last; earlier entries need fewer changes
+            for (size_t j = journeys.size(); j-- > 0;) {
+                const Journey& journey = journeys[j];
+                std::cout << "\n" << (j + 1 == journeys.size() ? "Earliest arrival" : "Fewer changes")
+                          << ": depart " << formatClockTime(journey.departureTime)
+                          << ", arrive " << formatClockTime(journey.arrivalTime)
+                          << ", " << journey.getTransfers() << " change(s)\n";
+                for (const JourneyLeg& leg : journey.legs) {
+                    std::cout << "  " << formatClockTime(leg.boardTime) << "  "
+                              << metroGraph.getStationName(leg.boardStop) << " -> "
+                              << metroGraph.getStationName(leg.alightStop) << " ("
+                              << metroGraph.getLineName(leg.line) << "), arrive "
+                              << formatClockTime(leg.alightTime) << "\n";
+                }
+            }
+        }
+        
+        std::cout << "\nPress Enter to continue...";
+        std::cin.get();
+    }
+
+    // Several distinct routes between two stations, shortest first
+    void findAlternativeRoutes() {
+        clearScreen();
+        std::cout << "\n========== ALTERNATIVE ROUTES ==========\n";
+        
+        std::string sourceStation;
+        int source = readStation("Enter source station: ", "Source", sourceStation);
+        if (source == -1) {
+            return;
+        }
+        
+        std::string destStation;
+        int destination = readStation("Enter destination station: ", "Destination", destStation);
+        if (destination == -1) {
+            return;
+        }
+        
+        KShortestPaths alternatives(metroGraph);
+        std::vector<Route> routes = alternatives.query(source, destination, ALTERNATIVE_ROUTES);
+        if (routes.empty()) {
+            std::cout << "No path found between " << sourceStation << " and " << destStation << "\n";
+        }
+        for (size_t r = 0; r < routes.size(); r++) {
+            const Route& route = routes[r];
+            std::cout << "\nRoute " << r + 1 << ": " << route.distance << " km, Rs " << route.fare
+                      << ", " << route.travelTime << " minutes, " << route.lineChanges
+                      << (route.lines.empty() ? " estimated" : "") << " line change(s)\n";
+            std::cout << "  " << metroGraph.getStationName(route.path[0]);
+            for (size_t i = 1; i < route.path.size(); i++) {
+                std::cout << " -> " << metroGraph.getStationName(route.path[i]);
+            }
+            std::cout << "\n";
+            for (int station : route.interchanges) {
+                std::cout << "  Interchange at " << metroGraph.getStationName(station) << "\n";
+            }
+        }
+        
+        std::cout << "\nPress Enter to continue...";
+        std::cin.get();
+    }
+
+    // Every station within a distance, fare or time budget of one station,
+    // nearest first, with the number of stations at each fare
+    void findStationsWithinReach() {
+        clearScreen();
+        std::cout << "\n========== STATIONS WITHIN REACH ==========\n";
+        
+        std::string originStation;
+        int origin = readStation("Enter origin station: ", "Origin", originStation);
+        if (origin == -1) {
+            return;
+        }
+        
+        int choice = getInput<int>("Limit by (1 = distance in km, 2 = fare in Rs, 3 = travel time in minutes): ");
+        if (choice < 1 || choice > 3) {
+            std::cout << "Invalid choice. Press Enter to continue...";
+            std::cin.get();
+            return;
+        }
+        const IsochroneBudget kinds[] = { IsochroneBudget::Distance, IsochroneBudget::Fare, IsochroneBudget::Time };
+        const char* units[] = { " km", "", " minutes" };
+        int budget = getInput<int>("Enter the limit: ");
+        
+        Isochrone reach;
+        isochrone(metroGraph, origin, kinds[choice - 1], budget, reach);
+        std::cout << "\n" << reach.size() << " station(s) within " << (choice == 2 ? "Rs " : "") << budget
+                  << units[choice - 1] << " of " << originStation << ":\n";
+        for (size_t i = 0; i < reach.size(); i++) {
+            std::cout << "  " << metroGraph.getStationName(reach.stations[i]) << ": " << reach.distances[i]
+                      << " km, Rs " << static_cast<int>(reach.fares[i]) << ", " << reach.travelTimes[i]
+                      << " minutes\n";
+        }
+        
+        std::vector<std::pair<int, int>> bands;
+        reach.fareBands(bands);
+        for (size_t i = 0; i < bands.size(); i++) {
+            std::cout << (i == 0 ? "Stations by fare: " : ", ") << "Rs " << bands[i].first << ": " << bands[i].second;
+        }
+        std::cout << "\n\nPress Enter to continue...";
+        std::cin.get();
+    }
+
+    // Every route between two stations that no other beats on both
+    // distance and line changes, from the shortest to the fewest changes
+    void compareRouteOptions() {
+        clearScreen();
+        std::cout << "\n========== ROUTE OPTIONS ==========\n";
+        
+        std::string sourceStation;
+        int source = readStation("Enter source station: ", "Source", sourceStation);
+        if (source == -1) {
+            return;
+        }
+        
+        std::string destStation;
+        int destination = readStation("Enter destination station: ", "Destination", destStation);
+        if (destination == -1) {
+            return;
+        }
+        
+        std::vector<Route> routes;
+        paretoRoutes(metroGraph, source, destination, routes);
+        if (routes.empty()) {
+            std::cout << "No path found between " << sourceStation << " and " << destStation << "\n";
+        }
+        int fastest = 0;
+        for (size_t r = 1; r < routes.size(); r++) {
+            if (routes[r].travelTime < routes[fastest].travelTime) {
+                fastest = static_cast<int>(r);
+            }
+        }
+        for (size_t r = 0; r < routes.size(); r++) {
+            const Route& route = routes[r];
+            std::cout << "\nOption " << r + 1 << ": " << route.distance << " km, Rs " << route.fare
+                      << ", " << route.travelTime << " minutes, " << route.lineChanges
+                      << (route.lines.empty() ? " estimated" : "") << " line change(s)";
+            if (routes.size() > 1) {
+                std::cout << (r == 0 ? " - shortest" : r + 1 == routes.size() ? " - fewest changes" : "")
+                          << (static_cast<int>(r) == fastest ? " - fastest" : "");
+            }
+            std::cout << "\n  " << metroGraph.getStationName(route.path[0]);
+            for (size_t i = 1; i < route.path.size(); i++) {
+                std::cout << " -> " << metroGraph.getStationName(route.path[i]);
+            }
+            std::cout << "\n";
+            for (int station : route.interchanges) {
+                std::cout << "  Interchange at " << metroGraph.getStationName(station) << "\n";
+            }
+        }
+        
+        std::cout << "\nPress Enter to continue...";
+        std::cin.get();
+    }
+
     // Run the application
     void run() {
         int choice;
@@ -243,6 +557,18 @@ public:
                     getRouteAndFare();
                     break;
                 case 4:
+                    planTrip();
+                    break;
+                case 5:
+                    findAlternativeRoutes();
+                    break;
+                case 6:
+                    findStationsWithinReach();
+                    break;
+                case 7:
+                    compareRouteOptions();
+                    break;
+                case 8:
                     running = false;
                     break;
                 default:
@@ -255,8 +581,76 @@ public:
     }
 };
 
-int main() {
+// Print command-line usage
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--stations FILE --links FILE | --snapshot FILE]"
+              << " [--save-snapshot FILE] [--serve | --socket PATH | --batch FILE --output FILE] [--threads N]"
+              << " [--stats]\n";
+}
+
+int main(int argc, char* argv[]) {
+    std::string stationsPath, linksPath, snapshotPath, saveSnapshotPath, socketPath, batchPath, outputPath;
+    bool serveMode = false;
+    bool printStats = false;
+    int numThreads = 0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--stations" && i + 1 < argc) {
+            stationsPath = argv[++i];
+        } else if (arg == "--links" && i + 1 < argc) {
+            linksPath = argv[++i];
+        } else if (arg == "--snapshot" && i + 1 < argc) {
+            snapshotPath = argv[++i];
+        } else if (arg == "--save-snapshot" && i + 1 < argc) {
+            saveSnapshotPath = argv[++i];
+        } else if (arg == "--serve") {
+            serveMode = true;
+        } else if (arg == "--socket" && i + 1 < argc) {
+            serveMode = true;
+            socketPath = argv[++i];
+        } else if (arg == "--batch" && i + 1 < argc) {
+            batchPath = argv[++i];
+        } else if (arg == "--output" && i + 1 < argc) {
+            outputPath = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            numThreads = std::atoi(argv[++i]);
+        } else if (arg == "--stats") {
+            printStats = true;
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (stationsPath.empty() != linksPath.empty() || (!stationsPath.empty() && !snapshotPath.empty()) ||
+        batchPath.empty() != outputPath.empty() || (serveMode && !batchPath.empty())) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    
     DelhiMetroApp app;
-    app.run();
-    return 0;
+    if (!stationsPath.empty() && !app.loadNetworkFiles(stationsPath, linksPath)) {
+        return 1;
+    }
+    if (!snapshotPath.empty() && !app.loadSnapshotFile(snapshotPath)) {
+        return 1;
+    }
+    
+    // Build step: write the snapshot and exit instead of starting the menu
+    if (!saveSnapshotPath.empty()) {
+        return app.saveSnapshotFile(saveSnapshotPath) ? 0 : 1;
+    }
+    int status = 0;
+    if (!batchPath.empty()) {
+        status = app.runBatch(batchPath, outputPath, numThreads) ? 0 : 1;
+    } else if (serveMode) {
+        status = app.serve(socketPath, numThreads) ? 0 : 1;
+    } else {
+        app.run();
+    }
+    
+    // Query counters and latencies of the whole run
+    if (printStats) {
+        std::cerr << instrumentation::report().formatText();
+    }
+    return status;
 }
\ No newline at end of file
@@ -0,0 +1,162 @@
+#include "NetworkLoader.h"
+#include "CsvScanner.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+
+LoadResult::LoadResult() : stations(0), links(0) {}
+
+bool LoadResult::ok() const {
+    return errors.empty();
+}
+
+// Read a whole file into buffer with a single allocation
+static bool readFile(const std::string& path, std::vector<char>& buffer) {
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    buffer.resize(size > 0 ? static_cast<size_t>(size) : 0);
+    size_t read = buffer.empty() ? 0 : std::fread(buffer.data(), 1, buffer.size(), file);
+    std::fclose(file);
+    return read == buffer.size();
+}
+
+// Record a rejected line
+static void addError(LoadResult& result, const std::string& file, int line, const std::string& message) {
+    result.errors.push_back({ file, line, message });
+}
+
+LoadResult loadNetwork(Graph& graph, const std::string& stationsPath, const std::string& linksPath) {
+    LoadResult result;
+    std::vector<char> stationsBuffer, linksBuffer;
+    if (!readFile(stationsPath, stationsBuffer)) {
+        addError(result, stationsPath, 0, "cannot read file");
+        return result;
+    }
+    if (!readFile(linksPath, linksBuffer)) {
+        addError(result, linksPath, 0, "cannot read file");
+        return result;
+    }
+    
+    // Names map to indices through views into stationsBuffer, which stays
+    // alive until both files are processed
+    std::unordered_map<std::string_view, int> indices;
+    indices.reserve(std::count(stationsBuffer.begin(), stationsBuffer.end(), '\n') + 1);
+    
+    std::vector<std::string_view> fields;
+    const char* error;
+    CsvScanner stations(stationsBuffer);
+    bool header = true;
+    while (stations.next(fields, error)) {
+        if (header) {
+            header = false;
+            continue;
+        }
+        if (error) {
+            addError(result, stationsPath, stations.getLine(), error);
+        } else if (fields.size() < 2 || fields[0].empty()) {
+            addError(result, stationsPath, stations.getLine(), "expected name,line");
+        } else if (!indices.emplace(fields[0], graph.getNumVertices()).second) {
+            addError(result, stationsPath, stations.getLine(), "duplicate station '" + std::string(fields[0]) + "'");
+        } else {
+            graph.addStation(fields[0], fields[1]);
+            result.stations++;
+        }
+    }
+    
+    CsvScanner links(linksBuffer);
+    header = true;
+    while (links.next(fields, error)) {
+        if (header) {
+            header = false;
+            continue;
+        }
+        if (error) {
+            addError(result, linksPath, links.getLine(), error);
+            continue;
+        }
+        if (fields.size() < 3) {
+            addError(result, linksPath, links.getLine(), "expected from,to,distance");
+            continue;
+        }
+        
+        auto src = indices.find(fields[0]);
+        auto dest = indices.find(fields[1]);
+        int distance = -1;
+        std::from_chars_result parsed = std::from_chars(fields[2].data(), fields[2].data() + fields[2].size(), distance);
+        
+        if (src == indices.end()) {
+            addError(result, linksPath, links.getLine(), "unknown station '" + std::string(fields[0]) + "'");
+        } else if (dest == indices.end()) {
+            addError(result, linksPath, links.getLine(), "unknown station '" + std::string(fields[1]) + "'");
+        } else if (parsed.ec != std::errc() || parsed.ptr != fields[2].data() + fields[2].size() || distance < 0) {
+            addError(result, linksPath, links.getLine(), "invalid distance '" + std::string(fields[2]) + "'");
+        } else {
+            // Optional fourth column names the line; otherwise it is inferred
+            int line = Graph::NO_LINE;
+            if (fields.size() >= 4 && !fields[3].empty()) {
+                line = graph.addLine(fields[3]);
+            }
+            graph.addEdge(src->second, dest->second, distance, line);
+            result.links++;
+        }
+    }
+    
+    return result;
+}
+
+// Write one CSV field, quoting it if it contains a comma
+static void writeField(FILE* file, std::string_view field) {
+    bool quoted = field.find(',') != std::string_view::npos;
+    if (quoted) {
+        std::fputc('"', file);
+    }
+    std::fwrite(field.data(), 1, field.size(), file);
+    if (quoted) {
+        std::fputc('"', file);
+    }
+}
+
+bool saveNetwork(const Graph& graph, const std::string& stationsPath, const std::string& linksPath) {
+    FILE* stations = std::fopen(stationsPath.c_str(), "wb");
+    if (!stations) {
+        return false;
+    }
+    std::fputs("name,line\n", stations);
+    for (int v = 0; v < graph.getNumVertices(); v++) {
+        writeField(stations, graph.getStationName(v));
+        std::fputc(',', stations);
+        writeField(stations, graph.getStationLine(v));
+        std::fputc('\n', stations);
+    }
+    bool ok = std::fclose(stations) == 0;
+    
+    FILE* links = std::fopen(linksPath.c_str(), "wb");
+    if (!links) {
+        return false;
+    }
+    std::fputs("from,to,distance,line\n", links);
+    
+    // Each undirected connection is stored in both directions; write it once
+    for (int u = 0; u < graph.getNumVertices(); u++) {
+        for (int e = graph.edgeBegin(u); e < graph.edgeEnd(u); e++) {
+            int v = graph.edgeTarget(e);
+            if (u < v) {
+                writeField(links, graph.getStationName(u));
+                std::fputc(',', links);
+                writeField(links, graph.getStationName(v));
+                std::fprintf(links, ",%d,", graph.edgeDistance(e));
+                writeField(links, graph.getLineName(graph.edgeLine(e)));
+                std::fputc('\n', links);
+            }
+        }
+    }
+    return std::fclose(links) == 0 && ok;
+}
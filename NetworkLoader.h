@@ -0,0 +1,43 @@
+#ifndef NETWORK_LOADER_H
+#define NETWORK_LOADER_H
+
+#include <string>
+#include <vector>
+#include "Graph.h"
+
+// A problem found while loading a network file
+struct LoadError {
+    std::string file;
+    int line;            // 1-based line number
+    std::string message;
+};
+
+// Outcome of loadNetwork
+struct LoadResult {
+    int stations;                 // Stations added
+    int links;                    // Connections added
+    std::vector<LoadError> errors; // Rejected lines, in file order
+
+    LoadResult();
+    
+    // Check if every line was accepted
+    bool ok() const;
+};
+
+// Load a network from two CSV files into an empty graph:
+//   stations file:  name,line                e.g.  Rajiv Chowk,Blue & Yellow Line
+//   links file:     from,to,distance[,line]  e.g.  Rajiv Chowk,Mandi House,2,Blue Line
+// The first line of each file is a header and is skipped. Fields may be
+// wrapped in double quotes (to hold commas); extra columns are ignored.
+// Links without a line take the one line their stations share, if any.
+// Each file is read into memory once and scanned in a single pass without
+// per-line string allocations. Bad lines (unknown stations, duplicate
+// names, malformed distances) are skipped and reported with their line
+// numbers. The graph is left unfrozen.
+LoadResult loadNetwork(Graph& graph, const std::string& stationsPath, const std::string& linksPath);
+
+// Write a frozen graph in the format read by loadNetwork.
+// Returns false on I/O failure.
+bool saveNetwork(const Graph& graph, const std::string& stationsPath, const std::string& linksPath);
+
+#endif // NETWORK_LOADER_H
@@ -0,0 +1,336 @@
+#include "NetworkSnapshot.h"
+#include "Graph.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char SNAPSHOT_MAGIC[8] = { 'M', 'E', 'T', 'R', 'O', 'S', 'N', 'P' };
+static const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+uint64_t snapshotChecksum(const char* data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        hash ^= word;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// MappedFile implementation
+MappedFile::MappedFile() : data(nullptr), size(0), mapped(false) {}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+    if (mapped) {
+        munmap(const_cast<char*>(data), size);
+    }
+#endif
+}
+
+bool MappedFile::open(const std::string& path, std::string& error) {
+#ifdef _WIN32
+    // No mmap: read the file into memory instead
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::fseek(file, 0, SEEK_END);
+    long length = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    buffer.resize(length > 0 ? static_cast<size_t>(length) : 0);
+    size_t read = buffer.empty() ? 0 : std::fread(buffer.data(), 1, buffer.size(), file);
+    std::fclose(file);
+    if (read != buffer.size()) {
+        error = "cannot read " + path;
+        return false;
+    }
+    data = buffer.data();
+    size = buffer.size();
+    return true;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = "cannot open " + path;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        error = "cannot stat " + path;
+        return false;
+    }
+    size = static_cast<size_t>(info.st_size);
+    if (size == 0) {
+        ::close(fd);
+        data = nullptr;
+        return true;
+    }
+    void* address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping keeps the file referenced
+    if (address == MAP_FAILED) {
+        size = 0;
+        error = "cannot map " + path;
+        return false;
+    }
+    data = static_cast<const char*>(address);
+    mapped = true;
+    return true;
+#endif
+}
+
+// NetworkSnapshot implementation
+NetworkSnapshot::NetworkSnapshot() : header(nullptr) {}
+
+bool NetworkSnapshot::open(const std::string& path, std::string& error, bool verifyChecksum) {
+    if (!file.open(path, error)) {
+        return false;
+    }
+
+    const char* data = file.getData();
+    size_t size = file.getSize();
+    if (size < sizeof(SnapshotHeader)) {
+        error = path + ": not a network snapshot (too short)";
+        return false;
+    }
+    header = reinterpret_cast<const SnapshotHeader*>(data);
+    if (std::memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) {
+        error = path + ": not a network snapshot";
+        return false;
+    }
+    if (header->formatVersion != SNAPSHOT_FORMAT_VERSION || header->headerSize != sizeof(SnapshotHeader) ||
+        header->byteOrder != SNAPSHOT_BYTE_ORDER) {
+        error = path + ": snapshot format " + std::to_string(header->formatVersion) +
+                " is not supported (expected " + std::to_string(SNAPSHOT_FORMAT_VERSION) + ")";
+        return false;
+    }
+    if (header->fileSize != size || size % sizeof(uint64_t) != 0) {
+        error = path + ": snapshot is truncated";
+        return false;
+    }
+    if (verifyChecksum &&
+        snapshotChecksum(data + sizeof(SnapshotHeader), size - sizeof(SnapshotHeader)) != header->checksum) {
+        error = path + ": snapshot checksum mismatch";
+        return false;
+    }
+
+    // Every section must lie inside the file at its expected length
+    size_t vertices = header->numVertices;
+    size_t edges = header->numEdges;
+    size_t cells = vertices * vertices;
+    size_t offsetsBytes = (vertices + 1) * sizeof(uint32_t);
+    size_t lengths[SECTION_COUNT] = {
+        offsetsBytes, 0, offsetsBytes, 0, vertices * sizeof(int),
+        (header->numLines + 1) * sizeof(uint32_t), 0,
+        (vertices + 1) * sizeof(int), edges * sizeof(int), edges * sizeof(int), edges * sizeof(int),
+        edges * sizeof(int), (vertices + 1) * sizeof(int), 0, 0,
+        cells * sizeof(int), cells * sizeof(unsigned short), cells * sizeof(unsigned char),
+        cells * sizeof(unsigned short), cells * sizeof(unsigned short)
+    };
+    int sections = hasAllPairs() ? SECTION_COUNT : SECTION_PAIR_DISTANCES;
+    for (int i = 0; i < sections; i++) {
+        // Variable-length sections are sized by an earlier, checked section
+        if (i == SECTION_NAME_DATA || i == SECTION_LINE_DATA) {
+            lengths[i] = section<uint32_t>(i - 1)[vertices];
+        } else if (i == SECTION_LINE_NAME_DATA) {
+            lengths[i] = section<uint32_t>(i - 1)[header->numLines];
+        } else if (i == SECTION_STATE_LINES || i == SECTION_STATE_STATIONS) {
+            lengths[i] = static_cast<size_t>(getStateOffsets()[vertices]) * sizeof(int);
+        }
+        uint64_t offset = header->sections[i];
+        if (offset % sizeof(uint64_t) != 0 || offset < sizeof(SnapshotHeader) ||
+            offset > size || lengths[i] > size - offset) {
+            error = path + ": snapshot section " + std::to_string(i) + " is out of bounds";
+            return false;
+        }
+    }
+    if (getEdgeOffsets()[vertices] != static_cast<int>(edges)) {
+        error = path + ": snapshot adjacency is inconsistent";
+        return false;
+    }
+    return true;
+}
+
+std::string_view NetworkSnapshot::getLineName(int line) const {
+    return text(SECTION_LINE_NAME_OFFSETS, SECTION_LINE_NAME_DATA, line);
+}
+
+std::string_view NetworkSnapshot::text(int offsetsId, int dataId, int index) const {
+    const uint32_t* offsets = section<uint32_t>(offsetsId);
+    return std::string_view(section<char>(dataId) + offsets[index], offsets[index + 1] - offsets[index]);
+}
+
+std::string_view NetworkSnapshot::getStationName(int index) const {
+    return text(SECTION_NAME_OFFSETS, SECTION_NAME_DATA, index);
+}
+
+std::string_view NetworkSnapshot::getStationLine(int index) const {
+    return text(SECTION_LINE_OFFSETS, SECTION_LINE_DATA, index);
+}
+
+int NetworkSnapshot::findStation(std::string_view name) const {
+    const int* order = section<int>(SECTION_NAME_INDEX);
+    const int* end = order + getNumVertices();
+
+    // The index is sorted by (name, station index); like Graph's name map,
+    // a duplicated name resolves to the station added last
+    const int* it = std::upper_bound(order, end, name, [this](std::string_view key, int station) {
+        return key < getStationName(station);
+    });
+    if (it == order || getStationName(*(it - 1)) != name) {
+        return -1;
+    }
+    return *(it - 1);
+}
+
+// Snapshot writer: sections are appended to one buffer, padded to 8 bytes
+class SnapshotWriter {
+private:
+    std::vector<char> buffer;
+
+public:
+    SnapshotWriter() : buffer(sizeof(SnapshotHeader), 0) {}
+
+    std::vector<char>& getBuffer() { return buffer; }
+
+    SnapshotHeader& getHeader() { return *reinterpret_cast<SnapshotHeader*>(buffer.data()); }
+
+    // Append bytes as section id
+    void append(int id, const void* bytes, size_t length) {
+        uint64_t offset = buffer.size();
+        buffer.insert(buffer.end(), static_cast<const char*>(bytes), static_cast<const char*>(bytes) + length);
+        buffer.resize((buffer.size() + 7) / 8 * 8, 0);
+        getHeader().sections[id] = offset;
+    }
+
+    // Append strings as an offsets section followed by a data section
+    void appendStrings(int offsetsId, int dataId, const std::vector<std::string>& strings) {
+        std::vector<uint32_t> offsets(1, 0);
+        std::string data;
+        for (const std::string& s : strings) {
+            data += s;
+            offsets.push_back(static_cast<uint32_t>(data.size()));
+        }
+        append(offsetsId, offsets.data(), offsets.size() * sizeof(uint32_t));
+        append(dataId, data.data(), data.size());
+    }
+};
+
+bool saveSnapshot(const Graph& graph, const std::string& path, std::string& error) {
+    if (!graph.isFrozen()) {
+        error = "graph must be frozen before saving a snapshot";
+        return false;
+    }
+
+    int numVertices = graph.getNumVertices();
+    std::vector<std::string> names(numVertices), lines(numVertices);
+    for (int v = 0; v < numVertices; v++) {
+        names[v] = graph.getStationName(v);
+        lines[v] = graph.getStationLine(v);
+    }
+    std::vector<int> order(numVertices);
+    for (int v = 0; v < numVertices; v++) {
+        order[v] = v;
+    }
+    std::sort(order.begin(), order.end(), [&names](int a, int b) {
+        return names[a] != names[b] ? names[a] < names[b] : a < b;
+    });
+
+    SnapshotWriter writer;
+    writer.appendStrings(SECTION_NAME_OFFSETS, SECTION_NAME_DATA, names);
+    writer.appendStrings(SECTION_LINE_OFFSETS, SECTION_LINE_DATA, lines);
+    writer.append(SECTION_NAME_INDEX, order.data(), order.size() * sizeof(int));
+
+    std::vector<std::string> lineNames(graph.getNumLines());
+    for (int line = 0; line < graph.getNumLines(); line++) {
+        lineNames[line] = graph.getLineName(line);
+    }
+    writer.appendStrings(SECTION_LINE_NAME_OFFSETS, SECTION_LINE_NAME_DATA, lineNames);
+
+    std::vector<int> offsets(numVertices + 1), targets, distances, edgeLines, edgeStates;
+    for (int u = 0; u < numVertices; u++) {
+        offsets[u] = static_cast<int>(targets.size());
+        for (int e = graph.edgeBegin(u); e < graph.edgeEnd(u); e++) {
+            targets.push_back(graph.edgeTarget(e));
+            distances.push_back(graph.edgeDistance(e));
+            edgeLines.push_back(graph.edgeLine(e));
+            edgeStates.push_back(graph.edgeState(e));
+        }
+    }
+    offsets[numVertices] = static_cast<int>(targets.size());
+    writer.append(SECTION_EDGE_OFFSETS, offsets.data(), offsets.size() * sizeof(int));
+    writer.append(SECTION_EDGE_TARGETS, targets.data(), targets.size() * sizeof(int));
+    writer.append(SECTION_EDGE_DISTANCES, distances.data(), distances.size() * sizeof(int));
+    writer.append(SECTION_EDGE_LINES, edgeLines.data(), edgeLines.size() * sizeof(int));
+    writer.append(SECTION_EDGE_STATES, edgeStates.data(), edgeStates.size() * sizeof(int));
+
+    std::vector<int> stateOffsets(numVertices + 1), stateLines, stateStations;
+    for (int v = 0; v < numVertices; v++) {
+        stateOffsets[v] = static_cast<int>(stateLines.size());
+        for (int state = graph.stateBegin(v); state < graph.stateEnd(v); state++) {
+            stateLines.push_back(graph.stateLine(state));
+            stateStations.push_back(graph.stateStation(state));
+        }
+    }
+    stateOffsets[numVertices] = static_cast<int>(stateLines.size());
+    writer.append(SECTION_STATE_OFFSETS, stateOffsets.data(), stateOffsets.size() * sizeof(int));
+    writer.append(SECTION_STATE_LINES, stateLines.data(), stateLines.size() * sizeof(int));
+    writer.append(SECTION_STATE_STATIONS, stateStations.data(), stateStations.size() * sizeof(int));
+
+    uint32_t flags = graph.isLineAware() ? SNAPSHOT_LINE_AWARE : 0;
+    const AllPairsTable* table = graph.getAllPairsTable();
+    if (table) {
+        size_t cells = static_cast<size_t>(numVertices) * numVertices;
+        writer.append(SECTION_PAIR_DISTANCES, table->getDistanceData(), cells * sizeof(int));
+        writer.append(SECTION_PAIR_NEXT_HOPS, table->getNextHopData(), cells * sizeof(unsigned short));
+        writer.append(SECTION_PAIR_FARES, table->getFareData(), cells * sizeof(unsigned char));
+        writer.append(SECTION_PAIR_TRAVEL_TIMES, table->getTravelTimeData(), cells * sizeof(unsigned short));
+        writer.append(SECTION_PAIR_LINE_CHANGES, table->getLineChangeData(), cells * sizeof(unsigned short));
+        flags |= SNAPSHOT_HAS_ALL_PAIRS;
+    }
+
+    std::vector<char>& buffer = writer.getBuffer();
+    SnapshotHeader& header = writer.getHeader();
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.formatVersion = SNAPSHOT_FORMAT_VERSION;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.byteOrder = SNAPSHOT_BYTE_ORDER;
+    header.numVertices = static_cast<uint32_t>(numVertices);
+    header.numEdges = static_cast<uint32_t>(targets.size());
+    header.maxEdgeDistance = graph.getMaxEdgeDistance();
+    header.flags = flags;
+    header.numLines = static_cast<uint32_t>(graph.getNumLines());
+    header.fileSize = buffer.size();
+    header.checksum = snapshotChecksum(buffer.data() + sizeof(SnapshotHeader), buffer.size() - sizeof(SnapshotHeader));
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        error = "cannot create " + path;
+        return false;
+    }
+    size_t written = std::fwrite(buffer.data(), 1, buffer.size(), file);
+    if (std::fclose(file) != 0 || written != buffer.size()) {
+        error = "cannot write " + path;
+        return false;
+    }
+    return true;
+}
+
+bool loadSnapshot(Graph& graph, const std::string& path, std::string& error, bool verifyChecksum) {
+    std::shared_ptr<NetworkSnapshot> snapshot = std::make_shared<NetworkSnapshot>();
+    if (!snapshot->open(path, error, verifyChecksum)) {
+        return false;
+    }
+    graph.attachSnapshot(snapshot);
+    return true;
+}
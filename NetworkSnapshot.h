@@ -0,0 +1,167 @@
+#ifndef NETWORK_SNAPSHOT_H
+#define NETWORK_SNAPSHOT_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+
+class Graph;
+
+// Binary network snapshots.
+//
+// A snapshot is the frozen query layout of a Graph written out verbatim, so
+// a process can start by mapping the file and answering queries straight
+// from the mapped pages: no parsing, no per-station allocations, no CSR or
+// all-pairs rebuild. Layout (native byte order, every section 8-byte aligned):
+//
+//   SnapshotHeader
+//   station names      uint32 offsets[V + 1] + character data
+//   station lines      uint32 offsets[V + 1] + character data
+//   name index         int32[V], station indices sorted by name
+//   line names         uint32 offsets[L + 1] + character data
+//   CSR adjacency      int32 offsets[V + 1], targets[E], distances[E], lines[E]
+//   line states        int32 edge states[E], state offsets[V + 1],
+//                      state lines[S], state stations[S] (see Graph)
+//   all-pairs tables   optional, the five AllPairsTable arrays
+//
+// Readers reject files written by a different format version, with a
+// different header layout or byte order, or whose checksum does not match.
+
+// Bumped whenever the layout or the meaning of any section changes
+const uint32_t SNAPSHOT_FORMAT_VERSION = 2;
+
+// Section indices into SnapshotHeader::sections
+enum SnapshotSection {
+    SECTION_NAME_OFFSETS,
+    SECTION_NAME_DATA,
+    SECTION_LINE_OFFSETS,
+    SECTION_LINE_DATA,
+    SECTION_NAME_INDEX,
+    SECTION_LINE_NAME_OFFSETS,
+    SECTION_LINE_NAME_DATA,
+    SECTION_EDGE_OFFSETS,
+    SECTION_EDGE_TARGETS,
+    SECTION_EDGE_DISTANCES,
+    SECTION_EDGE_LINES,
+    SECTION_EDGE_STATES,
+    SECTION_STATE_OFFSETS,
+    SECTION_STATE_LINES,
+    SECTION_STATE_STATIONS,
+    SECTION_PAIR_DISTANCES,
+    SECTION_PAIR_NEXT_HOPS,
+    SECTION_PAIR_FARES,
+    SECTION_PAIR_TRAVEL_TIMES,
+    SECTION_PAIR_LINE_CHANGES,
+    SECTION_COUNT
+};
+
+// SnapshotHeader::flags
+const uint32_t SNAPSHOT_HAS_ALL_PAIRS = 1;
+const uint32_t SNAPSHOT_LINE_AWARE = 2;
+
+struct SnapshotHeader {
+    char magic[8];                    // "METROSNP"
+    uint32_t formatVersion;           // SNAPSHOT_FORMAT_VERSION of the writer
+    uint32_t headerSize;              // sizeof(SnapshotHeader) of the writer
+    uint32_t byteOrder;               // 0x01020304 as written by the writer
+    uint32_t numVertices;
+    uint32_t numEdges;                // Directed CSR entries
+    int32_t maxEdgeDistance;
+    uint32_t flags;
+    uint32_t numLines;
+    uint64_t fileSize;
+    uint64_t checksum;                // snapshotChecksum of everything after the header
+    uint64_t sections[SECTION_COUNT]; // Byte offset of each section (0 if absent)
+};
+
+// 64-bit FNV-1a over 8-byte words (size must be a multiple of 8)
+uint64_t snapshotChecksum(const char* data, size_t size);
+
+// Read-only view of a whole file, memory-mapped where the platform allows
+// and read into memory otherwise
+class MappedFile {
+private:
+    const char* data;
+    size_t size;
+    bool mapped;
+    std::vector<char> buffer; // Contents when not mapped
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Map path. Returns false and sets error on failure.
+    bool open(const std::string& path, std::string& error);
+
+    const char* getData() const { return data; }
+    size_t getSize() const { return size; }
+};
+
+// A validated snapshot file. Accessors point into the mapping.
+class NetworkSnapshot {
+private:
+    MappedFile file;
+    const SnapshotHeader* header;
+
+    template <typename T>
+    const T* section(int id) const {
+        return reinterpret_cast<const T*>(file.getData() + header->sections[id]);
+    }
+
+    std::string_view text(int offsetsId, int dataId, int index) const;
+
+public:
+    NetworkSnapshot();
+
+    // Map and validate path. Skipping the checksum avoids touching every
+    // page up front, for callers that trust the file.
+    bool open(const std::string& path, std::string& error, bool verifyChecksum = true);
+
+    int getNumVertices() const { return static_cast<int>(header->numVertices); }
+    int getNumEdges() const { return static_cast<int>(header->numEdges); }
+    int getMaxEdgeDistance() const { return header->maxEdgeDistance; }
+    int getNumLines() const { return static_cast<int>(header->numLines); }
+    bool isLineAware() const { return (header->flags & SNAPSHOT_LINE_AWARE) != 0; }
+    size_t getFileSize() const { return file.getSize(); }
+
+    std::string_view getStationName(int index) const;
+    std::string_view getStationLine(int index) const;
+    std::string_view getLineName(int line) const;
+
+    // Index of the station called name, or -1 (binary search of the name index)
+    int findStation(std::string_view name) const;
+
+    const int* getEdgeOffsets() const { return section<int>(SECTION_EDGE_OFFSETS); }
+    const int* getEdgeTargets() const { return section<int>(SECTION_EDGE_TARGETS); }
+    const int* getEdgeDistances() const { return section<int>(SECTION_EDGE_DISTANCES); }
+    const int* getEdgeLines() const { return section<int>(SECTION_EDGE_LINES); }
+    const int* getEdgeStates() const { return section<int>(SECTION_EDGE_STATES); }
+    const int* getStateOffsets() const { return section<int>(SECTION_STATE_OFFSETS); }
+    const int* getStateLines() const { return section<int>(SECTION_STATE_LINES); }
+    const int* getStateStations() const { return section<int>(SECTION_STATE_STATIONS); }
+
+    bool hasAllPairs() const { return (header->flags & SNAPSHOT_HAS_ALL_PAIRS) != 0; }
+    const int* getPairDistances() const { return section<int>(SECTION_PAIR_DISTANCES); }
+    const unsigned short* getPairNextHops() const { return section<unsigned short>(SECTION_PAIR_NEXT_HOPS); }
+    const unsigned char* getPairFares() const { return section<unsigned char>(SECTION_PAIR_FARES); }
+    const unsigned short* getPairTravelTimes() const { return section<unsigned short>(SECTION_PAIR_TRAVEL_TIMES); }
+    const unsigned short* getPairLineChanges() const { return section<unsigned short>(SECTION_PAIR_LINE_CHANGES); }
+};
+
+// Write a frozen graph, with its all-pairs table if built, to path.
+// Returns false and sets error on I/O failure.
+bool saveSnapshot(const Graph& graph, const std::string& path, std::string& error);
+
+// Replace graph with a read-only view of the snapshot at path. The graph
+// answers queries directly from the mapped file and rejects modification.
+// Returns false and sets error (leaving graph untouched) if the file is
+// missing, truncated, corrupt or from an incompatible version.
+bool loadSnapshot(Graph& graph, const std::string& path, std::string& error, bool verifyChecksum = true);
+
+#endif // NETWORK_SNAPSHOT_H
@@ -0,0 +1,179 @@
+#include "ParetoRoutes.h"
+#include <algorithm>
+#include <limits>
+
+// ParetoContext implementation
+ParetoContext::ParetoContext() {}
+
+ParetoContext& ParetoContext::local() {
+    thread_local ParetoContext context;
+    return context;
+}
+
+// Fewest line changes from every state to dest, by a search backwards from
+// dest's states that takes the states one change count at a time: a state
+// reached at no extra change joins the current level, one needing a change
+// the next. changes gets INT_MAX for states that cannot reach dest.
+static void changesToDestination(const Graph& graph, int dest, std::vector<int>& changes, std::vector<int>& level,
+                                 std::vector<int>& nextLevel) {
+    changes.assign(graph.getNumStates(), std::numeric_limits<int>::max());
+    level.clear();
+    for (int state = graph.stateBegin(dest); state < graph.stateEnd(dest); state++) {
+        changes[state] = 0;
+        level.push_back(state);
+    }
+
+    for (int count = 0; !level.empty(); count++) {
+        nextLevel.clear();
+        for (size_t i = 0; i < level.size(); i++) {
+            int state = level[i];
+            if (changes[state] != count) {
+                continue; // Lowered to this level after being queued for it as the next
+            }
+
+            // The hops into state come from the neighbours joined to its
+            // station on its line; a rider there may be on any line
+            int v = graph.stateStation(state);
+            int line = graph.stateLine(state);
+            for (int e = graph.edgeBegin(v); e < graph.edgeEnd(v); e++) {
+                if (graph.edgeLine(e) != line) {
+                    continue;
+                }
+                int u = graph.edgeTarget(e);
+                for (int previous = graph.stateBegin(u); previous < graph.stateEnd(u); previous++) {
+                    bool change = Graph::isLineChange(graph.stateLine(previous), line);
+                    if (count + (change ? 1 : 0) < changes[previous]) {
+                        changes[previous] = count + (change ? 1 : 0);
+                        (change ? nextLevel : level).push_back(previous);
+                    }
+                }
+            }
+        }
+        std::swap(level, nextLevel);
+    }
+}
+
+int paretoRoutes(const Graph& graph, int src, int dest, ParetoContext& context, std::vector<Route>& routes) {
+    METRO_TIME_QUERY(Pareto);
+    const int INF = std::numeric_limits<int>::max();
+    routes.clear();
+    if (src == dest) {
+        Route route;
+        route.distance = 0;
+        route.fare = graph.calculateFare(0);
+        route.path.push_back(src);
+        routes.push_back(route);
+        return 1;
+    }
+
+    // Lower bounds on the distance and the changes left to dest
+    graph.shortestPathTree(dest, context.bound);
+    if (context.bound.getDistance(src) == INF) {
+        return 0;
+    }
+    changesToDestination(graph, dest, context.changesBound, context.level, context.nextLevel);
+
+    context.labels.clear();
+    context.heap.clear();
+    context.front.clear();
+    context.stateBest.assign(graph.getNumStates(), INF);
+    context.stationBest.assign(graph.getNumVertices(), INF);
+    int destBest = INF; // Fewest changes of a route found so far
+
+    // Whether a label with these changes in state is dominated by none
+    // settled so far, at its state, its station or dest
+    auto undominated = [&context, &graph, &destBest](int state, int changes) {
+        return changes < context.stateBest[state] && changes <= context.stationBest[graph.stateStation(state)] &&
+               context.changesBound[state] < destBest - changes;
+    };
+
+    // Smallest key, then fewest changes, first
+    auto later = [](const ParetoContext::Entry& a, const ParetoContext::Entry& b) {
+        return a.key != b.key ? a.key > b.key : a.changes > b.changes;
+    };
+
+    // Queue a new label unless it is already dominated
+    auto push = [&](int state, int distance, int changes, int parent) {
+        if (!undominated(state, changes)) {
+            return;
+        }
+        int label = static_cast<int>(context.labels.size());
+        context.labels.push_back(ParetoContext::Label{ state, distance, changes, parent });
+        int key = distance + context.bound.getDistance(graph.stateStation(state));
+        context.heap.push_back(ParetoContext::Entry{ key, changes, label });
+        std::push_heap(context.heap.begin(), context.heap.end(), later);
+    };
+
+    // Boarding at the source is free on every line: seed each first hop
+    for (int e = graph.edgeBegin(src); e < graph.edgeEnd(src); e++) {
+        push(graph.edgeState(e), graph.edgeDistance(e), 0, -1);
+    }
+
+    int settled = 0;
+    int relaxed = 0;
+    while (!context.heap.empty()) {
+        std::pop_heap(context.heap.begin(), context.heap.end(), later);
+        int current = context.heap.back().label;
+        context.heap.pop_back();
+
+        // The pool may grow below, so copy the label out
+        ParetoContext::Label label = context.labels[current];
+        if (!undominated(label.state, label.changes)) {
+            continue;
+        }
+        settled++;
+        int u = graph.stateStation(label.state);
+        context.stateBest[label.state] = label.changes;
+        context.stationBest[u] = std::min(context.stationBest[u], label.changes);
+
+        // Going on from dest cannot lead back to it with fewer changes
+        if (u == dest) {
+            context.front.push_back(current);
+            destBest = label.changes;
+            continue;
+        }
+
+        int line = graph.stateLine(label.state);
+        relaxed += graph.edgeEnd(u) - graph.edgeBegin(u);
+        for (int e = graph.edgeBegin(u); e < graph.edgeEnd(u); e++) {
+            push(graph.edgeState(e), label.distance + graph.edgeDistance(e),
+                 label.changes + (Graph::isLineChange(line, graph.edgeLine(e)) ? 1 : 0), current);
+        }
+    }
+    METRO_COUNT(SettledNodes, settled);
+    METRO_COUNT(RelaxedEdges, relaxed);
+
+    // Unpack each route found by walking its labels back to the source
+    for (int last : context.front) {
+        Route route;
+        for (int label = last; label != -1; label = context.labels[label].parent) {
+            route.path.push_back(graph.stateStation(context.labels[label].state));
+            route.lines.push_back(graph.stateLine(context.labels[label].state));
+        }
+        route.path.push_back(src);
+        std::reverse(route.path.begin(), route.path.end());
+        std::reverse(route.lines.begin(), route.lines.end());
+        route.distance = context.labels[last].distance;
+        route.fare = graph.calculateFare(route.distance);
+
+        if (graph.isLineAware()) {
+            // The station after hop i - 1 is where the rider changes before hop i
+            for (size_t i = 1; i < route.lines.size(); i++) {
+                if (Graph::isLineChange(route.lines[i - 1], route.lines[i])) {
+                    route.interchanges.push_back(route.path[i]);
+                }
+            }
+            route.lineChanges = static_cast<int>(route.interchanges.size());
+        } else {
+            route.lines.clear();
+            route.lineChanges = graph.estimateLineChanges(static_cast<int>(route.path.size()));
+        }
+        route.travelTime = graph.estimateTravelTime(route.distance, route.lineChanges);
+        routes.push_back(route);
+    }
+    return static_cast<int>(routes.size());
+}
+
+int paretoRoutes(const Graph& graph, int src, int dest, std::vector<Route>& routes) {
+    return paretoRoutes(graph, src, dest, ParetoContext::local(), routes);
+}
@@ -0,0 +1,74 @@
+#ifndef PARETO_ROUTES_H
+#define PARETO_ROUTES_H
+
+#include <vector>
+#include "Graph.h"
+#include "QueryContext.h"
+
+// Reusable scratch state of Pareto route queries. A context must not be
+// shared between threads; use local() for a per-thread instance.
+class ParetoContext {
+private:
+    friend int paretoRoutes(const Graph&, int, int, ParetoContext&, std::vector<Route>&);
+
+    // A partial route: its last hop arrives in state, parent is the label
+    // it extends (-1 for a first hop from the source)
+    struct Label {
+        int state;
+        int distance;
+        int changes;
+        int parent;
+    };
+
+    // Queue entry: distance plus the lower bound to the destination, then
+    // changes, so labels leave the queue in lexicographic order
+    struct Entry {
+        int key;
+        int changes;
+        int label;
+    };
+
+    std::vector<Label> labels;           // Label pool of the current query, emptied (not freed) by the next
+    std::vector<Entry> heap;
+    BasicQueryContext<BucketQueue> bound; // Shortest-path tree from the destination (km lower bounds)
+    std::vector<int> changesBound;       // Fewest changes from each state to the destination
+    std::vector<int> level;              // States of the backward search at this and the next change count
+    std::vector<int> nextLevel;
+    std::vector<int> stateBest;          // Fewest changes of a label settled in each state
+    std::vector<int> stationBest;        // ... and at each station, on any line
+    std::vector<int> front;              // Labels settled at the destination
+
+public:
+    ParetoContext();
+
+    // Context owned by the calling thread
+    static ParetoContext& local();
+};
+
+// Every route from src to dest that no other route beats on both distance
+// and line changes, shortest first (and so with the most changes first),
+// one route per distinct (km, changes) pair. The fare never falls as the
+// distance grows, so these are also the routes no other beats on fare band,
+// distance and changes together; the shortest and the fastest route
+// (Graph::fastestRoute) are always among them. Returns the number of
+// routes written; 0 if dest is unreachable. The graph must be frozen.
+//
+// The search is a multi-label Dijkstra over (station, line) states: a
+// state may hold several labels, each a partial route with its distance
+// and changes, kept in one pool for the query. Labels leave the queue by
+// distance plus a lower bound to dest (from an exact shortest-path tree
+// grown from dest, so this is still settling order), then by changes. In
+// that order a label is dominated exactly when one settled earlier in the
+// same state has no more changes: one comparison per state. It is also
+// dominated by a label settled at its station on another line with fewer
+// changes (changing line there costs at most one), and by a route to dest
+// already found with no more changes than the label's plus the fewest
+// changes still needed from its state (from a 0-1 search backwards over
+// the states). On networks without line data no route has changes, so
+// only the shortest route is left; its changes are then estimated.
+int paretoRoutes(const Graph& graph, int src, int dest, ParetoContext& context, std::vector<Route>& routes);
+
+// paretoRoutes() in the calling thread's context
+int paretoRoutes(const Graph& graph, int src, int dest, std::vector<Route>& routes);
+
+#endif // PARETO_ROUTES_H
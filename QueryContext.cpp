@@ -0,0 +1,32 @@
+#include "QueryContext.h"
+#include <algorithm>
+
+SearchState::SearchState() : generation(0) {}
+
+void SearchState::reset(int numVertices) {
+    if (static_cast<int>(stamps.size()) < numVertices) {
+        distances.resize(numVertices);
+        parents.resize(numVertices);
+        stamps.resize(numVertices, 0);
+    }
+    
+    // Bumping the generation invalidates every entry at once. On wrap-around
+    // the stamps are cleared so stale entries cannot alias the new generation.
+    generation++;
+    if (generation == 0) {
+        std::fill(stamps.begin(), stamps.end(), 0);
+        generation = 1;
+    }
+}
+
+void SearchState::buildPath(int dest, std::vector<int>& path) const {
+    path.clear();
+    if (getDistance(dest) == std::numeric_limits<int>::max()) {
+        return;
+    }
+    
+    for (int v = dest; v != -1; v = getParent(v)) {
+        path.push_back(v);
+    }
+    std::reverse(path.begin(), path.end());
+}
@@ -0,0 +1,105 @@
+#ifndef QUERY_CONTEXT_H
+#define QUERY_CONTEXT_H
+
+#include <vector>
+#include <limits>
+#include "Heap.h"
+
+// Generation-stamped distance and parent arrays for one search direction.
+// Entries are only valid while their stamp matches the current generation,
+// so starting a new query costs O(1) instead of O(V).
+class SearchState {
+private:
+    std::vector<int> distances;
+    std::vector<int> parents;
+    std::vector<unsigned int> stamps;
+    unsigned int generation;
+
+public:
+    SearchState();
+    
+    // Start a new query on a graph with numVertices stations
+    void reset(int numVertices);
+    
+    // Tentative distance of a vertex (INT_MAX if not reached yet)
+    int getDistance(int vertex) const {
+        return stamps[vertex] == generation ? distances[vertex] : std::numeric_limits<int>::max();
+    }
+    
+    // Predecessor of a vertex on its current best path (-1 if none)
+    int getParent(int vertex) const {
+        return stamps[vertex] == generation ? parents[vertex] : -1;
+    }
+    
+    // Record a new tentative distance and predecessor for a vertex
+    void update(int vertex, int distance, int parent) {
+        distances[vertex] = distance;
+        parents[vertex] = parent;
+        stamps[vertex] = generation;
+    }
+    
+    // Write the path ending at dest into path, source first.
+    // The vector's capacity is reused, so steady-state calls do not allocate.
+    void buildPath(int dest, std::vector<int>& path) const;
+};
+
+// Reusable scratch state for shortest-path queries: the stamped search
+// arrays plus a priority queue chosen at compile time (see Heap.h).
+// A context must not be shared between threads; use local() for a
+// per-thread instance.
+template <typename Queue>
+class BasicQueryContext : public SearchState {
+private:
+    Queue queue;
+
+public:
+    BasicQueryContext() {}
+    
+    explicit BasicQueryContext(int numVertices) {
+        reset(numVertices, 0);
+    }
+    
+    // Start a new query; maxEdgeWeight sizes bucket-based queues
+    void reset(int numVertices, int maxEdgeWeight) {
+        SearchState::reset(numVertices);
+        queue.reset(numVertices, maxEdgeWeight);
+    }
+    
+    // Priority queue used by the search
+    Queue& getQueue() { return queue; }
+    
+    // Context owned by the calling thread
+    static BasicQueryContext& local() {
+        thread_local BasicQueryContext context;
+        return context;
+    }
+};
+
+typedef BasicQueryContext<MinHeap> QueryContext;
+
+// Scratch state for a bidirectional search: one context per direction
+template <typename Queue>
+class BasicBidirectionalContext {
+private:
+    BasicQueryContext<Queue> forward;
+    BasicQueryContext<Queue> backward;
+
+public:
+    BasicBidirectionalContext() {}
+    
+    // Search state growing from the source
+    BasicQueryContext<Queue>& getForward() { return forward; }
+    
+    // Search state growing from the destination
+    BasicQueryContext<Queue>& getBackward() { return backward; }
+    
+    // Context owned by the calling thread
+    static BasicBidirectionalContext& local() {
+        thread_local BasicBidirectionalContext context;
+        return context;
+    }
+};
+
+typedef BasicBidirectionalContext<MinHeap> BidirectionalContext;
+
+#endif // QUERY_CONTEXT_H
@@ -0,0 +1,159 @@
+#include "RouteCache.h"
+#include <mutex>
+#include <algorithm>
+
+// RouteCacheStats implementation
+RouteCacheStats::RouteCacheStats() : hits(0), misses(0), evictions(0), entries(0), bytes(0), maxBytes(0) {}
+
+double RouteCacheStats::hitRate() const {
+    unsigned long long lookups = hits + misses;
+    return lookups == 0 ? 0.0 : static_cast<double>(hits) / lookups;
+}
+
+// RouteCache implementation
+size_t RouteCache::KeyHash::operator()(const Key& key) const {
+    // Mix the three fields so that neighbouring stations spread over shards
+    unsigned long long h = static_cast<unsigned int>(key.src);
+    h = h * 0x9E3779B97F4A7C15ULL + static_cast<unsigned int>(key.dest);
+    h = h * 0x9E3779B97F4A7C15ULL + static_cast<unsigned int>(key.options);
+    h ^= h >> 29;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 32;
+    return static_cast<size_t>(h);
+}
+
+RouteCache::Slot::Slot() : key{ -1, -1, 0 }, bytes(0), used(false), referenced(false) {}
+
+RouteCache::Shard::Shard() : hand(0), bytes(0), version(0), hits(0), misses(0), evictions(0) {}
+
+RouteCache::RouteCache(size_t maxBytes, int numShards)
+    : shards(new Shard[std::max(1, numShards)]), numShards(std::max(1, numShards)), maxBytes(maxBytes),
+      shardBytes(maxBytes / std::max(1, numShards)) {}
+
+RouteCache::Shard& RouteCache::shardOf(const Key& key) {
+    // High bits pick the shard; the shard's hash table uses the low ones
+    return shards[(KeyHash()(key) >> 48) % numShards];
+}
+
+size_t RouteCache::entryBytes(const Route& route) {
+    // The slot, a hash node (key, slot index, next pointer, cached hash,
+    // bucket) and the route's arrays
+    size_t nodeBytes = sizeof(Key) + sizeof(size_t) + 3 * sizeof(void*);
+    return sizeof(Slot) + nodeBytes +
+           (route.path.size() + route.lines.size() + route.interchanges.size()) * sizeof(int);
+}
+
+void RouteCache::clearShard(Shard& shard) {
+    shard.index.clear();
+    shard.slots.clear();
+    shard.freeSlots.clear();
+    shard.hand = 0;
+    shard.bytes = 0;
+}
+
+void RouteCache::evictOne(Shard& shard) {
+    // Called with bytes > 0, so some slot is in use and the hand stops
+    // within two sweeps
+    while (true) {
+        Slot& slot = shard.slots[shard.hand];
+        size_t position = shard.hand;
+        shard.hand = (shard.hand + 1) % shard.slots.size();
+        if (!slot.used) {
+            continue;
+        }
+        if (slot.referenced.exchange(false, std::memory_order_relaxed)) {
+            continue; // Second chance
+        }
+
+        shard.index.erase(slot.key);
+        shard.bytes -= slot.bytes;
+        slot.used = false;
+        slot.route = Route(); // Release the arrays
+        shard.freeSlots.push_back(position);
+        shard.evictions++;
+        return;
+    }
+}
+
+bool RouteCache::lookup(int src, int dest, int options, unsigned long long version, Route& route) {
+    Key key = { src, dest, options };
+    Shard& shard = shardOf(key);
+    std::shared_lock<std::shared_mutex> lock(shard.mutex);
+
+    if (shard.version == version) {
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            Slot& slot = shard.slots[it->second];
+            slot.referenced.store(true, std::memory_order_relaxed);
+            route = slot.route;
+            shard.hits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    shard.misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void RouteCache::insert(int src, int dest, int options, unsigned long long version, const Route& route) {
+    Key key = { src, dest, options };
+    Shard& shard = shardOf(key);
+    size_t bytes = entryBytes(route);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+
+    // Entries of an older network can never hit again. A route computed on
+    // a network that has since changed is not stored at all.
+    if (version < shard.version) {
+        return;
+    }
+    if (version > shard.version) {
+        clearShard(shard);
+        shard.version = version;
+    }
+
+    // Another thread may have filled the same miss first
+    if (shard.index.count(key) != 0 || bytes > shardBytes) {
+        return;
+    }
+    while (shard.bytes + bytes > shardBytes) {
+        evictOne(shard);
+    }
+
+    size_t position;
+    if (!shard.freeSlots.empty()) {
+        position = shard.freeSlots.back();
+        shard.freeSlots.pop_back();
+    } else {
+        position = shard.slots.size();
+        shard.slots.emplace_back();
+    }
+    Slot& slot = shard.slots[position];
+    slot.key = key;
+    slot.route = route;
+    slot.bytes = bytes;
+    slot.used = true;
+    slot.referenced.store(false, std::memory_order_relaxed);
+    shard.index[key] = position;
+    shard.bytes += bytes;
+}
+
+void RouteCache::clear() {
+    for (int i = 0; i < numShards; i++) {
+        std::unique_lock<std::shared_mutex> lock(shards[i].mutex);
+        clearShard(shards[i]);
+    }
+}
+
+RouteCacheStats RouteCache::getStats() const {
+    RouteCacheStats stats;
+    stats.maxBytes = maxBytes;
+    for (int i = 0; i < numShards; i++) {
+        const Shard& shard = shards[i];
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        stats.hits += shard.hits.load(std::memory_order_relaxed);
+        stats.misses += shard.misses.load(std::memory_order_relaxed);
+        stats.evictions += shard.evictions;
+        stats.entries += shard.index.size();
+        stats.bytes += shard.bytes;
+    }
+    return stats;
+}
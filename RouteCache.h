@@ -0,0 +1,124 @@
+#ifndef ROUTE_CACHE_H
+#define ROUTE_CACHE_H
+
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <shared_mutex>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include "Graph.h"
+
+// Counters and occupancy of a RouteCache, summed over its shards
+struct RouteCacheStats {
+    unsigned long long hits;
+    unsigned long long misses;
+    unsigned long long evictions;
+    size_t entries;
+    size_t bytes;     // Estimated memory held by the entries
+    size_t maxBytes;
+
+    RouteCacheStats();
+
+    // Fraction of lookups answered from the cache
+    double hitRate() const;
+};
+
+// Thread-safe cache of planned routes keyed by (source, destination,
+// options), where options distinguishes the kinds of query a caller caches.
+//
+// Keys are spread over independently locked shards. A hit takes only its
+// shard's lock in shared mode, so concurrent hits never wait for each other
+// and a miss being filled blocks one shard, not the cache. Each shard is
+// bounded by its share of maxBytes and evicts with CLOCK: a hit only sets
+// the entry's reference bit (an atomic store, allowed under the shared
+// lock), and the clock hand gives referenced entries a second chance.
+//
+// Every entry remembers the Graph::getVersion() it was computed on and is
+// ignored once the network has changed, so invalidating the whole cache is
+// free; a shard drops its stale entries the next time it stores one.
+// Versions only grow, so a late insert from an older network is discarded.
+class RouteCache {
+private:
+    struct Key {
+        int src;
+        int dest;
+        int options;
+
+        bool operator==(const Key& other) const {
+            return src == other.src && dest == other.dest && options == other.options;
+        }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Slot {
+        Key key;
+        Route route;
+        size_t bytes;
+        bool used;
+        std::atomic<bool> referenced; // Hit since the clock hand last passed
+
+        Slot();
+    };
+
+    // One independently locked part of the cache. Slots live in a deque so
+    // they never move; freed slots are reused before new ones are added.
+    struct alignas(64) Shard {
+        mutable std::shared_mutex mutex;
+        std::unordered_map<Key, size_t, KeyHash> index;
+        std::deque<Slot> slots;
+        std::vector<size_t> freeSlots;
+        size_t hand;
+        size_t bytes;
+        unsigned long long version; // Graph version of every entry
+        std::atomic<unsigned long long> hits;
+        std::atomic<unsigned long long> misses;
+        unsigned long long evictions;
+
+        Shard();
+    };
+
+    std::unique_ptr<Shard[]> shards;
+    int numShards;
+    size_t maxBytes;
+    size_t shardBytes; // Budget of each shard
+
+    Shard& shardOf(const Key& key);
+
+    // Estimated memory of an entry holding route
+    static size_t entryBytes(const Route& route);
+
+    // Drop every entry of a shard (its lock held exclusively)
+    static void clearShard(Shard& shard);
+
+    // Evict one entry with the clock hand (lock held exclusively)
+    static void evictOne(Shard& shard);
+
+public:
+    static const size_t DEFAULT_MAX_BYTES = 64u << 20;
+    static const int DEFAULT_SHARDS = 16;
+
+    explicit RouteCache(size_t maxBytes = DEFAULT_MAX_BYTES, int numShards = DEFAULT_SHARDS);
+
+    RouteCache(const RouteCache&) = delete;
+    RouteCache& operator=(const RouteCache&) = delete;
+
+    // Copy the cached route into route if present and computed on graph
+    // version. Counts a hit or a miss.
+    bool lookup(int src, int dest, int options, unsigned long long version, Route& route);
+
+    // Store route for the key, evicting as needed. Routes larger than a
+    // shard's budget are not cached.
+    void insert(int src, int dest, int options, unsigned long long version, const Route& route);
+
+    // Drop every entry (counters are kept)
+    void clear();
+
+    RouteCacheStats getStats() const;
+};
+
+#endif // ROUTE_CACHE_H
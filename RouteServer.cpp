@@ -0,0 +1,584 @@
+#include "RouteServer.h"
+#include "Instrumentation.h"
+#include "StationIndex.h"
+#include "Isochrone.h"
+#include "HubLabels.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Requests handed to a worker at a time; single queries are too cheap to
+// be worth a steal each
+static const int REQUESTS_PER_TASK = 16;
+
+// Received but unanswered request bytes after which a client is not read
+// from until its requests are answered
+static const size_t MAX_PENDING_INPUT = 1u << 20;
+
+// Bytes read from a client at a time
+static const size_t READ_CHUNK = 64u << 10;
+
+// Marks a request line that was longer than MAX_REQUEST_BYTES
+static const std::string_view OVERLONG_REQUEST;
+
+// ServerStats implementation
+ServerStats::ServerStats() : requests(0), batches(0), connections(0), seconds(0.0) {}
+
+double ServerStats::requestsPerSecond() const {
+    return seconds > 0.0 ? requests / seconds : 0.0;
+}
+
+// One client: its buffered input and output
+struct RouteServer::Connection {
+    int inFd;
+    int outFd;
+    bool owned;       // Close the descriptors once done
+    bool isSocket;    // Write with send() so a closed peer is an error, not SIGPIPE
+    std::string input;
+    size_t inputStart; // First byte not yet taken as a request
+    bool discarding;   // Skipping the rest of an overlong line
+    bool inputClosed;
+    bool failed;
+    std::string output;
+    size_t outputStart; // First byte not yet written
+    size_t firstRequest; // This round's requests of the client in RouteServer::requests
+    size_t numRequests;
+
+    Connection(int inFd, int outFd, bool owned)
+        : inFd(inFd), outFd(outFd), owned(owned), isSocket(false), inputStart(0), discarding(false),
+          inputClosed(false), failed(false), outputStart(0), firstRequest(0), numRequests(0) {}
+};
+
+// Append a decimal integer without going through a stream
+static void appendNumber(std::string& text, int value) {
+    char digits[16];
+    std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+    text.append(digits, result.ptr - digits);
+}
+
+// RouteServer implementation
+RouteServer::RouteServer(const Graph& graph, int numThreads, int maxBatch)
+    : graph(&graph), hubLabels(nullptr), pool(numThreads), maxBatch(std::max(1, maxBatch)), stopping(false) {
+    if (!graph.isFrozen()) {
+        throw std::logic_error("Graph must be frozen before serving queries");
+    }
+    wakeFds[0] = wakeFds[1] = -1;
+#ifndef _WIN32
+    if (pipe(wakeFds) != 0) {
+        throw std::runtime_error("cannot create the server's wake-up pipe");
+    }
+    fcntl(wakeFds[0], F_SETFL, fcntl(wakeFds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(wakeFds[1], F_SETFL, fcntl(wakeFds[1], F_GETFL) | O_NONBLOCK);
+#endif
+}
+
+RouteServer::~RouteServer() {
+#ifndef _WIN32
+    close(wakeFds[0]);
+    close(wakeFds[1]);
+#endif
+}
+
+void RouteServer::setHubLabels(const HubLabels* labels) {
+    hubLabels = labels;
+}
+
+int RouteServer::parseStation(std::string_view field) const {
+    if (!field.empty() && field[0] == '#') {
+        int index = -1;
+        const char* end = field.data() + field.size();
+        std::from_chars_result result = std::from_chars(field.data() + 1, end, index);
+        if (result.ec != std::errc() || result.ptr != end || index < 0 || index >= graph->getNumVertices()) {
+            return -1;
+        }
+        return index;
+    }
+    return graph->getStationIndex(field);
+}
+
+void RouteServer::answer(std::string_view request, std::string& response) const {
+    response.clear();
+    if (request.data() == OVERLONG_REQUEST.data()) {
+        response += "ERR\trequest too long\n";
+        return;
+    }
+
+    // Split into at most five fields; a fifth means too many
+    std::string_view fields[5];
+    int numFields = 0;
+    while (numFields < 5) {
+        size_t tab = request.find('\t');
+        fields[numFields++] = request.substr(0, tab);
+        if (tab == std::string_view::npos) {
+            break;
+        }
+        request.remove_prefix(tab + 1);
+    }
+
+    if (fields[0] == "PING" && numFields == 1) {
+        response += "PONG\n";
+        return;
+    }
+    if (fields[0] == "SUGGEST" && numFields == 2) {
+        const StationIndex* index = graph->getNameIndex();
+        if (!index) {
+            response += "ERR\tstation search not available\n";
+            return;
+        }
+        thread_local std::vector<StationMatch> matches;
+        index->search(fields[1], SUGGESTIONS, SUGGESTION_MAX_EDITS, matches);
+        response += "OK";
+        for (const StationMatch& match : matches) {
+            response += '\t';
+            response += graph->getStationName(match.station);
+        }
+        response += '\n';
+        return;
+    }
+    if (fields[0] == "STATS" && numFields == 1) {
+        response += "STATS\t";
+        response += instrumentation::report().formatJson();
+        response += '\n';
+        return;
+    }
+    if (fields[0] == "REACH") {
+        answerReach(fields, numFields, response);
+        return;
+    }
+    if (fields[0] != "ROUTE" && fields[0] != "FARE") {
+        response += "ERR\tunknown command\n";
+        return;
+    }
+    if (numFields != 3) {
+        response += "ERR\t";
+        response += fields[0];
+        response += " needs a source and a destination\n";
+        return;
+    }
+
+    int src = parseStation(fields[1]);
+    int dest = parseStation(fields[2]);
+    if (src == -1 || dest == -1) {
+        response += "ERR\tunknown station: ";
+        response += src == -1 ? fields[1] : fields[2];
+        response += '\n';
+        return;
+    }
+    if (fields[0] == "FARE") {
+        answerFare(src, dest, response);
+        return;
+    }
+
+    // Each worker thread reuses its own route scratch
+    thread_local Route route;
+    if (!graph->planRoute(src, dest, route) || route.path.empty()) {
+        response += "NONE\n";
+        return;
+    }
+    response += "OK\t";
+    appendNumber(response, route.distance);
+    response += '\t';
+    appendNumber(response, route.fare);
+    response += '\t';
+    appendNumber(response, route.travelTime);
+    response += '\t';
+    appendNumber(response, route.lineChanges);
+    for (int station : route.path) {
+        response += '\t';
+        response += graph->getStationName(station);
+    }
+    response += '\n';
+}
+
+void RouteServer::answerFare(int src, int dest, std::string& response) const {
+    // Only the distance is needed: a label merge when the labels are set
+    int distance;
+    if (hubLabels) {
+        distance = hubLabels->distance(src, dest);
+    } else {
+        thread_local std::vector<int> path;
+        distance = graph->bidirectionalDijkstra(src, dest, BidirectionalContext::local(), path);
+    }
+    if (distance == std::numeric_limits<int>::max()) {
+        response += "NONE\n";
+        return;
+    }
+    response += "OK\t";
+    appendNumber(response, distance);
+    response += '\t';
+    appendNumber(response, graph->calculateFare(distance));
+    response += '\n';
+}
+
+void RouteServer::answerReach(const std::string_view* fields, int numFields, std::string& response) const {
+    const char* units[] = { "km", "rs", "min" };
+    const IsochroneBudget kinds[] = { IsochroneBudget::Distance, IsochroneBudget::Fare, IsochroneBudget::Time };
+    int unit = 0;
+    while (unit < 3 && (numFields != 4 || fields[2] != units[unit])) {
+        unit++;
+    }
+    int limit = -1;
+    const char* end = fields[3].data() + fields[3].size();
+    if (unit == 3 || std::from_chars(fields[3].data(), end, limit).ptr != end || limit < 0) {
+        response += "ERR\tREACH needs a station, km, rs or min, and a limit\n";
+        return;
+    }
+    int src = parseStation(fields[1]);
+    if (src == -1) {
+        response += "ERR\tunknown station: ";
+        response += fields[1];
+        response += '\n';
+        return;
+    }
+
+    thread_local Isochrone reach;
+    isochrone(*graph, src, kinds[unit], limit, reach);
+    response += "OK";
+    for (size_t i = 0; i < reach.size(); i++) {
+        response += '\t';
+        response += graph->getStationName(reach.stations[i]);
+        response += '\t';
+        appendNumber(response, reach.distances[i]);
+        response += '\t';
+        appendNumber(response, reach.travelTimes[i]);
+        response += '\t';
+        appendNumber(response, reach.fares[i]);
+    }
+    response += '\n';
+}
+
+void RouteServer::answerBatch() {
+    int count = static_cast<int>(requests.size());
+    if (static_cast<int>(responses.size()) < count) {
+        responses.resize(count);
+    }
+    if (count <= REQUESTS_PER_TASK) {
+        for (int i = 0; i < count; i++) {
+            answer(requests[i], responses[i]);
+        }
+        return;
+    }
+
+    int numTasks = (count + REQUESTS_PER_TASK - 1) / REQUESTS_PER_TASK;
+    pool.parallelFor(numTasks, [&](int task) {
+        int end = std::min(count, (task + 1) * REQUESTS_PER_TASK);
+        for (int i = task * REQUESTS_PER_TASK; i < end; i++) {
+            answer(requests[i], responses[i]);
+        }
+    });
+}
+
+#ifndef _WIN32
+
+// Take the complete request lines of a connection, until the round has
+// limit requests. Returns false if complete lines were left for later.
+static bool collectRequests(std::string& input, size_t& inputStart, bool& discarding, bool inputClosed,
+                            std::vector<std::string_view>& requests, size_t limit) {
+    while (true) {
+        size_t newline = input.find('\n', inputStart);
+        if (discarding) {
+            if (newline == std::string::npos) {
+                inputStart = input.size();
+                return true;
+            }
+            inputStart = newline + 1;
+            discarding = false;
+            continue;
+        }
+
+        size_t end = newline;
+        if (newline == std::string::npos) {
+            if (input.size() - inputStart > RouteServer::MAX_REQUEST_BYTES) {
+                // Answer it now and skip the rest when it arrives
+                if (requests.size() >= limit) {
+                    return false;
+                }
+                requests.push_back(OVERLONG_REQUEST);
+                inputStart = input.size();
+                discarding = true;
+                return true;
+            }
+            if (!inputClosed || inputStart == input.size()) {
+                return true;
+            }
+            end = input.size(); // Last line without a newline
+        }
+        if (requests.size() >= limit) {
+            return false;
+        }
+
+        std::string_view line(input.data() + inputStart, end - inputStart);
+        inputStart = end == input.size() ? end : end + 1;
+        if (!line.empty() && line.back() == '\r') {
+            line.remove_suffix(1);
+        }
+        if (line.size() > RouteServer::MAX_REQUEST_BYTES) {
+            requests.push_back(OVERLONG_REQUEST);
+        } else if (!line.empty()) {
+            requests.push_back(line);
+        }
+    }
+}
+
+// Write as much pending output as the descriptor takes without blocking
+// (or all of it, if it blocks)
+static void flushOutput(int fd, bool isSocket, std::string& output, size_t& outputStart, bool& failed) {
+    while (outputStart < output.size()) {
+        const char* data = output.data() + outputStart;
+        size_t length = output.size() - outputStart;
+        ssize_t written = isSocket ? send(fd, data, length, MSG_NOSIGNAL) : write(fd, data, length);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                failed = true;
+            }
+            break;
+        }
+        outputStart += written;
+    }
+
+    if (outputStart == output.size()) {
+        output.clear();
+        outputStart = 0;
+    } else if (outputStart > output.size() / 2) {
+        output.erase(0, outputStart);
+        outputStart = 0;
+    }
+}
+
+static bool isSocketDescriptor(int fd) {
+    struct stat info;
+    return fstat(fd, &info) == 0 && S_ISSOCK(info.st_mode);
+}
+
+bool RouteServer::serve(std::vector<Connection>& connections, int listenFd, std::string& error) {
+    typedef std::chrono::steady_clock Clock;
+    Clock::time_point start = Clock::now();
+    std::vector<pollfd> pollFds;
+    std::vector<std::pair<size_t, bool>> pollOwners; // (connection, is input) per entry after the fixed ones
+    bool ok = true;
+
+    while (!stopping.load()) {
+        // Answer every complete request already received, as one round
+        requests.clear();
+        bool backlog = false;
+        for (Connection& connection : connections) {
+            connection.firstRequest = requests.size();
+            if (connection.output.size() - connection.outputStart < MAX_PENDING_OUTPUT && !connection.failed) {
+                backlog |= !collectRequests(connection.input, connection.inputStart, connection.discarding,
+                                            connection.inputClosed, requests, maxBatch);
+            }
+            connection.numRequests = requests.size() - connection.firstRequest;
+        }
+        if (!requests.empty()) {
+            answerBatch();
+            stats.requests += requests.size();
+            stats.batches++;
+            for (Connection& connection : connections) {
+                for (size_t i = 0; i < connection.numRequests; i++) {
+                    connection.output += responses[connection.firstRequest + i];
+                }
+                if (connection.numRequests > 0) {
+                    flushOutput(connection.outFd, connection.isSocket, connection.output, connection.outputStart,
+                                connection.failed);
+                }
+            }
+        }
+
+        // Forget answered input; drop clients that are done
+        for (size_t c = 0; c < connections.size();) {
+            Connection& connection = connections[c];
+            if (connection.inputStart > 0) {
+                connection.input.erase(0, connection.inputStart);
+                connection.inputStart = 0;
+            }
+            bool done = connection.failed ||
+                        (connection.inputClosed && connection.input.empty() && connection.output.empty());
+            if (!done) {
+                c++;
+                continue;
+            }
+            if (connection.owned) {
+                close(connection.inFd);
+            }
+            connections.erase(connections.begin() + c);
+        }
+        if (listenFd < 0 && connections.empty()) {
+            break;
+        }
+
+        // Wait for input, writable output or a new client. Requests left
+        // over from a full round are answered without waiting.
+        pollFds.clear();
+        pollOwners.clear();
+        pollFds.push_back({ wakeFds[0], POLLIN, 0 });
+        if (listenFd >= 0) {
+            pollFds.push_back({ listenFd, POLLIN, 0 });
+        }
+        size_t fixed = pollFds.size();
+        for (size_t c = 0; c < connections.size(); c++) {
+            const Connection& connection = connections[c];
+            size_t pendingOutput = connection.output.size() - connection.outputStart;
+            if (!connection.inputClosed && pendingOutput < MAX_PENDING_OUTPUT &&
+                connection.input.size() < MAX_PENDING_INPUT) {
+                pollFds.push_back({ connection.inFd, POLLIN, 0 });
+                pollOwners.push_back(std::make_pair(c, true));
+            }
+            if (pendingOutput > 0) {
+                pollFds.push_back({ connection.outFd, POLLOUT, 0 });
+                pollOwners.push_back(std::make_pair(c, false));
+            }
+        }
+
+        int ready = poll(pollFds.data(), pollFds.size(), backlog ? 0 : -1);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            error = std::string("poll failed: ") + std::strerror(errno);
+            ok = false;
+            break;
+        }
+
+        if (pollFds[0].revents != 0) {
+            char drained[64];
+            while (read(wakeFds[0], drained, sizeof(drained)) > 0) {}
+        }
+        for (size_t p = fixed; p < pollFds.size(); p++) {
+            if (pollFds[p].revents == 0) {
+                continue;
+            }
+            Connection& connection = connections[pollOwners[p - fixed].first];
+            if (!pollOwners[p - fixed].second) {
+                flushOutput(connection.outFd, connection.isSocket, connection.output, connection.outputStart,
+                            connection.failed);
+                continue;
+            }
+
+            size_t size = connection.input.size();
+            connection.input.resize(size + READ_CHUNK);
+            ssize_t received = read(connection.inFd, &connection.input[size], READ_CHUNK);
+            connection.input.resize(size + std::max<ssize_t>(received, 0));
+            if (received == 0) {
+                connection.inputClosed = true;
+            } else if (received < 0 && errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) {
+                connection.failed = true;
+            }
+        }
+        if (listenFd >= 0 && pollFds[1].revents != 0) {
+            while (true) {
+                int client = accept(listenFd, nullptr, nullptr);
+                if (client < 0) {
+                    break;
+                }
+                fcntl(client, F_SETFL, fcntl(client, F_GETFL) | O_NONBLOCK);
+                connections.emplace_back(client, client, true);
+                connections.back().isSocket = true;
+                stats.connections++;
+            }
+        }
+    }
+
+    for (Connection& connection : connections) {
+        if (connection.owned) {
+            close(connection.inFd);
+        }
+    }
+    stopping.store(false);
+    stats.seconds += std::chrono::duration<double>(Clock::now() - start).count();
+    return ok;
+}
+
+bool RouteServer::serveStream(int inFd, int outFd, std::string& error) {
+    std::vector<Connection> connections;
+    connections.emplace_back(inFd, outFd, false);
+    connections.back().isSocket = isSocketDescriptor(outFd);
+    stats.connections++;
+    return serve(connections, -1, error);
+}
+
+bool RouteServer::serveSocket(const std::string& path, std::string& error) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        error = "invalid socket path: " + path;
+        return false;
+    }
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+    // A socket file left behind by an earlier server is replaced; any
+    // other file is not touched
+    struct stat existing;
+    if (lstat(path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+        unlink(path.c_str());
+    }
+
+    int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        error = std::string("cannot create socket: ") + std::strerror(errno);
+        return false;
+    }
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listenFd, SOMAXCONN) != 0) {
+        error = "cannot listen on " + path + ": " + std::strerror(errno);
+        close(listenFd);
+        return false;
+    }
+    fcntl(listenFd, F_SETFL, fcntl(listenFd, F_GETFL) | O_NONBLOCK);
+
+    std::vector<Connection> connections;
+    bool ok = serve(connections, listenFd, error);
+    close(listenFd);
+    unlink(path.c_str());
+    return ok;
+}
+
+void RouteServer::stop() {
+    stopping.store(true);
+    char wake = 0;
+    ssize_t ignored = write(wakeFds[1], &wake, 1);
+    (void)ignored;
+}
+
+#else
+
+bool RouteServer::serve(std::vector<Connection>&, int, std::string& error) {
+    error = "server mode is not supported on Windows";
+    return false;
+}
+
+bool RouteServer::serveStream(int, int, std::string& error) {
+    std::vector<Connection> connections;
+    return serve(connections, -1, error);
+}
+
+bool RouteServer::serveSocket(const std::string&, std::string& error) {
+    std::vector<Connection> connections;
+    return serve(connections, -1, error);
+}
+
+void RouteServer::stop() {
+    stopping.store(true);
+}
+
+#endif
+
+ServerStats RouteServer::getStats() const {
+    return stats;
+}
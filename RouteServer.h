@@ -0,0 +1,126 @@
+#ifndef ROUTE_SERVER_H
+#define ROUTE_SERVER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <atomic>
+#include "Graph.h"
+#include "ThreadPool.h"
+
+class HubLabels;
+
+// Totals of a RouteServer since it was created
+struct ServerStats {
+    unsigned long long requests;
+    unsigned long long batches;     // Rounds of requests answered together
+    unsigned long long connections; // Clients accepted (the stream counts as one)
+    double seconds;                 // Time spent serving
+
+    ServerStats();
+
+    double requestsPerSecond() const;
+};
+
+// Answers route queries for other programs over a line protocol, on a
+// worker pool sharing one frozen (read-only) Graph.
+//
+// Every request is one line of tab-separated fields and gets exactly one
+// response line, in request order per client:
+//
+//   ROUTE <from> <to>   OK <km> <Rs> <minutes> <line changes> <station>...
+//                       NONE                      (no route)
+//   FARE <from> <to>    OK <km> <Rs>              (shortest route)
+//                       NONE                      (no route)
+//   SUGGEST <text>      OK <station>...           (best matches first)
+//   REACH <from> <km|rs|min> <limit>
+//                       OK <station> <km> <minutes> <Rs>...
+//                                                 (within the limit, nearest first)
+//   PING                PONG
+//   STATS               STATS <JSON of instrumentation::report()>
+//   anything invalid    ERR <message>
+//
+// A station is given by name or as #<index>. Blank lines are ignored.
+//
+// Clients may pipeline: send any number of requests without waiting. One
+// thread does all I/O with poll(). Each round it takes every complete line
+// already received from any client, up to maxBatch, answers them together
+// on the pool and writes each client's responses with a single write.
+// A client whose responses are not being read stops being read from.
+class RouteServer {
+private:
+    struct Connection;
+
+    const Graph* graph;
+    const HubLabels* hubLabels;
+    ThreadPool pool;
+    int maxBatch;
+    std::atomic<bool> stopping;
+    int wakeFds[2]; // Pipe that interrupts poll() when stop() is called
+    ServerStats stats;
+
+    // Scratch of the current round, reused across rounds
+    std::vector<std::string_view> requests;
+    std::vector<std::string> responses;
+
+    // Station of a request field, or -1
+    int parseStation(std::string_view field) const;
+
+    // Write the response line (with its newline) for one request line
+    void answer(std::string_view request, std::string& response) const;
+
+    // Write the response to a FARE request
+    void answerFare(int src, int dest, std::string& response) const;
+
+    // Write the response to a REACH request split into fields
+    void answerReach(const std::string_view* fields, int numFields, std::string& response) const;
+
+    // Answer the round's requests, on the pool when there are several
+    void answerBatch();
+
+    // Serve the connections, plus new clients of listenFd (-1 for none),
+    // until stop() or, without a listener, until every connection is done
+    bool serve(std::vector<Connection>& connections, int listenFd, std::string& error);
+
+public:
+    static const int DEFAULT_MAX_BATCH = 4096;
+
+    // Stations returned for SUGGEST, and the typos tolerated
+    static const int SUGGESTIONS = 5;
+    static const int SUGGESTION_MAX_EDITS = 2;
+
+    // Longest request line accepted, and the unread response backlog after
+    // which a client is no longer read from
+    static const size_t MAX_REQUEST_BYTES = 4096;
+    static const size_t MAX_PENDING_OUTPUT = 1u << 20;
+
+    // graph must be frozen and stay unchanged while the server runs.
+    // numThreads = 0 uses one worker per hardware thread.
+    explicit RouteServer(const Graph& graph, int numThreads = 0, int maxBatch = DEFAULT_MAX_BATCH);
+    ~RouteServer();
+
+    RouteServer(const RouteServer&) = delete;
+    RouteServer& operator=(const RouteServer&) = delete;
+
+    // Answer FARE requests from hub labels of the graph instead of a
+    // search (nullptr to stop). The labels must outlive the server; set
+    // them before serving.
+    void setHubLabels(const HubLabels* labels);
+
+    // Serve requests read from inFd with responses written to outFd (which
+    // may be the same socket) until the input ends and every response is
+    // written. The descriptors are not closed.
+    bool serveStream(int inFd, int outFd, std::string& error);
+
+    // Listen on a Unix domain socket at path, replacing a stale socket file,
+    // and serve every client that connects until stop() is called
+    bool serveSocket(const std::string& path, std::string& error);
+
+    // Make a running serveStream or serveSocket return; safe from any thread
+    void stop();
+
+    // Totals of every finished serveStream and serveSocket call
+    ServerStats getStats() const;
+};
+
+#endif // ROUTE_SERVER_H
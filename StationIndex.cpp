@@ -0,0 +1,335 @@
+#include "StationIndex.h"
+#include "StringArena.h"
+#include <algorithm>
+
+StationMatch::StationMatch() : station(-1), edits(0), nameStart(false) {}
+
+StationMatch::StationMatch(int station, int edits, bool nameStart)
+    : station(station), edits(edits), nameStart(nameStart) {}
+
+// First eight bytes of a key, big-endian and zero padded, so integer order
+// agrees with string order
+static uint64_t keyHead(std::string_view key) {
+    uint64_t head = 0;
+    for (size_t i = 0; i < 8; i++) {
+        head = (head << 8) | (i < key.size() ? static_cast<unsigned char>(key[i]) : 0);
+    }
+    return head;
+}
+
+StationIndex::StationIndex() : longestKey(0) {}
+
+std::string_view StationIndex::keyText(const Key& key) const {
+    return std::string_view(folded.data() + key.offset, key.length);
+}
+
+std::string StationIndex::fold(std::string_view text) {
+    std::string result;
+    fold(text, result);
+    return result;
+}
+
+void StationIndex::fold(std::string_view text, std::string& result) {
+    result.clear();
+    result.reserve(text.size());
+    bool separator = false;
+    for (char ch : text) {
+        unsigned char c = static_cast<unsigned char>(ch);
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<unsigned char>(c - 'A' + 'a');
+        }
+        if (!((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c >= 0x80)) {
+            separator = !result.empty();
+            continue;
+        }
+        if (separator) {
+            result += ' ';
+            separator = false;
+        }
+        result += static_cast<char>(c);
+    }
+}
+
+void StationIndex::sortKeys(KeyArray& array) const {
+    std::sort(array.keys.begin(), array.keys.end(), [this](const Key& a, const Key& b) {
+        if (a.head != b.head) {
+            return a.head < b.head;
+        }
+        int order = keyText(a).compare(keyText(b));
+        return order != 0 ? order < 0 : a.station < b.station;
+    });
+    array.commonPrefix.assign(array.keys.size(), 0);
+    for (size_t i = 1; i < array.keys.size(); i++) {
+        std::string_view previous = keyText(array.keys[i - 1]);
+        std::string_view current = keyText(array.keys[i]);
+        size_t shared = 0;
+        while (shared < previous.size() && shared < current.size() && previous[shared] == current[shared]) {
+            shared++;
+        }
+        array.commonPrefix[i] = static_cast<uint32_t>(shared);
+    }
+}
+
+void StationIndex::build(const std::vector<std::string_view>& stationNames) {
+    int numStations = static_cast<int>(stationNames.size());
+    names.clear();
+    folded.clear();
+    nameOffsets.assign(1, 0);
+    firstWords.keys.clear();
+    laterWords.keys.clear();
+    longestKey = 0;
+
+    size_t numSlots = 2;
+    while (numSlots < 2 * static_cast<size_t>(numStations)) {
+        numSlots *= 2;
+    }
+    slots.assign(numSlots, Slot{ 0, -1 });
+
+    for (int station = 0; station < numStations; station++) {
+        std::string_view name = stationNames[station];
+        names += name;
+        nameOffsets.push_back(static_cast<uint32_t>(names.size()));
+
+        // A repeated name takes over the slot of the earlier station
+        uint64_t hash = hashString(name);
+        size_t slot = hash & (numSlots - 1);
+        while (slots[slot].station != -1 &&
+               (slots[slot].hash != static_cast<uint32_t>(hash >> 32) || getName(slots[slot].station) != name)) {
+            slot = (slot + 1) & (numSlots - 1);
+        }
+        slots[slot] = Slot{ static_cast<uint32_t>(hash >> 32), station };
+
+        // One key per word, running to the end of the name
+        std::string key = fold(name);
+        for (size_t p = 0; p < key.size(); p++) {
+            if (p == 0 || key[p - 1] == ' ') {
+                std::string_view rest = std::string_view(key).substr(p);
+                Key entry = { keyHead(rest), static_cast<uint32_t>(folded.size() + p),
+                              static_cast<uint32_t>(rest.size()), station };
+                (p == 0 ? firstWords : laterWords).keys.push_back(entry);
+                longestKey = std::max(longestKey, static_cast<int>(rest.size()));
+            }
+        }
+        folded += key;
+    }
+    sortKeys(firstWords);
+    sortKeys(laterWords);
+}
+
+int StationIndex::size() const {
+    return static_cast<int>(nameOffsets.size()) - 1;
+}
+
+int StationIndex::find(std::string_view name) const {
+    uint64_t hash = hashString(name);
+    size_t mask = slots.size() - 1;
+    for (size_t slot = hash & mask; slots[slot].station != -1; slot = (slot + 1) & mask) {
+        if (slots[slot].hash == static_cast<uint32_t>(hash >> 32) && getName(slots[slot].station) == name) {
+            return slots[slot].station;
+        }
+    }
+    return -1;
+}
+
+std::vector<StationIndex::Key>::const_iterator StationIndex::lowerBound(const KeyArray& array,
+                                                                        const std::string& text) const {
+    uint64_t head = keyHead(text);
+    return std::lower_bound(array.keys.begin(), array.keys.end(), text,
+                            [this, head](const Key& key, const std::string& value) {
+                                if (key.head != head) {
+                                    return key.head < head;
+                                }
+                                return keyText(key) < value;
+                            });
+}
+
+int StationIndex::findFolded(std::string_view text) const {
+    thread_local std::string key;
+    fold(text, key);
+    int found = -1;
+    for (auto it = lowerBound(firstWords, key); it != firstWords.keys.end() && keyText(*it) == key; ++it) {
+        if (found != -1) {
+            return -1; // Ambiguous
+        }
+        found = it->station;
+    }
+    return found;
+}
+
+void StationIndex::completeIn(const KeyArray& array, const std::string& prefix, bool nameStart, int k,
+                              std::vector<StationMatch>& results) const {
+    for (auto it = lowerBound(array, prefix);
+         static_cast<int>(results.size()) < k && it != array.keys.end() &&
+         keyText(*it).substr(0, prefix.size()) == prefix;
+         ++it) {
+        // A station matched through several of its words is listed once
+        bool listed = false;
+        for (const StationMatch& match : results) {
+            listed = listed || match.station == it->station;
+        }
+        if (!listed) {
+            results.push_back(StationMatch(it->station, 0, nameStart));
+        }
+    }
+}
+
+void StationIndex::complete(std::string_view prefix, int k, std::vector<StationMatch>& results) const {
+    results.clear();
+    thread_local std::string key;
+    fold(prefix, key);
+    if (k <= 0 || key.empty()) {
+        return;
+    }
+    completeIn(firstWords, key, true, k, results);
+    completeIn(laterWords, key, false, k, results);
+}
+
+void StationIndex::searchIn(const KeyArray& array, const std::string& query, bool nameStart, int k, int maxEdits,
+                            std::vector<StationMatch>& results) const {
+    int bound = maxEdits;
+    int m = static_cast<int>(query.size());
+
+    // rows[d] holds the edit distances between the first d bytes of the
+    // current key and every prefix of the query, and best[d] the smallest
+    // distance between the whole query and the first d' <= d bytes of it.
+    // Rows up to depth valid still describe the current key.
+    int width = m + 1;
+    thread_local std::vector<int> rows;
+    thread_local std::vector<int> best;
+    rows.resize(static_cast<size_t>(longestKey + 1) * width);
+    best.resize(longestKey + 1);
+    for (int j = 0; j <= m; j++) {
+        rows[j] = j;
+    }
+    best[0] = m;
+    int valid = 0;
+
+    // Keep the k best, fewest edits first and otherwise in the order found;
+    // a station reached through several of its words is kept once
+    auto offer = [&results, k](int station, int edits, bool start) {
+        for (size_t r = 0; r < results.size(); r++) {
+            if (results[r].station == station) {
+                if (edits >= results[r].edits) {
+                    return;
+                }
+                results.erase(results.begin() + r);
+                break;
+            }
+        }
+        if (static_cast<int>(results.size()) == k && edits >= results.back().edits) {
+            return;
+        }
+        auto position = std::upper_bound(results.begin(), results.end(), edits,
+                                         [](int value, const StationMatch& match) { return value < match.edits; });
+        results.insert(position, StationMatch(station, edits, start));
+        if (static_cast<int>(results.size()) > k) {
+            results.pop_back();
+        }
+    };
+
+    const std::vector<Key>& keys = array.keys;
+    size_t i = 0;
+    while (i < keys.size() && bound >= 0) {
+        std::string_view key = keyText(keys[i]);
+        int depth = std::min(valid, static_cast<int>(array.commonPrefix[i]));
+        bool cut = false;
+        while (depth < static_cast<int>(key.size())) {
+            const int* previous = &rows[static_cast<size_t>(depth) * width];
+            int* row = &rows[static_cast<size_t>(depth + 1) * width];
+            char c = key[depth];
+            row[0] = depth + 1;
+            int rowMin = row[0];
+            for (int j = 1; j <= m; j++) {
+                int cost = previous[j - 1] + (query[j - 1] != c ? 1 : 0);
+                cost = std::min(cost, previous[j] + 1);
+                cost = std::min(cost, row[j - 1] + 1);
+                if (depth > 0 && j > 1 && query[j - 1] == key[depth - 1] && query[j - 2] == c) {
+                    cost = std::min(cost, rows[static_cast<size_t>(depth - 1) * width + j - 2] + 1);
+                }
+                row[j] = cost;
+                rowMin = std::min(rowMin, cost);
+            }
+            depth++;
+            best[depth] = std::min(best[depth - 1], row[m]);
+            if (rowMin > bound) {
+                cut = true;
+                break;
+            }
+        }
+        valid = depth;
+
+        // Past a depth where every distance exceeds the bound, the keys
+        // starting with the same depth bytes all score best[depth]: either
+        // they all match or none does
+        size_t end = i + 1;
+        if (cut) {
+            std::string_view stem = key.substr(0, depth);
+            end = std::partition_point(keys.begin() + i + 1, keys.end(),
+                                       [this, stem](const Key& other) {
+                                           return keyText(other).substr(0, stem.size()) == stem;
+                                       }) - keys.begin();
+        }
+        if (best[depth] <= bound) {
+            for (size_t w = i; w < end && best[depth] <= bound; w++) {
+                offer(keys[w].station, best[depth], nameStart);
+                if (static_cast<int>(results.size()) == k) {
+                    bound = results.back().edits - 1;
+                }
+            }
+        }
+        i = end;
+    }
+}
+
+void StationIndex::search(std::string_view text, int k, int maxEdits, std::vector<StationMatch>& results) const {
+    results.clear();
+    thread_local std::string query;
+    fold(text, query);
+    if (static_cast<int>(query.size()) > MAX_QUERY_LENGTH) {
+        query.resize(MAX_QUERY_LENGTH);
+    }
+    int m = static_cast<int>(query.size());
+    if (k <= 0 || m == 0 || maxEdits < 0) {
+        return;
+    }
+    int bound = std::min(maxEdits, m <= 2 ? 0 : m <= 5 ? 1 : maxEdits);
+
+    // Later words only matter if they need fewer edits than the k-th name
+    thread_local std::vector<StationMatch> starts;
+    thread_local std::vector<StationMatch> later;
+    starts.clear();
+    later.clear();
+    searchIn(firstWords, query, true, k, bound, starts);
+    if (static_cast<int>(starts.size()) == k) {
+        bound = starts.back().edits - 1;
+    }
+    if (bound >= 0) {
+        searchIn(laterWords, query, false, k, bound, later);
+    }
+
+    // Merge, name starts first among equal edits, each station once
+    size_t a = 0;
+    size_t b = 0;
+    while (static_cast<int>(results.size()) < k && (a < starts.size() || b < later.size())) {
+        const StationMatch& next = b == later.size() || (a < starts.size() && starts[a].edits <= later[b].edits)
+                                       ? starts[a++] : later[b++];
+        bool listed = false;
+        for (const StationMatch& match : results) {
+            listed = listed || match.station == next.station;
+        }
+        if (!listed) {
+            results.push_back(next);
+        }
+    }
+}
+
+std::string_view StationIndex::getName(int station) const {
+    return std::string_view(names.data() + nameOffsets[station], nameOffsets[station + 1] - nameOffsets[station]);
+}
+
+size_t StationIndex::memoryBytes() const {
+    return names.capacity() + folded.capacity() + nameOffsets.capacity() * sizeof(uint32_t) +
+           slots.capacity() * sizeof(Slot) +
+           (firstWords.keys.capacity() + laterWords.keys.capacity()) * sizeof(Key) +
+           (firstWords.commonPrefix.capacity() + laterWords.commonPrefix.capacity()) * sizeof(uint32_t);
+}
@@ -0,0 +1,127 @@
+#ifndef STATION_INDEX_H
+#define STATION_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// A station found for typed text
+struct StationMatch {
+    int station;
+    int edits;       // Typos between the text and the start of a word of the name
+    bool nameStart;  // Matched at the first word of the name
+
+    StationMatch();
+    StationMatch(int station, int edits, bool nameStart);
+};
+
+// Read-only index of station names for exact lookup, autocomplete and
+// typo-tolerant search, built once and shared by any number of threads.
+// Lookups and searches do not allocate beyond a per-thread scratch buffer.
+//
+// Exact names go into an open-addressing table hashed straight from the
+// bytes, so a lookup needs no std::string. For search, every name is folded
+// (lower case, punctuation and spaces collapsed to one space) and each of
+// its words is kept with the rest of the name in a sorted array, so
+// "chowk" and "rajiv ch" both find "Rajiv Chowk". First words and later
+// words are kept apart, so matches at the start of a name can come first
+// without scanning the others.
+//
+// Fuzzy search walks a sorted array as an implicit trie: words sharing a
+// prefix reuse its edit-distance rows, and a prefix that is already more
+// than the allowed edits away skips every word below it at once.
+class StationIndex {
+private:
+    // One entry of a sorted word array. head holds the key's first eight
+    // bytes big-endian, so most comparisons are a single integer compare.
+    struct Key {
+        uint64_t head;
+        uint32_t offset; // Start of the key in folded
+        uint32_t length; // Bytes to the end of the name
+        int station;
+    };
+
+    // Sorted keys with the bytes each shares with the one before
+    struct KeyArray {
+        std::vector<Key> keys;
+        std::vector<uint32_t> commonPrefix;
+    };
+
+    // Slot of the exact name table (station -1 when empty)
+    struct Slot {
+        uint32_t hash;
+        int station;
+    };
+
+    std::string names;                 // Exact names, back to back
+    std::vector<uint32_t> nameOffsets; // Station i is [nameOffsets[i], nameOffsets[i + 1])
+    std::vector<Slot> slots;           // Power-of-two sized, at most half full
+    std::string folded;                // Folded names, back to back
+    KeyArray firstWords;               // Whole folded names
+    KeyArray laterWords;               // Every later word to the end of its name
+    int longestKey;
+
+    std::string_view keyText(const Key& key) const;
+
+    // Sort keys and fill in their common prefixes
+    void sortKeys(KeyArray& array) const;
+
+    // First key of array not ordered before text
+    std::vector<Key>::const_iterator lowerBound(const KeyArray& array, const std::string& text) const;
+
+    // Append stations with a key starting with prefix, in key order,
+    // until results holds k
+    void completeIn(const KeyArray& array, const std::string& prefix, bool nameStart, int k,
+                    std::vector<StationMatch>& results) const;
+
+    // The k closest keys of array within maxEdits of query, fewest edits
+    // first and otherwise in key order
+    void searchIn(const KeyArray& array, const std::string& query, bool nameStart, int k, int maxEdits,
+                  std::vector<StationMatch>& results) const;
+
+public:
+    // Longest folded query considered; longer text is cut
+    static const int MAX_QUERY_LENGTH = 64;
+
+    StationIndex();
+
+    // Index the names of stations 0 .. stationNames.size() - 1
+    void build(const std::vector<std::string_view>& stationNames);
+
+    int size() const;
+
+    // Exact, case-sensitive lookup; like Graph::getStationIndex, a name
+    // used twice resolves to the station added last. -1 if not found.
+    int find(std::string_view name) const;
+
+    // Station whose whole folded name equals the folded text, if exactly
+    // one does: "rajiv  CHOWK" finds "Rajiv Chowk". -1 otherwise.
+    int findFolded(std::string_view text) const;
+
+    // Up to k stations with a word starting with the folded text: names
+    // starting with it first, each group in alphabetical order
+    void complete(std::string_view prefix, int k, std::vector<StationMatch>& results) const;
+
+    // Up to k stations with a word whose start is within maxEdits
+    // insertions, deletions, substitutions or swaps of adjacent letters of
+    // the folded text: fewest edits first, then matches at the start of the
+    // name, then alphabetical. Short text allows fewer edits: none up to two
+    // characters, one up to five.
+    void search(std::string_view text, int k, int maxEdits, std::vector<StationMatch>& results) const;
+
+    // Name of a station
+    std::string_view getName(int station) const;
+
+    // Bytes held by the index
+    size_t memoryBytes() const;
+
+    // Lower case ASCII letters and replace every run of other characters
+    // than letters, digits and non-ASCII bytes by one space, trimmed
+    static std::string fold(std::string_view text);
+
+    // Same, written into result so a reused buffer keeps its capacity
+    static void fold(std::string_view text, std::string& result);
+};
+
+#endif // STATION_INDEX_H
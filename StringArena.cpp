@@ -0,0 +1,64 @@
+#include "StringArena.h"
+
+StringArena::StringArena() : offsets(1, 0), slots(16, -1), slotHashes(16, 0) {}
+
+size_t StringArena::findSlot(std::string_view value, uint64_t hash) const {
+    size_t mask = slots.size() - 1;
+    uint32_t tag = static_cast<uint32_t>(hash >> 32);
+    size_t slot = hash & mask;
+    while (slots[slot] != -1 && (slotHashes[slot] != tag || get(slots[slot]) != value)) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+void StringArena::grow() {
+    std::vector<int> previous = std::move(slots);
+    slots.assign(previous.size() * 2, -1);
+    slotHashes.assign(previous.size() * 2, 0);
+
+    size_t mask = slots.size() - 1;
+    for (int id : previous) {
+        if (id == -1) {
+            continue;
+        }
+        uint64_t hash = hashString(get(id));
+        size_t slot = hash & mask;
+        while (slots[slot] != -1) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = id;
+        slotHashes[slot] = static_cast<uint32_t>(hash >> 32);
+    }
+}
+
+int StringArena::intern(std::string_view value) {
+    uint64_t hash = hashString(value);
+    size_t slot = findSlot(value, hash);
+    if (slots[slot] != -1) {
+        return slots[slot];
+    }
+
+    int id = size();
+    text.append(value.data(), value.size());
+    offsets.push_back(static_cast<uint32_t>(text.size()));
+    slots[slot] = id;
+    slotHashes[slot] = static_cast<uint32_t>(hash >> 32);
+    if (2 * static_cast<size_t>(size()) > slots.size()) {
+        grow();
+    }
+    return id;
+}
+
+int StringArena::find(std::string_view value) const {
+    return slots[findSlot(value, hashString(value))];
+}
+
+int StringArena::size() const {
+    return static_cast<int>(offsets.size()) - 1;
+}
+
+size_t StringArena::memoryBytes() const {
+    return text.capacity() + offsets.capacity() * sizeof(uint32_t) + slots.capacity() * sizeof(int) +
+           slotHashes.capacity() * sizeof(uint32_t);
+}
@@ -0,0 +1,67 @@
+#ifndef STRING_ARENA_H
+#define STRING_ARENA_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Hash of a string's bytes, mixing eight bytes at a time
+inline uint64_t hashString(std::string_view text) {
+    uint64_t hash = 0x9e3779b97f4a7c15ull ^ text.size();
+    size_t i = 0;
+    for (; i + 8 <= text.size(); i += 8) {
+        uint64_t word;
+        std::memcpy(&word, text.data() + i, 8);
+        hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+        hash ^= hash >> 32;
+    }
+    uint64_t tail = 0;
+    if (i < text.size()) {
+        // An empty view may have a null data(), which memcpy must not see
+        std::memcpy(&tail, text.data() + i, text.size() - i);
+    }
+    hash = (hash ^ tail) * 0xc4ceb9fe1a85ec53ull;
+    return hash ^ (hash >> 29);
+}
+
+// Interned strings stored back to back in one buffer and named by dense
+// integer ids (0, 1, 2, ...). Interning the same text twice gives the same
+// id, so ids can be compared instead of strings. Views returned by get()
+// stay valid until the next intern().
+class StringArena {
+private:
+    std::string text;                // Every string, back to back
+    std::vector<uint32_t> offsets;   // String id is [offsets[id], offsets[id + 1])
+    std::vector<int> slots;          // Open-addressing table of ids (-1 empty), at most half full
+    std::vector<uint32_t> slotHashes;
+
+    // Slot holding value, or the empty slot where it belongs
+    size_t findSlot(std::string_view value, uint64_t hash) const;
+
+    // Double the table and re-insert every id
+    void grow();
+
+public:
+    StringArena();
+
+    // Id of value, adding it if new
+    int intern(std::string_view value);
+
+    // Id of value, or -1 if it was never interned
+    int find(std::string_view value) const;
+
+    // Text of an id
+    std::string_view get(int id) const {
+        return std::string_view(text.data() + offsets[id], offsets[id + 1] - offsets[id]);
+    }
+
+    // Number of distinct strings
+    int size() const;
+
+    // Bytes held, including the lookup table
+    size_t memoryBytes() const;
+};
+
+#endif // STRING_ARENA_H
@@ -0,0 +1,220 @@
+#include "SyntheticNetwork.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+SyntheticNetworkOptions::SyntheticNetworkOptions()
+    : numLines(10), stationsPerLine(20), interchangeProbability(0.1),
+      minDistance(1), maxDistance(5), seed(42), layout(SyntheticLayout::RandomChains),
+      spacing(StopSpacing::Uniform), interchangeRadius(1.0) {}
+
+// mt19937 output is specified by the standard; reducing it with modulo or
+// scaling (rather than std::uniform_*_distribution) keeps networks
+// identical across standard library implementations.
+static double unitRandom(std::mt19937& rng) {
+    return rng() / 4294967296.0;
+}
+
+static void generateRandomChains(Graph& graph, const SyntheticNetworkOptions& options) {
+    std::mt19937 rng(options.seed);
+    int distanceRange = options.maxDistance - options.minDistance + 1;
+    
+    for (int line = 0; line < options.numLines; line++) {
+        std::string lineName = "Line " + std::to_string(line + 1);
+        int lineId = graph.addLine(lineName);
+        int existing = graph.getNumVertices();
+        int previous = -1;
+        
+        for (int stop = 0; stop < options.stationsPerLine; stop++) {
+            bool interchange = existing > 0 &&
+                (stop == 0 || rng() % 1000000 < options.interchangeProbability * 1000000);
+            
+            int current;
+            if (interchange) {
+                // Reuse a station from an earlier line
+                current = static_cast<int>(rng() % existing);
+                if (current == previous) {
+                    continue;
+                }
+            } else {
+                current = graph.getNumVertices();
+                graph.addStation("L" + std::to_string(line + 1) + "-S" + std::to_string(stop + 1), lineName);
+            }
+            
+            if (previous != -1) {
+                int distance = options.minDistance + static_cast<int>(rng() % distanceRange);
+                graph.addEdge(previous, current, distance, lineId);
+            }
+            previous = current;
+        }
+    }
+}
+
+// Station positions bucketed into square cells for nearest-station lookups
+class StationGrid {
+private:
+    double cellSize;
+    std::unordered_map<long long, std::vector<int>> cells;
+    
+    long long cellKey(long long cx, long long cy) const {
+        return (cx << 32) ^ (cy & 0xFFFFFFFFLL);
+    }
+    
+    long long cellOf(double coordinate) const {
+        return static_cast<long long>(std::floor(coordinate / cellSize));
+    }
+
+public:
+    std::vector<double> xs;
+    std::vector<double> ys;
+    
+    explicit StationGrid(double cellSize) : cellSize(cellSize) {}
+    
+    void add(int station, double x, double y) {
+        xs.resize(std::max<size_t>(xs.size(), station + 1));
+        ys.resize(xs.size());
+        xs[station] = x;
+        ys[station] = y;
+        cells[cellKey(cellOf(x), cellOf(y))].push_back(station);
+    }
+    
+    // Closest station within radius of (x, y) that is not excluded (a
+    // station index below firstNew counts as a station of another line
+    // unless marked in used); -1 if none. Sets distance.
+    int nearest(double x, double y, double radius, int firstNew, const std::vector<char>& used,
+                double& distance) const {
+        int best = -1;
+        distance = radius;
+        long long reach = static_cast<long long>(std::ceil(radius / cellSize));
+        long long cx = cellOf(x);
+        long long cy = cellOf(y);
+        for (long long i = cx - reach; i <= cx + reach; i++) {
+            for (long long j = cy - reach; j <= cy + reach; j++) {
+                auto it = cells.find(cellKey(i, j));
+                if (it == cells.end()) {
+                    continue;
+                }
+                for (int station : it->second) {
+                    if (station >= firstNew || used[station]) {
+                        continue;
+                    }
+                    double d = std::hypot(xs[station] - x, ys[station] - y);
+                    if (d <= distance) {
+                        distance = d;
+                        best = station;
+                    }
+                }
+            }
+        }
+        return best;
+    }
+};
+
+static void generateGeometric(Graph& graph, const SyntheticNetworkOptions& options) {
+    const double PI = 3.14159265358979323846;
+    std::mt19937 rng(options.seed);
+    int spacingRange = options.maxDistance - options.minDistance;
+    double averageSpacing = (options.minDistance + options.maxDistance) / 2.0;
+    
+    // A line runs roughly across the city
+    double radius = std::max(1.0, options.stationsPerLine * averageSpacing / 2.0);
+    double snapRadius = std::max(options.interchangeRadius, 1e-9);
+    StationGrid grid(std::max(snapRadius, averageSpacing));
+    
+    std::vector<double> pointX, pointY;
+    std::vector<int> snapped;
+    std::vector<char> used;
+    for (int line = 0; line < options.numLines; line++) {
+        std::string lineName = "Line " + std::to_string(line + 1);
+        int lineId = graph.addLine(lineName);
+        int existing = graph.getNumVertices();
+        
+        // Enter at a random point of the edge and head for a random point
+        // of the central area, bending slightly along the way
+        double angle = unitRandom(rng) * 2 * PI;
+        double x = radius * std::cos(angle);
+        double y = radius * std::sin(angle);
+        double throughAngle = unitRandom(rng) * 2 * PI;
+        double throughRadius = unitRandom(rng) * radius * 0.3;
+        double course = std::atan2(throughRadius * std::sin(throughAngle) - y,
+                                   throughRadius * std::cos(throughAngle) - x);
+        double bend = 0; // Drifts around 0, so the line keeps its course overall
+        pointX.clear();
+        pointY.clear();
+        for (int stop = 0; stop < options.stationsPerLine; stop++) {
+            pointX.push_back(x);
+            pointY.push_back(y);
+            double spacing = options.minDistance;
+            if (options.spacing == StopSpacing::Uniform) {
+                spacing += static_cast<int>(rng() % (spacingRange + 1));
+            } else {
+                double edge = std::min(1.0, std::hypot(x, y) / radius);
+                spacing += unitRandom(rng) * edge * spacingRange;
+            }
+            bend = 0.9 * bend + (unitRandom(rng) - 0.5) * 0.3;
+            x += spacing * std::cos(course + bend);
+            y += spacing * std::sin(course + bend);
+        }
+        
+        // Stops near an earlier line's station become interchanges. A line
+        // meeting no other joins at the stop closest to any station.
+        used.assign(existing, 0);
+        snapped.assign(pointX.size(), -1);
+        bool joined = existing == 0;
+        for (size_t p = 0; p < pointX.size(); p++) {
+            double distance;
+            snapped[p] = grid.nearest(pointX[p], pointY[p], snapRadius, existing, used, distance);
+            if (snapped[p] != -1) {
+                used[snapped[p]] = 1;
+                joined = true;
+            }
+        }
+        if (!joined) {
+            double bestDistance = std::numeric_limits<double>::max();
+            size_t bestPoint = 0;
+            int bestStation = -1;
+            double searchRadius = options.maxDistance;
+            while (bestStation == -1) {
+                for (size_t p = 0; p < pointX.size(); p++) {
+                    double distance;
+                    int station = grid.nearest(pointX[p], pointY[p], std::min(searchRadius, bestDistance),
+                                               existing, used, distance);
+                    if (station != -1 && distance < bestDistance) {
+                        bestDistance = distance;
+                        bestPoint = p;
+                        bestStation = station;
+                    }
+                }
+                searchRadius *= 4;
+            }
+            snapped[bestPoint] = bestStation;
+        }
+        
+        int previous = -1;
+        for (size_t p = 0; p < pointX.size(); p++) {
+            int current = snapped[p];
+            if (current == -1) {
+                current = graph.getNumVertices();
+                graph.addStation("L" + std::to_string(line + 1) + "-S" + std::to_string(p + 1), lineName);
+                grid.add(current, pointX[p], pointY[p]);
+            }
+            if (previous != -1) {
+                double length = std::hypot(grid.xs[current] - grid.xs[previous], grid.ys[current] - grid.ys[previous]);
+                graph.addEdge(previous, current, std::max(1, static_cast<int>(std::lround(length))), lineId);
+            }
+            previous = current;
+        }
+    }
+}
+
+void generateSyntheticNetwork(Graph& graph, const SyntheticNetworkOptions& options) {
+    if (options.layout == SyntheticLayout::Geometric) {
+        generateGeometric(graph, options);
+    } else {
+        generateRandomChains(graph, options);
+    }
+}
@@ -0,0 +1,50 @@
+#ifndef SYNTHETIC_NETWORK_H
+#define SYNTHETIC_NETWORK_H
+
+#include "Graph.h"
+
+// How a synthetic network is laid out
+enum class SyntheticLayout {
+    RandomChains, // Chains of stops reusing random earlier stations; no geography
+    Geometric     // Lines cross a round city; stops close to another line's station become interchanges
+};
+
+// How far apart consecutive stops are (Geometric layout)
+enum class StopSpacing {
+    Uniform,  // Anywhere in [minDistance, maxDistance]
+    Suburban  // Close together in the centre, up to maxDistance apart at the edge
+};
+
+// Parameters for a generated metro-like network
+struct SyntheticNetworkOptions {
+    int numLines;                  // Number of lines
+    int stationsPerLine;           // Stops on each line
+    double interchangeProbability; // Chance a stop reuses a station of another line (RandomChains)
+    int minDistance;               // Shortest inter-station distance (km)
+    int maxDistance;               // Longest inter-station distance (km)
+    unsigned int seed;             // Same seed, same network
+    SyntheticLayout layout;
+    StopSpacing spacing;           // Geometric only
+    double interchangeRadius;      // km within which a stop joins another line's station (Geometric only)
+
+    SyntheticNetworkOptions();
+};
+
+// Add a synthetic network to an empty graph. The graph is left unfrozen.
+//
+// RandomChains: each line is a chain of stops; a stop is either a new
+// station or, with interchangeProbability, an existing station of an
+// earlier line. Every line after the first starts at an interchange, so the
+// network is connected.
+//
+// Geometric: each line enters a round city at a random point, heads
+// through the central area with a slight random curve and leaves on the far
+// side. The city grows with the line length, so lines meet mostly in the
+// centre, as in real networks. A stop within interchangeRadius of an
+// earlier line's station becomes that station; a line that meets no other
+// is joined to the network at its closest stop, so the network is
+// connected. Distances are the straight-line distances between stations,
+// rounded to whole km (at least 1).
+void generateSyntheticNetwork(Graph& graph, const SyntheticNetworkOptions& options);
+
+#endif // SYNTHETIC_NETWORK_H
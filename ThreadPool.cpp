@@ -0,0 +1,144 @@
+#include "ThreadPool.h"
+
+// Pack and unpack a [begin, end) range
+static unsigned long long packRange(unsigned int begin, unsigned int end) {
+    return (static_cast<unsigned long long>(begin) << 32) | end;
+}
+
+static unsigned int rangeBegin(unsigned long long range) {
+    return static_cast<unsigned int>(range >> 32);
+}
+
+static unsigned int rangeEnd(unsigned long long range) {
+    return static_cast<unsigned int>(range);
+}
+
+ThreadPool::ThreadPool(int numThreads)
+    : task(nullptr), running(0), epoch(0), stopping(false) {
+    if (numThreads <= 0) {
+        numThreads = static_cast<int>(std::thread::hardware_concurrency());
+        if (numThreads <= 0) {
+            numThreads = 1;
+        }
+    }
+    ranges.reset(new WorkRange[numThreads]);
+    for (int i = 0; i < numThreads; i++) {
+        ranges[i].range.store(0);
+    }
+    for (int i = 0; i < numThreads; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+int ThreadPool::size() const {
+    return static_cast<int>(workers.size());
+}
+
+void ThreadPool::workerLoop(int worker) {
+    unsigned long long seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] { return stopping || epoch != seen; });
+            if (stopping) {
+                return;
+            }
+            seen = epoch;
+        }
+        
+        drain(worker);
+        
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--running == 0) {
+            finished.notify_all();
+        }
+    }
+}
+
+void ThreadPool::drain(int worker) {
+    std::atomic<unsigned long long>& own = ranges[worker].range;
+    while (true) {
+        unsigned long long range = own.load();
+        unsigned int begin = rangeBegin(range);
+        unsigned int end = rangeEnd(range);
+        
+        if (begin < end) {
+            // Claim the front item; a thief may have shrunk the range meanwhile
+            if (own.compare_exchange_weak(range, packRange(begin + 1, end))) {
+                (*task)(static_cast<int>(begin));
+            }
+        } else if (!steal(worker)) {
+            // Items still in flight belong to thieves that will run them
+            return;
+        }
+    }
+}
+
+bool ThreadPool::steal(int worker) {
+    int numWorkers = size();
+    while (true) {
+        // Pick the victim with the most remaining work
+        int victim = -1;
+        unsigned int most = 0;
+        for (int i = 1; i < numWorkers; i++) {
+            int candidate = (worker + i) % numWorkers;
+            unsigned long long range = ranges[candidate].range.load();
+            unsigned int remaining = rangeEnd(range) - rangeBegin(range);
+            if (rangeBegin(range) < rangeEnd(range) && remaining > most) {
+                most = remaining;
+                victim = candidate;
+            }
+        }
+        if (victim == -1) {
+            return false;
+        }
+        
+        unsigned long long range = ranges[victim].range.load();
+        unsigned int begin = rangeBegin(range);
+        unsigned int end = rangeEnd(range);
+        if (begin >= end) {
+            continue;
+        }
+        
+        // Take the back half, or the single remaining item
+        unsigned int middle = begin + (end - begin) / 2;
+        if (ranges[victim].range.compare_exchange_weak(range, packRange(begin, middle))) {
+            ranges[worker].range.store(packRange(middle, end));
+            return true;
+        }
+    }
+}
+
+void ThreadPool::parallelFor(int count, const std::function<void(int)>& task) {
+    if (count <= 0) {
+        return;
+    }
+    
+    std::unique_lock<std::mutex> lock(mutex);
+    this->task = &task;
+    
+    // Even initial split; stealing fixes any imbalance
+    int numWorkers = size();
+    for (int i = 0; i < numWorkers; i++) {
+        unsigned int begin = static_cast<unsigned int>(static_cast<long long>(count) * i / numWorkers);
+        unsigned int end = static_cast<unsigned int>(static_cast<long long>(count) * (i + 1) / numWorkers);
+        ranges[i].range.store(packRange(begin, end));
+    }
+    
+    running = numWorkers;
+    epoch++;
+    wake.notify_all();
+    finished.wait(lock, [&] { return running == 0; });
+    this->task = nullptr;
+}
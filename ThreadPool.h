@@ -0,0 +1,62 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+// Fixed set of worker threads for data-parallel loops.
+// parallelFor splits the index range evenly across the workers. Each worker
+// takes indices from the front of its own range; a worker that runs dry
+// steals the back half of the fullest remaining range, so uneven items
+// (such as shortest-path trees of different sizes) still balance.
+class ThreadPool {
+private:
+    // A worker's remaining [begin, end) packed into one word so that the
+    // owner and thieves can update it with a single compare-and-swap
+    struct alignas(64) WorkRange {
+        std::atomic<unsigned long long> range;
+    };
+
+    std::vector<std::thread> workers;
+    std::unique_ptr<WorkRange[]> ranges;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable finished;
+    
+    // Current job, valid while running > 0
+    const std::function<void(int)>* task;
+    int running;              // Workers still inside the current job
+    unsigned long long epoch; // Incremented for every new job
+    bool stopping;
+
+    // Worker thread main loop
+    void workerLoop(int worker);
+    
+    // Run items of the current job until no range has work left
+    void drain(int worker);
+    
+    // Move half of another worker's range into this worker's range
+    bool steal(int worker);
+
+public:
+    // Start numThreads workers (0 = one per hardware thread)
+    explicit ThreadPool(int numThreads = 0);
+    ~ThreadPool();
+    
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    
+    // Number of worker threads
+    int size() const;
+    
+    // Run task(i) for every i in [0, count) across the workers and wait for
+    // all of them. Not reentrant: call from one thread at a time.
+    void parallelFor(int count, const std::function<void(int)>& task);
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,405 @@
+#include "Timetable.h"
+#include "Graph.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <cstdio>
+
+// TimetableOptions implementation
+TimetableOptions::TimetableOptions()
+    : firstDeparture(5 * 3600 + 30 * 60), lastDeparture(23 * 3600), peakHeadway(180),
+      offPeakHeadway(420), secondsPerKm(90), dwellSeconds(30), transferSeconds(120) {}
+
+// Check if a departure falls in the morning (08-10) or evening (17-20) peak
+static bool isPeak(int time) {
+    return (time >= 8 * 3600 && time < 10 * 3600) || (time >= 17 * 3600 && time < 20 * 3600);
+}
+
+// Timetable implementation
+Timetable::Timetable() : numStations(0), transferSeconds(0), finalized(false) {
+    routeStopOffsets.push_back(0);
+}
+
+void Timetable::reset(int numStations, int transferSeconds) {
+    *this = Timetable();
+    this->numStations = numStations;
+    this->transferSeconds = transferSeconds;
+}
+
+int Timetable::addRoute(int line, const std::vector<int>& stops) {
+    if (stops.size() < 2) {
+        throw std::invalid_argument("A route needs at least two stops");
+    }
+    routeLines.push_back(line);
+    routeStops.insert(routeStops.end(), stops.begin(), stops.end());
+    routeStopOffsets.push_back(static_cast<int>(routeStops.size()));
+    finalized = false;
+    return static_cast<int>(routeLines.size()) - 1;
+}
+
+void Timetable::addTrip(int route, const std::vector<int>& tripArrivals, const std::vector<int>& tripDepartures) {
+    int numStops = routeStopOffsets[route + 1] - routeStopOffsets[route];
+    if (static_cast<int>(tripArrivals.size()) != numStops || static_cast<int>(tripDepartures.size()) != numStops) {
+        throw std::invalid_argument("A trip needs one arrival and departure per stop");
+    }
+    addedTrips.push_back({ route, tripArrivals, tripDepartures });
+    finalized = false;
+}
+
+void Timetable::finalize() {
+    int numRoutes = getNumRoutes();
+
+    // Group trips by route, each route's trips in departure order
+    std::vector<int> order(addedTrips.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        order[i] = static_cast<int>(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+        const TripTimes& x = addedTrips[a];
+        const TripTimes& y = addedTrips[b];
+        return x.route != y.route ? x.route < y.route : x.departures[0] < y.departures[0];
+    });
+
+    routeTripOffsets.assign(numRoutes + 1, 0);
+    tripRoutes.clear();
+    tripTimeOffsets.clear();
+    arrivals.clear();
+    departures.clear();
+    for (int t : order) {
+        const TripTimes& trip = addedTrips[t];
+        routeTripOffsets[trip.route + 1]++;
+        tripRoutes.push_back(trip.route);
+        tripTimeOffsets.push_back(static_cast<int>(arrivals.size()));
+        arrivals.insert(arrivals.end(), trip.arrivals.begin(), trip.arrivals.end());
+        departures.insert(departures.end(), trip.departures.begin(), trip.departures.end());
+    }
+    for (int r = 0; r < numRoutes; r++) {
+        routeTripOffsets[r + 1] += routeTripOffsets[r];
+    }
+
+    // Invert the route stop lists into per-station (route, position) lists
+    stationRouteOffsets.assign(numStations + 1, 0);
+    for (int stop : routeStops) {
+        stationRouteOffsets[stop + 1]++;
+    }
+    for (int v = 0; v < numStations; v++) {
+        stationRouteOffsets[v + 1] += stationRouteOffsets[v];
+    }
+    stationRoutes.resize(routeStops.size());
+    stationRoutePositions.resize(routeStops.size());
+    std::vector<int> next(stationRouteOffsets.begin(), stationRouteOffsets.end() - 1);
+    for (int r = 0; r < numRoutes; r++) {
+        for (int i = routeStopOffsets[r]; i < routeStopOffsets[r + 1]; i++) {
+            int slot = next[routeStops[i]]++;
+            stationRoutes[slot] = r;
+            stationRoutePositions[slot] = i - routeStopOffsets[r];
+        }
+    }
+    finalized = true;
+}
+
+void Timetable::generate(const Graph& graph, const TimetableOptions& options) {
+    reset(graph.getNumVertices(), options.transferSeconds);
+
+    // Connections of each line (NO_LINE included), each listed once
+    struct Link {
+        int from;
+        int to;
+        int distance;
+    };
+    std::vector<std::vector<Link>> lineLinks(graph.getNumLines() + 1);
+    for (int u = 0; u < graph.getNumVertices(); u++) {
+        for (int e = graph.edgeBegin(u); e < graph.edgeEnd(u); e++) {
+            if (u < graph.edgeTarget(e)) {
+                lineLinks[graph.edgeLine(e) + 1].push_back({ u, graph.edgeTarget(e), graph.edgeDistance(e) });
+            }
+        }
+    }
+
+    std::vector<int> stops, hops, arrivalTimes, departureTimes;
+    for (int line = Graph::NO_LINE; line < graph.getNumLines(); line++) {
+        const std::vector<Link>& links = lineLinks[line + 1];
+        if (links.empty()) {
+            continue;
+        }
+
+        // Local adjacency of the line's stations
+        std::vector<int> stations;
+        for (const Link& link : links) {
+            stations.push_back(link.from);
+            stations.push_back(link.to);
+        }
+        std::sort(stations.begin(), stations.end());
+        stations.erase(std::unique(stations.begin(), stations.end()), stations.end());
+        auto local = [&stations](int station) {
+            return static_cast<int>(std::lower_bound(stations.begin(), stations.end(), station) - stations.begin());
+        };
+        std::vector<std::vector<int>> incident(stations.size());
+        for (size_t i = 0; i < links.size(); i++) {
+            incident[local(links[i].from)].push_back(static_cast<int>(i));
+            incident[local(links[i].to)].push_back(static_cast<int>(i));
+        }
+        std::vector<int> degree(stations.size());
+        for (size_t i = 0; i < stations.size(); i++) {
+            degree[i] = static_cast<int>(incident[i].size());
+        }
+        std::vector<char> used(links.size(), 0);
+
+        // Peel off walks, starting from line ends (odd degree) so a
+        // plain line becomes a single route and branches become extra routes
+        size_t remaining = links.size();
+        while (remaining > 0) {
+            int start = -1;
+            for (size_t i = 0; i < stations.size() && start == -1; i++) {
+                if (degree[i] % 2 == 1) {
+                    start = static_cast<int>(i);
+                }
+            }
+            for (size_t i = 0; i < stations.size() && start == -1; i++) {
+                if (degree[i] > 0) {
+                    start = static_cast<int>(i);
+                }
+            }
+
+            stops.assign(1, stations[start]);
+            hops.clear();
+            int current = start;
+            while (degree[current] > 0) {
+                int link = -1;
+                for (int candidate : incident[current]) {
+                    if (!used[candidate]) {
+                        link = candidate;
+                        break;
+                    }
+                }
+                used[link] = 1;
+                remaining--;
+                int other = local(links[link].from) == current ? local(links[link].to) : local(links[link].from);
+                degree[current]--;
+                degree[other]--;
+                stops.push_back(stations[other]);
+                hops.push_back(links[link].distance);
+                current = other;
+            }
+
+            // Serve the walk in both directions with the same pattern
+            for (int direction = 0; direction < 2; direction++) {
+                if (direction == 1) {
+                    std::reverse(stops.begin(), stops.end());
+                    std::reverse(hops.begin(), hops.end());
+                }
+                int route = addRoute(line, stops);
+                for (int time = options.firstDeparture; time <= options.lastDeparture;
+                     time += isPeak(time) ? options.peakHeadway : options.offPeakHeadway) {
+                    arrivalTimes.assign(1, time);
+                    departureTimes.assign(1, time);
+                    for (size_t i = 0; i < hops.size(); i++) {
+                        int arrival = departureTimes.back() + hops[i] * options.secondsPerKm;
+                        bool last = i + 1 == hops.size();
+                        arrivalTimes.push_back(arrival);
+                        departureTimes.push_back(last ? arrival : arrival + options.dwellSeconds);
+                    }
+                    addTrip(route, arrivalTimes, departureTimes);
+                }
+            }
+        }
+    }
+    finalize();
+}
+
+int Timetable::earliestTrip(int route, int position, int time) const {
+    int low = routeTripOffsets[route];
+    int high = routeTripOffsets[route + 1];
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        if (departures[tripTimeOffsets[mid] + position] < time) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+    return low < routeTripOffsets[route + 1] ? low : -1;
+}
+
+bool Timetable::earliestArrival(int src, int dest, int departureTime, std::vector<Journey>& journeys,
+                                int maxTransfers) const {
+    return earliestArrival(src, dest, departureTime, journeys, maxTransfers, RaptorContext::local());
+}
+
+bool Timetable::earliestArrival(int src, int dest, int departureTime, std::vector<Journey>& journeys,
+                                int maxTransfers, RaptorContext& context) const {
+    if (!finalized) {
+        throw std::logic_error("Timetable must be finalized before querying");
+    }
+
+    const int INF = std::numeric_limits<int>::max();
+    int rounds = maxTransfers + 1;
+    int n = numStations;
+    context.reset(n, getNumRoutes(), rounds);
+    journeys.clear();
+
+    context.arrivals[src] = departureTime;
+    context.best[src] = departureTime;
+    context.marked[src] = 1;
+    context.markedStations.push_back(src);
+    if (src == dest) {
+        journeys.push_back({ departureTime, departureTime, std::vector<JourneyLeg>() });
+        return true;
+    }
+
+    for (int k = 1; k <= rounds; k++) {
+        int* arrival = &context.arrivals[k * n];
+        const int* previous = &context.arrivals[(k - 1) * n];
+
+        // Labels carry over: k trips can do anything k - 1 trips can
+        std::copy(previous, previous + n, arrival);
+        std::copy(&context.legTrips[(k - 1) * n], &context.legTrips[k * n], &context.legTrips[k * n]);
+        std::copy(&context.legBoards[(k - 1) * n], &context.legBoards[k * n], &context.legBoards[k * n]);
+        std::copy(&context.legAlights[(k - 1) * n], &context.legAlights[k * n], &context.legAlights[k * n]);
+        std::copy(&context.legRounds[(k - 1) * n], &context.legRounds[k * n], &context.legRounds[k * n]);
+
+        // Queue each route through a station improved last round, from the
+        // earliest such station along it
+        for (int station : context.markedStations) {
+            context.marked[station] = 0;
+            for (int i = stationRouteOffsets[station]; i < stationRouteOffsets[station + 1]; i++) {
+                int route = stationRoutes[i];
+                if (context.routeStart[route] == INF) {
+                    context.queuedRoutes.push_back(route);
+                }
+                context.routeStart[route] = std::min(context.routeStart[route], stationRoutePositions[i]);
+            }
+        }
+        context.markedStations.clear();
+
+        for (int route : context.queuedRoutes) {
+            int position = context.routeStart[route];
+            context.routeStart[route] = INF;
+            const int* stops = &routeStops[routeStopOffsets[route]];
+            int numStops = routeStopOffsets[route + 1] - routeStopOffsets[route];
+            int trip = -1;
+            int boardPosition = -1;
+
+            for (; position < numStops; position++) {
+                int station = stops[position];
+
+                // Ride the current trip to this stop
+                if (trip != -1) {
+                    int time = arrivals[tripTimeOffsets[trip] + position];
+                    if (time < context.best[station] && time < context.best[dest]) {
+                        int label = k * n + station;
+                        arrival[station] = time;
+                        context.best[station] = time;
+                        context.legTrips[label] = trip;
+                        context.legBoards[label] = boardPosition;
+                        context.legAlights[label] = position;
+                        context.legRounds[label] = k;
+                        if (!context.marked[station]) {
+                            context.marked[station] = 1;
+                            context.markedStations.push_back(station);
+                        }
+                    }
+                }
+
+                // Or catch an earlier trip here with k - 1 trips so far
+                if (previous[station] != INF) {
+                    int ready = previous[station] + (station == src ? 0 : transferSeconds);
+                    if (trip == -1 || ready <= departures[tripTimeOffsets[trip] + position]) {
+                        int earlier = earliestTrip(route, position, ready);
+                        if (earlier != -1 && (trip == -1 || earlier < trip)) {
+                            trip = earlier;
+                            boardPosition = position;
+                        }
+                    }
+                }
+            }
+        }
+        context.queuedRoutes.clear();
+
+        if (context.markedStations.empty()) {
+            rounds = k;
+            break;
+        }
+    }
+
+    // Each round that improved the arrival adds a Pareto-optimal journey
+    int last = INF;
+    for (int k = 1; k <= rounds; k++) {
+        int time = context.arrivals[k * n + dest];
+        if (time < last) {
+            journeys.push_back(Journey());
+            buildJourney(context, k, dest, journeys.back());
+            last = time;
+        }
+    }
+    return !journeys.empty();
+}
+
+void Timetable::buildJourney(const RaptorContext& context, int round, int dest, Journey& journey) const {
+    int n = numStations;
+    journey.legs.clear();
+
+    // Follow legs back to the origin; each leg's boarding label is from the
+    // round before the one that set it
+    int station = dest;
+    while (context.legTrips[round * n + station] != -1) {
+        int label = round * n + station;
+        int trip = context.legTrips[label];
+        int route = tripRoutes[trip];
+        int board = routeStops[routeStopOffsets[route] + context.legBoards[label]];
+        journey.legs.push_back({ routeLines[route], board, getDeparture(trip, context.legBoards[label]), station,
+                                 getArrival(trip, context.legAlights[label]) });
+        round = context.legRounds[label] - 1;
+        station = board;
+    }
+    std::reverse(journey.legs.begin(), journey.legs.end());
+    journey.departureTime = journey.legs.front().boardTime;
+    journey.arrivalTime = journey.legs.back().alightTime;
+}
+
+// RaptorContext implementation
+RaptorContext::RaptorContext() : numStations(0) {}
+
+void RaptorContext::reset(int numStations, int numRoutes, int rounds) {
+    const int INF = std::numeric_limits<int>::max();
+    this->numStations = numStations;
+    size_t labels = static_cast<size_t>(rounds + 1) * numStations;
+
+    // Only round 0 needs clearing; later rounds start as copies of it
+    arrivals.resize(labels);
+    legTrips.resize(labels);
+    legBoards.resize(labels);
+    legAlights.resize(labels);
+    legRounds.resize(labels);
+    std::fill(arrivals.begin(), arrivals.begin() + numStations, INF);
+    std::fill(legTrips.begin(), legTrips.begin() + numStations, -1);
+    best.assign(numStations, INF);
+    marked.assign(numStations, 0);
+    markedStations.clear();
+    if (static_cast<int>(routeStart.size()) != numRoutes) {
+        routeStart.assign(numRoutes, INF);
+    }
+    queuedRoutes.clear();
+}
+
+RaptorContext& RaptorContext::local() {
+    thread_local RaptorContext context;
+    return context;
+}
+
+int parseClockTime(const std::string& text) {
+    int hours, minutes;
+    char extra;
+    if (std::sscanf(text.c_str(), "%d:%d%c", &hours, &minutes, &extra) != 2 ||
+        hours < 0 || hours > 47 || minutes < 0 || minutes > 59) {
+        return -1;
+    }
+    return hours * 3600 + minutes * 60;
+}
+
+std::string formatClockTime(int seconds) {
+    int minutes = seconds / 60;
+    char text[8];
+    std::snprintf(text, sizeof(text), "%02d:%02d", minutes / 60 % 100, minutes % 60);
+    return text;
+}
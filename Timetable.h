@@ -0,0 +1,174 @@
+#ifndef TIMETABLE_H
+#define TIMETABLE_H
+
+#include <vector>
+#include <string>
+
+class Graph;
+
+// Service pattern used by Timetable::generate. Times are seconds after midnight.
+struct TimetableOptions {
+    int firstDeparture;     // First trip leaves its origin
+    int lastDeparture;      // No trip leaves its origin after this
+    int peakHeadway;        // Seconds between trips in the peaks
+    int offPeakHeadway;     // Seconds between trips otherwise
+    int secondsPerKm;       // Running time
+    int dwellSeconds;       // Stop at each intermediate station
+    int transferSeconds;    // Minimum time to change trains at a station
+
+    TimetableOptions();
+};
+
+// One ride on a single trip
+struct JourneyLeg {
+    int line;        // Graph line id (Graph::NO_LINE if unknown)
+    int boardStop;   // Station index
+    int boardTime;   // Departure, seconds after midnight
+    int alightStop;
+    int alightTime;  // Arrival
+};
+
+// A timetabled journey, legs in travel order
+struct Journey {
+    int departureTime; // Boarding time of the first leg
+    int arrivalTime;
+    std::vector<JourneyLeg> legs;
+
+    int getTransfers() const { return legs.empty() ? 0 : static_cast<int>(legs.size()) - 1; }
+};
+
+class RaptorContext;
+
+// Scheduled service on the stations of a Graph, with earliest-arrival
+// queries answered by RAPTOR (round-based public transit routing): round k
+// finds the best arrivals using k trips, scanning each route touched by the
+// previous round once, in stop order.
+//
+// A route is a stop sequence shared by all its trips; each direction of a
+// line pattern is its own route. After finalize() everything lives in flat
+// arrays: per-route stop lists, trips sorted by departure with their stop
+// times stored trip after trip, and per-station lists of (route, position).
+// Trips of a route must not overtake each other.
+class Timetable {
+private:
+    int numStations;
+    int transferSeconds;
+
+    // Routes: stops [routeStopOffsets[r], routeStopOffsets[r + 1]) of routeStops
+    std::vector<int> routeLines;
+    std::vector<int> routeStopOffsets;
+    std::vector<int> routeStops;
+
+    // Trips of route r: [routeTripOffsets[r], routeTripOffsets[r + 1]). The
+    // times of stop i on trip t are at tripTimeOffsets[t] + i.
+    std::vector<int> routeTripOffsets;
+    std::vector<int> tripRoutes;
+    std::vector<int> tripTimeOffsets;
+    std::vector<int> arrivals;
+    std::vector<int> departures;
+
+    // Routes serving each station, with the station's position on the route
+    std::vector<int> stationRouteOffsets;
+    std::vector<int> stationRoutes;
+    std::vector<int> stationRoutePositions;
+
+    // Trips as added; finalize() packs them into the arrays above
+    struct TripTimes {
+        int route;
+        std::vector<int> arrivals;
+        std::vector<int> departures;
+    };
+    std::vector<TripTimes> addedTrips;
+    bool finalized;
+
+    // First trip of route leaving stop position on or after time, or -1
+    int earliestTrip(int route, int position, int time) const;
+
+    // Unwind the labels of round into a journey ending at dest
+    void buildJourney(const RaptorContext& context, int round, int dest, Journey& journey) const;
+
+public:
+    // Transfers considered by default (rounds - 1)
+    static const int DEFAULT_MAX_TRANSFERS = 5;
+
+    Timetable();
+
+    // Start an empty timetable on numStations stations
+    void reset(int numStations, int transferSeconds);
+
+    // Add a route visiting stops in order; returns its id
+    int addRoute(int line, const std::vector<int>& stops);
+
+    // Add a trip on route with one arrival and departure per stop
+    void addTrip(int route, const std::vector<int>& tripArrivals, const std::vector<int>& tripDepartures);
+
+    // Sort trips and build the per-station route lists. Must be called
+    // after adding routes and trips and before querying.
+    void finalize();
+
+    // Replace the timetable with a regular service on every line of a
+    // frozen graph. Each line's connections are split into simple paths
+    // and every path is served in both directions.
+    void generate(const Graph& graph, const TimetableOptions& options);
+
+    int getNumRoutes() const { return static_cast<int>(routeLines.size()); }
+    int getNumTrips() const { return static_cast<int>(tripTimeOffsets.size()); }
+    int getNumStopTimes() const { return static_cast<int>(arrivals.size()); }
+    int getTransferSeconds() const { return transferSeconds; }
+
+    // Route accessors (valid after finalize)
+    int getRouteLine(int route) const { return routeLines[route]; }
+    int routeStopBegin(int route) const { return routeStopOffsets[route]; }
+    int routeStopEnd(int route) const { return routeStopOffsets[route + 1]; }
+    int routeStop(int index) const { return routeStops[index]; }
+    int routeTripBegin(int route) const { return routeTripOffsets[route]; }
+    int routeTripEnd(int route) const { return routeTripOffsets[route + 1]; }
+    int getArrival(int trip, int position) const { return arrivals[tripTimeOffsets[trip] + position]; }
+    int getDeparture(int trip, int position) const { return departures[tripTimeOffsets[trip] + position]; }
+
+    // Journeys from src leaving no earlier than departureTime to dest. On
+    // return journeys holds the Pareto set over (arrival, transfers): each
+    // entry arrives strictly earlier than the last and needs more transfers,
+    // so the final one is the earliest arrival. Returns false if dest
+    // cannot be reached within maxTransfers.
+    bool earliestArrival(int src, int dest, int departureTime, std::vector<Journey>& journeys,
+                         int maxTransfers = DEFAULT_MAX_TRANSFERS) const;
+
+    // Same, in the caller's reusable context
+    bool earliestArrival(int src, int dest, int departureTime, std::vector<Journey>& journeys,
+                         int maxTransfers, RaptorContext& context) const;
+};
+
+// Per-round labels of a RAPTOR query, reused between queries. A context
+// must not be shared between threads; use local() for a per-thread instance.
+class RaptorContext {
+private:
+    friend class Timetable;
+
+    int numStations;
+    std::vector<int> arrivals;    // Round-major: arrival at station in round k
+    std::vector<int> legTrips;    // Trip of the last leg (-1 for the origin)
+    std::vector<int> legBoards;   // Boarding position on the trip's route
+    std::vector<int> legAlights;  // Alighting position
+    std::vector<int> legRounds;   // Round the label was set in
+    std::vector<int> best;        // Best arrival over all rounds
+    std::vector<char> marked;     // Improved in the previous round
+    std::vector<int> markedStations;
+    std::vector<int> routeStart;  // Earliest marked position per route (INT_MAX if none)
+    std::vector<int> queuedRoutes;
+
+    void reset(int numStations, int numRoutes, int rounds);
+
+public:
+    RaptorContext();
+
+    // Context owned by the calling thread
+    static RaptorContext& local();
+};
+
+// "HH:MM" <-> seconds after midnight (formatting drops the seconds).
+// parseClockTime returns -1 if malformed.
+int parseClockTime(const std::string& text);
+std::string formatClockTime(int seconds);
+
+#endif // TIMETABLE_H